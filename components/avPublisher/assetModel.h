@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file assetModel.h
+ *
+ * Descriptors of the sensor data published to AirVantage: for each sensor, the
+ * sample members published, and the resource path and type each is published as.
+ *
+ * GENERATED by tools/genAssetModel.py from
+ * mangOH.io.sensortocloud.v3.0.app and sensorMap.txt.  DO NOT EDIT.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ASSET_MODEL_H_INCLUDE_GUARD
+#define ASSET_MODEL_H_INCLUDE_GUARD
+
+
+/// Type of an AirVantage resource.
+typedef enum
+{
+    MODEL_TYPE_INT,
+    MODEL_TYPE_DOUBLE,
+}
+model_Type_t;
+
+
+/// A sensor sample member and the resource it is published to.
+typedef struct
+{
+    const char* member; ///< JSON member name, or NULL if the sample is numeric.
+    const char* path;   ///< AirVantage resource path.
+    model_Type_t type;  ///< Type of the resource.
+}
+model_Field_t;
+
+
+/// A sensor whose samples are published.
+typedef struct
+{
+    const char* name;
+    bool isJson;                ///< true if samples are JSON, false if numeric.
+    size_t numFields;
+    const model_Field_t* fields;
+}
+model_Sensor_t;
+
+
+/// Sensor identifiers (indices into Model_Sensors).
+typedef enum
+{
+    MODEL_SENSOR_ACCEL,
+    MODEL_SENSOR_GYRO,
+    MODEL_SENSOR_LIGHT,
+    MODEL_SENSOR_PRESSURE,
+    MODEL_SENSOR_TEMPERATURE,
+    MODEL_SENSOR_POSITION,
+    MODEL_SENSOR_SHOCK,
+    MODEL_SENSOR_FREEFALL,
+    MODEL_SENSOR_ACCELMAGNITUDE,
+    MODEL_SENSOR_TILT,
+    MODEL_SENSOR_BOARDTEMP,
+    MODEL_SENSOR_LIGHTROLLUP,
+    MODEL_SENSOR_PRESSUREROLLUP,
+    MODEL_SENSOR_TEMPERATUREROLLUP,
+    MODEL_NUM_SENSORS
+}
+model_SensorId_t;
+
+/// Largest number of fields of any sensor.
+#define MODEL_MAX_FIELDS 5
+
+
+static const model_Field_t Model_AccelFields[] =
+{
+    { "x", "MangOH.Sensors.Accelerometer.Acceleration.X", MODEL_TYPE_DOUBLE },
+    { "y", "MangOH.Sensors.Accelerometer.Acceleration.Y", MODEL_TYPE_DOUBLE },
+    { "z", "MangOH.Sensors.Accelerometer.Acceleration.Z", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_GyroFields[] =
+{
+    { "x", "MangOH.Sensors.Accelerometer.Gyro.X", MODEL_TYPE_DOUBLE },
+    { "y", "MangOH.Sensors.Accelerometer.Gyro.Y", MODEL_TYPE_DOUBLE },
+    { "z", "MangOH.Sensors.Accelerometer.Gyro.Z", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_LightFields[] =
+{
+    { NULL, "MangOH.Sensors.Light.Level", MODEL_TYPE_INT },
+};
+
+static const model_Field_t Model_PressureFields[] =
+{
+    { NULL, "MangOH.Sensors.Pressure.Pressure", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_TemperatureFields[] =
+{
+    { NULL, "MangOH.Sensors.Pressure.Temperature", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_PositionFields[] =
+{
+    { "lat", "lwm2m.6.0.0", MODEL_TYPE_DOUBLE },
+    { "lon", "lwm2m.6.0.1", MODEL_TYPE_DOUBLE },
+    { "hAcc", "lwm2m.6.0.3", MODEL_TYPE_DOUBLE },
+    { "alt", "lwm2m.6.0.2", MODEL_TYPE_DOUBLE },
+    { "vAcc", "MangOH.Sensors.GPS.VerticalAccuracy", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_ShockFields[] =
+{
+    { "peak", "MangOH.Sensors.Accelerometer.Shock.Peak", MODEL_TYPE_DOUBLE },
+    { "duration", "MangOH.Sensors.Accelerometer.Shock.Duration", MODEL_TYPE_DOUBLE },
+    { "axis", "MangOH.Sensors.Accelerometer.Shock.Axis", MODEL_TYPE_INT },
+};
+
+static const model_Field_t Model_FreeFallFields[] =
+{
+    { "peak", "MangOH.Sensors.Accelerometer.FreeFall.Peak", MODEL_TYPE_DOUBLE },
+    { "duration", "MangOH.Sensors.Accelerometer.FreeFall.Duration", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_AccelMagnitudeFields[] =
+{
+    { NULL, "MangOH.Sensors.Accelerometer.Acceleration.Magnitude", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_TiltFields[] =
+{
+    { "pitch", "MangOH.Sensors.Accelerometer.Tilt.Pitch", MODEL_TYPE_DOUBLE },
+    { "roll", "MangOH.Sensors.Accelerometer.Tilt.Roll", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_BoardTempFields[] =
+{
+    { NULL, "MangOH.Sensors.Board.Temperature", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_LightRollupFields[] =
+{
+    { "count", "MangOH.Sensors.Light.Rollup.Count", MODEL_TYPE_INT },
+    { "min", "MangOH.Sensors.Light.Rollup.Min", MODEL_TYPE_DOUBLE },
+    { "max", "MangOH.Sensors.Light.Rollup.Max", MODEL_TYPE_DOUBLE },
+    { "mean", "MangOH.Sensors.Light.Rollup.Mean", MODEL_TYPE_DOUBLE },
+    { "last", "MangOH.Sensors.Light.Rollup.Last", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_PressureRollupFields[] =
+{
+    { "count", "MangOH.Sensors.Pressure.PressureRollup.Count", MODEL_TYPE_INT },
+    { "min", "MangOH.Sensors.Pressure.PressureRollup.Min", MODEL_TYPE_DOUBLE },
+    { "max", "MangOH.Sensors.Pressure.PressureRollup.Max", MODEL_TYPE_DOUBLE },
+    { "mean", "MangOH.Sensors.Pressure.PressureRollup.Mean", MODEL_TYPE_DOUBLE },
+    { "last", "MangOH.Sensors.Pressure.PressureRollup.Last", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Field_t Model_TemperatureRollupFields[] =
+{
+    { "count", "MangOH.Sensors.Pressure.TemperatureRollup.Count", MODEL_TYPE_INT },
+    { "min", "MangOH.Sensors.Pressure.TemperatureRollup.Min", MODEL_TYPE_DOUBLE },
+    { "max", "MangOH.Sensors.Pressure.TemperatureRollup.Max", MODEL_TYPE_DOUBLE },
+    { "mean", "MangOH.Sensors.Pressure.TemperatureRollup.Mean", MODEL_TYPE_DOUBLE },
+    { "last", "MangOH.Sensors.Pressure.TemperatureRollup.Last", MODEL_TYPE_DOUBLE },
+};
+
+static const model_Sensor_t Model_Sensors[MODEL_NUM_SENSORS] =
+{
+    [MODEL_SENSOR_ACCEL] = { "accel", true, 3, Model_AccelFields },
+    [MODEL_SENSOR_GYRO] = { "gyro", true, 3, Model_GyroFields },
+    [MODEL_SENSOR_LIGHT] = { "light", false, 1, Model_LightFields },
+    [MODEL_SENSOR_PRESSURE] = { "pressure", false, 1, Model_PressureFields },
+    [MODEL_SENSOR_TEMPERATURE] = { "temperature", false, 1, Model_TemperatureFields },
+    [MODEL_SENSOR_POSITION] = { "position", true, 5, Model_PositionFields },
+    [MODEL_SENSOR_SHOCK] = { "shock", true, 3, Model_ShockFields },
+    [MODEL_SENSOR_FREEFALL] = { "freeFall", true, 2, Model_FreeFallFields },
+    [MODEL_SENSOR_ACCELMAGNITUDE] = { "accelMagnitude", false, 1, Model_AccelMagnitudeFields },
+    [MODEL_SENSOR_TILT] = { "tilt", true, 2, Model_TiltFields },
+    [MODEL_SENSOR_BOARDTEMP] = { "boardTemp", false, 1, Model_BoardTempFields },
+    [MODEL_SENSOR_LIGHTROLLUP] = { "lightRollup", true, 5, Model_LightRollupFields },
+    [MODEL_SENSOR_PRESSUREROLLUP] = { "pressureRollup", true, 5, Model_PressureRollupFields },
+    [MODEL_SENSOR_TEMPERATUREROLLUP] = { "temperatureRollup", true, 5, Model_TemperatureRollupFields },
+};
+
+
+#endif // ASSET_MODEL_H_INCLUDE_GUARD
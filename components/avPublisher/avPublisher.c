@@ -7,8 +7,12 @@
  * Some "settings" and "commands" are provided to AirVantage that allow AirVantage to control
  * some features of the device, such as the on-board LED.
  *
- * Some "variables" are provided to AirVantage that allow AirVantage to read (on-demand) the
- * current values reported by sensors on the mangOH Red (such as the pressure sensor and gyro).
+ * The asset model's "variables" let AirVantage read (on-demand) the current values reported by
+ * the sensors on the mangOH Red (such as the pressure sensor and gyro), so the periodic pushes
+ * can be far apart without losing sight of the device.  Reads are answered from the latest sample
+ * each observation delivered (a last-value cache in the Sensor_t), without reading the sensor or
+ * querying the Data Hub.  The sensors kept on the device (see below) have none, and the Location
+ * object (lwm2m.6) is the positioning service's.
  *
  * Time-series data will be collected from the sensors via the Data Hub and will be pushed to
  * AirVantage on-change.  This allows us to use the Data Hub to do the buffering and queuing
@@ -23,7 +27,49 @@
  *
  * When there's an AirVantage session available, we can immediately push data when it arrives
  * from the Data Hub.  But, if the AV session goes down, then we have to wait until the session
- * comes back up, at which time we read data samples from the Data Hub's buffers and push it.
+ * comes back up, at which time we read data samples from the Data Hub's buffers and push it:
+ * the newest sample first, then the rest, oldest first.  What has been delivered is tracked as time
+ * ranges (see pushTracker.h), so only samples that weren't delivered are pushed again, including
+ * after a restart if the ranges are saved to the DELIVERED_FILE.  Samples are uplinked with
+ * per-sensor sequence numbers, which a sample keeps when its push is retried, so the server can
+ * drop the duplicates of pushes that reached it but were reported failed.  The sequence numbers
+ * also persist to the DELIVERED_FILE; without it, they restart from 1 when the app does.
+ *
+ * If the redStore app is running (see store.api), outages longer than the Data Hub's buffers can
+ * hold don't lose data: samples the buffers dropped are read back from the store instead.  This
+ * is only done for sensors whose observations don't filter samples (no change-by threshold),
+ * since the store keeps every sample.
+ *
+ * The numeric sensors' samples are also rolled up into 1 minute, 1 hour and 1 day buckets (see
+ * rollup.h), from observations of their own without a change-by threshold.  Completed buckets are
+ * pushed to this app's Data Hub inputs (rollup/<sensor>/<tier>) for local apps to use.  The
+ * sensors listed in ROLLUP_UPLINK have the buckets of one tier uplinked instead of their samples,
+ * which then stay on the device.
+ *
+ * Shock and free-fall events detected by redSensor are pushed as soon as they arrive, from
+ * observations without filtering whose buffers hold events through long outages.
+ *
+ * To let the modem sleep between pushes, the samples can instead be uplinked in bulk at scheduled
+ * windows (UPLINK_WINDOW, aligned on the clock), or when a sensor has UPLINK_BACKLOG samples
+ * waiting.  The sensors are then held in their push trackers, and each window flushes them: their
+ * backlogs are pushed as after an outage, in batches if the transport takes them.  Shock and
+ * free-fall events still go right away, and open the window early for the rest, since they wake
+ * the radio anyway.  The pushes and the times they wake the radio are counted per hour.
+ *
+ * The virtual sensors redSensor derives from the others (e.g., the acceleration magnitude and the
+ * board's tilt, see components/sensors/derived) are uplinked if listed in DERIVED_UPLINK.  The
+ * sensors listed in LOCAL_SENSORS aren't uplinked at all, so only what is derived from them
+ * leaves the device.
+ *
+ * How each sensor is reported can also be set from the server, with the LwM2M observe attributes
+ * (pmin, pmax, gt, lt and st) written to the sensor's /Report/<sensor> string setting, e.g.
+ * "pmin=60&st=0.5".  They are translated into its observation's settings in the Data Hub (see
+ * ApplyAttributes()), so a sample is only sent when the server wants it.
+ *
+ * At start, the AirVantage session is requested before anything else, so that it comes up while
+ * the observation graph (the Observations table, the rollups and the virtual sensors) is set up
+ * in the Data Hub.  The history store is only connected once startup is done.  The startup's
+ * phases and the session's time to come up are logged.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -31,7 +77,11 @@
 
 #include "legato.h"
 #include "interfaces.h"
-#include "json.h"
+#include "sampleCodec.h"
+#include "pushTracker.h"
+#include "assetModel.h"
+#include "uplink.h"
+#include "rollup.h"
 
 
 //--------------------------------------------------------------------------------------------------
@@ -57,6 +107,7 @@
 #define PRESSURE_BUFFER_COUNT 100
 #define TEMP_BUFFER_COUNT 100
 #define POS_BUFFER_COUNT 100
+#define EVENT_BUFFER_COUNT 200
 
 // Change-by thresholds:
 
@@ -64,6 +115,46 @@
 #define PRESSURE_CHANGE_BY 1.0 // kPa
 #define TEMP_CHANGE_BY 2.0  // degC
 
+// Rollups, uplinked instead of the samples for the sensors listed in the ROLLUP_UPLINK
+// environment variable, with the tier of each, e.g., "light=hour,pressure=minute".
+
+#define ROLLUP_UPLINK_ENV_VAR "ROLLUP_UPLINK"
+#define ROLLUP_BUFFER_COUNT 100
+#define ROLLUP_INPUT_PREFIX "rollup/"           // Data Hub inputs, relative to this app.
+#define ROLLUP_APP_PATH "/app/redCloud/"        // This app's Data Hub namespace.
+#define ROLLUP_CLOSE_DELAY 30  // seconds after its end that a bucket is complete without samples
+
+// Virtual sensors uplinked (see DERIVED_UPLINK in redCloud.adef), and sensors whose samples stay
+// on the device (LOCAL_SENSORS), as comma-separated lists of sensor names.
+
+#define DERIVED_UPLINK_ENV_VAR "DERIVED_UPLINK"
+#define LOCAL_SENSORS_ENV_VAR "LOCAL_SENSORS"
+#define DERIVED_BUFFER_COUNT 100
+
+// File the sensors' delivered time ranges and sequence numbers persist to (see pushTracker.h), so
+// that a restart neither pushes again what was delivered before it nor reuses sequence numbers.
+// Not set: nothing is loaded or saved.
+
+#define DELIVERED_FILE_ENV_VAR "DELIVERED_FILE"
+#define DELIVERED_SAVE_INTERVAL 60 // seconds between saves, at most, to spare the flash
+
+// Uplink windows: with UPLINK_WINDOW set (seconds), samples wait in the Data Hub's buffers and are
+// uplinked in bulk at multiples of it on the clock, or as soon as a sensor has UPLINK_BACKLOG of
+// them waiting.  A window is skipped if another opened less than half a window before it.  Not
+// set or 0: samples are pushed as they arrive.
+
+#define UPLINK_WINDOW_ENV_VAR "UPLINK_WINDOW"
+#define UPLINK_BACKLOG_ENV_VAR "UPLINK_BACKLOG"
+#define DEFAULT_UPLINK_BACKLOG 90 // samples, short of the 100 the buffers hold
+
+// Radio activity, counted per hour and pushed to this app's Data Hub inputs (uplink/pushes and
+// uplink/radioWakeups).  A push wakes the radio if it starts more than RADIO_TAIL after the
+// radio's last push ended, which is about when a cellular modem goes back to idle.
+
+#define UPLINK_STATS_INPUT_PREFIX "uplink/"
+#define UPLINK_STATS_INTERVAL 3600 // seconds
+#define RADIO_TAIL 10 // seconds
+
 // Data Hub Observation resource paths:
 
 #define ACCEL_OBS_PATH "/obs/accel"
@@ -72,6 +163,8 @@
 #define PRESSURE_OBS_PATH "/obs/pressure"
 #define TEMP_OBS_PATH "/obs/temperature"
 #define POS_OBS_PATH "/obs/position"
+#define SHOCK_OBS_PATH "/obs/shock"
+#define FREE_FALL_OBS_PATH "/obs/freeFall"
 
 // Data Hub sensor Input resource paths:
 
@@ -81,6 +174,37 @@
 #define POS_SENSOR_INPUT_PATH       "/app/redSensor/position/value"
 #define PRESSURE_SENSOR_INPUT_PATH  "/app/redSensor/pressure/value"
 #define TEMP_SENSOR_INPUT_PATH      "/app/redSensor/pressure/temp/value"
+#define SHOCK_INPUT_PATH            "/app/redSensor/accel/shock/value"
+#define FREE_FALL_INPUT_PATH        "/app/redSensor/accel/freeFall/value"
+#define ACCEL_MAGNITUDE_INPUT_PATH  "/app/redSensor/derived/accelMagnitude/value"
+#define TILT_INPUT_PATH             "/app/redSensor/derived/tilt/value"
+#define BOARD_TEMP_INPUT_PATH       "/app/redSensor/derived/boardTemp/value"
+
+// Uplink transport, selected by the UPLINK_TRANSPORT environment variable (see uplink.h):
+// "avdata" (default), "avdata-senml" or "mqtt".
+
+#define UPLINK_TRANSPORT_ENV_VAR "UPLINK_TRANSPORT"
+#define DEFAULT_UPLINK_TRANSPORT "avdata"
+
+// Longest rollup JSON sample (see HandleRollupComplete()).
+#define ROLLUP_MAX_JSON_LEN 127
+
+// Largest JSON sample added to a batch from the backlog.  Longer ones are pushed on their own.
+#define BATCH_MAX_JSON_LEN 255
+
+// Settings the server writes each sensor's LwM2M observe attributes to, e.g., "pmin=10&st=0.5"
+// (see ApplyAttributes()), at REPORT_SETTING_PREFIX<sensor name>.
+
+#define REPORT_SETTING_PREFIX "/Report/"
+#define MAX_ATTRIBUTES_LEN 127
+#define MAX_ATTRIBUTE_PERIOD (30 * 24 * 3600) // seconds; pmax in ms must fit a timer's uint32_t
+
+// Most AirVantage variables read from the sensors' latest samples (one per descriptor field).
+#define MAX_VARIABLES 64
+
+// Store samples less than this much older than a Data Hub sample are taken to be the same sample
+// (the store keeps timestamps to the microsecond).
+#define STORE_SAME_SAMPLE_MARGIN 0.000001 // seconds
 
 
 //--------------------------------------------------------------------------------------------------
@@ -104,24 +228,48 @@
  */
 //--------------------------------------------------------------------------------------------------
 
-/// Structure that holds variables needed to manage one sensor's data.
+/// LwM2M observe attributes the server set for a sensor.
 typedef struct
 {
-    const char* obsPath; ///< String containing Data Hub observation path to fetch data from.
-    double lastDeliveredTimestamp; ///< Timestamp of newest sample successfully delivered to cloud.
-    double timestamp; ///< Timestamp of sample we are trying to push to the cloud.
-    enum
-    {
-        SENSOR_STATE_IDLE,      ///< No data to send.
-        SENSOR_STATE_PUSHING,   ///< Sending data to the cloud.
-        SENSOR_STATE_BACKLOGGED,///< Sending data to the cloud and more data waiting to be sent.
-        SENSOR_STATE_FAULT,     ///< Failed to push data.
+    double pmin;                        ///< Shortest time between reports (s), or 0.
+    double pmax;                        ///< Longest time between reports (s), or 0.
+    double gt;                          ///< Report values above this, or NAN.
+    double lt;                          ///< Report values below this, or NAN.
+    double step;                        ///< Smallest change reported, or NAN for the default.
+}
+Attributes_t;
 
-    } state; ///< State of the sensor.
+
+/// Structure that holds variables needed to manage one sensor's data.
+typedef struct
+{
+    tracker_Sensor_t tracker;           ///< Cloud push tracking record.
+    const model_Sensor_t* modelPtr;     ///< What is published to AirVantage, and where.
+    uplink_Sensor_t uplink;             ///< The sensor, as the uplink transport knows it.
+    bool isFiltered;                    ///< The observation filters samples (e.g., change-by).
+    bool isLocal;                       ///< Its samples aren't uplinked (e.g., its rollups are).
+    bool isBackfilled;                  ///< Samples the Data Hub dropped are read from the store.
+    bool isPriority;                    ///< Pushed as it arrives, even between uplink windows.
+    unsigned int numHeld;               ///< Samples waiting for the next uplink window.
+    size_t storeColumns[MODEL_MAX_FIELDS]; ///< Store column of each descriptor field.
+    double lastTimestamp;               ///< Timestamp of the latest sample, or 0 if none yet.
+    double lastValues[MODEL_MAX_FIELDS]; ///< Descriptor field values of the latest sample.
+    double defaultChangeBy;             ///< Change-by threshold without attributes, or 0.
+    Attributes_t attributes;            ///< Observe attributes set by the server.
+    le_timer_Ref_t pmaxTimer;           ///< Reports the latest sample again at pmax, or NULL.
 }
 Sensor_t;
 
 
+/// An AirVantage variable, read from a descriptor field of a sensor's latest sample.
+typedef struct
+{
+    const Sensor_t* sensorPtr;
+    size_t field;                       ///< Index of the descriptor field.
+}
+Variable_t;
+
+
 //--------------------------------------------------------------------------------------------------
 /*
  * variable definitions
@@ -131,750 +279,999 @@ Sensor_t;
 /// True if the AirVantage session is active.  False if not.
 static bool IsAvSessionActive = false;
 
+/// Transport the samples are pushed through.
+static const uplink_Transport_t* Transport;
+
+/// True if connected to the history store.
+static bool IsStoreConnected = false;
+
+/// AirVantage variables created so far.
+static Variable_t Variables[MAX_VARIABLES];
+static size_t NumVariables = 0;
+
+/// File the delivered time ranges persist to, or NULL.
+static const char* DeliveredFilePath = NULL;
+
+/// true if a sensor's delivered time ranges changed since they were saved.
+static bool IsDeliveredDirty = false;
+
+/// Timer limiting how often the delivered time ranges are saved.
+static le_timer_Ref_t DeliveredSaveTimer;
+
+/// Time between uplink windows (s), or 0 if samples are pushed as they arrive.
+static int UplinkWindow = 0;
+
+/// Samples a sensor has waiting that open an uplink window early.
+static int UplinkBacklog = DEFAULT_UPLINK_BACKLOG;
+
+/// Timer opening the uplink windows.
+static le_timer_Ref_t UplinkWindowTimer;
+
+/// Radio activity: pushes in progress, end of the last one (seconds since boot), and pushes and
+/// radio wakeups since the last report.
+static unsigned int NumPushesInFlight = 0;
+static double LastPushEndTime = -RADIO_TAIL;
+static unsigned int NumPushes = 0;
+static unsigned int NumRadioWakeups = 0;
+
+/// Startup timing (seconds since boot), reported once the AirVantage session starts.
+static double StartTime;                ///< COMPONENT_INIT entered.
+static double SessionRequestTime;       ///< AirVantage session requested.
+static double ReadyTime;                ///< Data Hub graph set up.
+static bool IsStartupReported = false;
+
+
+static le_result_t PushNumeric(tracker_Sensor_t* sensorPtr, double timestamp, double value);
+static le_result_t PushJson(tracker_Sensor_t* sensorPtr, double timestamp, const char* value);
+static le_result_t ReadBacklogNumeric(tracker_Sensor_t* sensorPtr,
+                                      double startAfter,
+                                      double* timestampPtr,
+                                      double* valuePtr);
+static le_result_t ReadBacklogJson(tracker_Sensor_t* sensorPtr,
+                                   double startAfter,
+                                   double* timestampPtr,
+                                   char* valuePtr,
+                                   size_t valueSize);
+static void CreateReportSetting(Sensor_t* sensorPtr, double defaultChangeBy);
+
+/// Push tracking backend that pushes to AirVantage and reads the backlog from the Data Hub.
+static const tracker_Backend_t AvBackend = {
+    .pushNumeric=PushNumeric,
+    .pushJson=PushJson,
+    .readBacklogNumeric=ReadBacklogNumeric,
+    .readBacklogJson=ReadBacklogJson,
+};
+
 
 /// Cloud push tracking record for the accelerometer.
 static Sensor_t Accelerometer = {
-    .obsPath=ACCEL_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=ACCEL_OBS_PATH,
+        .isJson=true,
+        .maxJsonLen=CODEC_XYZ_MAX_LEN,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_ACCEL],
 };
 
 /// Cloud push tracking record for the gyroscope.
 static Sensor_t Gyroscope = {
-    .obsPath=GYRO_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=GYRO_OBS_PATH,
+        .isJson=true,
+        .maxJsonLen=CODEC_XYZ_MAX_LEN,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_GYRO],
 };
 
 /// Cloud push tracking record for the light level.
 static Sensor_t LightSensor = {
-    .obsPath=LIGHT_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=LIGHT_OBS_PATH,
+        .isJson=false,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_LIGHT],
 };
 
 /// Cloud push tracking record for the pressure.
 static Sensor_t PressureSensor = {
-    .obsPath=PRESSURE_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=PRESSURE_OBS_PATH,
+        .isJson=false,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_PRESSURE],
 };
 
 /// Cloud push tracking record for the temperature.
 static Sensor_t Thermometer = {
-    .obsPath=TEMP_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=TEMP_OBS_PATH,
+        .isJson=false,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_TEMPERATURE],
 };
 
 /// Cloud push tracking record for the position.
 static Sensor_t PositionSensor = {
-    .obsPath=POS_OBS_PATH,
-    .lastDeliveredTimestamp=0,
-    .timestamp=0,
-    .state=SENSOR_STATE_IDLE,
+    .tracker={
+        .obsPath=POS_OBS_PATH,
+        .isJson=true,
+        .maxJsonLen=CODEC_POSITION_MAX_LEN,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_POSITION],
 };
 
+/// Cloud push tracking record for the shock events.
+static Sensor_t ShockSensor = {
+    .tracker={
+        .obsPath=SHOCK_OBS_PATH,
+        .isJson=true,
+        .maxJsonLen=CODEC_SHOCK_MAX_LEN,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_SHOCK],
+    .isPriority=true,
+};
 
-//--------------------------------------------------------------------------------------------------
-/*
- * static function definitions
- */
-//--------------------------------------------------------------------------------------------------
+/// Cloud push tracking record for the free-fall events.
+static Sensor_t FreeFallSensor = {
+    .tracker={
+        .obsPath=FREE_FALL_OBS_PATH,
+        .isJson=true,
+        .maxJsonLen=CODEC_FREE_FALL_MAX_LEN,
+        .backendPtr=&AvBackend,
+        .timestamp=0,
+        .state=TRACKER_STATE_IDLE,
+    },
+    .modelPtr=&Model_Sensors[MODEL_SENSOR_FREEFALL],
+    .isPriority=true,
+};
 
+/// An observation of a redSensor sensor, and how the sensor and observation are configured.
+typedef struct
+{
+    Sensor_t* sensorPtr;
+    const char* inputPath;              ///< Data Hub input of the sensor's samples.
+    unsigned int bufferMaxCount;
+    double changeBy;                    ///< Change-by threshold, or 0 for none.
+    double period;                      ///< Sensor's polling period (s), or 0 for event sources.
+}
+Observation_t;
 
-static void PushBacklog(Sensor_t* sensorPtr);
+/// Observation graph of all the sensors published, set up in one pass at start.
+static const Observation_t Observations[] = {
+    {
+        .sensorPtr=&Accelerometer,
+        .inputPath=ACCEL_SENSOR_INPUT_PATH,
+        .bufferMaxCount=ACCEL_BUFFER_COUNT,
+        .period=ACCEL_PERIOD,
+    },
+    {
+        .sensorPtr=&Gyroscope,
+        .inputPath=GYRO_SENSOR_INPUT_PATH,
+        .bufferMaxCount=GYRO_BUFFER_COUNT,
+        .period=GYRO_PERIOD,
+    },
+    {
+        .sensorPtr=&LightSensor,
+        .inputPath=LIGHT_SENSOR_INPUT_PATH,
+        .bufferMaxCount=LIGHT_BUFFER_COUNT,
+        .changeBy=LIGHT_CHANGE_BY,
+        .period=LIGHT_PERIOD,
+    },
+    {
+        .sensorPtr=&PressureSensor,
+        .inputPath=PRESSURE_SENSOR_INPUT_PATH,
+        .bufferMaxCount=PRESSURE_BUFFER_COUNT,
+        .changeBy=PRESSURE_CHANGE_BY,
+        .period=PRESSURE_PERIOD,
+    },
+    {
+        .sensorPtr=&Thermometer,
+        .inputPath=TEMP_SENSOR_INPUT_PATH,
+        .bufferMaxCount=TEMP_BUFFER_COUNT,
+        .changeBy=TEMP_CHANGE_BY,
+        .period=TEMP_PERIOD,
+    },
+    {
+        .sensorPtr=&PositionSensor,
+        .inputPath=POS_SENSOR_INPUT_PATH,
+        .bufferMaxCount=POS_BUFFER_COUNT,
+        .period=POS_PERIOD,
+    },
+    {
+        .sensorPtr=&ShockSensor,
+        .inputPath=SHOCK_INPUT_PATH,
+        .bufferMaxCount=EVENT_BUFFER_COUNT,
+    },
+    {
+        .sensorPtr=&FreeFallSensor,
+        .inputPath=FREE_FALL_INPUT_PATH,
+        .bufferMaxCount=EVENT_BUFFER_COUNT,
+    },
+};
 
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Handles notification of AirVantage time-series push status.
- */
-//--------------------------------------------------------------------------------------------------
-static void HandleAvPushComplete
-(
-    le_avdata_PushStatus_t status, ///< Push success/failure status
-    void* context                  ///< Not used
-)
+/// A virtual sensor derived by redSensor.
+typedef struct
 {
-    Sensor_t* sensorPtr = context;
+    const char* inputPath;              ///< Data Hub input of its samples.
+    bool isUplinked;
+    Sensor_t sensor;
+}
+Derived_t;
 
-    switch (status)
+/// Virtual sensors, uplinked if listed in DERIVED_UPLINK.
+static Derived_t DerivedSensors[] = {
     {
-        case LE_AVDATA_PUSH_SUCCESS:
-
-            // Remember the timestamp we last successfully delivered.
-            sensorPtr->lastDeliveredTimestamp = sensorPtr->timestamp;
+        .inputPath=ACCEL_MAGNITUDE_INPUT_PATH,
+        .sensor={
+            .tracker={
+                .obsPath="/obs/accelMagnitude",
+                .isJson=false,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_ACCELMAGNITUDE],
+        },
+    },
+    {
+        .inputPath=TILT_INPUT_PATH,
+        .sensor={
+            .tracker={
+                .obsPath="/obs/tilt",
+                .isJson=true,
+                .maxJsonLen=CODEC_TILT_MAX_LEN,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_TILT],
+        },
+    },
+    {
+        .inputPath=BOARD_TEMP_INPUT_PATH,
+        .sensor={
+            .tracker={
+                .obsPath="/obs/boardTemp",
+                .isJson=false,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_BOARDTEMP],
+        },
+    },
+};
 
-            // If there's more data to push, push it now.
-            if (sensorPtr->state == SENSOR_STATE_BACKLOGGED)
-            {
-                PushBacklog(sensorPtr);
-            }
 
-            return;
+/// Rollups of a numeric sensor.
+typedef struct
+{
+    Sensor_t* sensorPtr;                ///< Sensor rolled up.
+    const char* inputPath;              ///< Data Hub input of the sensor's samples.
+    const char* feedObsPath;            ///< Observation of all the sensor's samples.
+    rollup_Series_t series;
+    bool isUplinked;                    ///< A tier is uplinked instead of the sensor's samples.
+    rollup_Tier_t uplinkTier;           ///< Tier uplinked.
+    Sensor_t uplink;                    ///< Cloud push tracking record of the tier uplinked.
+}
+Rollup_t;
 
-        case LE_AVDATA_PUSH_FAILED:
+/// Rollups of each numeric sensor.
+static Rollup_t Rollups[] = {
+    {
+        .sensorPtr=&LightSensor,
+        .inputPath=LIGHT_SENSOR_INPUT_PATH,
+        .feedObsPath="/obs/lightFeed",
+        .uplink={
+            .tracker={
+                .obsPath="/obs/lightRollup",
+                .isJson=true,
+                .maxJsonLen=ROLLUP_MAX_JSON_LEN,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_LIGHTROLLUP],
+        },
+    },
+    {
+        .sensorPtr=&PressureSensor,
+        .inputPath=PRESSURE_SENSOR_INPUT_PATH,
+        .feedObsPath="/obs/pressureFeed",
+        .uplink={
+            .tracker={
+                .obsPath="/obs/pressureRollup",
+                .isJson=true,
+                .maxJsonLen=ROLLUP_MAX_JSON_LEN,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_PRESSUREROLLUP],
+        },
+    },
+    {
+        .sensorPtr=&Thermometer,
+        .inputPath=TEMP_SENSOR_INPUT_PATH,
+        .feedObsPath="/obs/temperatureFeed",
+        .uplink={
+            .tracker={
+                .obsPath="/obs/temperatureRollup",
+                .isJson=true,
+                .maxJsonLen=ROLLUP_MAX_JSON_LEN,
+                .backendPtr=&AvBackend,
+                .timestamp=0,
+                .state=TRACKER_STATE_IDLE,
+            },
+            .modelPtr=&Model_Sensors[MODEL_SENSOR_TEMPERATUREROLLUP],
+        },
+    },
+};
 
-            LE_WARN("Push to AirVantage failed (%s). Retrying...", sensorPtr->obsPath);
 
-            // Try this one again.
-            PushBacklog(sensorPtr);
+/// Push tracking records of all the sensors that can be uplinked, whose delivered time ranges
+/// persist.
+static tracker_Sensor_t* TrackedSensors[NUM_ARRAY_MEMBERS(Observations)
+                                        + NUM_ARRAY_MEMBERS(DerivedSensors)
+                                        + NUM_ARRAY_MEMBERS(Rollups)];
 
-            return;
-    }
 
-    LE_FATAL("Unexpected push result status %d (%s).", status, sensorPtr->obsPath);
-}
+//--------------------------------------------------------------------------------------------------
+/*
+ * static function definitions
+ */
+//--------------------------------------------------------------------------------------------------
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records a light sensor reading into an avdata record and pushes it.
+ * Get the time since boot.
  *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ * @return Seconds.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushLightLevel
+static double GetUptime
 (
-    double timestamp,
-    double value
+    void
 )
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    le_clk_Time_t now = le_clk_GetRelativeTime();
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
 
-    const char *path = "MangOH.Sensors.Light.Level";
 
-    le_result_t result = le_avdata_RecordInt(rec, path, (int32_t)value, ms);
-    if (result != LE_OK)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save the sensors' delivered time ranges and sequence numbers if they changed.
+ *
+ * @return LE_OK if they are saved, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SaveDelivered
+(
+    void
+)
+{
+    if (!IsDeliveredDirty)
     {
-        LE_ERROR("Couldn't record light sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        return LE_OK;
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &LightSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    if (tracker_Save(TrackedSensors, NUM_ARRAY_MEMBERS(TrackedSensors), DeliveredFilePath) != LE_OK)
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        LE_ERROR("Couldn't save delivered ranges to '%s' (%m).", DeliveredFilePath);
+        return LE_FAULT;
     }
 
-done:
-
-    le_avdata_DeleteRecord(rec);
+    IsDeliveredDirty = false;
 
-    return result;
+    return LE_OK;
 }
 
+
 //--------------------------------------------------------------------------------------------------
 /**
- * Records a pressure sensor reading into an avdata record and pushes it.
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ * Save the sensors' delivered time ranges if they changed, at most once a save interval.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushPressure
+static void HandleDeliveredSaveTimer
 (
-    double timestamp,
-    double value
+    le_timer_Ref_t timer
 )
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    (void)SaveDelivered();
+}
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
 
-    const char *path = "MangOH.Sensors.Pressure.Pressure";
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handles notification of uplink push status.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePushComplete
+(
+    bool isSuccess,
+    void* context   ///< Pointer to the tracker_Sensor_t object of the sensor.
+)
+{
+    NumPushesInFlight--;
+    LastPushEndTime = GetUptime();
 
-    le_result_t result = le_avdata_RecordFloat(rec, path, value, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record pressure sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+    tracker_HandlePushComplete(context, isSuccess);
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &PressureSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    // What was acknowledged is saved now, or at the end of the save interval if a save was
+    // made less than that ago.
+    if (isSuccess && (DeliveredFilePath != NULL))
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        IsDeliveredDirty = true;
+        if (!le_timer_IsRunning(DeliveredSaveTimer))
+        {
+            HandleDeliveredSaveTimer(DeliveredSaveTimer);
+            le_timer_Start(DeliveredSaveTimer);
+        }
     }
+}
 
-done:
 
-    le_avdata_DeleteRecord(rec);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a push that was started, and whether it woke the radio.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountPush
+(
+    void
+)
+{
+    if ((NumPushesInFlight == 0) && ((GetUptime() - LastPushEndTime) > RADIO_TAIL))
+    {
+        NumRadioWakeups++;
+    }
 
-    return result;
+    NumPushes++;
+    NumPushesInFlight++;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records a temperature reading into an avdata record and pushes it.
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ * Push what a sensor has waiting for the uplink window.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushTemperature
+static void FlushSensor
 (
-    double timestamp,
-    double value
+    Sensor_t* sensorPtr
 )
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    sensorPtr->numHeld = 0;
+    tracker_Flush(&sensorPtr->tracker);
+}
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
 
-    const char *path = "MangOH.Sensors.Pressure.Temperature";
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedule the next uplink window at a multiple of the window on the clock, so the windows stay
+ * aligned however long one takes, but at least half a window from now, so one opened early isn't
+ * followed by another right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScheduleUplinkWindow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+    long ms = ((long)(UplinkWindow - (now.sec % UplinkWindow)) * 1000) - (now.usec / 1000);
 
-    le_result_t result = le_avdata_RecordFloat(rec, path, value, ms);
-    if (result != LE_OK)
+    if (ms < (UplinkWindow * 500L))
     {
-        LE_ERROR("Couldn't record pressure sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        ms += UplinkWindow * 1000L;
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Thermometer);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
-    }
+    le_timer_Stop(UplinkWindowTimer);
+    le_timer_SetMsInterval(UplinkWindowTimer, (uint32_t)ms);
+    le_timer_Start(UplinkWindowTimer);
+}
 
-done:
 
-    le_avdata_DeleteRecord(rec);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open an uplink window: push what all the sensors have waiting, and schedule the next window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenUplinkWindow
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(TrackedSensors); i++)
+    {
+        FlushSensor(CONTAINER_OF(TrackedSensors[i], Sensor_t, tracker));
+    }
 
-    return result;
+    ScheduleUplinkWindow();
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Extract a numerical member from a JSON structure.
- *
- * @return The number, or NAN if failed (check using isnan()) .
+ * Open the uplink window due.
  */
 //--------------------------------------------------------------------------------------------------
-static double ExtractNumber
+static void HandleUplinkWindowTimer
 (
-    const char* json,
-    const char* memberName
+    le_timer_Ref_t timer
 )
 {
-    char member[32];
-    json_DataType_t dataType;
+    OpenUplinkWindow();
+}
 
-    le_result_t result = json_Extract(member, sizeof(member), json, memberName, &dataType);
 
-    if (result != LE_OK)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open an uplink window early if a sensor's update calls for it: a priority event (which wakes the
+ * radio anyway), or a backlog that the Data Hub's buffer would soon drop samples of.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckUplinkWindow
+(
+    Sensor_t* sensorPtr
+)
+{
+    if (UplinkWindow == 0)
     {
-        LE_ERROR("'%s' not found in JSON value '%s'.", memberName, json);
-        return NAN;
+        return;
     }
 
-    if (dataType != JSON_TYPE_NUMBER)
+    if (sensorPtr->isPriority)
     {
-        LE_ERROR("'%s' has wrong data type (%s) in JSON value '%s'.",
-                 memberName,
-                 json_GetDataTypeName(dataType),
-                 json);
-        return NAN;
+        LE_DEBUG("Opening uplink window for %s.", sensorPtr->modelPtr->name);
+        OpenUplinkWindow();
     }
-
-    double number = json_ConvertToNumber(member);
-
-    if (isnan(number))
+    else if (   (sensorPtr->tracker.state == TRACKER_STATE_HELD)
+             && (++sensorPtr->numHeld >= (unsigned int)UplinkBacklog))
     {
-        LE_CRIT("Unable to convert '%s' to a number! (member '%s' of '%s')",
-                member,
-                memberName,
-                json);
+        LE_DEBUG("Opening uplink window for %u samples of %s.",
+                 sensorPtr->numHeld,
+                 sensorPtr->modelPtr->name);
+        OpenUplinkWindow();
     }
-
-    return number;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records an accelerometer reading into an avdata record and pushes it.
+ * Extracts the values of a sensor sample's descriptor fields.
  *
- * The JSON value is expected to look like this:
+ * JSON samples are expected to have a numeric member for each descriptor field, for example:
  *
  * {"x":-1.094340, "y":0.085514, "z":9.778496}
  *
  * @return
  *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ *      - LE_FORMAT_ERROR if a JSON sample is missing a member or has a non-numeric one
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushAcceleration
+static le_result_t ExtractValues
 (
-    double timestamp,
-    const char* value   ///< JSON string.
+    const Sensor_t* sensorPtr,
+    double numericValue,    ///< Value of a numeric sample (ignored for JSON samples).
+    const char* jsonValue,  ///< Value of a JSON sample, or NULL for a numeric sample.
+    double values[MODEL_MAX_FIELDS] ///< [OUT]
 )
 {
-    double x = ExtractNumber(value, "x");
-    if (isnan(x))
-    {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
-    }
-
-    double y = ExtractNumber(value, "y");
-    if (isnan(y))
-    {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
-    }
+    const model_Sensor_t* modelPtr = sensorPtr->modelPtr;
 
-    double z = ExtractNumber(value, "z");
-    if (isnan(z))
+    for (size_t i = 0; i < modelPtr->numFields; i++)
     {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
+        if (jsonValue == NULL)
+        {
+            values[i] = numericValue;
+        }
+        else
+        {
+            values[i] = codec_ExtractNumber(jsonValue, modelPtr->fields[i].member);
+            if (isnan(values[i]))
+            {
+                return LE_FORMAT_ERROR;
+            }
+        }
     }
 
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
-
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
-
-    // The '_' is a placeholder that will be replaced
-    static char path[] = "MangOH.Sensors.Accelerometer.Acceleration._";
+    return LE_OK;
+}
 
-    le_result_t result;
 
-    path[sizeof(path) - 2] = 'X';
-    result = le_avdata_RecordFloat(rec, path, x, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record accelerometer x reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
 
-    path[sizeof(path) - 2] = 'Y';
-    result = le_avdata_RecordFloat(rec, path, y, ms);
-    if (result != LE_OK)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the oldest sample of a sensor from the history store that is newer than a given timestamp
+ * and older than the oldest sample the Data Hub still has buffered, i.e., one the Data Hub's
+ * buffer has dropped.
+ *
+ * @return
+ *      - LE_OK if found
+ *      - LE_NOT_FOUND if there is none (or the store isn't used for the sensor).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadStoreGap
+(
+    const Sensor_t* sensorPtr,
+    double startAfter,
+    double bufferedTimestamp,       ///< Timestamp of the Data Hub's oldest sample after startAfter.
+    double* timestampPtr,           ///< [OUT]
+    double values[MODEL_MAX_FIELDS] ///< [OUT]
+)
+{
+    double timestamps[1];
+    double storeValues[STORE_MAX_COLUMNS];
+    size_t timestampsSize = NUM_ARRAY_MEMBERS(timestamps);
+    size_t valuesSize = NUM_ARRAY_MEMBERS(storeValues);
+
+    // Until something has been delivered (e.g., just after starting), there's no gap to fill:
+    // whatever the Data Hub has buffered is all that gets sent.
+    if (   (!sensorPtr->isBackfilled)
+        || (startAfter <= 0.0)
+        || ((bufferedTimestamp - startAfter) <= STORE_SAME_SAMPLE_MARGIN))
     {
-        LE_ERROR("Couldn't record accelerometer y reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        return LE_NOT_FOUND;
     }
 
-    path[sizeof(path) - 2] = 'Z';
-    result = le_avdata_RecordFloat(rec, path, z, ms);
-    if (result != LE_OK)
+    le_result_t result = store_Query(sensorPtr->modelPtr->name,
+                                     startAfter,
+                                     bufferedTimestamp - STORE_SAME_SAMPLE_MARGIN,
+                                     0.0,
+                                     timestamps,
+                                     &timestampsSize,
+                                     storeValues,
+                                     &valuesSize);
+    if ((result != LE_OK) || (timestampsSize == 0))
     {
-        LE_ERROR("Couldn't record accelerometer z reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        return LE_NOT_FOUND;
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Accelerometer);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    *timestampPtr = timestamps[0];
+    for (size_t i = 0; i < sensorPtr->modelPtr->numFields; i++)
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        values[i] = storeValues[sensorPtr->storeColumns[i]];
     }
 
-done:
-
-    le_avdata_DeleteRecord(rec);
+    LE_DEBUG("Backfilling %s sample at %lf from the store.",
+             sensorPtr->modelPtr->name,
+             timestamps[0]);
 
-    return result;
+    return LE_OK;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records an angular velocity (gyro) reading into an avdata record and pushes it.
- *
- * The JSON value is expected to look like this:
+ * Encodes a sensor's descriptor field values as a JSON sample, e.g.:
  *
- * {"x":-0.008520, "y":-0.006390, "z":-0.007455}
+ * {"x":-1.094340,"y":0.085514,"z":9.778496}
  *
  * @return
  *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ *      - LE_OVERFLOW if the buffer is too small
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushAngularVelocity
+static le_result_t EncodeValues
 (
-    double timestamp,
-    const char* value   ///< JSON string.
+    const Sensor_t* sensorPtr,
+    const double values[MODEL_MAX_FIELDS],
+    char* buffPtr,
+    size_t buffSize
 )
 {
-    double x = ExtractNumber(value, "x");
-    if (isnan(x))
-    {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
-    }
-
-    double y = ExtractNumber(value, "y");
-    if (isnan(y))
-    {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
-    }
+    const model_Sensor_t* modelPtr = sensorPtr->modelPtr;
+    size_t len = 0;
 
-    double z = ExtractNumber(value, "z");
-    if (isnan(z))
+    for (size_t i = 0; i < modelPtr->numFields; i++)
     {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
+        len += snprintf(buffPtr + len,
+                        (len < buffSize) ? (buffSize - len) : 0,
+                        "%s\"%s\":%lf",
+                        (i == 0) ? "{" : ",",
+                        modelPtr->fields[i].member,
+                        values[i]);
     }
+    len += snprintf(buffPtr + len, (len < buffSize) ? (buffSize - len) : 0, "}");
 
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    return (len < buffSize) ? LE_OK : LE_OVERFLOW;
+}
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
 
-    // The '_' is a placeholder that will be replaced
-    char path[] = "MangOH.Sensors.Accelerometer.Gyro._";
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reads the oldest buffered sample of a sensor newer than a given timestamp, and extracts its
+ * descriptor field values.
+ *
+ * @return
+ *      - LE_OK if found
+ *      - LE_NOT_FOUND if there is none
+ *      - LE_OVERFLOW if it is a JSON sample longer than BATCH_MAX_JSON_LEN
+ *      - LE_FORMAT_ERROR if it is malformed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadNextValues
+(
+    const Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,           ///< [OUT]
+    double values[MODEL_MAX_FIELDS] ///< [OUT]
+)
+{
+    const char* obsPath = sensorPtr->tracker.obsPath;
     le_result_t result;
 
-    path[sizeof(path) - 2] = 'X';
-    result = le_avdata_RecordFloat(rec, path, x, ms);
-    if (result != LE_OK)
+    if (sensorPtr->tracker.isJson)
     {
-        LE_ERROR("Couldn't record gyro x reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+        char json[BATCH_MAX_JSON_LEN + 1];
 
-    path[sizeof(path) - 2] = 'Y';
-    result = le_avdata_RecordFloat(rec, path, y, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record gyro y reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        result = dhubQuery_ReadBufferSampleJson(obsPath,
+                                                startAfter,
+                                                timestampPtr,
+                                                json,
+                                                sizeof(json));
+        if (result == LE_OK)
+        {
+            result = ExtractValues(sensorPtr, 0.0, json, values);
+        }
     }
-
-    path[sizeof(path) - 2] = 'Z';
-    result = le_avdata_RecordFloat(rec, path, z, ms);
-    if (result != LE_OK)
+    else
     {
-        LE_ERROR("Couldn't record gyro z reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        double value;
+
+        result = dhubQuery_ReadBufferSampleNumeric(obsPath, startAfter, timestampPtr, &value);
+        if (result == LE_OK)
+        {
+            result = ExtractValues(sensorPtr, value, NULL, values);
+        }
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Gyroscope);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    if (result == LE_OK)
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        // Prefer an older sample from the store, if the Data Hub dropped some.
+        (void)ReadStoreGap(sensorPtr, startAfter, *timestampPtr, timestampPtr, values);
     }
 
-done:
-
-    le_avdata_DeleteRecord(rec);
-
     return result;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records a position reading into a given avdata record.
+ * Pushes a sensor sample, batched with as many of the sensor's buffered samples newer than it as
+ * the transport takes in one push.
  *
- * The JSON value is expected to look like this:
- *
- * { "lat": 49.172350, "lon": -123.070987, "hAcc": 14.000000, "alt": 0.009000, "vAcc": 8.000000 }
+ * The push then covers all the samples the transport took, so the push tracker is told the
+ * timestamp of the newest one.  Each sample is pushed with its sequence number from the push
+ * tracker, and those it was given for the first time are reserved (and saved to the
+ * DELIVERED_FILE if the reservation grows) before the push.  Nothing is pushed if the reservation
+ * can't be saved, so a restart never gives the same sequence numbers out again; the push tracker
+ * retries with the sensor's next update.
  *
  * @return
  *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ *      - LE_FORMAT_ERROR if a JSON sample is missing a member or has a non-numeric one
+ *      - LE_OVERFLOW if the sample can't be encoded in a push on its own
+ *      - LE_FAULT non-specific failure, e.g., the reservation couldn't be saved
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushPosition
+static le_result_t PushSample
 (
+    Sensor_t* sensorPtr,
     double timestamp,
-    const char* value   ///< JSON string.
+    double numericValue,    ///< Value of a numeric sample (ignored for JSON samples).
+    const char* jsonValue   ///< Value of a JSON sample, or NULL for a numeric sample.
 )
 {
-    double latitude = ExtractNumber(value, "lat");
-    if (isnan(latitude))
+    uplink_Sample_t samples[UPLINK_MAX_BATCH];
+    size_t maxBatch = Transport->getMaxBatch();
+    size_t numSamples = 1;
+    size_t numPushed = 0;
+
+    LE_ASSERT((maxBatch > 0) && (maxBatch <= UPLINK_MAX_BATCH));
+
+    // Extract all the values first, so nothing is pushed from a malformed sample.
+    samples[0].timestamp = timestamp;
+    le_result_t result = ExtractValues(sensorPtr, numericValue, jsonValue, samples[0].values);
+    if (result != LE_OK)
     {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
+        LE_ERROR("Failed to decode %s value.", sensorPtr->modelPtr->name);
+        return result;
     }
 
-    double longitude = ExtractNumber(value, "lon");
-    if (isnan(longitude))
+    // Offer newer buffered samples too, up to the first one that can't be read (the push tracker
+    // gets to that one on its own later) or that was delivered already (e.g., after a gap).
+    while (   (numSamples < maxBatch)
+           && (ReadNextValues(sensorPtr,
+                              samples[numSamples - 1].timestamp,
+                              &samples[numSamples].timestamp,
+                              samples[numSamples].values) == LE_OK)
+           && !tracker_IsDelivered(&sensorPtr->tracker, samples[numSamples].timestamp))
     {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
-
-    double hAccuracy = ExtractNumber(value, "hAcc");
-    if (isnan(hAccuracy))
-    {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
-
-    double altitude = ExtractNumber(value, "alt");
-    if (isnan(altitude))
-    {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
-
-    double vAccuracy = ExtractNumber(value, "vAcc");
-    if (isnan(vAccuracy))
-    {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
-
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
-
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
-
-    // The '_' is a placeholder that will be replaced
-    char path[] = "lwm2m.6.0._";
-    le_result_t result;
-
-    path[sizeof(path) - 2] = '0';
-    result = le_avdata_RecordFloat(rec, path, latitude, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record gps latitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        numSamples++;
     }
 
-    path[sizeof(path) - 2] = '1';
-    result = le_avdata_RecordFloat(rec, path, longitude, ms);
-    if (result != LE_OK)
+    size_t numNew = 0;
+    for (size_t i = 0; i < numSamples; i++)
     {
-        LE_ERROR("Couldn't record gps longitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        samples[i].seq = tracker_GetSeq(&sensorPtr->tracker, samples[i].timestamp, &numNew);
     }
-
-    path[sizeof(path) - 2] = '3';
-    result = le_avdata_RecordFloat(rec, path, hAccuracy, ms);
-    if (result != LE_OK)
+    uint64_t seqLimit = sensorPtr->tracker.seqLimit;
+    if (tracker_ReserveSeqs(&sensorPtr->tracker, numNew) && (DeliveredFilePath != NULL))
     {
-        LE_ERROR("Couldn't record gps horizontal accuracy reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        IsDeliveredDirty = true;
+        if (SaveDelivered() != LE_OK)
+        {
+            // Reserved again, and saved, by the retry.
+            sensorPtr->tracker.seqLimit = seqLimit;
+            return LE_FAULT;
+        }
     }
 
-    path[sizeof(path) - 2] = '2';
-    result = le_avdata_RecordFloat(rec, path, altitude, ms);
-    if (result != LE_OK)
+    result = Transport->push(&sensorPtr->uplink,
+                             samples,
+                             numSamples,
+                             &numPushed,
+                             HandlePushComplete,
+                             &sensorPtr->tracker);
+    if (result == LE_OK)
     {
-        LE_ERROR("Couldn't record gps altitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+        CountPush();
 
-    result = le_avdata_RecordFloat(rec, "MangOH.Sensors.Gps.VerticalAccuracy", vAccuracy, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record gps vertical accuracy reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+        sensorPtr->tracker.timestamp = samples[numPushed - 1].timestamp;
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &PositionSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        for (size_t i = 0; i < numPushed; i++)
+        {
+            tracker_SetSent(&sensorPtr->tracker, samples[i].timestamp, samples[i].seq);
+        }
     }
 
-done:
-
-    le_avdata_DeleteRecord(rec);
-
     return result;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a numeric sensor sample to the cloud.
+ * Push a numeric sensor sample to AirVantage.
+ *
+ * @return LE_OK if the push was started.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushNumeric
+static le_result_t PushNumeric
 (
-    Sensor_t* sensorPtr,
+    tracker_Sensor_t* sensorPtr,
     double timestamp,
     double value
 )
 {
-    le_result_t result;
-
-    sensorPtr->timestamp = timestamp;
-
-    if (sensorPtr == &LightSensor)
-    {
-        result = PushLightLevel(timestamp, value);
-    }
-    else if (sensorPtr == &PressureSensor)
-    {
-        result = PushPressure(timestamp, value);
-    }
-    else if (sensorPtr == &Thermometer)
-    {
-        result = PushTemperature(timestamp, value);
-    }
-    else
-    {
-        LE_FATAL("Unexpected numeric sensor '%s'.", sensorPtr->obsPath);
-    }
-
-    if (result != LE_OK)
-    {
-        LE_CRIT("Failed (%s) delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
-
-        sensorPtr->state = SENSOR_STATE_FAULT;
-
-        // Wait for another update from the sensor to trigger a retry.
-    }
+    return PushSample(CONTAINER_OF(sensorPtr, Sensor_t, tracker), timestamp, value, NULL);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a JSON sensor sample to the cloud.
+ * Push a JSON sensor sample to AirVantage.
+ *
+ * @return LE_OK if the push was started, LE_FORMAT_ERROR if the sample is malformed.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushJson
+static le_result_t PushJson
 (
-    Sensor_t* sensorPtr,
+    tracker_Sensor_t* sensorPtr,
     double timestamp,
     const char* value
 )
 {
-    le_result_t result;
-
-    sensorPtr->timestamp = timestamp;
+    return PushSample(CONTAINER_OF(sensorPtr, Sensor_t, tracker), timestamp, 0.0, value);
+}
 
-    if (sensorPtr == &Accelerometer)
-    {
-        result = PushAcceleration(timestamp, value);
-    }
-    else if (sensorPtr == &Gyroscope)
-    {
-        result = PushAngularVelocity(timestamp, value);
-    }
-    else if (sensorPtr == &PositionSensor)
-    {
-        result = PushPosition(timestamp, value);
-    }
-    else
-    {
-        LE_FATAL("Unexpected numeric sensor '%s'.", sensorPtr->obsPath);
-    }
 
-    if (result == LE_FORMAT_ERROR)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fetch the oldest undelivered numeric sample from the Data Hub observation buffer for a sensor.
+ *
+ * @return LE_OK if found, LE_NOT_FOUND if there is none.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadBacklogNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    double* valuePtr
+)
+{
+    double values[MODEL_MAX_FIELDS];
+
+    le_result_t result = dhubQuery_ReadBufferSampleNumeric(sensorPtr->obsPath,
+                                                           startAfter,
+                                                           timestampPtr,
+                                                           valuePtr);
+    if (   (result == LE_OK)
+        && (ReadStoreGap(CONTAINER_OF(sensorPtr, Sensor_t, tracker),
+                         startAfter,
+                         *timestampPtr,
+                         timestampPtr,
+                         values) == LE_OK))
     {
-        LE_CRIT("Discarding malformed value from '%s' (%s).", sensorPtr->obsPath, value);
-
-        sensorPtr->lastDeliveredTimestamp = timestamp;
-        if (sensorPtr->state == SENSOR_STATE_PUSHING)
-        {
-            sensorPtr->state = SENSOR_STATE_IDLE;
-        }
+        *valuePtr = values[0];
     }
 
-    if (result != LE_OK)
-    {
-        LE_CRIT("%s: Delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
-
-        sensorPtr->state = SENSOR_STATE_FAULT;
-
-        // Wait for another update from the sensor to trigger a retry.
-    }
+    return result;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a sensor's backlog (or at least, the oldest samples of the backlog).
+ * Fetch the oldest undelivered JSON sample from the Data Hub observation buffer for a sensor.
+ *
+ * @return LE_OK if found, LE_NOT_FOUND if there is none, LE_OVERFLOW if it is longer than the
+ *         buffer.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushBacklog
+static le_result_t ReadBacklogJson
 (
-    Sensor_t* sensorPtr
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    char* valuePtr,
+    size_t valueSize
 )
-//--------------------------------------------------------------------------------------------------
 {
-    // Fetch the oldest undelivered record from the Data Hub observation buffer for this sensor.
-    if (   (sensorPtr == &Accelerometer)
-        || (sensorPtr == &Gyroscope)
-        || (sensorPtr == &PositionSensor)  )
-    {
-        double timestamp;
-        char value[IO_MAX_STRING_VALUE_LEN + 1];
-
-        le_result_t result = dhubQuery_ReadBufferSampleJson(sensorPtr->obsPath,
-                                                            sensorPtr->lastDeliveredTimestamp,
-                                                            &timestamp,
-                                                            value,
-                                                            sizeof(value));
-        if (result == LE_OK)
-        {
-            PushJson(sensorPtr, timestamp, value);
-        }
-        else if (result == LE_NOT_FOUND)
-        {
-            sensorPtr->state = SENSOR_STATE_IDLE;
-        }
-        else
-        {
-            LE_CRIT("Unexpected result code (%s) from Data Hub query.", LE_RESULT_TXT(result));
-        }
-    }
-    else if (   (sensorPtr == &LightSensor)
-             || (sensorPtr == &PressureSensor)
-             || (sensorPtr == &Thermometer)  )
+    Sensor_t* avSensorPtr = CONTAINER_OF(sensorPtr, Sensor_t, tracker);
+    double values[MODEL_MAX_FIELDS];
+    double storeTimestamp;
+
+    le_result_t result = dhubQuery_ReadBufferSampleJson(sensorPtr->obsPath,
+                                                        startAfter,
+                                                        timestampPtr,
+                                                        valuePtr,
+                                                        valueSize);
+    if (   (result == LE_OK)
+        && (ReadStoreGap(avSensorPtr, startAfter, *timestampPtr, &storeTimestamp, values) == LE_OK))
     {
-        double timestamp;
-        double value;
-
-        le_result_t result = dhubQuery_ReadBufferSampleNumeric(sensorPtr->obsPath,
-                                                               sensorPtr->lastDeliveredTimestamp,
-                                                               &timestamp,
-                                                               &value);
-        if (result == LE_OK)
-        {
-            PushNumeric(sensorPtr, timestamp, value);
-        }
-        else if (result == LE_NOT_FOUND)
+        if (EncodeValues(avSensorPtr, values, valuePtr, valueSize) == LE_OK)
         {
-            sensorPtr->state = SENSOR_STATE_IDLE;
+            *timestampPtr = storeTimestamp;
         }
         else
         {
-            LE_CRIT("Unexpected result code (%s) from Data Hub query.", LE_RESULT_TXT(result));
+            // Too long for the buffer, which now holds a truncated sample.  Skip the store's.
+            result = dhubQuery_ReadBufferSampleJson(sensorPtr->obsPath,
+                                                    startAfter,
+                                                    timestampPtr,
+                                                    valuePtr,
+                                                    valueSize);
         }
     }
-    else
-    {
-        LE_FATAL("Unrecognized sensor object %p.", sensorPtr);
-    }
+
+    return result;
 }
 
 
@@ -995,6 +1392,18 @@ static void AvSessionStateHandler
                 LE_INFO("AirVantage(tm) session started");
 
                 IsAvSessionActive = true;
+
+                if (!IsStartupReported)
+                {
+                    double now = GetUptime();
+
+                    LE_INFO("Startup: session up %.3f s after its request (%.3f s after boot),"
+                            " %.3f s after the Data Hub graph was ready.",
+                            now - SessionRequestTime,
+                            now,
+                            now - ReadyTime);
+                    IsStartupReported = true;
+                }
             }
             break;
         }
@@ -1017,99 +1426,176 @@ static void AvSessionStateHandler
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Call-back function that gets called when a numeric sensor update is received from the Data Hub.
+ * Keep a sensor's latest sample for its variables to be read from, and for reporting again at
+ * pmax.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleNumericUpdate
+static void UpdateLastValues
 (
+    Sensor_t* sensorPtr,
     double timestamp,
-    double value,
-    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+    double numericValue,    ///< Value of a numeric sample (ignored for JSON samples).
+    const char* jsonValue   ///< Value of a JSON sample, or NULL for a numeric sample.
 )
 {
-    Sensor_t* sensorPtr = contextPtr;
+    double values[MODEL_MAX_FIELDS];
 
-    switch (sensorPtr->state)
+    if (   (timestamp >= sensorPtr->lastTimestamp)
+        && (ExtractValues(sensorPtr, numericValue, jsonValue, values) == LE_OK))
     {
-        case SENSOR_STATE_IDLE:
-
-            sensorPtr->state = SENSOR_STATE_PUSHING;
-
-            PushNumeric(sensorPtr, timestamp, value);
-
-            break;
-
-        case SENSOR_STATE_PUSHING:
+        sensorPtr->lastTimestamp = timestamp;
+        memcpy(sensorPtr->lastValues, values, sizeof(values));
+    }
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
+    // Nothing to report again until pmax after this sample.
+    if (sensorPtr->pmaxTimer != NULL)
+    {
+        le_timer_Restart(sensorPtr->pmaxTimer);
+    }
+}
 
-            break;
 
-        case SENSOR_STATE_BACKLOGGED:
+//--------------------------------------------------------------------------------------------------
+/**
+ * Variable read handler.  Sets the variable to its field's value in the sensor's latest sample
+ * as the AirVantage server reads it.  Until the sensor has a sample, the variable is left unset.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleVariableRead
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr    ///< Pointer to the Variable_t.
+)
+{
+    const Variable_t* variablePtr = contextPtr;
+    const Sensor_t* sensorPtr = variablePtr->sensorPtr;
 
-            // Don't need to do anything.  Completion of the current push will result in more
-            // being pushed.
-            break;
+    if ((accessType != LE_AVDATA_ACCESS_READ) || (sensorPtr->lastTimestamp == 0.0))
+    {
+        return;
+    }
 
-        case SENSOR_STATE_FAULT:
+    double value = sensorPtr->lastValues[variablePtr->field];
+    le_result_t result;
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
-            PushBacklog(sensorPtr);
+    if (sensorPtr->modelPtr->fields[variablePtr->field].type == MODEL_TYPE_INT)
+    {
+        result = le_avdata_SetInt(path, (int32_t)lround(value));
+    }
+    else
+    {
+        result = le_avdata_SetFloat(path, value);
+    }
 
-            break;
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to set variable '%s' (%s).", path, LE_RESULT_TXT(result));
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Call-back function that gets called when a JSON sensor update is received from the Data Hub.
+ * Create a readable AirVantage variable for each of a sensor's descriptor fields, at the field's
+ * resource path relative to the asset (e.g., MangOH.Sensors.Light.Level is /Sensors/Light/Level).
+ * Fields of standard LwM2M objects are skipped.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleJsonUpdate
+static void CreateVariables
 (
-    double timestamp,
-    const char* value,
-    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+    Sensor_t* sensorPtr
 )
 {
-    Sensor_t* sensorPtr = contextPtr;
+    const model_Sensor_t* modelPtr = sensorPtr->modelPtr;
 
-    switch (sensorPtr->state)
+    for (size_t i = 0; i < modelPtr->numFields; i++)
     {
-        case SENSOR_STATE_IDLE:
+        const char* assetPath = strchr(modelPtr->fields[i].path, '.');
+        char path[LE_AVDATA_PATH_NAME_BYTES];
 
-            sensorPtr->state = SENSOR_STATE_PUSHING;
+        if ((strncmp(modelPtr->fields[i].path, "lwm2m.", 6) == 0) || (assetPath == NULL))
+        {
+            continue;
+        }
 
-            PushJson(sensorPtr, timestamp, value);
+        LE_FATAL_IF(strlen(assetPath) >= sizeof(path),
+                    "Variable path '%s' too long.",
+                    modelPtr->fields[i].path);
+        LE_FATAL_IF(NumVariables >= MAX_VARIABLES, "Too many variables (max %d).", MAX_VARIABLES);
 
-            break;
+        for (size_t j = 0; assetPath[j] != '\0'; j++)
+        {
+            path[j] = (assetPath[j] == '.') ? '/' : assetPath[j];
+        }
+        path[strlen(assetPath)] = '\0';
 
-        case SENSOR_STATE_PUSHING:
+        le_result_t result = le_avdata_CreateResource(path, LE_AVDATA_ACCESS_VARIABLE);
+        if (result != LE_OK)
+        {
+            LE_ERROR("Failed to create variable '%s' (%s).", path, LE_RESULT_TXT(result));
+            continue;
+        }
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
+        Variable_t* variablePtr = &Variables[NumVariables++];
+        variablePtr->sensorPtr = sensorPtr;
+        variablePtr->field = i;
+        le_avdata_AddResourceEventHandler(path, HandleVariableRead, variablePtr);
+    }
+}
 
-            break;
 
-        case SENSOR_STATE_BACKLOGGED:
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric sensor update is received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Pointer to the tracker_Sensor_t object associated with the sensor.
+)
+{
+    Sensor_t* sensorPtr = CONTAINER_OF(contextPtr, Sensor_t, tracker);
 
-            // Don't need to do anything.  Completion of the current push will result in more
-            // being pushed.
-            break;
+    // The samples of local sensors (e.g., whose rollups are uplinked) stay on the device.
+    if (!sensorPtr->isLocal)
+    {
+        UpdateLastValues(sensorPtr, timestamp, value, NULL);
+        tracker_HandleNumericUpdate(contextPtr, timestamp, value);
+        CheckUplinkWindow(sensorPtr);
+    }
+}
 
-        case SENSOR_STATE_FAULT:
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
-            PushBacklog(sensorPtr);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a JSON sensor update is received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleJsonUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Pointer to the tracker_Sensor_t object associated with the sensor.
+)
+{
+    Sensor_t* sensorPtr = CONTAINER_OF(contextPtr, Sensor_t, tracker);
 
-            break;
+    if (!sensorPtr->isLocal)
+    {
+        UpdateLastValues(sensorPtr, timestamp, 0.0, value);
+        tracker_HandleJsonUpdate(contextPtr, timestamp, value);
+        CheckUplinkWindow(sensorPtr);
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Create an Obsevation with a buffer in the data hub.
+ * Create an Obsevation with a buffer in the data hub, and add the sensor to the uplink transport.
  */
 //--------------------------------------------------------------------------------------------------
 static void CreateObservation
@@ -1119,70 +1605,1094 @@ static void CreateObservation
     double changeBy ///< Ignored if 0
 )
 {
-    le_result_t result = dhubAdmin_CreateObs(sensorPtr->obsPath);
+    const char* obsPath = sensorPtr->tracker.obsPath;
+
+    LE_ASSERT(sensorPtr->tracker.isJson == sensorPtr->modelPtr->isJson);
+
+    uplink_InitSensor(&sensorPtr->uplink, sensorPtr->modelPtr);
+    Transport->addSensor(&sensorPtr->uplink);
+
+    le_result_t result = dhubAdmin_CreateObs(obsPath);
 
     if (result != LE_OK)
     {
         LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
-                 sensorPtr->obsPath,
+                 obsPath,
                  LE_RESULT_TXT(result));
     }
 
-    dhubAdmin_SetBufferMaxCount(sensorPtr->obsPath, bufferMaxCount);
+    dhubAdmin_SetBufferMaxCount(obsPath, bufferMaxCount);
 
     if (changeBy != 0.0)
     {
-        dhubAdmin_SetChangeBy(sensorPtr->obsPath, changeBy);
+        dhubAdmin_SetChangeBy(obsPath, changeBy);
+        sensorPtr->isFiltered = true;
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Configure and enable a sensor whose 'value' input is at a given path.
+ * Create a sensor's observation, register for its updates and connect it to its source.
  */
 //--------------------------------------------------------------------------------------------------
-static void ConfigureSensor
+static void StartObservation
 (
-    const char* inputPath,
-    double period ///< seconds
+    Sensor_t* sensorPtr,
+    const char* sourcePath,
+    unsigned int bufferMaxCount,
+    double changeBy ///< Ignored if 0
 )
 {
-    const char* lastSlashPtr = strrchr(inputPath, '/');
+    const char* obsPath = sensorPtr->tracker.obsPath;
 
-    if (lastSlashPtr == NULL)
+    CreateObservation(sensorPtr, bufferMaxCount, changeBy);
+
+    if (!sensorPtr->isLocal)
     {
-        LE_FATAL("No '/' found in path '%s'.", inputPath);
+        CreateVariables(sensorPtr);
+        CreateReportSetting(sensorPtr, changeBy);
     }
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    if (sensorPtr->tracker.isJson)
+    {
+        dhubAdmin_AddJsonPushHandler(obsPath, HandleJsonUpdate, &sensorPtr->tracker);
+    }
+    else
+    {
+        dhubAdmin_AddNumericPushHandler(obsPath, HandleNumericUpdate, &sensorPtr->tracker);
+    }
 
-    size_t basePathLen = (lastSlashPtr - inputPath) + 1; // +1 to include the slash.
+    dhubAdmin_SetSource(obsPath, sourcePath);
+}
 
-    // Buffer size check.
-    LE_ASSERT((basePathLen + sizeof("period")) < DHUBIO_MAX_RESOURCE_PATH_LEN);
 
-    // Set the period.
-    (void)strncpy(path, inputPath, basePathLen);    // WARNING: May not be null-terminated.
-    (void)strcpy(path + basePathLen, "period");   // Guaranteed to null-terminate.
-    dhubAdmin_SetNumericDefault(path, period);
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map a sensor's descriptor fields to the columns of its series in the history store, and start
+ * backfilling it from the store if they all map.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MapStoreColumns
+(
+    Sensor_t* sensorPtr
+)
+{
+    const model_Sensor_t* modelPtr = sensorPtr->modelPtr;
+    char columns[STORE_MAX_COLUMN_NAMES_LEN + 1];
+    uint64_t count;
+    double oldest;
+    double newest;
+
+    // The store keeps every sample, so it would fill the gaps a change-by filter makes too.
+    if (sensorPtr->isFiltered)
+    {
+        return;
+    }
 
-    // Enable the sensor.
-    (void)strcpy(path + basePathLen, "enable");   // Guaranteed to null-terminate.
-    dhubAdmin_PushBoolean(path, 0.0, true);
+    if (store_GetInfo(modelPtr->name, columns, sizeof(columns), &count, &oldest, &newest) != LE_OK)
+    {
+        LE_INFO("No '%s' series in the history store.", modelPtr->name);
+        return;
+    }
+
+    for (size_t i = 0; i < modelPtr->numFields; i++)
+    {
+        const char* member = (modelPtr->fields[i].member != NULL) ? modelPtr->fields[i].member
+                                                                   : "value";
+        size_t memberLen = strlen(member);
+        const char* columnPtr = columns;
+        size_t column = 0;
+
+        while (   (strncmp(columnPtr, member, memberLen) != 0)
+               || ((columnPtr[memberLen] != ',') && (columnPtr[memberLen] != '\0')))
+        {
+            columnPtr = strchr(columnPtr, ',');
+            if (columnPtr == NULL)
+            {
+                LE_WARN("No '%s' column in the '%s' series (%s).", member, modelPtr->name, columns);
+                return;
+            }
+            columnPtr++;
+            column++;
+        }
+
+        sensorPtr->storeColumns[i] = column;
+    }
+
+    sensorPtr->isBackfilled = true;
 }
 
 
 //--------------------------------------------------------------------------------------------------
-COMPONENT_INIT
+/**
+ * Handle the history store going away (e.g., the redStore app was stopped).
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleStoreDisconnect
+(
+    void* contextPtr
+)
 {
-    // Create a setting to allow the cloud to push a blink interval for the LED.
-    le_avdata_CreateResource(LED_CMD_LED_BLINK_INTERVAL_RES, LE_AVDATA_ACCESS_SETTING);
+    LE_WARN("Lost the history store; backlog is limited to the Data Hub's buffers.");
 
-    // Create a command to allow the cloud to command the LED to blink.
-    le_avdata_CreateResource(LED_CMD_SET_LED_BLINK_INTERVAL_RES, LE_AVDATA_ACCESS_COMMAND);
-    le_avdata_AddResourceEventHandler(LED_CMD_SET_LED_BLINK_INTERVAL_RES,
-                                      SetLedBlinkIntervalCmd,
+    IsStoreConnected = false;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Observations); i++)
+    {
+        Observations[i].sensorPtr->isBackfilled = false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect to the history store, if the redStore app is installed, to backfill samples the Data
+ * Hub's buffers drop during long outages.  Deferred until after startup: backfill is only needed
+ * after an outage.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConnectStore
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    if (store_TryConnectService() != LE_OK)
+    {
+        LE_INFO("No history store; backlog is limited to the Data Hub's buffers.");
+        return;
+    }
+
+    store_SetServerDisconnectHandler(HandleStoreDisconnect, NULL);
+    IsStoreConnected = true;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Observations); i++)
+    {
+        MapStoreColumns(Observations[i].sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time.
+ *
+ * @return Seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a sensor's latest sample again, timestamped now, when pmax has passed without one.  The
+ * report bypasses the backlog, so it is only made while the sensor has no push in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePmaxTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    Sensor_t* sensorPtr = le_timer_GetContextPtr(timer);
+
+    if (sensorPtr->lastTimestamp == 0.0)
+    {
+        return;
+    }
+
+    // Between uplink windows, what the sensor has waiting is reported at pmax instead, if
+    // anything.  Otherwise the latest sample is pushed right away, as it isn't buffered to wait.
+    if (sensorPtr->tracker.state == TRACKER_STATE_HELD)
+    {
+        FlushSensor(sensorPtr);
+        return;
+    }
+
+    bool isReported = false;
+
+    if (sensorPtr->tracker.isJson)
+    {
+        char json[BATCH_MAX_JSON_LEN + 1];
+
+        if (EncodeValues(sensorPtr, sensorPtr->lastValues, json, sizeof(json)) == LE_OK)
+        {
+            isReported = tracker_RepeatJson(&sensorPtr->tracker, GetNow(), json);
+        }
+    }
+    else
+    {
+        isReported = tracker_RepeatNumeric(&sensorPtr->tracker, GetNow(), sensorPtr->lastValues[0]);
+    }
+
+    // Only reported again when the sensor is idle (see tracker_RepeatNumeric()), so while its
+    // pushes are in progress, it is tried again pmax later.
+    if (!isReported)
+    {
+        le_timer_Restart(timer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse LwM2M observe attributes written as a query string, e.g., "pmin=10&pmax=60&st=0.5", over
+ * a sensor's current ones.  An attribute without a value (e.g., "pmin" or "pmin=") is cleared.
+ * "step" is accepted for "st".
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if an attribute is unknown or its value isn't a number
+ *      - LE_OUT_OF_RANGE if a value is negative where it can't be, pmin or pmax is longer than
+ *        MAX_ATTRIBUTE_PERIOD, or lt isn't below gt
+ *      - LE_OVERFLOW if the text is longer than MAX_ATTRIBUTES_LEN
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseAttributes
+(
+    const char* text,
+    Attributes_t* attributesPtr     ///< [IN/OUT]
+)
+{
+    char buffer[MAX_ATTRIBUTES_LEN + 1];
+    char* savePtr;
+
+    if (le_utf8_Copy(buffer, text, sizeof(buffer), NULL) != LE_OK)
+    {
+        return LE_OVERFLOW;
+    }
+
+    for (char* itemPtr = strtok_r(buffer, "&", &savePtr);
+         itemPtr != NULL;
+         itemPtr = strtok_r(NULL, "&", &savePtr))
+    {
+        char* valuePtr = strchr(itemPtr, '=');
+        bool isCleared = ((valuePtr == NULL) || (valuePtr[1] == '\0'));
+        double value = NAN;
+
+        if (valuePtr != NULL)
+        {
+            *valuePtr++ = '\0';
+        }
+
+        if (!isCleared)
+        {
+            char* endPtr;
+
+            value = strtod(valuePtr, &endPtr);
+            if ((*endPtr != '\0') || !isfinite(value))
+            {
+                return LE_FORMAT_ERROR;
+            }
+        }
+
+        if ((strcmp(itemPtr, "pmin") == 0) || (strcmp(itemPtr, "pmax") == 0))
+        {
+            if (isCleared)
+            {
+                value = 0.0;
+            }
+            else if ((value < 0.0) || (value > MAX_ATTRIBUTE_PERIOD))
+            {
+                return LE_OUT_OF_RANGE;
+            }
+
+            if (strcmp(itemPtr, "pmin") == 0)
+            {
+                attributesPtr->pmin = value;
+            }
+            else
+            {
+                attributesPtr->pmax = value;
+            }
+        }
+        else if (strcmp(itemPtr, "gt") == 0)
+        {
+            attributesPtr->gt = value;
+        }
+        else if (strcmp(itemPtr, "lt") == 0)
+        {
+            attributesPtr->lt = value;
+        }
+        else if ((strcmp(itemPtr, "st") == 0) || (strcmp(itemPtr, "step") == 0))
+        {
+            if (!isCleared && (value < 0.0))
+            {
+                return LE_OUT_OF_RANGE;
+            }
+            attributesPtr->step = value;
+        }
+        else
+        {
+            return LE_FORMAT_ERROR;
+        }
+    }
+
+    if (   !isnan(attributesPtr->gt)
+        && !isnan(attributesPtr->lt)
+        && (attributesPtr->lt >= attributesPtr->gt))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply a sensor's observe attributes to its observation in the Data Hub:
+ *
+ *  - pmin: minimum period of the observation.
+ *  - st: change-by threshold (the firmware's default when cleared).
+ *  - gt and lt: low and high limits.  The Data Hub filters on values rather than on crossings, so
+ *    gt passes the values at or above it and lt those at or below it; with both, the values
+ *    between lt and gt are dropped.
+ *  - pmax: if the observation passes no sample for pmax (e.g., none changed by st), the latest
+ *    one is reported again.  Ignored unless greater than pmin, as in LwM2M.
+ *
+ * Only pmin and pmax apply to JSON sensors: the Data Hub only filters numeric samples by value.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyAttributes
+(
+    Sensor_t* sensorPtr
+)
+{
+    const char* obsPath = sensorPtr->tracker.obsPath;
+    const Attributes_t* attributesPtr = &sensorPtr->attributes;
+    double changeBy = isnan(attributesPtr->step) ? sensorPtr->defaultChangeBy
+                                                 : attributesPtr->step;
+
+    dhubAdmin_SetMinPeriod(obsPath, attributesPtr->pmin);
+    sensorPtr->isFiltered = (attributesPtr->pmin > 0.0);
+
+    if (!sensorPtr->tracker.isJson)
+    {
+        dhubAdmin_SetChangeBy(obsPath, changeBy);
+        dhubAdmin_SetLowLimit(obsPath, attributesPtr->gt);
+        dhubAdmin_SetHighLimit(obsPath, attributesPtr->lt);
+
+        sensorPtr->isFiltered = (   sensorPtr->isFiltered
+                                 || (changeBy != 0.0)
+                                 || !isnan(attributesPtr->gt)
+                                 || !isnan(attributesPtr->lt));
+    }
+
+    // The store keeps every sample, so it would fill the gaps the filters make.
+    if (sensorPtr->isFiltered)
+    {
+        sensorPtr->isBackfilled = false;
+    }
+    else if (IsStoreConnected && !sensorPtr->isBackfilled)
+    {
+        MapStoreColumns(sensorPtr);
+    }
+
+    if (attributesPtr->pmax > attributesPtr->pmin)
+    {
+        if (sensorPtr->pmaxTimer == NULL)
+        {
+            sensorPtr->pmaxTimer = le_timer_Create(sensorPtr->modelPtr->name);
+            le_timer_SetHandler(sensorPtr->pmaxTimer, HandlePmaxTimer);
+            le_timer_SetContextPtr(sensorPtr->pmaxTimer, sensorPtr);
+            le_timer_SetRepeat(sensorPtr->pmaxTimer, 0);
+        }
+        le_timer_SetMsInterval(sensorPtr->pmaxTimer, (uint32_t)(attributesPtr->pmax * 1000.0));
+        le_timer_Restart(sensorPtr->pmaxTimer);
+    }
+    else if (sensorPtr->pmaxTimer != NULL)
+    {
+        le_timer_Stop(sensorPtr->pmaxTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Setting write handler.  Called when the server writes a sensor's observe attributes.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleReportWrite
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr    ///< Pointer to the Sensor_t.
+)
+{
+    Sensor_t* sensorPtr = contextPtr;
+    Attributes_t attributes = sensorPtr->attributes;
+    char text[MAX_ATTRIBUTES_LEN + 1];
+
+    if (accessType != LE_AVDATA_ACCESS_WRITE)
+    {
+        return;
+    }
+
+    le_result_t result = le_avdata_GetString(path, text, sizeof(text));
+    if (result == LE_OK)
+    {
+        result = ParseAttributes(text, &attributes);
+    }
+    if (result != LE_OK)
+    {
+        LE_ERROR("Rejected observe attributes of %s (%s).",
+                 sensorPtr->modelPtr->name,
+                 LE_RESULT_TXT(result));
+        return;
+    }
+
+    if (   sensorPtr->tracker.isJson
+        && (!isnan(attributes.gt) || !isnan(attributes.lt) || !isnan(attributes.step)))
+    {
+        LE_WARN("Only pmin and pmax apply to %s (JSON samples).", sensorPtr->modelPtr->name);
+    }
+
+    sensorPtr->attributes = attributes;
+    ApplyAttributes(sensorPtr);
+
+    LE_INFO("Observe attributes of %s: '%s'.", sensorPtr->modelPtr->name, text);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the setting the server writes a sensor's observe attributes to.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CreateReportSetting
+(
+    Sensor_t* sensorPtr,
+    double defaultChangeBy  ///< Change-by threshold when st isn't set, or 0.
+)
+{
+    char path[LE_AVDATA_PATH_NAME_BYTES];
+
+    sensorPtr->defaultChangeBy = defaultChangeBy;
+    sensorPtr->attributes = (Attributes_t){ .pmin=0.0, .pmax=0.0, .gt=NAN, .lt=NAN, .step=NAN };
+
+    int len = snprintf(path, sizeof(path), REPORT_SETTING_PREFIX "%s", sensorPtr->modelPtr->name);
+    LE_ASSERT((len > 0) && ((size_t)len < sizeof(path)));
+
+    le_result_t result = le_avdata_CreateResource(path, LE_AVDATA_ACCESS_SETTING);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to create setting '%s' (%s).", path, LE_RESULT_TXT(result));
+        return;
+    }
+
+    le_avdata_AddResourceEventHandler(path, HandleReportWrite, sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the Data Hub input path of a tier of a sensor's rollups, relative to this app.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetRollupInputPath
+(
+    const Rollup_t* rollupPtr,
+    rollup_Tier_t tier,
+    char* pathPtr,
+    size_t pathSize
+)
+{
+    int len = snprintf(pathPtr,
+                       pathSize,
+                       ROLLUP_INPUT_PREFIX "%s/%s",
+                       rollupPtr->sensorPtr->modelPtr->name,
+                       rollup_GetName(tier));
+    LE_ASSERT((len > 0) && ((size_t)len < pathSize));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the completion of a rollup bucket: push it to the Data Hub input of its tier, as a JSON
+ * sample timestamped with the start of the bucket, e.g.:
+ *
+ * {"count":6,"min":101.2,"max":101.4,"mean":101.3,"last":101.4}
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleRollupComplete
+(
+    rollup_Tier_t tier,
+    const rollup_Bucket_t* bucketPtr,
+    void* contextPtr    ///< Pointer to the Rollup_t.
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    char json[ROLLUP_MAX_JSON_LEN + 1];
+
+    GetRollupInputPath(contextPtr, tier, path, sizeof(path));
+
+    int len = snprintf(json,
+                       sizeof(json),
+                       "{\"count\":%" PRIu32 ",\"min\":%lf,\"max\":%lf,\"mean\":%lf,\"last\":%lf}",
+                       bucketPtr->count,
+                       bucketPtr->min,
+                       bucketPtr->max,
+                       bucketPtr->sum / bucketPtr->count,
+                       bucketPtr->last);
+    if ((len < 0) || ((size_t)len >= sizeof(json)))
+    {
+        LE_ERROR("Rollup of '%s' too long for its buffer.", path);
+        return;
+    }
+
+    dhubIO_PushJson(path, bucketPtr->start, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a sample of a rolled-up sensor is received from the
+ * Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleRollupSample
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Pointer to the Rollup_t.
+)
+{
+    Rollup_t* rollupPtr = contextPtr;
+
+    rollup_Add(&rollupPtr->series, timestamp, value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the rollup buckets of sensors that have stopped producing samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RollupTimerExpiryHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+    double closeTime = (double)now.sec + ((double)now.usec / 1000000.0) - ROLLUP_CLOSE_DELAY;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Rollups); i++)
+    {
+        rollup_CloseUntil(&Rollups[i].series, closeTime);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the sensors whose rollups are uplinked instead of their samples, from the ROLLUP_UPLINK
+ * environment variable (a comma-separated list of <sensor>=<tier>).
+ */
+//--------------------------------------------------------------------------------------------------
+static void SelectRollupUplinks
+(
+    void
+)
+{
+    const char* value = getenv(ROLLUP_UPLINK_ENV_VAR);
+    if (value == NULL)
+    {
+        return;
+    }
+
+    char list[128];
+    LE_FATAL_IF(le_utf8_Copy(list, value, sizeof(list), NULL) != LE_OK,
+                "%s too long.",
+                ROLLUP_UPLINK_ENV_VAR);
+
+    char* savePtr = NULL;
+    for (char* itemPtr = strtok_r(list, ", ", &savePtr);
+         itemPtr != NULL;
+         itemPtr = strtok_r(NULL, ", ", &savePtr))
+    {
+        char* tierNamePtr = strchr(itemPtr, '=');
+        rollup_Tier_t tier;
+        Rollup_t* rollupPtr = NULL;
+
+        LE_FATAL_IF(tierNamePtr == NULL,
+                    "Expected <sensor>=<tier> in %s, got '%s'.",
+                    ROLLUP_UPLINK_ENV_VAR,
+                    itemPtr);
+        *tierNamePtr++ = '\0';
+
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Rollups); i++)
+        {
+            if (strcmp(Rollups[i].sensorPtr->modelPtr->name, itemPtr) == 0)
+            {
+                rollupPtr = &Rollups[i];
+            }
+        }
+        LE_FATAL_IF(rollupPtr == NULL,
+                    "No rollups of '%s' in %s (expected 'light', 'pressure' or 'temperature').",
+                    itemPtr,
+                    ROLLUP_UPLINK_ENV_VAR);
+        LE_FATAL_IF(rollup_FindTier(tierNamePtr, &tier) != LE_OK,
+                    "Unknown rollup tier '%s' in %s (expected 'minute', 'hour' or 'day').",
+                    tierNamePtr,
+                    ROLLUP_UPLINK_ENV_VAR);
+
+        rollupPtr->isUplinked = true;
+        rollupPtr->uplinkTier = tier;
+        rollupPtr->sensorPtr->isLocal = true;
+
+        LE_INFO("Uplinking %s rollups of %s instead of its samples.", tierNamePtr, itemPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start rolling up the numeric sensors' samples, and uplinking the selected tiers.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartRollups
+(
+    void
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Rollups); i++)
+    {
+        Rollup_t* rollupPtr = &Rollups[i];
+
+        rollup_Init(&rollupPtr->series, HandleRollupComplete, rollupPtr);
+
+        for (rollup_Tier_t tier = 0; tier < ROLLUP_NUM_TIERS; tier++)
+        {
+            GetRollupInputPath(rollupPtr, tier, path, sizeof(path));
+
+            le_result_t result = dhubIO_CreateInput(path, DHUBIO_DATA_TYPE_JSON, "");
+            LE_FATAL_IF((result != LE_OK) && (result != LE_DUPLICATE),
+                        "Failed to create Data Hub input '%s' (%s).",
+                        path,
+                        LE_RESULT_TXT(result));
+        }
+
+        // Without a change-by threshold, so the rollups see every sample.
+        le_result_t result = dhubAdmin_CreateObs(rollupPtr->feedObsPath);
+        LE_FATAL_IF(result != LE_OK,
+                    "Failed to create Data Hub observation at path '%s' (%s).",
+                    rollupPtr->feedObsPath,
+                    LE_RESULT_TXT(result));
+        dhubAdmin_AddNumericPushHandler(rollupPtr->feedObsPath, HandleRollupSample, rollupPtr);
+        dhubAdmin_SetSource(rollupPtr->feedObsPath, rollupPtr->inputPath);
+
+        if (rollupPtr->isUplinked)
+        {
+            Sensor_t* uplinkPtr = &rollupPtr->uplink;
+            char sourcePath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+            GetRollupInputPath(rollupPtr, rollupPtr->uplinkTier, path, sizeof(path));
+            LE_ASSERT(snprintf(sourcePath, sizeof(sourcePath), ROLLUP_APP_PATH "%s", path)
+                      < (int)sizeof(sourcePath));
+
+            StartObservation(uplinkPtr, sourcePath, ROLLUP_BUFFER_COUNT, 0.0);
+        }
+    }
+
+    le_timer_Ref_t timer = le_timer_Create("rollup");
+    le_timer_SetMsInterval(timer, ROLLUP_CLOSE_DELAY * 1000);
+    le_timer_SetRepeat(timer, 0);
+    le_timer_SetHandler(timer, RollupTimerExpiryHandler);
+    le_timer_Start(timer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call a function for each sensor name in a comma-separated list in an environment variable.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ForEachListedSensor
+(
+    const char* envVarName,
+    void (*func)(const char* name)
+)
+{
+    const char* value = getenv(envVarName);
+    if (value == NULL)
+    {
+        return;
+    }
+
+    char list[128];
+    LE_FATAL_IF(le_utf8_Copy(list, value, sizeof(list), NULL) != LE_OK,
+                "%s too long.",
+                envVarName);
+
+    char* savePtr = NULL;
+    for (char* itemPtr = strtok_r(list, ", ", &savePtr);
+         itemPtr != NULL;
+         itemPtr = strtok_r(NULL, ", ", &savePtr))
+    {
+        func(itemPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select a virtual sensor to be uplinked.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SelectDerivedUplink
+(
+    const char* name
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+    {
+        if (strcmp(DerivedSensors[i].sensor.modelPtr->name, name) == 0)
+        {
+            DerivedSensors[i].isUplinked = true;
+            LE_INFO("Uplinking virtual sensor %s.", name);
+            return;
+        }
+    }
+
+    LE_FATAL("Unknown virtual sensor '%s' in %s"
+             " (expected 'accelMagnitude', 'tilt' or 'boardTemp').",
+             name,
+             DERIVED_UPLINK_ENV_VAR);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select a sensor whose samples stay on the device.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SelectLocalSensor
+(
+    const char* name
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Observations); i++)
+    {
+        Sensor_t* sensorPtr = Observations[i].sensorPtr;
+
+        if (strcmp(sensorPtr->modelPtr->name, name) == 0)
+        {
+            sensorPtr->isLocal = true;
+            LE_INFO("Keeping the samples of %s on the device.", name);
+            return;
+        }
+    }
+
+    LE_FATAL("Unknown sensor '%s' in %s.", name, LOCAL_SENSORS_ENV_VAR);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start uplinking the selected virtual sensors.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartDerivedUplinks
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+    {
+        Derived_t* derivedPtr = &DerivedSensors[i];
+
+        if (!derivedPtr->isUplinked)
+        {
+            continue;
+        }
+
+        StartObservation(&derivedPtr->sensor, derivedPtr->inputPath, DERIVED_BUFFER_COUNT, 0.0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure and enable a sensor whose 'value' input is at a given path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConfigureSensor
+(
+    const char* inputPath,
+    double period ///< seconds
+)
+{
+    const char* lastSlashPtr = strrchr(inputPath, '/');
+
+    if (lastSlashPtr == NULL)
+    {
+        LE_FATAL("No '/' found in path '%s'.", inputPath);
+    }
+
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    size_t basePathLen = (lastSlashPtr - inputPath) + 1; // +1 to include the slash.
+
+    // Buffer size check.
+    LE_ASSERT((basePathLen + sizeof("period")) < DHUBIO_MAX_RESOURCE_PATH_LEN);
+
+    // Set the period.
+    (void)strncpy(path, inputPath, basePathLen);    // WARNING: May not be null-terminated.
+    (void)strcpy(path + basePathLen, "period");   // Guaranteed to null-terminate.
+    dhubAdmin_SetNumericDefault(path, period);
+
+    // Enable the sensor.
+    (void)strcpy(path + basePathLen, "enable");   // Guaranteed to null-terminate.
+    dhubAdmin_PushBoolean(path, 0.0, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the sensors' delivered time ranges from the DELIVERED_FILE, if set, and save them there as
+ * pushes are acknowledged.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartDeliveredFile
+(
+    void
+)
+{
+    size_t numSensors = 0;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Observations); i++)
+    {
+        TrackedSensors[numSensors++] = &Observations[i].sensorPtr->tracker;
+    }
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+    {
+        TrackedSensors[numSensors++] = &DerivedSensors[i].sensor.tracker;
+    }
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Rollups); i++)
+    {
+        TrackedSensors[numSensors++] = &Rollups[i].uplink.tracker;
+    }
+
+    DeliveredFilePath = getenv(DELIVERED_FILE_ENV_VAR);
+    if ((DeliveredFilePath == NULL) || (DeliveredFilePath[0] == '\0'))
+    {
+        DeliveredFilePath = NULL;
+        return;
+    }
+
+    le_result_t result = tracker_Load(TrackedSensors, numSensors, DeliveredFilePath);
+    if (result == LE_OK)
+    {
+        LE_INFO("Loaded delivered ranges from '%s'.", DeliveredFilePath);
+    }
+    else if (result != LE_NOT_FOUND)
+    {
+        LE_ERROR("Couldn't load delivered ranges from '%s' (%m).", DeliveredFilePath);
+    }
+
+    DeliveredSaveTimer = le_timer_Create("deliveredSave");
+    le_timer_SetHandler(DeliveredSaveTimer, HandleDeliveredSaveTimer);
+    le_timer_SetMsInterval(DeliveredSaveTimer, DELIVERED_SAVE_INTERVAL * 1000);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer configuration value from an environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if ((valueStr == NULL) || (valueStr[0] == '\0'))
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*endPtr != '\0') || (value < 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the pushes and radio wakeups since the last report, and start counting again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleUplinkStatsTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    LE_INFO("Uplink: %u pushes, waking the radio %u times, in the last hour.",
+            NumPushes,
+            NumRadioWakeups);
+
+    dhubIO_PushNumeric(UPLINK_STATS_INPUT_PREFIX "pushes", 0.0, NumPushes);
+    dhubIO_PushNumeric(UPLINK_STATS_INPUT_PREFIX "radioWakeups", 0.0, NumRadioWakeups);
+
+    NumPushes = 0;
+    NumRadioWakeups = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start counting the radio activity, and hold all the sensors but the priority ones for the
+ * uplink windows, if UPLINK_WINDOW is set.  The sensors' push tracking records must be listed in
+ * TrackedSensors (see StartDeliveredFile()).
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartUplinkWindows
+(
+    void
+)
+{
+    static const char* const statsInputs[] = {
+        UPLINK_STATS_INPUT_PREFIX "pushes",
+        UPLINK_STATS_INPUT_PREFIX "radioWakeups",
+    };
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(statsInputs); i++)
+    {
+        le_result_t result = dhubIO_CreateInput(statsInputs[i], DHUBIO_DATA_TYPE_NUMERIC, "");
+        LE_FATAL_IF((result != LE_OK) && (result != LE_DUPLICATE),
+                    "Failed to create Data Hub input '%s' (%s).",
+                    statsInputs[i],
+                    LE_RESULT_TXT(result));
+    }
+
+    le_timer_Ref_t statsTimer = le_timer_Create("uplinkStats");
+    le_timer_SetHandler(statsTimer, HandleUplinkStatsTimer);
+    le_timer_SetMsInterval(statsTimer, UPLINK_STATS_INTERVAL * 1000);
+    le_timer_SetRepeat(statsTimer, 0);
+    le_timer_Start(statsTimer);
+
+    UplinkWindow = GetEnvInt(UPLINK_WINDOW_ENV_VAR, 0);
+    if (UplinkWindow == 0)
+    {
+        return;
+    }
+
+    UplinkBacklog = GetEnvInt(UPLINK_BACKLOG_ENV_VAR, DEFAULT_UPLINK_BACKLOG);
+    LE_FATAL_IF(UplinkBacklog == 0, "%s must be at least 1.", UPLINK_BACKLOG_ENV_VAR);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(TrackedSensors); i++)
+    {
+        TrackedSensors[i]->isHeld = !CONTAINER_OF(TrackedSensors[i], Sensor_t, tracker)->isPriority;
+    }
+
+    UplinkWindowTimer = le_timer_Create("uplinkWindow");
+    le_timer_SetHandler(UplinkWindowTimer, HandleUplinkWindowTimer);
+    ScheduleUplinkWindow();
+
+    LE_INFO("Uplinking every %d s, or at %d samples waiting; shocks and free falls right away.",
+            UplinkWindow,
+            UplinkBacklog);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the whole observation graph: the sensors' observations, their rollups and the virtual
+ * sensors uplinked, and the sensors' periods.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartObservationGraph
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Observations); i++)
+    {
+        const Observation_t* obsPtr = &Observations[i];
+
+        StartObservation(obsPtr->sensorPtr,
+                         obsPtr->inputPath,
+                         obsPtr->bufferMaxCount,
+                         obsPtr->changeBy);
+
+        if (obsPtr->period != 0.0)
+        {
+            ConfigureSensor(obsPtr->inputPath, obsPtr->period);
+        }
+    }
+
+    // Roll up the numeric sensors' samples.
+    StartRollups();
+
+    // Uplink the selected virtual sensors.
+    StartDerivedUplinks();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    StartTime = GetUptime();
+
+    const char* transportName = getenv(UPLINK_TRANSPORT_ENV_VAR);
+    if (transportName == NULL)
+    {
+        transportName = DEFAULT_UPLINK_TRANSPORT;
+    }
+
+    Transport = uplink_FindTransport(transportName);
+    LE_FATAL_IF(Transport == NULL,
+                "Unknown %s '%s' (expected 'avdata', 'avdata-senml' or 'mqtt').",
+                UPLINK_TRANSPORT_ENV_VAR,
+                transportName);
+
+    le_result_t result = Transport->start();
+    LE_FATAL_IF(result != LE_OK,
+                "Couldn't start %s uplink (%s).",
+                transportName,
+                LE_RESULT_TXT(result));
+    LE_INFO("Uplink transport: %s.", transportName);
+
+    // The session takes seconds to come up (network and DTLS), so it is requested first, to
+    // come up while the Data Hub is set up.  Pushes made before it is up are queued.
+    SessionRequestTime = GetUptime();
+    (void)le_avdata_AddSessionStateHandler(AvSessionStateHandler, NULL);
+    LE_FATAL_IF(le_avdata_RequestSession() == NULL, "Failed to request avdata session");
+
+    SelectRollupUplinks();
+    ForEachListedSensor(DERIVED_UPLINK_ENV_VAR, SelectDerivedUplink);
+    ForEachListedSensor(LOCAL_SENSORS_ENV_VAR, SelectLocalSensor);
+
+    // Create a setting to allow the cloud to push a blink interval for the LED.
+    le_avdata_CreateResource(LED_CMD_LED_BLINK_INTERVAL_RES, LE_AVDATA_ACCESS_SETTING);
+
+    // Create a command to allow the cloud to command the LED to blink.
+    le_avdata_CreateResource(LED_CMD_SET_LED_BLINK_INTERVAL_RES, LE_AVDATA_ACCESS_COMMAND);
+    le_avdata_AddResourceEventHandler(LED_CMD_SET_LED_BLINK_INTERVAL_RES,
+                                      SetLedBlinkIntervalCmd,
                                       NULL);
 
     // Create a couple of commands for activating and deactivating the LED.
@@ -1191,39 +2701,21 @@ COMPONENT_INIT
     le_avdata_CreateResource(LED_CMD_DEACTIVATE_RES, LE_AVDATA_ACCESS_COMMAND);
     le_avdata_AddResourceEventHandler(LED_CMD_DEACTIVATE_RES, DeactivateLedCmd, NULL);
 
-    // Create "observations" in the Data Hub for filtering, buffering, and receiving sensor updates.
-    CreateObservation(&Accelerometer, ACCEL_BUFFER_COUNT, 0.0);
-    CreateObservation(&Gyroscope, GYRO_BUFFER_COUNT, 0.0);
-    CreateObservation(&PositionSensor, POS_BUFFER_COUNT, 0.0);
-    CreateObservation(&LightSensor, LIGHT_BUFFER_COUNT, LIGHT_CHANGE_BY);
-    CreateObservation(&PressureSensor, PRESSURE_BUFFER_COUNT, PRESSURE_CHANGE_BY);
-    CreateObservation(&Thermometer, TEMP_BUFFER_COUNT, TEMP_CHANGE_BY);
-
-    // Register for notification when the observations receive updates.
-    dhubAdmin_AddJsonPushHandler(Accelerometer.obsPath, HandleJsonUpdate, &Accelerometer);
-    dhubAdmin_AddJsonPushHandler(Gyroscope.obsPath, HandleJsonUpdate, &Gyroscope);
-    dhubAdmin_AddJsonPushHandler(PositionSensor.obsPath, HandleJsonUpdate, &PositionSensor);
-    dhubAdmin_AddNumericPushHandler(LightSensor.obsPath, HandleNumericUpdate, &LightSensor);
-    dhubAdmin_AddNumericPushHandler(PressureSensor.obsPath, HandleNumericUpdate, &PressureSensor);
-    dhubAdmin_AddNumericPushHandler(Thermometer.obsPath, HandleNumericUpdate, &Thermometer);
-
-    // Configure the sensors.
-    ConfigureSensor(ACCEL_SENSOR_INPUT_PATH, ACCEL_PERIOD);
-    ConfigureSensor(GYRO_SENSOR_INPUT_PATH, GYRO_PERIOD);
-    ConfigureSensor(POS_SENSOR_INPUT_PATH, POS_PERIOD);
-    ConfigureSensor(PRESSURE_SENSOR_INPUT_PATH, PRESSURE_PERIOD);
-    ConfigureSensor(TEMP_SENSOR_INPUT_PATH, TEMP_PERIOD);
-    ConfigureSensor(LIGHT_SENSOR_INPUT_PATH, LIGHT_PERIOD);
-
-    // Connect the observations to the sensor inputs in the Data Hub.
-    dhubAdmin_SetSource(Accelerometer.obsPath, ACCEL_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(Gyroscope.obsPath, GYRO_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(PositionSensor.obsPath, POS_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(PressureSensor.obsPath, PRESSURE_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(Thermometer.obsPath, TEMP_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(LightSensor.obsPath, LIGHT_SENSOR_INPUT_PATH);
-
-    // Request an AirVantage session.
-    (void)le_avdata_AddSessionStateHandler(AvSessionStateHandler, NULL);
-    LE_FATAL_IF(le_avdata_RequestSession() == NULL, "Failed to request avdata session");
+    // Create "observations" in the Data Hub for filtering, buffering, and receiving sensor
+    // updates, connect them to the sensors, and configure the sensors.
+    StartDeliveredFile();
+    StartUplinkWindows();
+    double graphStartTime = GetUptime();
+    StartObservationGraph();
+    ReadyTime = GetUptime();
+
+    // Fill gaps in the Data Hub's buffers from the history store, if there is one.
+    le_event_QueueFunction(ConnectStore, NULL, NULL);
+
+    LE_INFO("Startup: ready in %.1f ms (transport %.1f ms, Data Hub graph %.1f ms),"
+            " %.3f s after boot.",
+            (ReadyTime - StartTime) * 1000.0,
+            (SessionRequestTime - StartTime) * 1000.0,
+            (ReadyTime - graphStartTime) * 1000.0,
+            ReadyTime);
 }
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file allocCounter.c
+ *
+ * Counts heap allocations made by the benchmark process by interposing the C library's malloc
+ * family.  Because the definitions are in the executable, they also catch allocations made
+ * inside shared libraries (e.g., the FILE buffer allocated by fopen()).
+ *
+ * Only supported with glibc, which exports the __libc_* entry points used to forward the calls.
+ * Elsewhere the count is always 0.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "bench.h"
+
+
+/// Number of allocations so far.  Not atomic; the benchmarks are single-threaded.
+static uint64_t AllocCount = 0;
+
+
+#ifdef __GLIBC__
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+
+void* malloc
+(
+    size_t size
+)
+{
+    AllocCount++;
+    return __libc_malloc(size);
+}
+
+
+void* calloc
+(
+    size_t count,
+    size_t size
+)
+{
+    AllocCount++;
+    return __libc_calloc(count, size);
+}
+
+
+void* realloc
+(
+    void* ptr,
+    size_t size
+)
+{
+    AllocCount++;
+    return __libc_realloc(ptr, size);
+}
+
+
+void free
+(
+    void* ptr
+)
+{
+    __libc_free(ptr);
+}
+
+#endif // __GLIBC__
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of heap allocations (malloc, calloc, realloc) made by the process so far.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t bench_GetAllocCount
+(
+    void
+)
+{
+    return AllocCount;
+}
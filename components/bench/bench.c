@@ -0,0 +1,446 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file bench.c
+ *
+ * Micro-benchmark runner for the sensor sampling and cloud publishing hot paths.
+ *
+ * Usage: bench [--filter=SUBSTRING] [--min-time=MS] [--output=FILE] [--trace=LOG]
+ *              [--store-dir=DIR]
+ *
+ * Every registered case whose name contains the filter string is run repeatedly for at least
+ * the minimum time (default 500 ms) after a calibration pass, and reported as one JSON object per
+ * line, for example:
+ *
+ * {"suite":"redBench","version":1,"bench":"file_ReadInt","iterations":262144,
+ *  "ns_per_op":1843.2,"allocs_per_op":1.000,"syscalls_per_op":4.000}
+ *
+ * "syscalls_per_op" comes from the raw_syscalls:sys_enter kernel tracepoint through
+ * perf_event_open().  It is reported as -1 where that isn't available (kernel without
+ * tracepoints, or perf_event_paranoid forbidding it).  "allocs_per_op" is reported as -1 where
+ * allocations can't be counted (see allocCounter.c).
+ *
+ * Extra measurements (bench_ReportValue()) are output as
+ *
+ * {"suite":"redBench","version":1,"bench":"...","metric":"...","value":...}
+ *
+ * Cases that measure recorded data (e.g., encoded uplink sizes) use the sensor log given with
+ * --trace (as recorded by redReplay), or synthetic samples if there is none.
+ *
+ * The sensor history store cases keep their files in a new directory in the one given with
+ * --store-dir, so they can be measured on flash, or in the scratch directory (tmpfs) otherwise.
+ *
+ * Results go to stdout, and are also appended to the output file if one is given, so results
+ * from different releases can be collected and compared by scripts.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+
+/// Version of the result record format.
+#define RESULT_VERSION 1
+
+#define MAX_CASES 64
+
+#define DEFAULT_MIN_TIME_MS 500
+
+/// Paths of the tracepoint ID file for system call entry, in order of preference.
+static const char* const SyscallTracepointIdPaths[] =
+{
+    "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+};
+
+
+static const bench_Case_t* Cases[MAX_CASES];
+static size_t NumCases = 0;
+
+static const char* Filter = "";
+static int MinTimeMs = DEFAULT_MIN_TIME_MS;
+static const char* OutputPath = NULL;
+static FILE* OutputFile = NULL;
+static const char* TracePath = NULL;
+static const char* StoreBaseDir = NULL;
+
+/// perf event file descriptor counting system calls, or -1 if not available.
+static int SyscallCounterFd = -1;
+
+/// Scratch directory, or empty if not created yet.
+static char ScratchDir[PATH_MAX] = "";
+
+/// Directory created in StoreBaseDir, or empty if not created yet.
+static char StoreDir[PATH_MAX] = "";
+
+/// Sink for bench_Consume().
+static volatile double Sink;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a benchmark case.  The case structure must remain valid for the life of the process.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Register
+(
+    const bench_Case_t* casePtr
+)
+{
+    LE_FATAL_IF(NumCases >= MAX_CASES, "Too many benchmark cases (max %d).", MAX_CASES);
+
+    Cases[NumCases++] = casePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a computed value alive so the compiler can't optimize away the work that produced it.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Consume
+(
+    double value
+)
+{
+    Sink = value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a scratch directory (on tmpfs if available) that case files can use for fake files.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetScratchDir
+(
+    void
+)
+{
+    if (ScratchDir[0] == '\0')
+    {
+        struct stat st;
+        const char* base = ((stat("/dev/shm", &st) == 0) && S_ISDIR(st.st_mode)) ? "/dev/shm"
+                                                                                 : "/tmp";
+
+        snprintf(ScratchDir, sizeof(ScratchDir), "%s/redBench.XXXXXX", base);
+        LE_FATAL_IF(mkdtemp(ScratchDir) == NULL, "Couldn't create scratch directory - %m");
+    }
+
+    return ScratchDir;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a directory for the sensor history store cases' series.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetStoreDir
+(
+    void
+)
+{
+    if (StoreBaseDir == NULL)
+    {
+        return bench_GetScratchDir();
+    }
+
+    if (StoreDir[0] == '\0')
+    {
+        snprintf(StoreDir, sizeof(StoreDir), "%s/redBench.XXXXXX", StoreBaseDir);
+        LE_FATAL_IF(mkdtemp(StoreDir) == NULL, "Couldn't create store directory - %m");
+    }
+
+    return StoreDir;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the path of the recorded sensor log given with --trace.
+ *
+ * @return The path, or NULL if none was given.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetTracePath
+(
+    void
+)
+{
+    return TracePath;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a result line to stdout and the output file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Output
+(
+    const char* format,
+    ...
+)
+{
+    char line[512];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    fprintf(stdout, "%s\n", line);
+    fflush(stdout);
+
+    if (OutputFile != NULL)
+    {
+        fprintf(OutputFile, "%s\n", line);
+        fflush(OutputFile);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report an extra measurement that isn't a per-operation cost.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_ReportValue
+(
+    const char* benchName,
+    const char* metricName,
+    double value
+)
+{
+    Output("{\"suite\":\"redBench\",\"version\":%d,\"bench\":\"%s\",\"metric\":\"%s\","
+           "\"value\":%.6g}",
+           RESULT_VERSION,
+           benchName,
+           metricName,
+           value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a perf event counting system call entries by this process.
+ *
+ * @return The file descriptor, or -1 if not available.
+ */
+//--------------------------------------------------------------------------------------------------
+static int OpenSyscallCounter
+(
+    void
+)
+{
+    uint64_t tracepointId = 0;
+    bool found = false;
+
+    for (size_t i = 0; (i < NUM_ARRAY_MEMBERS(SyscallTracepointIdPaths)) && !found; i++)
+    {
+        FILE* f = fopen(SyscallTracepointIdPaths[i], "r");
+        if (f != NULL)
+        {
+            found = (fscanf(f, "%" SCNu64, &tracepointId) == 1);
+            fclose(f);
+        }
+    }
+
+    if (!found)
+    {
+        LE_WARN("System call tracepoint not available. syscalls/op will not be measured.");
+        return -1;
+    }
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = tracepointId;
+    attr.disabled = 1;
+    attr.exclude_kernel = 0;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0 /* this process */, -1 /* any CPU */, -1, 0);
+    if (fd < 0)
+    {
+        LE_WARN("perf_event_open failed (%m). syscalls/op will not be measured.");
+        return -1;
+    }
+
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the system call counter.
+ *
+ * @return The count, or 0 if not available.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t ReadSyscallCount
+(
+    void
+)
+{
+    uint64_t count = 0;
+
+    if ((SyscallCounterFd >= 0) && (read(SyscallCounterFd, &count, sizeof(count)) != sizeof(count)))
+    {
+        count = 0;
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current monotonic time in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t NowNs
+(
+    void
+)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Calibrate, run and report one benchmark case.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunCase
+(
+    const bench_Case_t* casePtr
+)
+{
+    if (casePtr->setup != NULL)
+    {
+        le_result_t result = casePtr->setup();
+        if (result != LE_OK)
+        {
+            LE_WARN("Skipping '%s' (%s).", casePtr->name, LE_RESULT_TXT(result));
+            return;
+        }
+    }
+
+    // Calibrate: double the iteration count until a run takes at least a tenth of the minimum
+    // time, then scale up to the minimum time.
+    uint64_t minTimeNs = (uint64_t)MinTimeMs * 1000000ULL;
+    uint64_t iterations = 1;
+    uint64_t elapsedNs;
+
+    for (;;)
+    {
+        uint64_t start = NowNs();
+        casePtr->run(iterations);
+        elapsedNs = NowNs() - start;
+
+        if ((elapsedNs >= (minTimeNs / 10)) || (iterations >= (1ULL << 40)))
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    if (elapsedNs < minTimeNs)
+    {
+        iterations = (uint64_t)((double)iterations * ((double)minTimeNs / (double)(elapsedNs + 1)));
+    }
+
+    // Measure.
+    uint64_t allocsBefore = bench_GetAllocCount();
+    uint64_t syscallsBefore = ReadSyscallCount();
+    uint64_t start = NowNs();
+
+    casePtr->run(iterations);
+
+    elapsedNs = NowNs() - start;
+    uint64_t syscalls = ReadSyscallCount() - syscallsBefore;
+    uint64_t allocs = bench_GetAllocCount() - allocsBefore;
+
+    if (casePtr->teardown != NULL)
+    {
+        casePtr->teardown();
+    }
+
+#ifdef __GLIBC__
+    double allocsPerOp = (double)allocs / (double)iterations;
+#else
+    double allocsPerOp = -1;
+    (void)allocs;
+#endif
+
+    double syscallsPerOp = (SyscallCounterFd >= 0) ? ((double)syscalls / (double)iterations) : -1;
+
+    Output("{\"suite\":\"redBench\",\"version\":%d,\"bench\":\"%s\",\"iterations\":%" PRIu64 ","
+           "\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f,\"syscalls_per_op\":%.3f}",
+           RESULT_VERSION,
+           casePtr->name,
+           iterations,
+           (double)elapsedNs / (double)iterations,
+           allocsPerOp,
+           syscallsPerOp);
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetStringVar(&Filter, NULL, "filter");
+    le_arg_SetIntVar(&MinTimeMs, NULL, "min-time");
+    le_arg_SetStringVar(&OutputPath, NULL, "output");
+    le_arg_SetStringVar(&TracePath, NULL, "trace");
+    le_arg_SetStringVar(&StoreBaseDir, NULL, "store-dir");
+    le_arg_Scan();
+
+    if (OutputPath != NULL)
+    {
+        OutputFile = fopen(OutputPath, "a");
+        LE_FATAL_IF(OutputFile == NULL, "Couldn't open '%s' - %m", OutputPath);
+    }
+
+    bench_RegisterSamplingCases();
+    bench_RegisterUplinkCases();
+    bench_RegisterStoreCases();
+    bench_RegisterRulesCases();
+    bench_RegisterTrackerCases();
+
+    SyscallCounterFd = OpenSyscallCounter();
+
+    for (size_t i = 0; i < NumCases; i++)
+    {
+        if (strstr(Cases[i]->name, Filter) != NULL)
+        {
+            RunCase(Cases[i]);
+        }
+    }
+
+    if (ScratchDir[0] != '\0')
+    {
+        le_dir_RemoveRecursive(ScratchDir);
+    }
+
+    if (StoreDir[0] != '\0')
+    {
+        le_dir_RemoveRecursive(StoreDir);
+    }
+
+    exit(EXIT_SUCCESS);
+}
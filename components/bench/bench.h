@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file bench.h
+ *
+ * Micro-benchmark framework.  Benchmark cases are registered by the case files (e.g.,
+ * samplingBench.c) and run by bench.c, which measures and reports ns/op, allocations/op and
+ * syscalls/op for each one.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BENCH_H_INCLUDE_GUARD
+#define BENCH_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A benchmark case.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* name;           ///< Unique name, e.g. "file_ReadInt".
+
+    /// Prepare to run.  Optional.  Return anything but LE_OK to skip the case (e.g., LE_UNAVAILABLE
+    /// if a service it needs isn't running).
+    le_result_t (*setup)(void);
+
+    /// Run the operation being measured the given number of times.
+    void (*run)(uint64_t iterations);
+
+    /// Clean up after running.  Optional.
+    void (*teardown)(void);
+}
+bench_Case_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a benchmark case.  The case structure must remain valid for the life of the process.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Register
+(
+    const bench_Case_t* casePtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report an extra measurement that isn't a per-operation cost (e.g., an encoded size).  It is
+ * output as a separate result record.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_ReportValue
+(
+    const char* benchName,
+    const char* metricName,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a scratch directory (on tmpfs if available) that case files can use for fake files.  It is
+ * created on first use and removed when the benchmarks finish.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetScratchDir
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a directory for the sensor history store cases' series: a new directory in the one given
+ * with --store-dir (e.g., on flash), or the scratch directory if none was given.  It is removed
+ * when the benchmarks finish.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetStoreDir
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the path of the recorded sensor log (see sensorLog.h) given with --trace, for case files
+ * that measure recorded data.
+ *
+ * @return The path, or NULL if none was given.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* bench_GetTracePath
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep a computed value alive so the compiler can't optimize away the work that produced it.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_Consume
+(
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of heap allocations (malloc, calloc, realloc) made by the process so far.
+ * Implemented in allocCounter.c.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t bench_GetAllocCount
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Case registration functions, one per case file.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterSamplingCases(void);
+void bench_RegisterUplinkCases(void);
+void bench_RegisterStoreCases(void);
+void bench_RegisterRulesCases(void);
+void bench_RegisterTrackerCases(void);
+
+
+#endif // BENCH_H_INCLUDE_GUARD
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rulesBench.c
+ *
+ * Benchmark cases for the edge rules engine (rules.h):
+ *
+ *  - Evaluating 100 rules that all depend on the accelerometer, per accelerometer sample (ns per
+ *    sample; allocations per sample should be 0).
+ *  - Compiling a rule (ns per rule).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+#include "rules.h"
+
+
+#define NUM_RULES 100
+
+#define SAMPLE_PERIOD 0.01 // seconds
+#define START_TIME 1500000000.0
+
+#define MAX_RULE_LEN 128
+
+
+/// Engine the cases run (too big for the stack).
+static rules_Engine_t Engine;
+
+static size_t AccelChannel;
+static size_t GyroChannel;
+
+/// Time of the next sample of the rules_Update100 case.
+static double SampleTime;
+
+/// Random number seed for the samples.
+static unsigned int SampleSeed = 1;
+
+/// Number of the next rule compiled by the rules_Add case.
+static unsigned int RuleNum = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count rule events, so they aren't optimized away.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountEvent
+(
+    const char* name,
+    bool isActive,
+    double timestamp,
+    void* contextPtr
+)
+{
+    bench_Consume(isActive ? 1.0 : 0.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the engine with the accelerometer and gyro channels, and no rules.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitEngine
+(
+    void
+)
+{
+    static const char* const Members[] = { "x", "y", "z" };
+
+    rules_Init(&Engine);
+    LE_ASSERT_OK(rules_AddChannel(&Engine, "accel", Members, 3, &AccelChannel));
+    LE_ASSERT_OK(rules_AddChannel(&Engine, "gyro", Members, 3, &GyroChannel));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make the text of a typical rule on the accelerometer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MakeRule
+(
+    unsigned int n,
+    char* textPtr,
+    size_t textSize
+)
+{
+    snprintf(textPtr,
+             textSize,
+             "r%u = mag(accel) > %u.5 && moving && abs(accel.z - 9.8) < %u for 200ms",
+             n,
+             n % 20,
+             (n % 5) + 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a rule, which must compile.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddRule
+(
+    const char* textPtr
+)
+{
+    char error[128];
+
+    le_result_t result = rules_Add(&Engine, textPtr, error, sizeof(error));
+    LE_FATAL_IF(result != LE_OK, "Couldn't add rule '%s' (%s).", textPtr, error);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add 100 rules that depend on the accelerometer, one of them through the others.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetupUpdate
+(
+    void
+)
+{
+    char text[MAX_RULE_LEN];
+
+    InitEngine();
+
+    AddRule("moving = mag(gyro) > 0.2");
+    for (unsigned int n = 1; n < NUM_RULES; n++)
+    {
+        MakeRule(n, text, sizeof(text));
+        AddRule(text);
+    }
+
+    double gyro[3] = { 0.3, 0.0, 0.0 };
+    rules_Update(&Engine, GyroChannel, gyro, START_TIME, CountEvent, NULL);
+    SampleTime = START_TIME;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the accelerometer with random samples around 1 g (up to 2.5 g), evaluating every rule.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunUpdate
+(
+    uint64_t iterations
+)
+{
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        double values[3];
+
+        for (size_t i = 0; i < 3; i++)
+        {
+            values[i] = 15.0 * (((double)rand_r(&SampleSeed) / RAND_MAX) - 0.5);
+        }
+        values[2] += 9.8;
+
+        SampleTime += SAMPLE_PERIOD;
+        rules_Update(&Engine, AccelChannel, values, SampleTime, CountEvent, NULL);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start compiling rules into an engine with only the rule they depend on.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetupAdd
+(
+    void
+)
+{
+    InitEngine();
+    AddRule("moving = mag(gyro) > 0.2");
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compile rules, starting over with an empty engine when it is full.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunAdd
+(
+    uint64_t iterations
+)
+{
+    char text[MAX_RULE_LEN];
+
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        if (Engine.numRules >= RULES_MAX_RULES)
+        {
+            SetupAdd();
+        }
+
+        MakeRule(RuleNum++, text, sizeof(text));
+        AddRule(text);
+    }
+}
+
+
+static const bench_Case_t UpdateCase =
+    { "rules_Update100", SetupUpdate, RunUpdate, NULL };
+static const bench_Case_t AddCase =
+    { "rules_Add", SetupAdd, RunAdd, NULL };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register the rules engine benchmark cases.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterRulesCases
+(
+    void
+)
+{
+    bench_Register(&UpdateCase);
+    bench_Register(&AddCase);
+}
@@ -0,0 +1,246 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file samplingBench.c
+ *
+ * Benchmark cases for the sensor sampling and cloud publishing hot paths:
+ *
+ *  - file_ReadInt / file_ReadDouble on fake driver attribute files on tmpfs.
+ *  - JSON encoding of accelerometer/gyro and position samples, as done by the sensors.
+ *  - JSON decoding of the same samples, as done by the cloud publisher.
+ *  - avdata record construction (create, record x/y/z, delete), if the AirVantage service runs.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+#include "fileUtils.h"
+#include "sampleCodec.h"
+
+
+static const char XyzSample[] = "{\"x\":-1.094340, \"y\":0.085514, \"z\":9.778496}";
+
+static const char PositionSample[] = "{ \"lat\": 49.172350, \"lon\": -123.070987, "
+                                     "\"hAcc\": 14.000000, \"alt\": 0.009000, \"vAcc\": 8.000000 }";
+
+static char IntAttrPath[PATH_MAX];
+static char DoubleAttrPath[PATH_MAX];
+
+/// true once connected to the AirVantage data service.
+static bool IsAvdataConnected = false;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a fake driver attribute file in the scratch directory.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CreateAttr
+(
+    char* pathBuf,
+    size_t pathBufSize,
+    const char* name,
+    const char* contents
+)
+{
+    snprintf(pathBuf, pathBufSize, "%s/%s", bench_GetScratchDir(), name);
+
+    FILE* f = fopen(pathBuf, "w");
+    LE_FATAL_IF(f == NULL, "Couldn't create '%s' - %m", pathBuf);
+    fprintf(f, "%s\n", contents);
+    fclose(f);
+}
+
+
+static le_result_t SetupFileAttrs
+(
+    void
+)
+{
+    CreateAttr(IntAttrPath, sizeof(IntAttrPath), "in_temp_input", "23800");
+    CreateAttr(DoubleAttrPath, sizeof(DoubleAttrPath), "in_accel_scale", "0.000598");
+
+    return LE_OK;
+}
+
+
+static void RunReadInt
+(
+    uint64_t iterations
+)
+{
+    int value = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(file_ReadInt(IntAttrPath, &value));
+    }
+
+    bench_Consume(value);
+}
+
+
+static void RunReadDouble
+(
+    uint64_t iterations
+)
+{
+    double value = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(file_ReadDouble(DoubleAttrPath, &value));
+    }
+
+    bench_Consume(value);
+}
+
+
+static void RunEncodeXyz
+(
+    uint64_t iterations
+)
+{
+    char sample[256];
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(codec_EncodeXyz(sample, sizeof(sample), -1.094340, 0.085514, 9.778496 + i));
+    }
+
+    bench_Consume(sample[5]);
+}
+
+
+static void RunEncodePosition
+(
+    uint64_t iterations
+)
+{
+    char sample[256];
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(codec_EncodePosition(sample,
+                                          sizeof(sample),
+                                          49.172350,
+                                          -123.070987,
+                                          14.0,
+                                          0.009 + i,
+                                          8.0));
+    }
+
+    bench_Consume(sample[5]);
+}
+
+
+static void RunDecodeXyz
+(
+    uint64_t iterations
+)
+{
+    double x = 0;
+    double y = 0;
+    double z = 0;
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(codec_DecodeXyz(XyzSample, &x, &y, &z));
+    }
+
+    bench_Consume(x + y + z);
+}
+
+
+static void RunDecodePosition
+(
+    uint64_t iterations
+)
+{
+    double v[5] = { 0 };
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        LE_ASSERT_OK(codec_DecodePosition(PositionSample, &v[0], &v[1], &v[2], &v[3], &v[4]));
+    }
+
+    bench_Consume(v[0] + v[4]);
+}
+
+
+static le_result_t SetupAvdata
+(
+    void
+)
+{
+    if (!IsAvdataConnected)
+    {
+        if (le_avdata_TryConnectService() != LE_OK)
+        {
+            return LE_UNAVAILABLE;
+        }
+        IsAvdataConnected = true;
+    }
+
+    return LE_OK;
+}
+
+
+static void RunAvdataRecord
+(
+    uint64_t iterations
+)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+        uint64_t ms = 1500000000000ULL + i;
+
+        LE_ASSERT_OK(le_avdata_RecordFloat(rec, "MangOH.Sensors.Accelerometer.Acceleration.X",
+                                           -1.094340, ms));
+        LE_ASSERT_OK(le_avdata_RecordFloat(rec, "MangOH.Sensors.Accelerometer.Acceleration.Y",
+                                           0.085514, ms));
+        LE_ASSERT_OK(le_avdata_RecordFloat(rec, "MangOH.Sensors.Accelerometer.Acceleration.Z",
+                                           9.778496, ms));
+
+        le_avdata_DeleteRecord(rec);
+    }
+}
+
+
+static const bench_Case_t ReadIntCase =
+    { "file_ReadInt", SetupFileAttrs, RunReadInt, NULL };
+static const bench_Case_t ReadDoubleCase =
+    { "file_ReadDouble", SetupFileAttrs, RunReadDouble, NULL };
+static const bench_Case_t EncodeXyzCase =
+    { "codec_EncodeXyz", NULL, RunEncodeXyz, NULL };
+static const bench_Case_t EncodePositionCase =
+    { "codec_EncodePosition", NULL, RunEncodePosition, NULL };
+static const bench_Case_t DecodeXyzCase =
+    { "codec_DecodeXyz", NULL, RunDecodeXyz, NULL };
+static const bench_Case_t DecodePositionCase =
+    { "codec_DecodePosition", NULL, RunDecodePosition, NULL };
+static const bench_Case_t AvdataRecordCase =
+    { "avdata_RecordXyz", SetupAvdata, RunAvdataRecord, NULL };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register the sampling hot path benchmark cases.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterSamplingCases
+(
+    void
+)
+{
+    bench_Register(&ReadIntCase);
+    bench_Register(&ReadDoubleCase);
+    bench_Register(&EncodeXyzCase);
+    bench_Register(&EncodePositionCase);
+    bench_Register(&DecodeXyzCase);
+    bench_Register(&DecodePositionCase);
+    bench_Register(&AvdataRecordCase);
+}
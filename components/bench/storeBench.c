@@ -0,0 +1,418 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file storeBench.c
+ *
+ * Benchmark cases for the sensor history store (tsStore.h):
+ *
+ *  - Appending accelerometer samples (ns per sample).
+ *  - Queries of a day of accelerometer samples at 10 Hz (ns per query): a 1 hour range, a page
+ *    of store.api's MAX_SAMPLES at a time, 1 hour downsampled to 1 minute means, and the latest
+ *    MAX_SAMPLES.
+ *
+ * The bytes of flash per sample of the day are reported when it is set up.  The series are kept
+ * in the directory given with --store-dir (e.g., to measure on flash), or the scratch directory.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+#include "tsStore.h"
+
+#include <dirent.h>
+
+
+#define NUM_COLUMNS 3
+
+/// Largest size of the appended series, which wraps around within it.
+#define APPEND_MAX_BYTES (16 * 1024 * 1024)
+
+/// Largest size of the day's series (enough to keep all of it).
+#define DAY_MAX_BYTES (64 * 1024 * 1024)
+
+#define DAY_PERIOD 0.1 // seconds
+#define DAY_NUM_SAMPLES 864000
+#define DAY_START_TIME 1500000000.0
+
+#define HOUR 3600.0 // seconds
+#define MINUTE 60.0 // seconds
+
+/// Samples per page, as store_Query() returns them.
+#define PAGE_SAMPLES 32
+
+
+/// Series appended to by the tss_Append case.
+static tss_Series_t* AppendSeriesPtr = NULL;
+
+/// Time of the next sample appended by the tss_Append case.
+static double AppendTime;
+
+/// Random number seed for the appended samples.
+static unsigned int AppendSeed = 1;
+
+/// Series holding a day of samples for the query cases, or NULL if not set up yet.
+static tss_Series_t* DaySeriesPtr = NULL;
+
+/// Random number seed for the query ranges.
+static unsigned int QuerySeed = 1;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate an accelerometer-like sample (m/s^2, with 6 decimal places like the sensors' JSON
+ * encoding).
+ */
+//--------------------------------------------------------------------------------------------------
+static void MakeSample
+(
+    unsigned int* seedPtr,
+    double values[NUM_COLUMNS]
+)
+{
+    static const double Gravity[NUM_COLUMNS] = { -0.1, 0.2, 9.8 };
+
+    for (size_t i = 0; i < NUM_COLUMNS; i++)
+    {
+        double noise = ((double)rand_r(seedPtr) / RAND_MAX) - 0.5;
+        values[i] = round((Gravity[i] + (0.05 * noise)) * 1e6) / 1e6;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time of a sample of the day.  Sample times jitter by a few milliseconds, like real
+ * sampling timers.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetSampleTime
+(
+    unsigned int* seedPtr,
+    uint64_t n
+)
+{
+    return DAY_START_TIME + ((double)n * DAY_PERIOD) + ((double)(rand_r(seedPtr) % 5) / 1000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of bytes used by the files in a series' directory.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t GetSeriesBytes
+(
+    const char* name
+)
+{
+    char path[PATH_MAX];
+    uint64_t total = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", bench_GetStoreDir(), name);
+
+    DIR* dirPtr = opendir(path);
+    if (dirPtr == NULL)
+    {
+        return 0;
+    }
+
+    struct dirent* entryPtr;
+    while ((entryPtr = readdir(dirPtr)) != NULL)
+    {
+        char filePath[PATH_MAX];
+        struct stat st;
+
+        int len = snprintf(filePath, sizeof(filePath), "%s/%s", path, entryPtr->d_name);
+        if (   (len >= 0)
+            && ((size_t)len < sizeof(filePath))
+            && (stat(filePath, &st) == 0)
+            && S_ISREG(st.st_mode))
+        {
+            total += st.st_size;
+        }
+    }
+
+    closedir(dirPtr);
+
+    return total;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count the samples a scan finds.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool CountSample
+(
+    double timestamp,
+    const double values[],
+    void* contextPtr
+)
+{
+    (*(size_t*)contextPtr)++;
+    bench_Consume(values[0]);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop a scan once a page of samples has been found.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PageSample
+(
+    double timestamp,
+    const double values[],
+    void* contextPtr
+)
+{
+    double* lastPtr = contextPtr;
+
+    lastPtr[0] = timestamp;
+    lastPtr[1] += 1.0;
+
+    return (lastPtr[1] < PAGE_SAMPLES);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open an empty series for the tss_Append case.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetupAppend
+(
+    void
+)
+{
+    le_result_t result = tss_Open(bench_GetStoreDir(),
+                                  "benchAppend",
+                                  NUM_COLUMNS,
+                                  APPEND_MAX_BYTES,
+                                  &AppendSeriesPtr);
+    AppendTime = DAY_START_TIME;
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunAppend
+(
+    uint64_t iterations
+)
+{
+    double values[NUM_COLUMNS];
+
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        MakeSample(&AppendSeed, values);
+        AppendTime += DAY_PERIOD;
+        LE_ASSERT_OK(tss_Append(AppendSeriesPtr, AppendTime, values));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the appended series.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TeardownAppend
+(
+    void
+)
+{
+    tss_Close(AppendSeriesPtr);
+    AppendSeriesPtr = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Store a day of samples (once) and report its size.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetupDay
+(
+    void
+)
+{
+    if (DaySeriesPtr != NULL)
+    {
+        return LE_OK;
+    }
+
+    le_result_t result = tss_Open(bench_GetStoreDir(), "benchDay", NUM_COLUMNS, DAY_MAX_BYTES,
+                                  &DaySeriesPtr);
+    if (result != LE_OK)
+    {
+        return result;
+    }
+
+    unsigned int seed = 1;
+    double values[NUM_COLUMNS];
+
+    for (uint64_t n = 0; n < DAY_NUM_SAMPLES; n++)
+    {
+        MakeSample(&seed, values);
+        LE_ASSERT_OK(tss_Append(DaySeriesPtr, GetSampleTime(&seed, n), values));
+    }
+    LE_ASSERT_OK(tss_Flush(DaySeriesPtr));
+
+    size_t numColumns;
+    uint64_t count;
+    double oldest;
+    double newest;
+
+    tss_GetInfo(DaySeriesPtr, &numColumns, &count, &oldest, &newest);
+    LE_FATAL_IF(count != DAY_NUM_SAMPLES, "Stored %" PRIu64 " of %d samples.",
+                count, DAY_NUM_SAMPLES);
+
+    bench_ReportValue("tss_Day", "samples", (double)count);
+    bench_ReportValue("tss_Day",
+                      "bytes_per_sample",
+                      (double)GetSeriesBytes("benchDay") / (double)count);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a random start time for a query range of a given length within the day.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetQueryStart
+(
+    double length
+)
+{
+    double span = (DAY_NUM_SAMPLES * DAY_PERIOD) - length;
+
+    return DAY_START_TIME + (span * ((double)rand_r(&QuerySeed) / RAND_MAX));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan 1 hour ranges.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunScanHour
+(
+    uint64_t iterations
+)
+{
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        double after = GetQueryStart(HOUR);
+        size_t count = 0;
+
+        LE_ASSERT_OK(tss_Scan(DaySeriesPtr, after, after + HOUR, CountSample, &count));
+        LE_ASSERT(count > 0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the day a page at a time, as a store.api client would, wrapping around at the end.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunScanPage
+(
+    uint64_t iterations
+)
+{
+    static double after = 0.0;
+
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        double last[2] = { after, 0.0 };    // Last timestamp, count.
+
+        LE_ASSERT_OK(tss_Scan(DaySeriesPtr, after, INFINITY, PageSample, last));
+        after = (last[1] < PAGE_SAMPLES) ? 0.0 : last[0];
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan 1 hour ranges downsampled to 1 minute means.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunScanDownsampled
+(
+    uint64_t iterations
+)
+{
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        double after = GetQueryStart(HOUR);
+        size_t count = 0;
+
+        LE_ASSERT_OK(tss_ScanDownsampled(DaySeriesPtr, after, after + HOUR, MINUTE,
+                                         CountSample, &count));
+        LE_ASSERT(count > 0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the latest page of samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunScanLatest
+(
+    uint64_t iterations
+)
+{
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        size_t count = 0;
+
+        LE_ASSERT_OK(tss_ScanLatest(DaySeriesPtr, PAGE_SAMPLES, CountSample, &count));
+        LE_ASSERT(count == PAGE_SAMPLES);
+    }
+}
+
+
+static const bench_Case_t AppendCase =
+    { "tss_Append", SetupAppend, RunAppend, TeardownAppend };
+static const bench_Case_t ScanHourCase =
+    { "tss_ScanHour", SetupDay, RunScanHour, NULL };
+static const bench_Case_t ScanPageCase =
+    { "tss_ScanPage", SetupDay, RunScanPage, NULL };
+static const bench_Case_t ScanDownsampledCase =
+    { "tss_ScanDownsampled", SetupDay, RunScanDownsampled, NULL };
+static const bench_Case_t ScanLatestCase =
+    { "tss_ScanLatest", SetupDay, RunScanLatest, NULL };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register the history store benchmark cases.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterStoreCases
+(
+    void
+)
+{
+    bench_Register(&AppendCase);
+    bench_Register(&ScanHourCase);
+    bench_Register(&ScanPageCase);
+    bench_Register(&ScanDownsampledCase);
+    bench_Register(&ScanLatestCase);
+}
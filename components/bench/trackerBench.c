@@ -0,0 +1,278 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file trackerBench.c
+ *
+ * Benchmark cases for the cloud push tracking state machine (pushTracker.h), fetching
+ * accelerometer samples from a JSON sensor's backlog:
+ *
+ *  - tracker_PushBacklogJson: through the state machine, into a pooled buffer sized to the
+ *    sensor's declared longest sample (ns per sample; allocations per sample should be 0).
+ *  - tracker_PushBacklogJson_fixed: into a stack buffer of TRACKER_MAX_JSON_LEN, as the state
+ *    machine used to, for comparison.
+ *
+ * Each case reports the event loop stack it takes per fetch (stack_bytes, from the case's run
+ * function down to the backend's read) and the size of the buffer read into (buffer_bytes).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+#include "pushTracker.h"
+#include "sampleCodec.h"
+
+
+#define SAMPLE "{\"x\":-1.094340, \"y\":0.085514, \"z\":9.778496}"
+
+#define SAMPLE_PERIOD 0.01 // seconds
+
+
+static le_result_t PushNumeric(tracker_Sensor_t* sensorPtr, double timestamp, double value);
+static le_result_t PushJson(tracker_Sensor_t* sensorPtr, double timestamp, const char* value);
+static le_result_t ReadBacklogNumeric(tracker_Sensor_t* sensorPtr,
+                                      double startAfter,
+                                      double* timestampPtr,
+                                      double* valuePtr);
+static le_result_t ReadBacklogJson(tracker_Sensor_t* sensorPtr,
+                                   double startAfter,
+                                   double* timestampPtr,
+                                   char* valuePtr,
+                                   size_t valueSize);
+
+/// Backend whose backlog always has a sample, and whose pushes always start.
+static const tracker_Backend_t Backend = {
+    .pushNumeric=PushNumeric,
+    .pushJson=PushJson,
+    .readBacklogNumeric=ReadBacklogNumeric,
+    .readBacklogJson=ReadBacklogJson,
+};
+
+static tracker_Sensor_t Sensor = {
+    .obsPath="/obs/accel",
+    .isJson=true,
+    .maxJsonLen=CODEC_XYZ_MAX_LEN,
+    .backendPtr=&Backend,
+};
+
+/// Address of a local of the case's run function.
+static uintptr_t StackTop;
+
+/// Deepest stack below StackTop seen by the backend's read.
+static size_t StackBytes;
+
+/// Size of the last buffer the backend read into.
+static size_t BufferBytes;
+
+
+static le_result_t PushNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+)
+{
+    return LE_OK;
+}
+
+
+static le_result_t PushJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+)
+{
+    bench_Consume((double)value[0]);
+
+    return LE_OK;
+}
+
+
+static le_result_t ReadBacklogNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    double* valuePtr
+)
+{
+    return LE_NOT_FOUND;
+}
+
+
+static le_result_t ReadBacklogJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    char* valuePtr,
+    size_t valueSize
+)
+{
+    char bottom;
+    size_t stackBytes = StackTop - (uintptr_t)&bottom;
+
+    if (stackBytes > StackBytes)
+    {
+        StackBytes = stackBytes;
+    }
+    BufferBytes = valueSize;
+
+    if (sizeof(SAMPLE) > valueSize)
+    {
+        return LE_OVERFLOW;
+    }
+
+    memcpy(valuePtr, SAMPLE, sizeof(SAMPLE));
+    *timestampPtr = startAfter + SAMPLE_PERIOD;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start with a backlogged sensor and no measurements.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Setup
+(
+    void
+)
+{
+    Sensor.numDelivered = 0;
+    Sensor.newestTimestamp = 0.0;
+    Sensor.pushStart = 0.0;
+    Sensor.timestamp = 0.0;
+    Sensor.state = TRACKER_STATE_BACKLOGGED;
+
+    StackBytes = 0;
+    BufferBytes = 0;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete pushes of a backlogged sensor, each of which fetches its next sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunPushBacklog
+(
+    uint64_t iterations
+)
+{
+    char top;
+
+    StackTop = (uintptr_t)&top;
+
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        tracker_HandlePushComplete(&Sensor, true);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fetch a sample from the backlog into a stack buffer of the longest sample the Data Hub allows,
+ * and push it.  Not inlined, so its frame is measured like the state machine's.
+ */
+//--------------------------------------------------------------------------------------------------
+__attribute__((noinline)) static void PushBacklogFixed
+(
+    tracker_Sensor_t* sensorPtr
+)
+{
+    char value[TRACKER_MAX_JSON_LEN + 1];
+    double timestamp;
+
+    if (sensorPtr->backendPtr->readBacklogJson(sensorPtr,
+                                               tracker_GetGapStart(sensorPtr),
+                                               &timestamp,
+                                               value,
+                                               sizeof(value)) == LE_OK)
+    {
+        sensorPtr->timestamp = timestamp;
+        (void)sensorPtr->backendPtr->pushJson(sensorPtr, timestamp, value);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fetch and push samples through a fixed stack buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunPushBacklogFixed
+(
+    uint64_t iterations
+)
+{
+    char top;
+
+    StackTop = (uintptr_t)&top;
+
+    for (uint64_t n = 0; n < iterations; n++)
+    {
+        tracker_AddDelivered(&Sensor, tracker_GetGapStart(&Sensor), Sensor.timestamp);
+        PushBacklogFixed(&Sensor);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the stack and buffer taken per fetch.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReportFootprint
+(
+    const char* benchName
+)
+{
+    bench_ReportValue(benchName, "stack_bytes", (double)StackBytes);
+    bench_ReportValue(benchName, "buffer_bytes", (double)BufferBytes);
+}
+
+
+static void TeardownPushBacklog
+(
+    void
+)
+{
+    ReportFootprint("tracker_PushBacklogJson");
+}
+
+
+static void TeardownPushBacklogFixed
+(
+    void
+)
+{
+    ReportFootprint("tracker_PushBacklogJson_fixed");
+}
+
+
+static const bench_Case_t PushBacklogCase =
+    { "tracker_PushBacklogJson", Setup, RunPushBacklog, TeardownPushBacklog };
+static const bench_Case_t PushBacklogFixedCase =
+    { "tracker_PushBacklogJson_fixed", Setup, RunPushBacklogFixed, TeardownPushBacklogFixed };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register the push tracking benchmark cases.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterTrackerCases
+(
+    void
+)
+{
+    bench_Register(&PushBacklogCase);
+    bench_Register(&PushBacklogFixedCase);
+}
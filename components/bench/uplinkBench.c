@@ -0,0 +1,476 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file uplinkBench.c
+ *
+ * Benchmark cases for the cloud uplink encodings:
+ *
+ *  - SenML-CBOR pack encoding of accelerometer samples (ns per sample).
+ *  - Uplink bytes per sample for each sensor, with:
+ *     - avdata: one avdata record value per sample field and one for its sequence number, each
+ *       modelled as a CBOR record carrying the full resource path, the value and an absolute
+ *       timestamp.
+ *     - senml_opaque: SenML packs small enough to be sent base64-encoded in one avdata string
+ *       value, counting the base64 text.
+ *     - senml_4k: 4 KiB SenML packs, counting the raw CBOR (for binary transports).
+ *
+ * The sizes are reported when the senml_EncodeXyzPack case is set up.  The samples come from the
+ * sensor log given with --trace, or are synthetic (1000 samples per sensor, 10 s apart, with 6
+ * decimal places like the sensors' JSON encoding).  Each sample is encoded with a sequence number,
+ * counting from 1, as it is uplinked.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "bench.h"
+#include "sampleCodec.h"
+#include "senml.h"
+#include "sensorLog.h"
+#include "assetModel.h"
+
+
+/// Largest SenML pack whose base64 text fits in an avdata string value.
+#define OPAQUE_PACK_BYTES (((LE_AVDATA_STRING_VALUE_BYTES - 1) / 4) * 3)
+
+/// Pack size for binary transports.
+#define LARGE_PACK_BYTES 4096
+
+#define SYNTH_NUM_SAMPLES 1000
+#define SYNTH_PERIOD 10.0 // seconds
+#define SYNTH_START_TIME 1500000000.0
+
+#define MAX_BASE_NAME_BYTES 128
+
+
+/// One sample, as the values of its sensor's asset model descriptor fields.
+typedef struct
+{
+    double timestamp;
+    double values[MODEL_MAX_FIELDS];
+}
+Sample_t;
+
+/// Samples of one sensor.
+typedef struct
+{
+    const model_Sensor_t* modelPtr;
+    char baseName[MAX_BASE_NAME_BYTES];     ///< SenML base name.
+    const char* names[MODEL_MAX_FIELDS];    ///< SenML names, relative to baseName.
+    Sample_t* samplesPtr;
+    size_t numSamples;
+    size_t capacity;
+}
+Series_t;
+
+
+static Series_t Series[MODEL_NUM_SENSORS];
+
+/// true once the samples have been loaded and the sizes reported.
+static bool IsLoaded = false;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a sample to a series.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AppendSample
+(
+    Series_t* seriesPtr,
+    double timestamp,
+    const double values[]
+)
+{
+    if (seriesPtr->numSamples == seriesPtr->capacity)
+    {
+        seriesPtr->capacity = (seriesPtr->capacity == 0) ? 256 : (seriesPtr->capacity * 2);
+        seriesPtr->samplesPtr = realloc(seriesPtr->samplesPtr,
+                                        seriesPtr->capacity * sizeof(Sample_t));
+        LE_ASSERT(seriesPtr->samplesPtr != NULL);
+    }
+
+    Sample_t* samplePtr = &seriesPtr->samplesPtr[seriesPtr->numSamples++];
+    samplePtr->timestamp = timestamp;
+    memcpy(samplePtr->values, values, seriesPtr->modelPtr->numFields * sizeof(double));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the series a sensor log channel's samples go to: the sensor whose name is the last element
+ * of the channel's observation path.
+ *
+ * @return The series, or NULL if the channel isn't published.
+ */
+//--------------------------------------------------------------------------------------------------
+static Series_t* GetChannelSeries
+(
+    slog_Channel_t channel
+)
+{
+    const char* obsName = strrchr(slog_GetObsPath(channel), '/') + 1;
+
+    for (size_t i = 0; i < MODEL_NUM_SENSORS; i++)
+    {
+        if (strcmp(Model_Sensors[i].name, obsName) == 0)
+        {
+            return &Series[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the samples of the published sensors from a sensor log.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadTrace
+(
+    const char* path
+)
+{
+    FILE* f = fopen(path, "rb");
+    LE_FATAL_IF(f == NULL, "Couldn't open '%s' - %m", path);
+    LE_FATAL_IF(slog_ReadHeader(f) != LE_OK, "'%s' is not a sensor log.", path);
+
+    static slog_Record_t record;
+    le_result_t result;
+    size_t numMalformed = 0;
+
+    while ((result = slog_ReadRecord(f, &record)) == LE_OK)
+    {
+        Series_t* seriesPtr = GetChannelSeries(record.channel);
+        if (seriesPtr == NULL)
+        {
+            continue;
+        }
+
+        const model_Sensor_t* modelPtr = seriesPtr->modelPtr;
+        double values[MODEL_MAX_FIELDS];
+        bool isValid = true;
+
+        for (size_t i = 0; i < modelPtr->numFields; i++)
+        {
+            values[i] = (record.type == SLOG_TYPE_NUMERIC) ? record.numeric
+                                : codec_ExtractNumber(record.json, modelPtr->fields[i].member);
+            isValid = isValid && !isnan(values[i]);
+        }
+
+        if (isValid)
+        {
+            AppendSample(seriesPtr, record.timestamp, values);
+        }
+        else
+        {
+            numMalformed++;
+        }
+    }
+
+    LE_FATAL_IF(result != LE_NOT_FOUND, "'%s' is corrupt (%s).", path, LE_RESULT_TXT(result));
+    LE_WARN_IF(numMalformed > 0, "Skipped %zu malformed samples in '%s'.", numMalformed, path);
+
+    fclose(f);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate synthetic samples for every published sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Synthesize
+(
+    void
+)
+{
+    unsigned int seed = 1;
+
+    for (size_t s = 0; s < MODEL_NUM_SENSORS; s++)
+    {
+        Series_t* seriesPtr = &Series[s];
+        const model_Sensor_t* modelPtr = seriesPtr->modelPtr;
+
+        for (size_t n = 0; n < SYNTH_NUM_SAMPLES; n++)
+        {
+            double values[MODEL_MAX_FIELDS];
+
+            for (size_t i = 0; i < modelPtr->numFields; i++)
+            {
+                double noise = ((double)rand_r(&seed) / RAND_MAX) - 0.5;
+
+                if (modelPtr->fields[i].type == MODEL_TYPE_INT)
+                {
+                    values[i] = round(400.0 + (100.0 * noise));
+                }
+                else
+                {
+                    values[i] = round((10.0 * (i + 1) + noise) * 1e6) / 1e6;
+                }
+            }
+
+            // Sample times jitter by a few milliseconds, like real sampling timers.
+            double jitter = (double)(rand_r(&seed) % 20) / 1000.0;
+
+            AppendSample(seriesPtr, SYNTH_START_TIME + (n * SYNTH_PERIOD) + jitter, values);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the uplink size of a series with one avdata record value per sample field, modelled as one
+ * CBOR record per value carrying the full resource path and an absolute timestamp.
+ *
+ * @return Bytes.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetAvdataSize
+(
+    const Series_t* seriesPtr
+)
+{
+    const model_Sensor_t* modelPtr = seriesPtr->modelPtr;
+    static const char* const NoName[] = { "" };
+    uint8_t buff[MAX_BASE_NAME_BYTES * 2];
+    char seqPath[MAX_BASE_NAME_BYTES];
+    senml_Pack_t pack;
+    size_t total = 0;
+
+    snprintf(seqPath, sizeof(seqPath), "MangOH.Sensors.Seq.%s", modelPtr->name);
+
+    for (size_t n = 0; n < seriesPtr->numSamples; n++)
+    {
+        const Sample_t* samplePtr = &seriesPtr->samplesPtr[n];
+
+        for (size_t i = 0; i < modelPtr->numFields; i++)
+        {
+            senml_Start(&pack, buff, sizeof(buff), modelPtr->fields[i].path, samplePtr->timestamp);
+            LE_ASSERT_OK(senml_AddSample(&pack,
+                                         samplePtr->timestamp,
+                                         NoName,
+                                         &samplePtr->values[i],
+                                         1,
+                                         0));
+            total += senml_Finish(&pack);
+        }
+
+        double seq = (double)(n + 1);
+
+        senml_Start(&pack, buff, sizeof(buff), seqPath, samplePtr->timestamp);
+        LE_ASSERT_OK(senml_AddSample(&pack, samplePtr->timestamp, NoName, &seq, 1, 0));
+        total += senml_Finish(&pack);
+    }
+
+    return total;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the uplink size of a series in SenML packs of at most a given size.
+ *
+ * @return Bytes (of the base64 text if isBase64 is true, of the CBOR otherwise).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetSenmlSize
+(
+    const Series_t* seriesPtr,
+    size_t maxPackBytes,
+    bool isBase64
+)
+{
+    uint8_t buff[LARGE_PACK_BYTES];
+    senml_Pack_t pack;
+    size_t total = 0;
+    size_t n = 0;
+
+    LE_ASSERT(maxPackBytes <= sizeof(buff));
+
+    while (n < seriesPtr->numSamples)
+    {
+        senml_Start(&pack, buff, maxPackBytes, seriesPtr->baseName,
+                    seriesPtr->samplesPtr[n].timestamp);
+
+        size_t first = n;
+
+        while (   (n < seriesPtr->numSamples)
+               && (senml_AddSample(&pack,
+                                   seriesPtr->samplesPtr[n].timestamp,
+                                   seriesPtr->names,
+                                   seriesPtr->samplesPtr[n].values,
+                                   seriesPtr->modelPtr->numFields,
+                                   n + 1) == LE_OK))
+        {
+            n++;
+        }
+
+        LE_FATAL_IF(n == first, "A %s sample doesn't fit in a %zu byte pack.",
+                    seriesPtr->modelPtr->name, maxPackBytes);
+
+        size_t packLen = senml_Finish(&pack);
+        total += isBase64 ? (((packLen + 2) / 3) * 4) : packLen;
+    }
+
+    return total;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the uplink bytes per sample of each sensor with each encoding.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReportSizes
+(
+    void
+)
+{
+    for (size_t s = 0; s < MODEL_NUM_SENSORS; s++)
+    {
+        const Series_t* seriesPtr = &Series[s];
+
+        if (seriesPtr->numSamples == 0)
+        {
+            continue;
+        }
+
+        char benchName[64];
+        double numSamples = (double)seriesPtr->numSamples;
+        snprintf(benchName, sizeof(benchName), "uplink_size_%s", seriesPtr->modelPtr->name);
+
+        bench_ReportValue(benchName, "samples", numSamples);
+        bench_ReportValue(benchName,
+                          "avdata_bytes_per_sample",
+                          GetAvdataSize(seriesPtr) / numSamples);
+        bench_ReportValue(benchName,
+                          "senml_opaque_bytes_per_sample",
+                          GetSenmlSize(seriesPtr, OPAQUE_PACK_BYTES, true) / numSamples);
+        bench_ReportValue(benchName,
+                          "senml_4k_bytes_per_sample",
+                          GetSenmlSize(seriesPtr, LARGE_PACK_BYTES, false) / numSamples);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the samples (once) and report the uplink sizes.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetupSeries
+(
+    void
+)
+{
+    if (IsLoaded)
+    {
+        return LE_OK;
+    }
+
+    for (size_t s = 0; s < MODEL_NUM_SENSORS; s++)
+    {
+        Series_t* seriesPtr = &Series[s];
+        const model_Sensor_t* modelPtr = &Model_Sensors[s];
+        const char* paths[MODEL_MAX_FIELDS];
+
+        seriesPtr->modelPtr = modelPtr;
+
+        for (size_t i = 0; i < modelPtr->numFields; i++)
+        {
+            paths[i] = modelPtr->fields[i].path;
+        }
+
+        size_t baseNameLen = senml_GetBaseNameLen(paths, modelPtr->numFields);
+        LE_ASSERT(baseNameLen < sizeof(seriesPtr->baseName));
+        memcpy(seriesPtr->baseName, paths[0], baseNameLen);
+        seriesPtr->baseName[baseNameLen] = '\0';
+
+        for (size_t i = 0; i < modelPtr->numFields; i++)
+        {
+            seriesPtr->names[i] = paths[i] + baseNameLen;
+        }
+    }
+
+    const char* tracePath = bench_GetTracePath();
+    if (tracePath != NULL)
+    {
+        LoadTrace(tracePath);
+    }
+    else
+    {
+        Synthesize();
+    }
+
+    ReportSizes();
+
+    IsLoaded = true;
+
+    return (Series[MODEL_SENSOR_ACCEL].numSamples > 0) ? LE_OK : LE_NOT_FOUND;
+}
+
+
+static void RunEncodePack
+(
+    uint64_t iterations
+)
+{
+    const Series_t* seriesPtr = &Series[MODEL_SENSOR_ACCEL];
+    uint8_t buff[LARGE_PACK_BYTES];
+    senml_Pack_t pack;
+    size_t n = 0;
+    size_t len = 0;
+
+    senml_Start(&pack, buff, sizeof(buff), seriesPtr->baseName, seriesPtr->samplesPtr[0].timestamp);
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        const Sample_t* samplePtr = &seriesPtr->samplesPtr[n];
+
+        if (senml_AddSample(&pack,
+                            samplePtr->timestamp,
+                            seriesPtr->names,
+                            samplePtr->values,
+                            seriesPtr->modelPtr->numFields,
+                            i + 1) != LE_OK)
+        {
+            len += senml_Finish(&pack);
+            senml_Start(&pack, buff, sizeof(buff), seriesPtr->baseName, samplePtr->timestamp);
+            LE_ASSERT_OK(senml_AddSample(&pack,
+                                         samplePtr->timestamp,
+                                         seriesPtr->names,
+                                         samplePtr->values,
+                                         seriesPtr->modelPtr->numFields,
+                                         i + 1));
+        }
+
+        n = ((n + 1) < seriesPtr->numSamples) ? (n + 1) : 0;
+    }
+
+    len += senml_Finish(&pack);
+
+    bench_Consume(len);
+}
+
+
+static const bench_Case_t EncodePackCase =
+    { "senml_EncodeXyzPack", SetupSeries, RunEncodePack, NULL };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register the uplink encoding benchmark cases.
+ */
+//--------------------------------------------------------------------------------------------------
+void bench_RegisterUplinkCases
+(
+    void
+)
+{
+    bench_Register(&EncodePackCase);
+}
@@ -85,6 +85,39 @@ done:
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a sensor driver attribute file (e.g., "in_accel_x_raw").  The directory is
+ * FILE_DEFAULT_DRIVER_DIR unless overridden by the FILE_DRIVER_DIR_ENV environment variable.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the path doesn't fit in the buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_MakeDriverPath
+(
+    const char *attrName,
+    char *pathBuf,
+    size_t pathBufSize
+)
+{
+    const char *dir = getenv(FILE_DRIVER_DIR_ENV);
+    if ((dir == NULL) || (dir[0] == '\0'))
+    {
+        dir = FILE_DEFAULT_DRIVER_DIR;
+    }
+
+    int len = snprintf(pathBuf, pathBufSize, "%s/%s", dir, attrName);
+    if ((len < 0) || (len >= pathBufSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
 COMPONENT_INIT
 {
 }
@@ -12,6 +12,14 @@
 #define FILE_UTILS_H_INCLUDE_GUARD
 
 
+/// Environment variable that overrides the directory the sensor driver attribute files are in.
+/// Used to point the sensor components at a fake sysfs tree when running off-target.
+#define FILE_DRIVER_DIR_ENV "SENSOR_DRIVER_DIR"
+
+/// Directory the sensor driver attribute files are bundled into on target.
+#define FILE_DEFAULT_DRIVER_DIR "/driver"
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Read a signed integer from a sysfs file (convert the string contents to a number).
@@ -46,4 +54,22 @@ LE_SHARED le_result_t file_ReadDouble
 );
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a sensor driver attribute file (e.g., "in_accel_x_raw").  The directory is
+ * FILE_DEFAULT_DRIVER_DIR unless overridden by the FILE_DRIVER_DIR_ENV environment variable.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the path doesn't fit in the buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_MakeDriverPath
+(
+    const char *attrName,
+    char *pathBuf,
+    size_t pathBufSize
+);
+
+
 #endif // FILE_UTILS_H_INCLUDE_GUARD
@@ -0,0 +1,628 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuCalibration.c
+ *
+ * Online gyro bias and accelerometer offset calibration (see imuCalibration.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "imuCalibration.h"
+
+
+/// Standard gravity (m/s^2).
+#define STANDARD_GRAVITY 9.80665
+
+/// Longest line of a calibration file (including the newline and null terminator).
+#define MAX_LINE_BYTES 256
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the bin of a temperature.
+ *
+ * @return The index of the nearest bin.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetBin
+(
+    double temperature
+)
+{
+    double pos = (temperature - CALIB_MIN_TEMP) / CALIB_BIN_WIDTH;
+
+    // Also catches NaN.
+    if (!(pos > 0.0))
+    {
+        return 0;
+    }
+    if (pos >= (CALIB_NUM_BINS - 1))
+    {
+        return CALIB_NUM_BINS - 1;
+    }
+
+    return (size_t)(pos + 0.5);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Interpolate one correction of every bin center from the bins that have it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Interpolate
+(
+    const calib_Table_t* tablePtr,
+    bool isGyro,
+    double values[CALIB_NUM_BINS][3]    ///< [OUT]
+)
+{
+    int lower = -1;
+
+    for (int i = 0; i < CALIB_NUM_BINS; i++)
+    {
+        const calib_Bin_t* binPtr = &tablePtr->bins[i];
+        if ((isGyro ? binPtr->gyroWeight : binPtr->accelWindows) > 0.0)
+        {
+            lower = i;
+        }
+
+        int upper = -1;
+        for (int j = i; j < CALIB_NUM_BINS; j++)
+        {
+            binPtr = &tablePtr->bins[j];
+            if ((isGyro ? binPtr->gyroWeight : binPtr->accelWindows) > 0.0)
+            {
+                upper = j;
+                break;
+            }
+        }
+
+        // Outside the calibrated bins, hold the nearest one.
+        int low = (lower < 0) ? upper : lower;
+        int high = (upper < 0) ? lower : upper;
+
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            if (low < 0)
+            {
+                values[i][axis] = 0.0;
+                continue;
+            }
+
+            const calib_Bin_t* lowPtr = &tablePtr->bins[low];
+            const calib_Bin_t* highPtr = &tablePtr->bins[high];
+            double lowValue = isGyro ? lowPtr->gyroBias[axis] : lowPtr->accelOffset[axis];
+            double highValue = isGyro ? highPtr->gyroBias[axis] : highPtr->accelOffset[axis];
+
+            values[i][axis] = (high == low) ? lowValue
+                                           : lowValue + ((highValue - lowValue) * (i - low)
+                                                         / (high - low));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rebuild the interpolated corrections after bins changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Rebuild
+(
+    calib_Table_t* tablePtr
+)
+{
+    Interpolate(tablePtr, true, tablePtr->gyroBias);
+    Interpolate(tablePtr, false, tablePtr->accelOffset);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fit the center of the sphere through a bin's stationary mean accelerations.
+ *
+ * |a|^2 = 2 a.o + k for every acceleration a on the sphere of center o, so the center is half the
+ * least-squares slope of |a|^2 against a: o = Cov(a)^-1 Cov(a, |a|^2) / 2.  The covariance is
+ * solved by Cholesky decomposition, whose pivots also tell whether the accelerations spread along
+ * every axis.
+ *
+ * @return LE_OK if successful, LE_UNDERFLOW if the accelerations don't spread enough,
+ *         LE_OUT_OF_RANGE if the center is too far from 0 to be an offset.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t FitSphere
+(
+    const calib_Fit_t* fitPtr,
+    double center[3]            ///< [OUT]
+)
+{
+    double n = fitPtr->count;
+    double mean[3];
+    double cov[3][3];
+    double rhs[3];
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        mean[i] = fitPtr->sum[i] / n;
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        for (size_t j = 0; j < 3; j++)
+        {
+            cov[i][j] = (fitPtr->sumProducts[i][j] / n) - (mean[i] * mean[j]);
+        }
+        rhs[i] = (fitPtr->sumScaled[i] / n) - (mean[i] * fitPtr->sumSquares / n);
+    }
+
+    // Cholesky decomposition cov = L L^T, in the lower triangle.
+    double l[3][3] = { { 0.0 } };
+    for (size_t j = 0; j < 3; j++)
+    {
+        double pivot = cov[j][j];
+        for (size_t k = 0; k < j; k++)
+        {
+            pivot -= l[j][k] * l[j][k];
+        }
+        if (pivot < (CALIB_MIN_SPREAD * CALIB_MIN_SPREAD))
+        {
+            return LE_UNDERFLOW;
+        }
+        l[j][j] = sqrt(pivot);
+
+        for (size_t i = j + 1; i < 3; i++)
+        {
+            double value = cov[i][j];
+            for (size_t k = 0; k < j; k++)
+            {
+                value -= l[i][k] * l[j][k];
+            }
+            l[i][j] = value / l[j][j];
+        }
+    }
+
+    // Solve L y = rhs, then L^T x = y.
+    double y[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        y[i] = rhs[i];
+        for (size_t k = 0; k < i; k++)
+        {
+            y[i] -= l[i][k] * y[k];
+        }
+        y[i] /= l[i][i];
+    }
+    for (int i = 2; i >= 0; i--)
+    {
+        double x = y[i];
+        for (int k = i + 1; k < 3; k++)
+        {
+            x -= l[k][i] * center[k];
+        }
+        center[i] = x / l[i][i];
+    }
+
+    double norm = 0.0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        center[i] /= 2.0;
+        norm += center[i] * center[i];
+    }
+
+    return (sqrt(norm) > CALIB_MAX_ACCEL_OFFSET) ? LE_OUT_OF_RANGE : LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update a bin's accelerometer offset with the mean acceleration of a stationary window.
+ *
+ * @return true if the offset changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool UpdateAccelOffset
+(
+    calib_Fit_t* fitPtr,
+    calib_Bin_t* binPtr,
+    const double accel[3]
+)
+{
+    // Halve the weight of the older accelerations, so the fit follows aging.
+    if (fitPtr->count >= CALIB_MAX_WEIGHT)
+    {
+        fitPtr->count /= 2.0;
+        fitPtr->sumSquares /= 2.0;
+        for (size_t i = 0; i < 3; i++)
+        {
+            fitPtr->sum[i] /= 2.0;
+            fitPtr->sumScaled[i] /= 2.0;
+            for (size_t j = 0; j < 3; j++)
+            {
+                fitPtr->sumProducts[i][j] /= 2.0;
+            }
+        }
+    }
+
+    double squares = (accel[0] * accel[0]) + (accel[1] * accel[1]) + (accel[2] * accel[2]);
+
+    fitPtr->count += 1.0;
+    fitPtr->sumSquares += squares;
+    for (size_t i = 0; i < 3; i++)
+    {
+        fitPtr->sum[i] += accel[i];
+        fitPtr->sumScaled[i] += accel[i] * squares;
+        for (size_t j = 0; j < 3; j++)
+        {
+            fitPtr->sumProducts[i][j] += accel[i] * accel[j];
+        }
+    }
+
+    double center[3];
+    if (FitSphere(fitPtr, center) != LE_OK)
+    {
+        return false;
+    }
+
+    memcpy(binPtr->accelOffset, center, sizeof(center));
+    binPtr->accelWindows = fitPtr->count;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the table with the current window, if it is stationary.
+ *
+ * @return true if the table changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool EndWindow
+(
+    calib_Estimator_t* estimatorPtr
+)
+{
+    double n = (double)estimatorPtr->count;
+    double mean[7];
+
+    for (size_t i = 0; i < 7; i++)
+    {
+        mean[i] = estimatorPtr->sum[i] / n;
+    }
+
+    for (size_t i = 0; i < 6; i++)
+    {
+        double variance = (estimatorPtr->sumSquares[i] / n) - (mean[i] * mean[i]);
+        double still = (i < 3) ? CALIB_GYRO_STILL : CALIB_ACCEL_STILL;
+
+        if (variance > (still * still))
+        {
+            return false;
+        }
+    }
+
+    const double* gyro = &mean[0];
+    const double* accel = &mean[3];
+    double magnitude = sqrt((accel[0] * accel[0]) + (accel[1] * accel[1]) + (accel[2] * accel[2]));
+
+    if (fabs(magnitude - STANDARD_GRAVITY) > CALIB_MAX_ACCEL_OFFSET)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (fabs(gyro[i]) > CALIB_MAX_GYRO_BIAS)
+        {
+            return false;
+        }
+    }
+
+    size_t bin = GetBin(mean[6]);
+    calib_Bin_t* binPtr = &estimatorPtr->tablePtr->bins[bin];
+
+    if (binPtr->gyroWeight < CALIB_MAX_WEIGHT)
+    {
+        binPtr->gyroWeight += 1.0;
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        binPtr->gyroBias[i] += (gyro[i] - binPtr->gyroBias[i]) / binPtr->gyroWeight;
+    }
+
+    UpdateAccelOffset(&estimatorPtr->fits[bin], binPtr, accel);
+
+    Rebuild(estimatorPtr->tablePtr);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an empty table, which corrects nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+void calib_InitTable
+(
+    calib_Table_t* tablePtr
+)
+{
+    memset(tablePtr, 0, sizeof(*tablePtr));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an estimator updating a table.
+ */
+//--------------------------------------------------------------------------------------------------
+void calib_Init
+(
+    calib_Estimator_t* estimatorPtr,
+    calib_Table_t* tablePtr,
+    size_t windowSize
+)
+{
+    LE_ASSERT(windowSize >= 2);
+
+    memset(estimatorPtr, 0, sizeof(*estimatorPtr));
+    estimatorPtr->tablePtr = tablePtr;
+    estimatorPtr->windowSize = windowSize;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a raw sample.
+ *
+ * @return true if the sample ended a stationary window, which updated the table.
+ */
+//--------------------------------------------------------------------------------------------------
+bool calib_Add
+(
+    calib_Estimator_t* estimatorPtr,
+    const double gyro[3],
+    const double accel[3],
+    double temperature
+)
+{
+    for (size_t i = 0; i < 3; i++)
+    {
+        estimatorPtr->sum[i] += gyro[i];
+        estimatorPtr->sumSquares[i] += gyro[i] * gyro[i];
+        estimatorPtr->sum[3 + i] += accel[i];
+        estimatorPtr->sumSquares[3 + i] += accel[i] * accel[i];
+    }
+    estimatorPtr->sum[6] += temperature;
+    estimatorPtr->count++;
+
+    if (estimatorPtr->count < estimatorPtr->windowSize)
+    {
+        return false;
+    }
+
+    bool isUpdated = EndWindow(estimatorPtr);
+
+    estimatorPtr->count = 0;
+    memset(estimatorPtr->sum, 0, sizeof(estimatorPtr->sum));
+    memset(estimatorPtr->sumSquares, 0, sizeof(estimatorPtr->sumSquares));
+
+    return isUpdated;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct raw samples, in place, at a temperature.  Either may be NULL.
+ */
+//--------------------------------------------------------------------------------------------------
+void calib_Apply
+(
+    const calib_Table_t* tablePtr,
+    double temperature,
+    double gyro[3],
+    double accel[3]
+)
+{
+    double pos = (temperature - CALIB_MIN_TEMP) / CALIB_BIN_WIDTH;
+    size_t bin;
+    double fraction;
+
+    if (!(pos > 0.0))
+    {
+        bin = 0;
+        fraction = 0.0;
+    }
+    else if (pos >= (CALIB_NUM_BINS - 1))
+    {
+        bin = CALIB_NUM_BINS - 2;
+        fraction = 1.0;
+    }
+    else
+    {
+        bin = (size_t)pos;
+        fraction = pos - bin;
+    }
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (gyro != NULL)
+        {
+            const double (*biasPtr)[3] = &tablePtr->gyroBias[bin];
+            gyro[i] -= biasPtr[0][i] + (fraction * (biasPtr[1][i] - biasPtr[0][i]));
+        }
+        if (accel != NULL)
+        {
+            const double (*offsetPtr)[3] = &tablePtr->accelOffset[bin];
+            accel[i] -= offsetPtr[0][i] + (fraction * (offsetPtr[1][i] - offsetPtr[0][i]));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of calibrated bins.
+ *
+ * @return The number of bins with a gyro bias, and, through accelBinsPtr, with an accelerometer
+ *         offset.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t calib_CountBins
+(
+    const calib_Table_t* tablePtr,
+    size_t* accelBinsPtr
+)
+{
+    size_t gyroBins = 0;
+    size_t accelBins = 0;
+
+    for (size_t i = 0; i < CALIB_NUM_BINS; i++)
+    {
+        gyroBins += (tablePtr->bins[i].gyroWeight > 0.0);
+        accelBins += (tablePtr->bins[i].accelWindows > 0.0);
+    }
+
+    *accelBinsPtr = accelBins;
+    return gyroBins;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load a table from a file, replacing its bins.  Malformed lines are skipped.
+ *
+ * @return LE_OK if successful, LE_NOT_FOUND if there is no file, LE_FAULT if it can't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t calib_Load
+(
+    calib_Table_t* tablePtr,
+    const char* path
+)
+{
+    FILE* filePtr = fopen(path, "r");
+    if (filePtr == NULL)
+    {
+        return (errno == ENOENT) ? LE_NOT_FOUND : LE_FAULT;
+    }
+
+    calib_InitTable(tablePtr);
+
+    char line[MAX_LINE_BYTES];
+    unsigned int lineNum = 0;
+
+    while (fgets(line, sizeof(line), filePtr) != NULL)
+    {
+        lineNum++;
+        if ((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+
+        double temperature;
+        calib_Bin_t bin;
+        int numFields = sscanf(line,
+                               "%lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                               &temperature,
+                               &bin.gyroWeight,
+                               &bin.gyroBias[0],
+                               &bin.gyroBias[1],
+                               &bin.gyroBias[2],
+                               &bin.accelWindows,
+                               &bin.accelOffset[0],
+                               &bin.accelOffset[1],
+                               &bin.accelOffset[2]);
+        if (   (numFields != 9)
+            || (bin.gyroWeight < 0.0)
+            || (bin.accelWindows < 0.0)
+            || (fabs(temperature - (CALIB_MIN_TEMP + (GetBin(temperature) * CALIB_BIN_WIDTH)))
+                > 0.01))
+        {
+            LE_WARN("%s:%u: malformed calibration. Skipped.", path, lineNum);
+            continue;
+        }
+
+        tablePtr->bins[GetBin(temperature)] = bin;
+    }
+
+    bool isOk = !ferror(filePtr);
+    fclose(filePtr);
+
+    Rebuild(tablePtr);
+
+    return isOk ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save a table to a file.
+ *
+ * The table is written to a temporary file beside the target, synced, and then renamed over the
+ * target, so a power loss during a save leaves the previous table intact.
+ *
+ * @return LE_OK if successful, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t calib_Save
+(
+    const calib_Table_t* tablePtr,
+    const char* path
+)
+{
+    char tmpPath[PATH_MAX];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath))
+    {
+        return LE_FAULT;
+    }
+
+    FILE* filePtr = fopen(tmpPath, "w");
+    if (filePtr == NULL)
+    {
+        return LE_FAULT;
+    }
+
+    bool isOk = (fprintf(filePtr,
+                         "# temp gyroWeight gx gy gz accelWindows ax ay az"
+                         " (degC, rad/s, m/s^2)\n") > 0);
+
+    for (size_t i = 0; isOk && (i < CALIB_NUM_BINS); i++)
+    {
+        const calib_Bin_t* binPtr = &tablePtr->bins[i];
+
+        if ((binPtr->gyroWeight > 0.0) || (binPtr->accelWindows > 0.0))
+        {
+            isOk = (fprintf(filePtr,
+                            "%.1f %.0f %.7g %.7g %.7g %.1f %.7g %.7g %.7g\n",
+                            CALIB_MIN_TEMP + (i * CALIB_BIN_WIDTH),
+                            binPtr->gyroWeight,
+                            binPtr->gyroBias[0],
+                            binPtr->gyroBias[1],
+                            binPtr->gyroBias[2],
+                            binPtr->accelWindows,
+                            binPtr->accelOffset[0],
+                            binPtr->accelOffset[1],
+                            binPtr->accelOffset[2]) > 0);
+        }
+    }
+
+    isOk = isOk && (fflush(filePtr) == 0) && (fsync(fileno(filePtr)) == 0);
+    isOk = (fclose(filePtr) == 0) && isOk;
+    isOk = isOk && (rename(tmpPath, path) == 0);
+
+    if (!isOk)
+    {
+        unlink(tmpPath);
+        return LE_FAULT;
+    }
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,215 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuCalibration.h
+ *
+ * Online calibration of the IMU's gyro bias and accelerometer offset against temperature.
+ *
+ * Samples of the raw gyro and accelerometer are added in windows of a fixed number of samples.
+ * A window is stationary if no axis of either sensor varies by more than CALIB_GYRO_STILL or
+ * CALIB_ACCEL_STILL (standard deviation), and the mean acceleration is gravity to within
+ * CALIB_MAX_ACCEL_OFFSET.  Each stationary window updates the temperature bin of its mean
+ * temperature (CALIB_BIN_WIDTH degrees wide, centered on multiples of it from CALIB_MIN_TEMP):
+ *
+ *  - The gyro bias is the window's mean rotation, averaged over the bin's windows (up to
+ *    CALIB_MAX_WEIGHT, so it follows slow drift).
+ *  - The accelerometer offset is the center of the sphere best fitting the bin's stationary mean
+ *    accelerations.  Gravity's magnitude is all that is known in an arbitrary orientation, so a
+ *    bin's offset is only estimated once its windows' accelerations spread (standard deviation)
+ *    at least CALIB_MIN_SPREAD along every axis, i.e., after the board has rested in several
+ *    orientations at that temperature.  A board that never moves keeps its accelerometer offset
+ *    at 0.
+ *
+ * Corrections are interpolated linearly between the centers of the calibrated bins, and held at
+ * the nearest calibrated bin outside them.  The interpolated table is rebuilt when a bin changes,
+ * so applying it only takes a bin lookup and a few multiply-adds.
+ *
+ * The bins persist to a text file, one line per calibrated bin:
+ *
+ * <temp> <gyroWeight> <gx> <gy> <gz> <accelWindows> <ax> <ay> <az>
+ *
+ * (degrees C, rad/s, m/s^2), where accelWindows is 0 if the bin's accelerometer offset isn't
+ * estimated.  Lines starting with # are comments.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef IMU_CALIBRATION_H_INCLUDE_GUARD
+#define IMU_CALIBRATION_H_INCLUDE_GUARD
+
+
+/// Center of the lowest temperature bin (degrees C).
+#define CALIB_MIN_TEMP -40.0
+
+/// Width of a temperature bin (degrees C).
+#define CALIB_BIN_WIDTH 5.0
+
+/// Number of temperature bins (up to 85 degrees C).
+#define CALIB_NUM_BINS 26
+
+/// Largest gyro standard deviation on any axis in a stationary window (rad/s).
+#define CALIB_GYRO_STILL 0.01
+
+/// Largest accelerometer standard deviation on any axis in a stationary window (m/s^2).
+#define CALIB_ACCEL_STILL 0.05
+
+/// Largest gyro bias accepted (rad/s).  A steady rotation faster than this isn't bias.
+#define CALIB_MAX_GYRO_BIAS 0.1
+
+/// Largest difference between the mean acceleration's magnitude and gravity in a stationary
+/// window (m/s^2).
+#define CALIB_MAX_ACCEL_OFFSET 1.0
+
+/// Standard deviation of the stationary mean accelerations needed along every axis to fit a bin's
+/// accelerometer offset (m/s^2, about 0.3 g).
+#define CALIB_MIN_SPREAD 3.0
+
+/// Largest number of windows a bin's gyro bias is averaged over, and of stationary mean
+/// accelerations kept for its offset (the older ones are halved in weight).
+#define CALIB_MAX_WEIGHT 64
+
+
+/// Calibration of a temperature bin.
+typedef struct
+{
+    double gyroWeight;          ///< Number of stationary windows averaged (0 if uncalibrated).
+    double gyroBias[3];         ///< rad/s
+    double accelWindows;        ///< Weight of the offset's fit (0 if not estimated).
+    double accelOffset[3];      ///< m/s^2
+}
+calib_Bin_t;
+
+
+/// Calibration table.  Initialize with calib_InitTable().
+typedef struct
+{
+    calib_Bin_t bins[CALIB_NUM_BINS];
+    double gyroBias[CALIB_NUM_BINS][3];     ///< Interpolated at every bin center.
+    double accelOffset[CALIB_NUM_BINS][3];  ///< Interpolated at every bin center.
+}
+calib_Table_t;
+
+
+/// Sums of the stationary mean accelerations of a bin, for fitting its offset.
+typedef struct
+{
+    double count;
+    double sum[3];
+    double sumProducts[3][3];   ///< Sum of a[i] * a[j].
+    double sumSquares;          ///< Sum of |a|^2.
+    double sumScaled[3];        ///< Sum of a[i] * |a|^2.
+}
+calib_Fit_t;
+
+
+/// Estimator updating a table.  Initialize with calib_Init().
+typedef struct
+{
+    calib_Table_t* tablePtr;
+    size_t windowSize;          ///< Samples per window.
+    size_t count;               ///< Samples in the current window.
+    double sum[7];              ///< Sums of the window's gyro, accel and temperature.
+    double sumSquares[6];       ///< Sums of squares of the window's gyro and accel.
+    calib_Fit_t fits[CALIB_NUM_BINS];
+}
+calib_Estimator_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an empty table, which corrects nothing.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void calib_InitTable
+(
+    calib_Table_t* tablePtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an estimator updating a table.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void calib_Init
+(
+    calib_Estimator_t* estimatorPtr,
+    calib_Table_t* tablePtr,
+    size_t windowSize               ///< Samples per window (at least 2).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a raw sample.
+ *
+ * @return true if the sample ended a stationary window, which updated the table.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool calib_Add
+(
+    calib_Estimator_t* estimatorPtr,
+    const double gyro[3],           ///< rad/s
+    const double accel[3],          ///< m/s^2
+    double temperature              ///< degrees C
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct raw samples, in place, at a temperature.  Either may be NULL.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void calib_Apply
+(
+    const calib_Table_t* tablePtr,
+    double temperature,             ///< degrees C
+    double gyro[3],                 ///< rad/s
+    double accel[3]                 ///< m/s^2
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of calibrated bins.
+ *
+ * @return The number of bins with a gyro bias, and, through accelBinsPtr, with an accelerometer
+ *         offset.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED size_t calib_CountBins
+(
+    const calib_Table_t* tablePtr,
+    size_t* accelBinsPtr            ///< [OUT]
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load a table from a file, replacing its bins.  Malformed lines are skipped.
+ *
+ * @return LE_OK if successful, LE_NOT_FOUND if there is no file, LE_FAULT if it can't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t calib_Load
+(
+    calib_Table_t* tablePtr,
+    const char* path
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save a table to a file.
+ *
+ * @return LE_OK if successful, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t calib_Save
+(
+    const calib_Table_t* tablePtr,
+    const char* path
+);
+
+
+#endif // IMU_CALIBRATION_H_INCLUDE_GUARD
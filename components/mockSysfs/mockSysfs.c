@@ -0,0 +1,547 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file mockSysfs.c
+ *
+ * Generates and animates a fake sensor driver tree, so the redSensor components can run on a
+ * development host (localhost build) without the mangOH Red hardware.
+ *
+ * Usage: mocksysfs [--dir=DIR] [--speed=N] [--loop] [--script=FILE | --log=FILE]
+ *
+ * The tree contains the IIO attribute files the IMU and pressure components read (in_accel_x_raw,
+ * in_pressure_input, ...) plus the files read by the mock sensor backend (adc/EXT_ADC3 and
+ * pos/location, see mockBackend.c).  Point redSensor at it with SENSOR_DRIVER_DIR.
+ *
+ * The values written come from one of:
+ *
+ *  - A script (--script): text lines of the form "<seconds> <file> <contents...>".  At the given
+ *    time since start, the file (relative to DIR) is replaced with the contents.  Lines must be in
+ *    time order.  Blank lines and lines starting with '#' are ignored.
+ *  - A recorded sensor log (--log, see sensorLog.h): each sample is converted back into the
+ *    driver files that would have produced it (with the scales set to 1).
+ *  - Otherwise, a built-in script of a device lying still on a desk.
+ *
+ * --speed plays the script or log N times faster than real time.  --loop restarts it when the end
+ * is reached.  Files are replaced atomically (written to a temporary file then renamed), so a
+ * reader never sees a partial value.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "json.h"
+#include "sensorLog.h"
+
+
+#define DEFAULT_DRIVER_DIR "/tmp/redMock/driver"
+
+/// Maximum number of files written by one event.
+#define MAX_WRITES_PER_EVENT 3
+
+#define MAX_FILE_NAME_BYTES 64
+#define MAX_CONTENTS_BYTES 128
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A set of file writes that happen at the same time.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double time;    ///< Seconds since the start of the script or log.
+    size_t numWrites;
+    struct
+    {
+        char file[MAX_FILE_NAME_BYTES];
+        char contents[MAX_CONTENTS_BYTES];
+    }
+    writes[MAX_WRITES_PER_EVENT];
+}
+Event_t;
+
+
+/// Static attribute files that are written once, at start-up.
+static const char* const StaticFiles[][2] =
+{
+    { "in_accel_scale", "1.0" },
+    { "in_anglvel_scale", "1.0" },
+    { "in_temp_scale", "1.0" },
+    { "in_temp_offset", "0" },
+};
+
+/// Built-in script used when neither a script nor a log is given: a device at rest on a desk.
+static const char* const DefaultScript[] =
+{
+    "0.0 in_accel_x_raw 0.012",
+    "0.0 in_accel_y_raw -0.020",
+    "0.0 in_accel_z_raw 9.806",
+    "0.0 in_anglvel_x_raw 0.001",
+    "0.0 in_anglvel_y_raw -0.002",
+    "0.0 in_anglvel_z_raw 0.000",
+    "0.0 in_temp_raw 24500",
+    "0.0 in_pressure_input 101.325",
+    "0.0 in_temp_input 23800",
+    "0.0 adc/EXT_ADC3 512",
+    "0.0 pos/location 49172350 -123070987 14 9 8",
+    "5.0 in_accel_x_raw 0.015",
+    "5.0 in_temp_input 23900",
+    "5.0 adc/EXT_ADC3 530",
+    "10.0 in_accel_x_raw 0.012",
+    "10.0 in_temp_input 23800",
+    "10.0 adc/EXT_ADC3 512",
+};
+
+
+static const char* DriverDir = DEFAULT_DRIVER_DIR;
+static const char* ScriptPath = NULL;
+static const char* LogPath = NULL;
+static int Speed = 1;
+static bool IsLooping = false;
+
+/// Open script or log file (NULL when playing the built-in script).
+static FILE* InputFile = NULL;
+
+/// Index of the next line of the built-in script.
+static size_t DefaultScriptIndex = 0;
+
+/// Timestamp of the first record in the log.
+static double FirstLogTimestamp = NAN;
+
+/// The next event to be played, and the absolute time (s) at which playing (re)started.
+static Event_t Next;
+static double StartTime;
+
+static le_timer_Ref_t PaceTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Atomically replace the contents of a file in the fake driver tree.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteFile
+(
+    const char* file,
+    const char* contents
+)
+{
+    char path[PATH_MAX];
+    char tmpPath[PATH_MAX];
+
+    LE_FATAL_IF(snprintf(path, sizeof(path), "%s/%s", DriverDir, file) >= sizeof(path),
+                "Path too long for '%s'.",
+                file);
+    LE_FATAL_IF(snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= sizeof(tmpPath),
+                "Path too long for '%s'.",
+                file);
+
+    FILE* f = fopen(tmpPath, "w");
+    LE_FATAL_IF(f == NULL, "Couldn't create '%s' - %m", tmpPath);
+
+    fprintf(f, "%s\n", contents);
+
+    LE_FATAL_IF(fclose(f) != 0, "Couldn't write '%s' - %m", tmpPath);
+    LE_FATAL_IF(rename(tmpPath, path) != 0, "Couldn't rename '%s' - %m", tmpPath);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a file write to an event.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddWrite
+(
+    Event_t* eventPtr,
+    const char* file,
+    const char* format,
+    ...
+)
+{
+    LE_ASSERT(eventPtr->numWrites < MAX_WRITES_PER_EVENT);
+
+    LE_ASSERT(le_utf8_Copy(eventPtr->writes[eventPtr->numWrites].file,
+                           file,
+                           sizeof(eventPtr->writes[0].file),
+                           NULL) == LE_OK);
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(eventPtr->writes[eventPtr->numWrites].contents,
+              sizeof(eventPtr->writes[0].contents),
+              format,
+              args);
+    va_end(args);
+
+    eventPtr->numWrites++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a script line into an event.
+ *
+ * @return
+ *  - LE_OK if the line holds an event.
+ *  - LE_NOT_FOUND if the line is blank or a comment.
+ *  - LE_FORMAT_ERROR if the line is malformed.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseScriptLine
+(
+    const char* line,
+    Event_t* eventPtr
+)
+{
+    while (isspace((unsigned char)*line))
+    {
+        line++;
+    }
+
+    if ((*line == '\0') || (*line == '#'))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    char file[MAX_FILE_NAME_BYTES];
+    int contentsOffset;
+
+    if (sscanf(line, "%lf %63s %n", &eventPtr->time, file, &contentsOffset) != 2)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    char contents[MAX_CONTENTS_BYTES];
+    if (le_utf8_Copy(contents, line + contentsOffset, sizeof(contents), NULL) != LE_OK)
+    {
+        return LE_FORMAT_ERROR;
+    }
+    contents[strcspn(contents, "\r\n")] = '\0';
+
+    eventPtr->numWrites = 0;
+    AddWrite(eventPtr, file, "%s", contents);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract the members of a JSON sample.
+ *
+ * @return LE_OK if all the members were found and are numbers.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ExtractNumbers
+(
+    const char* json,
+    const char* const memberNames[],
+    double values[],
+    size_t count
+)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        char member[32];
+        json_DataType_t dataType;
+
+        if (   (json_Extract(member, sizeof(member), json, memberNames[i], &dataType) != LE_OK)
+            || (dataType != JSON_TYPE_NUMBER)  )
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        values[i] = json_ConvertToNumber(member);
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a sensor log record into the driver file writes that would have produced it.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ConvertLogRecord
+(
+    const slog_Record_t* recPtr,
+    Event_t* eventPtr
+)
+{
+    static const char* const xyz[] = { "x", "y", "z" };
+    static const char* const position[] = { "lat", "lon", "hAcc", "alt", "vAcc" };
+    double v[5];
+
+    eventPtr->time = recPtr->timestamp - FirstLogTimestamp;
+    eventPtr->numWrites = 0;
+
+    switch (recPtr->channel)
+    {
+        case SLOG_CHANNEL_ACCEL:
+        case SLOG_CHANNEL_GYRO:
+        {
+            const char* prefix = (recPtr->channel == SLOG_CHANNEL_ACCEL) ? "in_accel"
+                                                                         : "in_anglvel";
+            if (ExtractNumbers(recPtr->json, xyz, v, 3) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            for (int i = 0; i < 3; i++)
+            {
+                char file[MAX_FILE_NAME_BYTES];
+                snprintf(file, sizeof(file), "%s_%s_raw", prefix, xyz[i]);
+                AddWrite(eventPtr, file, "%lf", v[i]);
+            }
+            return LE_OK;
+        }
+
+        case SLOG_CHANNEL_LIGHT:
+
+            AddWrite(eventPtr, "adc/EXT_ADC3", "%d", (int)recPtr->numeric);
+            return LE_OK;
+
+        case SLOG_CHANNEL_PRESSURE:
+
+            AddWrite(eventPtr, "in_pressure_input", "%lf", recPtr->numeric);
+            return LE_OK;
+
+        case SLOG_CHANNEL_TEMPERATURE:
+
+            AddWrite(eventPtr, "in_temp_input", "%d", (int)(recPtr->numeric * 1000.0));
+            return LE_OK;
+
+        case SLOG_CHANNEL_POSITION:
+
+            if (ExtractNumbers(recPtr->json, position, v, 5) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            AddWrite(eventPtr,
+                     "pos/location",
+                     "%d %d %d %d %d",
+                     (int)lround(v[0] * 1000000.0),
+                     (int)lround(v[1] * 1000000.0),
+                     (int)lround(v[2]),
+                     (int)lround(v[3] * 1000.0),
+                     (int)lround(v[4]));
+            return LE_OK;
+
+        case SLOG_NUM_CHANNELS:
+            break;
+    }
+
+    return LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next event from the script, log or built-in script.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND at the end of the input.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadEvent
+(
+    Event_t* eventPtr
+)
+{
+    if (LogPath != NULL)
+    {
+        slog_Record_t record;
+
+        for (;;)
+        {
+            le_result_t result = slog_ReadRecord(InputFile, &record);
+            if (result == LE_NOT_FOUND)
+            {
+                return LE_NOT_FOUND;
+            }
+            LE_FATAL_IF(result != LE_OK, "Corrupt sensor log '%s'.", LogPath);
+
+            if (isnan(FirstLogTimestamp))
+            {
+                FirstLogTimestamp = record.timestamp;
+            }
+
+            if (ConvertLogRecord(&record, eventPtr) == LE_OK)
+            {
+                return LE_OK;
+            }
+
+            LE_WARN("Skipping malformed sample for '%s'.", slog_GetObsPath(record.channel));
+        }
+    }
+
+    for (;;)
+    {
+        char line[MAX_FILE_NAME_BYTES + MAX_CONTENTS_BYTES + 32];
+
+        if (InputFile != NULL)
+        {
+            if (fgets(line, sizeof(line), InputFile) == NULL)
+            {
+                return LE_NOT_FOUND;
+            }
+        }
+        else
+        {
+            if (DefaultScriptIndex >= NUM_ARRAY_MEMBERS(DefaultScript))
+            {
+                return LE_NOT_FOUND;
+            }
+            const char* scriptLine = DefaultScript[DefaultScriptIndex++];
+            LE_ASSERT_OK(le_utf8_Copy(line, scriptLine, sizeof(line), NULL));
+        }
+
+        le_result_t result = ParseScriptLine(line, eventPtr);
+        if (result == LE_OK)
+        {
+            return LE_OK;
+        }
+        LE_FATAL_IF(result == LE_FORMAT_ERROR, "Malformed script line '%s'.", line);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Rewind the input to the start for looping.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Rewind
+(
+    void
+)
+{
+    if (InputFile != NULL)
+    {
+        rewind(InputFile);
+        if (LogPath != NULL)
+        {
+            LE_ASSERT_OK(slog_ReadHeader(InputFile));
+        }
+    }
+
+    DefaultScriptIndex = 0;
+    StartTime = Now();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Play all events that have come due, then arm the timer for the next one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PaceTimerHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    double elapsed = (Now() - StartTime) * Speed;
+
+    while (Next.time <= elapsed)
+    {
+        for (size_t i = 0; i < Next.numWrites; i++)
+        {
+            WriteFile(Next.writes[i].file, Next.writes[i].contents);
+        }
+
+        if (ReadEvent(&Next) != LE_OK)
+        {
+            if (!IsLooping)
+            {
+                LE_INFO("End of input reached. The driver tree keeps its last values.");
+                return;
+            }
+
+            Rewind();
+            elapsed = 0;
+            LE_ASSERT_OK(ReadEvent(&Next));
+        }
+    }
+
+    double waitMs = ((Next.time - elapsed) / Speed) * 1000.0;
+
+    le_timer_SetMsInterval(PaceTimer, (waitMs < 1.0) ? 1 : (uint32_t)waitMs);
+    le_timer_Start(PaceTimer);
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetStringVar(&DriverDir, NULL, "dir");
+    le_arg_SetStringVar(&ScriptPath, NULL, "script");
+    le_arg_SetStringVar(&LogPath, NULL, "log");
+    le_arg_SetIntVar(&Speed, NULL, "speed");
+    le_arg_SetFlagVar(&IsLooping, NULL, "loop");
+    le_arg_Scan();
+
+    LE_FATAL_IF((ScriptPath != NULL) && (LogPath != NULL), "Give either --script or --log.");
+    LE_FATAL_IF(Speed < 1, "Speed must be at least 1.");
+
+    if (ScriptPath != NULL)
+    {
+        InputFile = fopen(ScriptPath, "r");
+        LE_FATAL_IF(InputFile == NULL, "Couldn't open '%s' - %m", ScriptPath);
+    }
+    else if (LogPath != NULL)
+    {
+        InputFile = fopen(LogPath, "r");
+        LE_FATAL_IF(InputFile == NULL, "Couldn't open '%s' - %m", LogPath);
+        LE_FATAL_IF(slog_ReadHeader(InputFile) != LE_OK, "'%s' is not a sensor log.", LogPath);
+    }
+
+    char path[PATH_MAX];
+    static const char* const subDirs[] = { "", "/adc", "/pos" };
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(subDirs); i++)
+    {
+        snprintf(path, sizeof(path), "%s%s", DriverDir, subDirs[i]);
+        LE_FATAL_IF(le_dir_MakePath(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+                    != LE_OK,
+                    "Couldn't create directory '%s'.",
+                    path);
+    }
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(StaticFiles); i++)
+    {
+        WriteFile(StaticFiles[i][0], StaticFiles[i][1]);
+    }
+
+    LE_FATAL_IF(ReadEvent(&Next) != LE_OK, "Input is empty.");
+
+    StartTime = Now();
+
+    PaceTimer = le_timer_Create("mockSysfsPace");
+    le_timer_SetHandler(PaceTimer, PaceTimerHandler);
+    le_timer_SetMsInterval(PaceTimer, 1);
+    le_timer_Start(PaceTimer);
+
+    LE_INFO("Fake sensor driver tree at '%s' (%s, %dx%s).",
+            DriverDir,
+            (ScriptPath != NULL) ? ScriptPath : (LogPath != NULL) ? LogPath : "built-in script",
+            Speed,
+            IsLooping ? ", looping" : "");
+}
@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motionDetector.c
+ *
+ * Shock and free-fall detection (see motionDetector.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "motionDetector.h"
+
+
+/// Time constant of the gravity low-pass filter (seconds).
+#define GRAVITY_TIME_CONSTANT 2.0
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the dominant axis of a vector.
+ *
+ * @return +/-1, 2 or 3 for the positive or negative x, y or z axis.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetAxis
+(
+    const double v[3]
+)
+{
+    size_t axis = 0;
+
+    for (size_t i = 1; i < 3; i++)
+    {
+        if (fabs(v[i]) > fabs(v[axis]))
+        {
+            axis = i;
+        }
+    }
+
+    return (v[axis] < 0.0) ? -(int)(axis + 1) : (int)(axis + 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * End the shock in progress, and report it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndShock
+(
+    motion_Detector_t* detectorPtr
+)
+{
+    motion_Event_t* shockPtr = &detectorPtr->shock;
+
+    shockPtr->duration = detectorPtr->shockLast - shockPtr->start;
+    detectorPtr->inShock = false;
+    detectorPtr->eventFunc(shockPtr, detectorPtr->contextPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Track a shock with the dynamic acceleration of a sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DetectShock
+(
+    motion_Detector_t* detectorPtr,
+    double timestamp,
+    const double dynamic[3]     ///< m/s^2
+)
+{
+    double magnitude = sqrt((dynamic[0] * dynamic[0]) +
+                            (dynamic[1] * dynamic[1]) +
+                            (dynamic[2] * dynamic[2])) / MOTION_STANDARD_GRAVITY;
+    motion_Event_t* shockPtr = &detectorPtr->shock;
+
+    if (magnitude > detectorPtr->config.shockThreshold)
+    {
+        if (!detectorPtr->inShock)
+        {
+            shockPtr->type = MOTION_EVENT_SHOCK;
+            shockPtr->start = timestamp;
+            shockPtr->peak = magnitude;
+            shockPtr->axis = GetAxis(dynamic);
+            detectorPtr->inShock = true;
+        }
+        else if (magnitude > shockPtr->peak)
+        {
+            shockPtr->peak = magnitude;
+            shockPtr->axis = GetAxis(dynamic);
+        }
+        detectorPtr->shockLast = timestamp;
+    }
+    else if (detectorPtr->inShock && ((timestamp - detectorPtr->shockLast) > MOTION_SHOCK_GAP))
+    {
+        EndShock(detectorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Track a free fall with the acceleration of a sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DetectFreeFall
+(
+    motion_Detector_t* detectorPtr,
+    double timestamp,
+    double magnitude            ///< g
+)
+{
+    motion_Event_t* freeFallPtr = &detectorPtr->freeFall;
+
+    if (magnitude < detectorPtr->config.freeFallThreshold)
+    {
+        if (!detectorPtr->inFreeFall)
+        {
+            freeFallPtr->type = MOTION_EVENT_FREE_FALL;
+            freeFallPtr->start = timestamp;
+            freeFallPtr->peak = magnitude;
+            freeFallPtr->axis = 0;
+            detectorPtr->inFreeFall = true;
+        }
+        else if (magnitude < freeFallPtr->peak)
+        {
+            freeFallPtr->peak = magnitude;
+        }
+        detectorPtr->freeFallLast = timestamp;
+    }
+    else if (detectorPtr->inFreeFall)
+    {
+        freeFallPtr->duration = detectorPtr->freeFallLast - freeFallPtr->start;
+        detectorPtr->inFreeFall = false;
+
+        if (freeFallPtr->duration >= detectorPtr->config.freeFallMinDuration)
+        {
+            detectorPtr->eventFunc(freeFallPtr, detectorPtr->contextPtr);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a detector.
+ */
+//--------------------------------------------------------------------------------------------------
+void motion_Init
+(
+    motion_Detector_t* detectorPtr,
+    const motion_Config_t* configPtr,
+    motion_EventFunc_t eventFunc,
+    void* contextPtr
+)
+{
+    memset(detectorPtr, 0, sizeof(*detectorPtr));
+
+    detectorPtr->config = *configPtr;
+    detectorPtr->eventFunc = eventFunc;
+    detectorPtr->contextPtr = contextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an accelerometer sample, reporting the events it ends.
+ */
+//--------------------------------------------------------------------------------------------------
+void motion_Add
+(
+    motion_Detector_t* detectorPtr,
+    double timestamp,
+    double x,
+    double y,
+    double z
+)
+{
+    const double sample[3] = { x, y, z };
+    double* gravity = detectorPtr->gravity;
+    double dt = timestamp - detectorPtr->lastTime;
+
+    // After a long gap, the board may have been turned over in between, so start again from the
+    // sample before detecting anything with it.
+    if (!detectorPtr->hasGravity || (dt >= GRAVITY_TIME_CONSTANT))
+    {
+        memcpy(gravity, sample, sizeof(sample));
+        detectorPtr->hasGravity = true;
+    }
+
+    double dynamic[3];
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        dynamic[i] = sample[i] - gravity[i];
+    }
+    DetectShock(detectorPtr, timestamp, dynamic);
+
+    double magnitude = sqrt((x * x) + (y * y) + (z * z)) / MOTION_STANDARD_GRAVITY;
+    DetectFreeFall(detectorPtr, timestamp, magnitude);
+
+    if (detectorPtr->inShock && ((timestamp - detectorPtr->shock.start) >= MOTION_MAX_SHOCK))
+    {
+        // Too long for a shock: the board's orientation changed, so gravity is what it measures.
+        EndShock(detectorPtr);
+        memcpy(gravity, sample, sizeof(sample));
+    }
+    else if (motion_IsIdle(detectorPtr) && (dt > 0.0))
+    {
+        // Gravity is held while the board is shaken or falling.
+        double alpha = dt / (GRAVITY_TIME_CONSTANT + dt);
+
+        for (size_t i = 0; i < 3; i++)
+        {
+            gravity[i] += alpha * (sample[i] - gravity[i]);
+        }
+    }
+
+    detectorPtr->lastTime = timestamp;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether an event is in progress.
+ *
+ * @return true if neither a shock nor a free fall is in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+bool motion_IsIdle
+(
+    const motion_Detector_t* detectorPtr
+)
+{
+    return !(detectorPtr->inShock || detectorPtr->inFreeFall);
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motionDetector.h
+ *
+ * Shock and free-fall detection on accelerometer samples taken at a high rate (tens to hundreds
+ * of Hz).
+ *
+ * A shock is the dynamic acceleration (the acceleration minus gravity) exceeding a threshold.
+ * Gravity is tracked with a slow low-pass filter of the samples, held while an event is in
+ * progress.  Crossings less than MOTION_SHOCK_GAP apart are one shock, so the ringing after an
+ * impact doesn't make several events.  The shock's peak is its largest dynamic acceleration, and
+ * its axis the dominant one at the peak.  A shock lasting MOTION_MAX_SHOCK is ended there and
+ * gravity taken from the sample, since the board has most likely been turned over rather than
+ * shaken; otherwise the held gravity would keep it in a shock for good.  Gravity is also taken
+ * from the sample after a gap in the samples, in which the board may have been turned over.
+ *
+ * A free fall is the magnitude of the acceleration staying below a threshold (an accelerometer in
+ * free fall measures about 0 g) for at least a minimum duration.
+ *
+ * Events are reported to the event function when they end, with the timestamp of their first
+ * sample past the threshold.  Everything is in the detector structure; adding a sample takes
+ * constant time and never allocates.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef MOTION_DETECTOR_H_INCLUDE_GUARD
+#define MOTION_DETECTOR_H_INCLUDE_GUARD
+
+
+/// Standard gravity (m/s^2 per g).
+#define MOTION_STANDARD_GRAVITY 9.80665
+
+/// Longest time below the threshold within one shock (seconds).
+#define MOTION_SHOCK_GAP 0.05
+
+/// Longest shock (seconds).
+#define MOTION_MAX_SHOCK 1.0
+
+
+/// Kinds of events.
+typedef enum
+{
+    MOTION_EVENT_SHOCK,
+    MOTION_EVENT_FREE_FALL,
+}
+motion_EventType_t;
+
+
+/// A detected event.
+typedef struct
+{
+    motion_EventType_t type;
+    double start;           ///< Timestamp of its first sample past the threshold.
+    double duration;        ///< Seconds from its first to its last sample past the threshold.
+    double peak;            ///< Largest dynamic acceleration of a shock, or smallest acceleration
+                            ///< in a free fall (g).
+    int axis;               ///< Shock: dominant axis at the peak, +/-1, 2 or 3 for the positive or
+                            ///< negative x, y or z axis.  Free fall: 0.
+}
+motion_Event_t;
+
+
+/// Detection thresholds.
+typedef struct
+{
+    double shockThreshold;          ///< Dynamic acceleration (g).
+    double freeFallThreshold;       ///< Acceleration (g).
+    double freeFallMinDuration;     ///< Seconds.
+}
+motion_Config_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called when an event ends.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*motion_EventFunc_t)
+(
+    const motion_Event_t* eventPtr,
+    void* contextPtr
+);
+
+
+/// A detector.  Initialize with motion_Init().
+typedef struct
+{
+    motion_Config_t config;
+    motion_EventFunc_t eventFunc;
+    void* contextPtr;
+    bool hasGravity;            ///< A sample has been added, so gravity is known.
+    double gravity[3];          ///< Low-pass filtered acceleration (m/s^2).
+    double lastTime;            ///< Timestamp of the latest sample.
+    bool inShock;
+    motion_Event_t shock;       ///< Shock in progress.
+    double shockLast;           ///< Timestamp of its latest sample over the threshold.
+    bool inFreeFall;
+    motion_Event_t freeFall;    ///< Free fall in progress.
+    double freeFallLast;        ///< Timestamp of its latest sample under the threshold.
+}
+motion_Detector_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a detector.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void motion_Init
+(
+    motion_Detector_t* detectorPtr,
+    const motion_Config_t* configPtr,
+    motion_EventFunc_t eventFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an accelerometer sample, reporting the events it ends.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void motion_Add
+(
+    motion_Detector_t* detectorPtr,
+    double timestamp,       ///< Seconds.
+    double x,               ///< m/s^2
+    double y,               ///< m/s^2
+    double z                ///< m/s^2
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether an event is in progress.
+ *
+ * @return true if neither a shock nor a free fall is in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool motion_IsIdle
+(
+    const motion_Detector_t* detectorPtr
+);
+
+
+#endif // MOTION_DETECTOR_H_INCLUDE_GUARD
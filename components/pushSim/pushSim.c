@@ -0,0 +1,1019 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pushSim.c
+ *
+ * Deterministic simulator for the cloud push tracking state machine (see pushTracker.h).
+ *
+ * Usage: pushsim [--scenario=steady|outage|flap] [--hours=N] [--seed=N] [--ties=fifo|lifo|shuffle]
+ *                [--period=S] [--buffer=N] [--latency=MS] [--fail-timeout=S]
+ *                [--outage=S] [--every=S] [--flap-up=S] [--flap-down=S]
+ *                [--reject-when-down] [--window=S] [--backlog=N] [--output=FILE]
+ *
+ * The state machine is driven exactly as avPublisher drives it, but on a virtual clock, so
+ * thousands of hours of operation are simulated in seconds.  Six sensors like the mangOH Red's
+ * (three numeric, three JSON) produce one sample every period (default 10 s) into simulated Data
+ * Hub observation buffers (default 100 samples each).  Change-by filtering is not simulated.
+ *
+ * Pushes go over a simulated cloud link:
+ *
+ *  - Link up: the push completes successfully after the latency (default 500 ms).
+ *  - Link down: the push fails after the failure timeout (default 30 s), as the AirVantage agent
+ *    does when it can't reach the server.  With --reject-when-down the push is refused
+ *    immediately instead, so the state machine goes to its FAULT state.
+ *  - Link lost while a push is in flight: the server got the data but the device is told the push
+ *    failed, so a retry delivers a duplicate.
+ *
+ * Pushes carry sequence numbers from the state machine, as avPublisher's do, and the server drops
+ * a sample whose sequence number it has received before, so only duplicates that were pushed
+ * again under a new sequence number get through.
+ *
+ * The link is always up in the "steady" scenario.  In the "outage" scenario it goes down for
+ * --outage seconds (default 3600) every --every seconds (default 86400).  In the "flap" scenario
+ * up and down periods are exponentially distributed, with means --flap-up (default 300 s) and
+ * --flap-down (default 60 s).
+ *
+ * With --window, the sensors are held and flushed at uplink windows every --window seconds, or
+ * as soon as one has --backlog samples waiting (default 90), as avPublisher does with
+ * UPLINK_WINDOW.  The radio is taken to be on while pushes are in progress and for 10 s (its
+ * tail) after the last one ends, so a push wakes it if started later than that.
+ *
+ * Events due at the same virtual time (e.g., a push completion and a new sample) are ordered
+ * first-scheduled-first (fifo, the default), last-scheduled-first (lifo), or pseudo-randomly
+ * (shuffle), to expose ordering dependencies.  All randomness comes from the --seed, so a run
+ * can be repeated exactly.
+ *
+ * One JSON object per sensor, plus one for all sensors, is output per run, for example:
+ *
+ * {"suite":"redSim","version":3,"scenario":"flap","sensor":"all","generated":2160000,
+ *  "delivered":2159940,"delivered_ratio":0.999972,"duplicates":12,"deduplicated":12,
+ *  "duplicate_ratio":0.000000,"seq_conflicts":0,"pushes":2175020,"failed_pushes":15068,
+ *  "lost":0,"pending":60,"stall_s":0.0,"mean_latency_s":6.37,"overlapping_pushes":0,
+ *  "radio_wakeups_per_hour":0.0,"radio_on_ratio":1.000}
+ *
+ *  - delivered: samples received by the server at least once.
+ *  - duplicates: samples received by the server again.
+ *  - deduplicated: duplicates the server dropped by their sequence number.
+ *  - duplicate_ratio: duplicates that got through the deduplication, per sample delivered.
+ *  - seq_conflicts: samples received with a sequence number another sample had (should be 0).
+ *  - lost: samples overwritten in the observation buffer before being delivered.
+ *  - pending: samples still waiting in the observation buffer when the simulation ended.
+ *  - stall_s: time during which the link was up and undelivered samples were waiting, but no
+ *    push was in progress (other than for the next uplink window).
+ *  - mean_latency_s: mean time from sample to first delivery.
+ *  - overlapping_pushes: pushes started while another push for the same sensor was in progress
+ *    (the state machine should never do this).
+ *  - radio_wakeups_per_hour: pushes of the sensor that woke the radio, per simulated hour.
+ *  - radio_on_ratio: share of the time the radio was on (for all sensors).
+ *
+ * Results go to stdout, and are also appended to the output file if one is given.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pushTracker.h"
+
+
+/// Version of the result record format.
+#define RESULT_VERSION 3
+
+#define NUM_SENSORS 6
+
+/// Longest simulated JSON sample, {"seq":<uint64>}.
+#define SIM_MAX_JSON_LEN 31
+
+/// Maximum number of events pending at once: a sample and a push completion per sensor, plus a
+/// link state change and an uplink window.
+#define MAX_EVENTS ((NUM_SENSORS * 2) + 2)
+
+/// Time the radio stays connected after a push ends (seconds).
+#define RADIO_TAIL 10.0
+
+
+/// Kinds of simulation event.
+typedef enum
+{
+    EVENT_SAMPLE,       ///< A sensor produces a sample.
+    EVENT_PUSH_DONE,    ///< A push completes.
+    EVENT_LINK,         ///< The cloud link goes up or down.
+    EVENT_WINDOW,       ///< An uplink window opens.
+}
+EventType_t;
+
+
+/// A simulation event.
+typedef struct
+{
+    double time;            ///< Virtual time at which the event happens (seconds).
+    double key;             ///< Order among events due at the same time (lowest first).
+    EventType_t type;
+    int sensorIndex;        ///< Sensor the event is for (not used for EVENT_LINK).
+    uint64_t sampleNum;     ///< Sample being pushed (EVENT_PUSH_DONE only).
+    uint64_t seq;           ///< Sequence number it is pushed with (EVENT_PUSH_DONE only).
+    bool isReceived;        ///< true if the server got the pushed sample (EVENT_PUSH_DONE only).
+}
+Event_t;
+
+
+/// A sample held in a simulated observation buffer.
+typedef struct
+{
+    double timestamp;
+    uint64_t sampleNum;
+}
+Slot_t;
+
+
+/// Simulated sensor, observation buffer, and delivery statistics.
+typedef struct
+{
+    tracker_Sensor_t tracker;   ///< State machine instance under test.
+    const char* name;
+    double phase;               ///< Time of the first sample (seconds).
+
+    Slot_t* buffer;             ///< Observation buffer (ring of BufferCount slots).
+    size_t head;                ///< Index of the oldest sample in the buffer.
+    size_t count;               ///< Number of samples in the buffer.
+
+    uint8_t* deliveredMap;      ///< Non-zero for each sample number received by the server.
+    uint64_t* seqMap;           ///< Sample number + 1 received by the server per sequence number.
+    size_t seqMapSize;          ///< Number of entries in seqMap.
+    int inFlight;               ///< Number of pushes in progress.
+    int numHeld;                ///< Samples waiting for the next uplink window.
+
+    uint64_t generated;
+    uint64_t delivered;
+    uint64_t duplicates;
+    uint64_t deduplicated;
+    uint64_t seqConflicts;
+    uint64_t pushes;
+    uint64_t failedPushes;
+    uint64_t overlapping;
+    uint64_t radioWakeups;
+    double stallTime;
+    double latencySum;
+}
+SimSensor_t;
+
+
+static le_result_t SimPushNumeric(tracker_Sensor_t* trackerPtr, double timestamp, double value);
+static le_result_t SimPushJson(tracker_Sensor_t* trackerPtr, double timestamp, const char* value);
+static le_result_t SimReadBacklogNumeric(tracker_Sensor_t* trackerPtr,
+                                         double startAfter,
+                                         double* timestampPtr,
+                                         double* valuePtr);
+static le_result_t SimReadBacklogJson(tracker_Sensor_t* trackerPtr,
+                                      double startAfter,
+                                      double* timestampPtr,
+                                      char* valuePtr,
+                                      size_t valueSize);
+
+/// Push tracking backend that pushes over the simulated link from the simulated buffers.
+static const tracker_Backend_t SimBackend = {
+    .pushNumeric=SimPushNumeric,
+    .pushJson=SimPushJson,
+    .readBacklogNumeric=SimReadBacklogNumeric,
+    .readBacklogJson=SimReadBacklogJson,
+};
+
+static SimSensor_t Sensors[NUM_SENSORS] = {
+    { .tracker={ .obsPath="/obs/accel", .isJson=true, .maxJsonLen=SIM_MAX_JSON_LEN },
+      .name="accel" },
+    { .tracker={ .obsPath="/obs/gyro", .isJson=true, .maxJsonLen=SIM_MAX_JSON_LEN },
+      .name="gyro" },
+    { .tracker={ .obsPath="/obs/light", .isJson=false }, .name="light" },
+    { .tracker={ .obsPath="/obs/pressure", .isJson=false }, .name="pressure" },
+    { .tracker={ .obsPath="/obs/temperature", .isJson=false }, .name="temperature" },
+    { .tracker={ .obsPath="/obs/position", .isJson=true, .maxJsonLen=SIM_MAX_JSON_LEN },
+      .name="position" },
+};
+
+
+// Command-line options.
+static const char* Scenario = "steady";
+static int Hours = 1000;
+static int Seed = 1;
+static const char* Ties = "fifo";
+static int Period = 10;
+static int BufferCount = 100;
+static int LatencyMs = 500;
+static int FailTimeout = 30;
+static int OutageDuration = 3600;
+static int OutageEvery = 86400;
+static int FlapUpMean = 300;
+static int FlapDownMean = 60;
+static bool RejectWhenDown = false;
+static int Window = 0;
+static int Backlog = 90;
+static const char* OutputPath = NULL;
+static FILE* OutputFile = NULL;
+
+
+/// Pending events (binary min-heap ordered by time, then key).
+static Event_t Events[MAX_EVENTS];
+static size_t NumEvents = 0;
+
+/// Number of events scheduled so far (used to order events due at the same time).
+static uint64_t EventCount = 0;
+
+/// Current virtual time (seconds).
+static double Now = 0;
+
+/// true if the simulated cloud link is up.
+static bool IsLinkUp = true;
+
+/// Pushes in progress for all sensors, when the last one ended, and how long the radio has been
+/// on (seconds).
+static int NumInFlight = 0;
+static double LastPushEndTime = -RADIO_TAIL;
+static double RadioOnTime = 0;
+
+/// Time the next uplink window opens (seconds).
+static double NextWindowTime;
+
+/// State of the pseudo-random number generator (xorshift64).
+static uint64_t RandomState;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate a uniformly distributed pseudo-random number in (0, 1].
+ */
+//--------------------------------------------------------------------------------------------------
+static double Random
+(
+    void
+)
+{
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 7;
+    RandomState ^= RandomState << 17;
+
+    return ((double)(RandomState >> 11) + 1.0) / (double)(1ULL << 53);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether one event must be handled before another.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsBefore
+(
+    const Event_t* aPtr,
+    const Event_t* bPtr
+)
+{
+    return (aPtr->time < bPtr->time) || ((aPtr->time == bPtr->time) && (aPtr->key < bPtr->key));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedule an event.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Schedule
+(
+    Event_t event
+)
+{
+    LE_FATAL_IF(NumEvents >= MAX_EVENTS, "Event queue overflow.");
+
+    EventCount++;
+
+    if (strcmp(Ties, "lifo") == 0)
+    {
+        event.key = -(double)EventCount;
+    }
+    else if (strcmp(Ties, "shuffle") == 0)
+    {
+        event.key = Random();
+    }
+    else
+    {
+        event.key = (double)EventCount;
+    }
+
+    // Sift up.
+    size_t i = NumEvents++;
+    while ((i > 0) && IsBefore(&event, &Events[(i - 1) / 2]))
+    {
+        Events[i] = Events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    Events[i] = event;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the earliest event from the queue.
+ */
+//--------------------------------------------------------------------------------------------------
+static Event_t NextEvent
+(
+    void
+)
+{
+    Event_t first = Events[0];
+    Event_t last = Events[--NumEvents];
+
+    // Sift down.
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = (i * 2) + 1;
+        if (child >= NumEvents)
+        {
+            break;
+        }
+        if (((child + 1) < NumEvents) && IsBefore(&Events[child + 1], &Events[child]))
+        {
+            child++;
+        }
+        if (!IsBefore(&Events[child], &last))
+        {
+            break;
+        }
+        Events[i] = Events[child];
+        i = child;
+    }
+    Events[i] = last;
+
+    return first;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a buffered sample by age order (0 = oldest).
+ */
+//--------------------------------------------------------------------------------------------------
+static const Slot_t* GetSlot
+(
+    const SimSensor_t* simPtr,
+    size_t i
+)
+{
+    return &simPtr->buffer[(simPtr->head + i) % BufferCount];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the oldest buffered sample newer than a given timestamp, like the Data Hub's
+ * ReadBufferSample functions do.
+ *
+ * @return The sample, or NULL if there is none.
+ */
+//--------------------------------------------------------------------------------------------------
+static const Slot_t* FindSampleAfter
+(
+    const SimSensor_t* simPtr,
+    double startAfter
+)
+{
+    // The buffer is in timestamp order, so binary search it.
+    size_t low = 0;
+    size_t high = simPtr->count;
+
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+
+        if (GetSlot(simPtr, mid)->timestamp > startAfter)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    return (low < simPtr->count) ? GetSlot(simPtr, low) : NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a simulated push of a sample.
+ *
+ * @return LE_OK if the push was started, LE_FAULT if refused because the link is down.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartPush
+(
+    tracker_Sensor_t* trackerPtr,
+    double timestamp,
+    uint64_t sampleNum
+)
+{
+    SimSensor_t* simPtr = CONTAINER_OF(trackerPtr, SimSensor_t, tracker);
+
+    // Number the sample as avPublisher does (the reservation isn't saved, as nothing restarts).
+    size_t numNew = 0;
+    uint64_t seq = tracker_GetSeq(trackerPtr, timestamp, &numNew);
+    (void)tracker_ReserveSeqs(trackerPtr, numNew);
+
+    simPtr->pushes++;
+
+    if (simPtr->inFlight > 0)
+    {
+        simPtr->overlapping++;
+    }
+
+    if (!IsLinkUp && RejectWhenDown)
+    {
+        simPtr->failedPushes++;
+        return LE_FAULT;
+    }
+
+    if ((NumInFlight == 0) && ((Now - LastPushEndTime) > RADIO_TAIL))
+    {
+        simPtr->radioWakeups++;
+    }
+
+    simPtr->inFlight++;
+    NumInFlight++;
+    tracker_SetSent(trackerPtr, timestamp, seq);
+
+    Event_t event = {
+        .time = Now + (IsLinkUp ? ((double)LatencyMs / 1000.0) : (double)FailTimeout),
+        .type = EVENT_PUSH_DONE,
+        .sensorIndex = simPtr - Sensors,
+        .sampleNum = sampleNum,
+        .seq = seq,
+        .isReceived = IsLinkUp,
+    };
+    Schedule(event);
+
+    return LE_OK;
+}
+
+
+static le_result_t SimPushNumeric
+(
+    tracker_Sensor_t* trackerPtr,
+    double timestamp,
+    double value    ///< Sample number.
+)
+{
+    return StartPush(trackerPtr, timestamp, (uint64_t)value);
+}
+
+
+static le_result_t SimPushJson
+(
+    tracker_Sensor_t* trackerPtr,
+    double timestamp,
+    const char* value   ///< {"seq":<sample number>}
+)
+{
+    uint64_t sampleNum;
+
+    if (sscanf(value, "{\"seq\":%" SCNu64 "}", &sampleNum) != 1)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return StartPush(trackerPtr, timestamp, sampleNum);
+}
+
+
+static le_result_t SimReadBacklogNumeric
+(
+    tracker_Sensor_t* trackerPtr,
+    double startAfter,
+    double* timestampPtr,
+    double* valuePtr
+)
+{
+    const Slot_t* slotPtr = FindSampleAfter(CONTAINER_OF(trackerPtr, SimSensor_t, tracker),
+                                            startAfter);
+    if (slotPtr == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    *timestampPtr = slotPtr->timestamp;
+    *valuePtr = (double)slotPtr->sampleNum;
+
+    return LE_OK;
+}
+
+
+static le_result_t SimReadBacklogJson
+(
+    tracker_Sensor_t* trackerPtr,
+    double startAfter,
+    double* timestampPtr,
+    char* valuePtr,
+    size_t valueSize
+)
+{
+    const Slot_t* slotPtr = FindSampleAfter(CONTAINER_OF(trackerPtr, SimSensor_t, tracker),
+                                            startAfter);
+    if (slotPtr == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    *timestampPtr = slotPtr->timestamp;
+    int len = snprintf(valuePtr, valueSize, "{\"seq\":%" PRIu64 "}", slotPtr->sampleNum);
+
+    return ((len >= 0) && ((size_t)len < valueSize)) ? LE_OK : LE_OVERFLOW;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open an uplink window: flush all the sensors.  The next window opens at the next multiple of
+ * the window at least half a window from now, as avPublisher's do.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenWindow
+(
+    void
+)
+{
+    for (int i = 0; i < NUM_SENSORS; i++)
+    {
+        Sensors[i].numHeld = 0;
+        tracker_Flush(&Sensors[i].tracker);
+    }
+
+    NextWindowTime = (floor(Now / Window) + 1.0) * Window;
+    if ((NextWindowTime - Now) < (Window / 2.0))
+    {
+        NextWindowTime += Window;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the uplink window due, unless one opened early since, and wait for the next.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleWindow
+(
+    void
+)
+{
+    if (Now >= NextWindowTime)
+    {
+        OpenWindow();
+    }
+
+    Event_t event = { .time = NextWindowTime, .type = EVENT_WINDOW };
+    Schedule(event);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Produce a sample: buffer it and notify the state machine, as the Data Hub would.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSample
+(
+    SimSensor_t* simPtr
+)
+{
+    uint64_t sampleNum = simPtr->generated++;
+
+    if (simPtr->count == BufferCount)
+    {
+        simPtr->head = (simPtr->head + 1) % BufferCount;
+        simPtr->count--;
+    }
+
+    Slot_t* slotPtr = &simPtr->buffer[(simPtr->head + simPtr->count) % BufferCount];
+    slotPtr->timestamp = Now;
+    slotPtr->sampleNum = sampleNum;
+    simPtr->count++;
+
+    if (simPtr->tracker.isJson)
+    {
+        char value[32];
+
+        snprintf(value, sizeof(value), "{\"seq\":%" PRIu64 "}", sampleNum);
+        tracker_HandleJsonUpdate(&simPtr->tracker, Now, value);
+    }
+    else
+    {
+        tracker_HandleNumericUpdate(&simPtr->tracker, Now, (double)sampleNum);
+    }
+
+    // Open the window early rather than let the buffer drop samples.
+    if ((simPtr->tracker.state == TRACKER_STATE_HELD) && (++simPtr->numHeld >= Backlog))
+    {
+        OpenWindow();
+    }
+
+    Event_t event = {
+        .time = simPtr->phase + ((double)simPtr->generated * Period),
+        .type = EVENT_SAMPLE,
+        .sensorIndex = simPtr - Sensors,
+    };
+    Schedule(event);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive a pushed sample at the server, dropping it if its sequence number was received before.
+ *
+ * @return true if the sample was kept.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ReceiveSeq
+(
+    SimSensor_t* simPtr,
+    const Event_t* eventPtr
+)
+{
+    if (eventPtr->seq >= simPtr->seqMapSize)
+    {
+        size_t size = (simPtr->seqMapSize > 0) ? simPtr->seqMapSize : 1024;
+        while (size <= eventPtr->seq)
+        {
+            size *= 2;
+        }
+
+        simPtr->seqMap = realloc(simPtr->seqMap, size * sizeof(simPtr->seqMap[0]));
+        LE_ASSERT(simPtr->seqMap != NULL);
+        memset(&simPtr->seqMap[simPtr->seqMapSize],
+               0,
+               (size - simPtr->seqMapSize) * sizeof(simPtr->seqMap[0]));
+        simPtr->seqMapSize = size;
+    }
+
+    uint64_t* entryPtr = &simPtr->seqMap[eventPtr->seq];
+
+    if (*entryPtr == 0)
+    {
+        *entryPtr = eventPtr->sampleNum + 1;
+        return true;
+    }
+
+    if (*entryPtr != (eventPtr->sampleNum + 1))
+    {
+        simPtr->seqConflicts++;
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete a push: record delivery at the server and report the outcome to the state machine.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePushDone
+(
+    SimSensor_t* simPtr,
+    const Event_t* eventPtr
+)
+{
+    simPtr->inFlight--;
+    NumInFlight--;
+    LastPushEndTime = Now;
+
+    if (eventPtr->isReceived)
+    {
+        bool isKept = ReceiveSeq(simPtr, eventPtr);
+
+        if (simPtr->deliveredMap[eventPtr->sampleNum])
+        {
+            simPtr->duplicates++;
+            if (!isKept)
+            {
+                simPtr->deduplicated++;
+            }
+        }
+        else if (isKept)
+        {
+            simPtr->deliveredMap[eventPtr->sampleNum] = 1;
+            simPtr->delivered++;
+            simPtr->latencySum += Now - (simPtr->phase + ((double)eventPtr->sampleNum * Period));
+        }
+    }
+
+    // The device only hears about success if the link is still up to carry the response.
+    bool isSuccess = eventPtr->isReceived && IsLinkUp;
+
+    if (!isSuccess)
+    {
+        simPtr->failedPushes++;
+    }
+
+    tracker_HandlePushComplete(&simPtr->tracker, isSuccess);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Toggle the link state and schedule the next change for the scenario.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleLink
+(
+    void
+)
+{
+    IsLinkUp = !IsLinkUp;
+
+    double duration;
+
+    if (strcmp(Scenario, "outage") == 0)
+    {
+        duration = IsLinkUp ? (double)(OutageEvery - OutageDuration) : (double)OutageDuration;
+    }
+    else
+    {
+        duration = -log(Random()) * (double)(IsLinkUp ? FlapUpMean : FlapDownMean);
+    }
+
+    Event_t event = { .time = Now + duration, .type = EVENT_LINK };
+    Schedule(event);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the virtual clock, accounting stall time for every sensor that has undelivered samples
+ * waiting while the link is up and nothing is being pushed, unless they wait for a window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AdvanceTo
+(
+    double time
+)
+{
+    double elapsed = time - Now;
+
+    if (NumInFlight > 0)
+    {
+        RadioOnTime += elapsed;
+    }
+    else if ((LastPushEndTime + RADIO_TAIL) > Now)
+    {
+        RadioOnTime += fmin(time, LastPushEndTime + RADIO_TAIL) - Now;
+    }
+
+    if (IsLinkUp)
+    {
+        for (int i = 0; i < NUM_SENSORS; i++)
+        {
+            SimSensor_t* simPtr = &Sensors[i];
+
+            if (   (simPtr->inFlight == 0)
+                && (simPtr->tracker.state != TRACKER_STATE_HELD)
+                && (simPtr->count > 0)
+                && (GetSlot(simPtr, simPtr->count - 1)->timestamp
+                        > tracker_GetGapStart(&simPtr->tracker))  )
+            {
+                simPtr->stallTime += elapsed;
+            }
+        }
+    }
+
+    Now = time;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a result line to stdout and the output file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Report
+(
+    const char* name,
+    const SimSensor_t* totalsPtr    ///< Statistics, with count = number of samples pending.
+)
+{
+    char line[512];
+    uint64_t undelivered = totalsPtr->generated - totalsPtr->delivered;
+    uint64_t pending = totalsPtr->count;
+
+    snprintf(line,
+             sizeof(line),
+             "{\"suite\":\"redSim\",\"version\":%d,\"scenario\":\"%s\",\"sensor\":\"%s\","
+             "\"generated\":%" PRIu64 ",\"delivered\":%" PRIu64 ",\"delivered_ratio\":%.6f,"
+             "\"duplicates\":%" PRIu64 ",\"deduplicated\":%" PRIu64 ",\"duplicate_ratio\":%.6f,"
+             "\"seq_conflicts\":%" PRIu64 ",\"pushes\":%" PRIu64 ",\"failed_pushes\":%" PRIu64 ","
+             "\"lost\":%" PRIu64 ",\"pending\":%" PRIu64 ",\"stall_s\":%.1f,"
+             "\"mean_latency_s\":%.2f,\"overlapping_pushes\":%" PRIu64 ","
+             "\"radio_wakeups_per_hour\":%.1f,\"radio_on_ratio\":%.3f}",
+             RESULT_VERSION,
+             Scenario,
+             name,
+             totalsPtr->generated,
+             totalsPtr->delivered,
+             (totalsPtr->generated > 0)
+                 ? ((double)totalsPtr->delivered / (double)totalsPtr->generated) : 0.0,
+             totalsPtr->duplicates,
+             totalsPtr->deduplicated,
+             (totalsPtr->delivered > 0)
+                 ? ((double)(totalsPtr->duplicates - totalsPtr->deduplicated)
+                        / (double)totalsPtr->delivered)
+                 : 0.0,
+             totalsPtr->seqConflicts,
+             totalsPtr->pushes,
+             totalsPtr->failedPushes,
+             undelivered - pending,
+             pending,
+             totalsPtr->stallTime,
+             (totalsPtr->delivered > 0) ? (totalsPtr->latencySum / totalsPtr->delivered) : 0.0,
+             totalsPtr->overlapping,
+             (double)totalsPtr->radioWakeups / (double)Hours,
+             RadioOnTime / ((double)Hours * 3600.0));
+
+    fprintf(stdout, "%s\n", line);
+    fflush(stdout);
+
+    if (OutputFile != NULL)
+    {
+        fprintf(OutputFile, "%s\n", line);
+        fflush(OutputFile);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count the buffered samples not yet delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t CountPending
+(
+    const SimSensor_t* simPtr
+)
+{
+    uint64_t pending = 0;
+
+    for (size_t i = 0; i < simPtr->count; i++)
+    {
+        if (!simPtr->deliveredMap[GetSlot(simPtr, i)->sampleNum])
+        {
+            pending++;
+        }
+    }
+
+    return pending;
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetStringVar(&Scenario, NULL, "scenario");
+    le_arg_SetIntVar(&Hours, NULL, "hours");
+    le_arg_SetIntVar(&Seed, NULL, "seed");
+    le_arg_SetStringVar(&Ties, NULL, "ties");
+    le_arg_SetIntVar(&Period, NULL, "period");
+    le_arg_SetIntVar(&BufferCount, NULL, "buffer");
+    le_arg_SetIntVar(&LatencyMs, NULL, "latency");
+    le_arg_SetIntVar(&FailTimeout, NULL, "fail-timeout");
+    le_arg_SetIntVar(&OutageDuration, NULL, "outage");
+    le_arg_SetIntVar(&OutageEvery, NULL, "every");
+    le_arg_SetIntVar(&FlapUpMean, NULL, "flap-up");
+    le_arg_SetIntVar(&FlapDownMean, NULL, "flap-down");
+    le_arg_SetFlagVar(&RejectWhenDown, NULL, "reject-when-down");
+    le_arg_SetIntVar(&Window, NULL, "window");
+    le_arg_SetIntVar(&Backlog, NULL, "backlog");
+    le_arg_SetStringVar(&OutputPath, NULL, "output");
+    le_arg_Scan();
+
+    LE_FATAL_IF(   (strcmp(Scenario, "steady") != 0)
+                && (strcmp(Scenario, "outage") != 0)
+                && (strcmp(Scenario, "flap") != 0),
+                "Unknown scenario '%s'.", Scenario);
+    LE_FATAL_IF((Hours <= 0) || (Period <= 0) || (BufferCount <= 0) || (LatencyMs < 0)
+                || (FailTimeout <= 0) || (OutageDuration <= 0)
+                || (OutageEvery <= OutageDuration) || (FlapUpMean <= 0) || (FlapDownMean <= 0)
+                || (Window < 0) || (Backlog <= 0),
+                "Invalid simulation parameters.");
+
+    if (OutputPath != NULL)
+    {
+        OutputFile = fopen(OutputPath, "a");
+        LE_FATAL_IF(OutputFile == NULL, "Couldn't open '%s' - %m", OutputPath);
+    }
+
+    // xorshift must not start from zero.
+    RandomState = 0x9E3779B97F4A7C15ULL ^ (uint64_t)Seed;
+
+    double endTime = (double)Hours * 3600.0;
+    size_t maxSamples = (size_t)(endTime / Period) + 1;
+
+    for (int i = 0; i < NUM_SENSORS; i++)
+    {
+        SimSensor_t* simPtr = &Sensors[i];
+
+        simPtr->tracker.backendPtr = &SimBackend;
+        simPtr->tracker.state = TRACKER_STATE_IDLE;
+        simPtr->tracker.isHeld = (Window > 0);
+        simPtr->buffer = calloc(BufferCount, sizeof(Slot_t));
+        simPtr->deliveredMap = calloc(maxSamples, 1);
+        LE_ASSERT((simPtr->buffer != NULL) && (simPtr->deliveredMap != NULL));
+
+        // All sensors share the period and start together, like avPublisher configures them,
+        // so their samples are due at the same times and the tie-break order matters.  Timestamps
+        // start at one period, as samples timestamped at or before 0 count as delivered.
+        simPtr->phase = (double)Period;
+
+        Event_t event = { .time = simPtr->phase, .type = EVENT_SAMPLE, .sensorIndex = i };
+        Schedule(event);
+    }
+
+    if (strcmp(Scenario, "outage") == 0)
+    {
+        Event_t event = { .time = (double)(OutageEvery - OutageDuration), .type = EVENT_LINK };
+        Schedule(event);
+    }
+    else if (strcmp(Scenario, "flap") == 0)
+    {
+        Event_t event = { .time = -log(Random()) * (double)FlapUpMean, .type = EVENT_LINK };
+        Schedule(event);
+    }
+
+    if (Window > 0)
+    {
+        NextWindowTime = (double)Window;
+
+        Event_t event = { .time = NextWindowTime, .type = EVENT_WINDOW };
+        Schedule(event);
+    }
+
+    le_clk_Time_t wallStart = le_clk_GetRelativeTime();
+    uint64_t numEvents = 0;
+
+    while ((NumEvents > 0) && (Events[0].time <= endTime))
+    {
+        Event_t event = NextEvent();
+
+        AdvanceTo(event.time);
+        numEvents++;
+
+        switch (event.type)
+        {
+            case EVENT_SAMPLE:
+                HandleSample(&Sensors[event.sensorIndex]);
+                break;
+
+            case EVENT_PUSH_DONE:
+                HandlePushDone(&Sensors[event.sensorIndex], &event);
+                break;
+
+            case EVENT_LINK:
+                HandleLink();
+                break;
+
+            case EVENT_WINDOW:
+                HandleWindow();
+                break;
+        }
+    }
+
+    AdvanceTo(endTime);
+
+    le_clk_Time_t wallTime = le_clk_Sub(le_clk_GetRelativeTime(), wallStart);
+    LE_INFO("Simulated %d hours (%" PRIu64 " events) in %.3lf s.",
+            Hours,
+            numEvents,
+            (double)wallTime.sec + ((double)wallTime.usec / 1000000.0));
+
+    SimSensor_t totals = { .name = "all" };
+
+    for (int i = 0; i < NUM_SENSORS; i++)
+    {
+        SimSensor_t* simPtr = &Sensors[i];
+        SimSensor_t result = *simPtr;
+
+        result.count = CountPending(simPtr);
+        Report(simPtr->name, &result);
+
+        totals.generated += result.generated;
+        totals.delivered += result.delivered;
+        totals.duplicates += result.duplicates;
+        totals.deduplicated += result.deduplicated;
+        totals.seqConflicts += result.seqConflicts;
+        totals.pushes += result.pushes;
+        totals.failedPushes += result.failedPushes;
+        totals.overlapping += result.overlapping;
+        totals.radioWakeups += result.radioWakeups;
+        totals.stallTime += result.stallTime;
+        totals.latencySum += result.latencySum;
+        totals.count += result.count;
+    }
+
+    Report("all", &totals);
+
+    exit(EXIT_SUCCESS);
+}
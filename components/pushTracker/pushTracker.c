@@ -0,0 +1,979 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pushTracker.c
+ *
+ * Cloud push tracking state machine.  See pushTracker.h.
+ *
+ * Only one push per sensor is ever in progress.  Samples that arrive while a push is in progress
+ * are left in the backlog buffer and fetched as earlier pushes complete: the newest sample first,
+ * if it hasn't been delivered, then the oldest gap in the delivered ranges.  A sensor update that
+ * arrives with no push in progress (including after a push couldn't be started) is pushed right
+ * away, unless the sensor is held, in which case it waits for the flush.  Each push covers a time
+ * range (from the end of what was delivered before the sample, or from the sample before it for
+ * the newest sample), which is only added to the delivered ranges when the push succeeds, so
+ * failures leave gaps of exactly the samples that weren't delivered.
+ *
+ * The sequence numbers of the samples pushed without acknowledgement are kept until the samples
+ * are delivered.  When more are pushed without acknowledgement than can be kept, the oldest are
+ * forgotten, and get new sequence numbers if they are pushed again.
+ *
+ * A gap whose samples the backlog buffer has since dropped is found when the oldest sample after
+ * the gap's start turns out to be delivered already.  The gap is then closed, as there is nothing
+ * left to send for it.
+ *
+ * JSON samples are fetched from the backlog into buffers sized to the sensor's declared longest
+ * sample (maxJsonLen), not to the longest the Data Hub allows, which would take tens of KB of the
+ * event loop's stack on every fetch.  The buffers come from pools of power-of-two size classes,
+ * created as sensors need them, so only the classes in use take memory.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pushTracker.h"
+
+
+/// Smallest JSON backlog buffer (bytes).
+#define MIN_BUFFER_BYTES 64
+
+/// Number of JSON backlog buffer size classes, from MIN_BUFFER_BYTES up to the first holding
+/// TRACKER_MAX_JSON_LEN (64 KiB).
+#define NUM_SIZE_CLASSES 11
+
+/// Longest line of a delivered ranges file (bytes).
+#define MAX_LINE_BYTES 256
+
+/// Pools of JSON backlog buffers, by size class.  NULL until a sensor needs the class.
+static le_mem_PoolRef_t BufferPools[NUM_SIZE_CLASSES];
+
+
+static void PushNext(tracker_Sensor_t* sensorPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate a buffer for a JSON sample from the pool of the smallest size class that holds it.
+ * Release it with le_mem_Release().
+ *
+ * @return The buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static char* AllocJsonBuffer
+(
+    size_t maxLen,          ///< Longest sample to hold (excluding the null terminator).
+    size_t* buffSizePtr     ///< [OUT] Size of the buffer.
+)
+{
+    size_t sizeClass = 0;
+    size_t buffSize = MIN_BUFFER_BYTES;
+
+    while (buffSize <= maxLen)
+    {
+        buffSize *= 2;
+        sizeClass++;
+    }
+    LE_ASSERT(sizeClass < NUM_SIZE_CLASSES);
+
+    if (BufferPools[sizeClass] == NULL)
+    {
+        char name[32];
+
+        snprintf(name, sizeof(name), "TrackerJson%zu", buffSize);
+        BufferPools[sizeClass] = le_mem_CreatePool(name, buffSize);
+    }
+
+    *buffSizePtr = buffSize;
+    return le_mem_ForceAlloc(BufferPools[sizeClass]);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a numeric sensor sample to the cloud.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+)
+{
+    sensorPtr->timestamp = timestamp;
+
+    le_result_t result = sensorPtr->backendPtr->pushNumeric(sensorPtr, timestamp, value);
+
+    if (result != LE_OK)
+    {
+        LE_CRIT("Failed (%s) delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
+
+        sensorPtr->state = TRACKER_STATE_FAULT;
+
+        // Wait for another update from the sensor to trigger a retry.
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a JSON sensor sample to the cloud.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+)
+{
+    sensorPtr->timestamp = timestamp;
+
+    le_result_t result = sensorPtr->backendPtr->pushJson(sensorPtr, timestamp, value);
+
+    if (result == LE_FORMAT_ERROR)
+    {
+        LE_CRIT("Discarding malformed value from '%s' (%s).", sensorPtr->obsPath, value);
+
+        tracker_AddDelivered(sensorPtr, sensorPtr->pushStart, timestamp);
+        if (sensorPtr->state == TRACKER_STATE_PUSHING)
+        {
+            sensorPtr->state = TRACKER_STATE_IDLE;
+        }
+    }
+
+    if (result != LE_OK)
+    {
+        LE_CRIT("%s: Delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
+
+        sensorPtr->state = TRACKER_STATE_FAULT;
+
+        // Wait for another update from the sensor to trigger a retry.
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest sample of a sensor's backlog newer than a given timestamp.  A JSON sample is
+ * read into a buffer allocated on the first read, and replaced by the largest one if the sample
+ * is longer than the sensor declared.
+ *
+ * @return LE_OK if found, LE_NOT_FOUND if there is none, or the backend's error.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadBacklog
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,   ///< [OUT]
+    double* valuePtr,       ///< [OUT] Numeric sample.
+    char** jsonPtrPtr,      ///< [IN/OUT] JSON buffer, or NULL to allocate one.
+    size_t* jsonSizePtr     ///< [IN/OUT] Size of the JSON buffer.
+)
+{
+    const tracker_Backend_t* backendPtr = sensorPtr->backendPtr;
+
+    if (!sensorPtr->isJson)
+    {
+        return backendPtr->readBacklogNumeric(sensorPtr, startAfter, timestampPtr, valuePtr);
+    }
+
+    size_t maxLen = (sensorPtr->maxJsonLen > 0) ? sensorPtr->maxJsonLen : TRACKER_MAX_JSON_LEN;
+
+    if (*jsonPtrPtr == NULL)
+    {
+        *jsonPtrPtr = AllocJsonBuffer(maxLen, jsonSizePtr);
+    }
+
+    le_result_t result = backendPtr->readBacklogJson(sensorPtr,
+                                                     startAfter,
+                                                     timestampPtr,
+                                                     *jsonPtrPtr,
+                                                     *jsonSizePtr);
+    if ((result == LE_OVERFLOW) && (*jsonSizePtr <= TRACKER_MAX_JSON_LEN))
+    {
+        // Rather than stall the backlog on a sample longer than declared, read it into the
+        // largest buffer.
+        LE_WARN("Sample from '%s' is longer than its declared %zu bytes.",
+                sensorPtr->obsPath,
+                maxLen);
+
+        le_mem_Release(*jsonPtrPtr);
+        *jsonPtrPtr = AllocJsonBuffer(TRACKER_MAX_JSON_LEN, jsonSizePtr);
+
+        result = backendPtr->readBacklogJson(sensorPtr,
+                                             startAfter,
+                                             timestampPtr,
+                                             *jsonPtrPtr,
+                                             *jsonSizePtr);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the next undelivered sample of a sensor's backlog: the newest sample if it hasn't been
+ * delivered, otherwise the oldest sample in the oldest gap.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushNext
+(
+    tracker_Sensor_t* sensorPtr
+)
+{
+    char* jsonPtr = NULL;
+    size_t jsonSize = 0;
+    le_result_t result;
+
+    sensorPtr->state = TRACKER_STATE_BACKLOGGED;
+
+    for (;;)
+    {
+        bool isNewest = (sensorPtr->newestTimestamp > 0.0)
+                        && !tracker_IsDelivered(sensorPtr, sensorPtr->newestTimestamp);
+        double startAfter = isNewest ? sensorPtr->newestStart : tracker_GetGapStart(sensorPtr);
+        double timestamp;
+        double value;
+
+        result = ReadBacklog(sensorPtr, startAfter, &timestamp, &value, &jsonPtr, &jsonSize);
+
+        if ((result == LE_OK) && !tracker_IsDelivered(sensorPtr, timestamp))
+        {
+            sensorPtr->pushStart = startAfter;
+
+            if (sensorPtr->isJson)
+            {
+                PushJson(sensorPtr, timestamp, jsonPtr);
+            }
+            else
+            {
+                PushNumeric(sensorPtr, timestamp, value);
+            }
+            break;
+        }
+
+        if (isNewest && ((result == LE_OK) || (result == LE_NOT_FOUND)))
+        {
+            // The newest sample isn't buffered (anymore), so there's nothing to send for it.
+            tracker_AddDelivered(sensorPtr, startAfter, sensorPtr->newestTimestamp);
+        }
+        else if (result == LE_OK)
+        {
+            // The gap's samples were dropped from the buffer before they could be sent.
+            LE_DEBUG("Samples of '%s' after %lf dropped before delivery.",
+                     sensorPtr->obsPath,
+                     startAfter);
+            tracker_AddDelivered(sensorPtr, startAfter, timestamp);
+        }
+        else
+        {
+            if (result == LE_NOT_FOUND)
+            {
+                sensorPtr->state = TRACKER_STATE_IDLE;
+            }
+            else
+            {
+                LE_CRIT("Unexpected result code (%s) from backlog query.", LE_RESULT_TXT(result));
+            }
+            break;
+        }
+    }
+
+    if (jsonPtr != NULL)
+    {
+        le_mem_Release(jsonPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Forget the sequence numbers of the samples pushed without acknowledgement that have since been
+ * delivered.  They are never pushed again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ForgetDeliveredSeqs
+(
+    tracker_Sensor_t* sensorPtr
+)
+{
+    size_t numKept = 0;
+
+    for (size_t i = 0; i < sensorPtr->numSent; i++)
+    {
+        if (!tracker_IsDelivered(sensorPtr, sensorPtr->sent[i].timestamp))
+        {
+            sensorPtr->sent[numKept++] = sensorPtr->sent[i];
+        }
+    }
+
+    sensorPtr->numSent = numKept;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the arrival of a sensor update.  If the sample is to be pushed right away, the push
+ * function is called with it.
+ *
+ * @return true if the sample should be pushed right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HandleUpdate
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    // Updates arrive in the order they were buffered, so the only sample buffered after the
+    // previous update is this one.  Without a previous update (e.g., just after starting), the
+    // sample can only stand for itself.
+    double start = nextafter(timestamp, -HUGE_VAL);
+
+    if (timestamp > sensorPtr->newestTimestamp)
+    {
+        if (sensorPtr->newestTimestamp > 0.0)
+        {
+            start = sensorPtr->newestTimestamp;
+        }
+        sensorPtr->newestStart = start;
+        sensorPtr->newestTimestamp = timestamp;
+    }
+
+    switch (sensorPtr->state)
+    {
+        case TRACKER_STATE_IDLE:
+
+            if (sensorPtr->isHeld)
+            {
+                sensorPtr->state = TRACKER_STATE_HELD;
+                break;
+            }
+
+            sensorPtr->state = TRACKER_STATE_PUSHING;
+            sensorPtr->pushStart = start;
+
+            return true;
+
+        case TRACKER_STATE_PUSHING:
+
+            sensorPtr->state = TRACKER_STATE_BACKLOGGED;
+
+            break;
+
+        case TRACKER_STATE_BACKLOGGED:
+
+            // Don't need to do anything.  Completion of the current push will result in more
+            // being pushed.
+            break;
+
+        case TRACKER_STATE_HELD:
+
+            // Waits for the flush.
+            break;
+
+        case TRACKER_STATE_FAULT:
+
+            if (sensorPtr->isHeld)
+            {
+                // The retry waits for the flush too.
+                sensorPtr->state = TRACKER_STATE_HELD;
+                break;
+            }
+
+            // Retry with the fresh sample.  The backlog follows once it has been delivered.
+            sensorPtr->state = TRACKER_STATE_BACKLOGGED;
+            sensorPtr->pushStart = start;
+
+            return true;
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a numeric sensor update arriving from the sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_HandleNumericUpdate
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+)
+{
+    if (HandleUpdate(sensorPtr, timestamp))
+    {
+        PushNumeric(sensorPtr, timestamp, value);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a JSON sensor update arriving from the sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_HandleJsonUpdate
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+)
+{
+    if (HandleUpdate(sensorPtr, timestamp))
+    {
+        PushJson(sensorPtr, timestamp, value);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start reporting a sensor's latest sample again, if the sensor is idle.
+ *
+ * @return true if the sample should be pushed right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HandleRepeat
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    // The sample isn't buffered, so it can only be pushed now: with a push in progress, its turn
+    // would come after the backlog was read past it.
+    if ((sensorPtr->state != TRACKER_STATE_IDLE) || (timestamp <= sensorPtr->newestTimestamp))
+    {
+        return false;
+    }
+
+    // Nor can it wait for a flush.
+    bool isHeld = sensorPtr->isHeld;
+    sensorPtr->isHeld = false;
+    bool isPushed = HandleUpdate(sensorPtr, timestamp);
+    sensorPtr->isHeld = isHeld;
+
+    return isPushed;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a numeric sensor's latest sample again, with a newer timestamp, if the sensor is idle.
+ *
+ * @return true if the sample is pushed, false if nothing was done.
+ */
+//--------------------------------------------------------------------------------------------------
+bool tracker_RepeatNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+)
+{
+    if (!HandleRepeat(sensorPtr, timestamp))
+    {
+        return false;
+    }
+
+    PushNumeric(sensorPtr, timestamp, value);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a JSON sensor's latest sample again, with a newer timestamp, if the sensor is idle.
+ *
+ * @return true if the sample is pushed, false if nothing was done.
+ */
+//--------------------------------------------------------------------------------------------------
+bool tracker_RepeatJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+)
+{
+    if (!HandleRepeat(sensorPtr, timestamp))
+    {
+        return false;
+    }
+
+    PushJson(sensorPtr, timestamp, value);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the completion of a push started by the backend.
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_HandlePushComplete
+(
+    tracker_Sensor_t* sensorPtr,
+    bool isSuccess
+)
+{
+    if (isSuccess)
+    {
+        tracker_AddDelivered(sensorPtr, sensorPtr->pushStart, sensorPtr->timestamp);
+        ForgetDeliveredSeqs(sensorPtr);
+
+        // If there's more data to push (including gaps older than the newest sample, e.g., from
+        // before a restart), push it now.  Otherwise, the next update from the sensor can be
+        // pushed right away.
+        if (   (sensorPtr->state == TRACKER_STATE_BACKLOGGED)
+            || (tracker_GetGapStart(sensorPtr) < sensorPtr->newestTimestamp))
+        {
+            PushNext(sensorPtr);
+        }
+        else if (sensorPtr->state == TRACKER_STATE_PUSHING)
+        {
+            sensorPtr->state = TRACKER_STATE_IDLE;
+        }
+    }
+    else
+    {
+        LE_WARN("Push to the cloud failed (%s). Retrying...", sensorPtr->obsPath);
+
+        // Nothing it covered was delivered, so it's retried as part of a gap.
+        PushNext(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push what a sensor has waiting, if it is held (or its last push couldn't be started).
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_Flush
+(
+    tracker_Sensor_t* sensorPtr
+)
+{
+    if ((sensorPtr->state == TRACKER_STATE_HELD) || (sensorPtr->state == TRACKER_STATE_FAULT))
+    {
+        PushNext(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sample has been delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+bool tracker_IsDelivered
+(
+    const tracker_Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    if (timestamp <= 0.0)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < sensorPtr->numDelivered; i++)
+    {
+        const tracker_Interval_t* intervalPtr = &sensorPtr->delivered[i];
+
+        if (timestamp <= intervalPtr->end)
+        {
+            return (timestamp > intervalPtr->start);
+        }
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the start of the oldest gap in what has been delivered.
+ *
+ * @return The timestamp the gap is after.
+ */
+//--------------------------------------------------------------------------------------------------
+double tracker_GetGapStart
+(
+    const tracker_Sensor_t* sensorPtr
+)
+{
+    if ((sensorPtr->numDelivered > 0) && (sensorPtr->delivered[0].start <= 0.0))
+    {
+        return sensorPtr->delivered[0].end;
+    }
+
+    return 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a time range as delivered, merging it with the ranges it overlaps or touches.
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_AddDelivered
+(
+    tracker_Sensor_t* sensorPtr,
+    double start,   ///< Exclusive.
+    double end      ///< Inclusive.
+)
+{
+    tracker_Interval_t* delivered = sensorPtr->delivered;
+    size_t count = sensorPtr->numDelivered;
+
+    // Samples at or before 0 count as delivered already.
+    if (!(end > start) || (end <= 0.0))
+    {
+        return;
+    }
+
+    // Find the first range ending at or after the new one's start, and the ranges after it that
+    // start at or before the new one's end: those are merged with the new one.
+    size_t first = 0;
+    while ((first < count) && (delivered[first].end < start))
+    {
+        first++;
+    }
+
+    size_t last = first;
+    while ((last < count) && (delivered[last].start <= end))
+    {
+        start = fmin(start, delivered[last].start);
+        end = fmax(end, delivered[last].end);
+        last++;
+    }
+
+    if (last > first)
+    {
+        delivered[first].start = start;
+        delivered[first].end = end;
+        memmove(&delivered[first + 1], &delivered[last], (count - last) * sizeof(delivered[0]));
+        sensorPtr->numDelivered = count - (last - first - 1);
+        return;
+    }
+
+    if (count == TRACKER_MAX_INTERVALS)
+    {
+        // Give up on the oldest gap.  Its samples are the likeliest to be dropped from the backlog
+        // buffer before they can be sent anyway.
+        LE_WARN("Too many gaps in the delivery of '%s'. Giving up on the samples after %lf.",
+                sensorPtr->obsPath,
+                (first == 0) ? end : delivered[0].end);
+
+        if (first == 0)
+        {
+            delivered[0].start = start;
+            return;
+        }
+
+        delivered[0].end = delivered[1].end;
+        memmove(&delivered[1], &delivered[2], (count - 2) * sizeof(delivered[0]));
+        sensorPtr->numDelivered = count - 1;
+
+        tracker_AddDelivered(sensorPtr, start, end);
+        return;
+    }
+
+    memmove(&delivered[first + 1], &delivered[first], (count - first) * sizeof(delivered[0]));
+    delivered[first].start = start;
+    delivered[first].end = end;
+    sensorPtr->numDelivered = count + 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the sequence number to push a sample with: the one it was pushed with before without
+ * acknowledgement, or else a new one.  Nothing is recorded until tracker_SetSent() is called, so
+ * new ones are counted in numNewPtr, to give each sample of a batch a different one.
+ *
+ * @return The sequence number.
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t tracker_GetSeq
+(
+    const tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    size_t* numNewPtr   ///< [IN/OUT] New sequence numbers given so far in the batch.
+)
+{
+    for (size_t i = 0; i < sensorPtr->numSent; i++)
+    {
+        if (sensorPtr->sent[i].timestamp == timestamp)
+        {
+            return sensorPtr->sent[i].seq;
+        }
+    }
+
+    (*numNewPtr)++;
+
+    return sensorPtr->lastSeq + *numNewPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that a sample was pushed with a sequence number from tracker_GetSeq().
+ */
+//--------------------------------------------------------------------------------------------------
+void tracker_SetSent
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    uint64_t seq
+)
+{
+    if (seq > sensorPtr->lastSeq)
+    {
+        sensorPtr->lastSeq = seq;
+    }
+
+    for (size_t i = 0; i < sensorPtr->numSent; i++)
+    {
+        if (sensorPtr->sent[i].timestamp == timestamp)
+        {
+            sensorPtr->sent[i].seq = seq;
+            return;
+        }
+    }
+
+    if (sensorPtr->numSent == TRACKER_MAX_SENT)
+    {
+        memmove(&sensorPtr->sent[0],
+                &sensorPtr->sent[1],
+                (TRACKER_MAX_SENT - 1) * sizeof(sensorPtr->sent[0]));
+        sensorPtr->numSent--;
+    }
+
+    sensorPtr->sent[sensorPtr->numSent].timestamp = timestamp;
+    sensorPtr->sent[sensorPtr->numSent].seq = seq;
+    sensorPtr->numSent++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make sure sequence numbers are reserved for a number of new samples, before pushing them.  The
+ * reservation is what persists, so that a restart never gives out a sequence number again.
+ *
+ * @return true if more were reserved, which must be saved (see tracker_Save()) before the push.
+ *         If they can't be, seqLimit must be set back to what it was and nothing pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+bool tracker_ReserveSeqs
+(
+    tracker_Sensor_t* sensorPtr,
+    size_t numNew
+)
+{
+    if ((sensorPtr->lastSeq + numNew) <= sensorPtr->seqLimit)
+    {
+        return false;
+    }
+
+    sensorPtr->seqLimit = sensorPtr->lastSeq + numNew + TRACKER_SEQ_BLOCK;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a sensor by observation path.
+ *
+ * @return The sensor, or NULL if none has the path.
+ */
+//--------------------------------------------------------------------------------------------------
+static tracker_Sensor_t* FindSensor
+(
+    tracker_Sensor_t* const sensors[],
+    size_t numSensors,
+    const char* obsPath
+)
+{
+    for (size_t i = 0; i < numSensors; i++)
+    {
+        if (strcmp(sensors[i]->obsPath, obsPath) == 0)
+        {
+            return sensors[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load sensors' delivered ranges and sequence numbers from a file, adding the ranges to the ones
+ * they have.  Lines for other sensors and malformed lines are skipped.
+ *
+ * @return LE_OK if successful, LE_NOT_FOUND if there is no file, LE_FAULT if it can't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tracker_Load
+(
+    tracker_Sensor_t* const sensors[],
+    size_t numSensors,
+    const char* path
+)
+{
+    FILE* filePtr = fopen(path, "r");
+    if (filePtr == NULL)
+    {
+        return (errno == ENOENT) ? LE_NOT_FOUND : LE_FAULT;
+    }
+
+    char line[MAX_LINE_BYTES];
+    char obsPath[MAX_LINE_BYTES];
+    unsigned int lineNum = 0;
+
+    while (fgets(line, sizeof(line), filePtr) != NULL)
+    {
+        lineNum++;
+        if ((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+
+        double start;
+        double end;
+        uint64_t seq;
+        tracker_Sensor_t* sensorPtr;
+
+        if (sscanf(line, "%255s seq %" SCNu64, obsPath, &seq) == 2)
+        {
+            // Continue after the sequence numbers that may have been given out.
+            sensorPtr = FindSensor(sensors, numSensors, obsPath);
+            if ((sensorPtr != NULL) && (seq > sensorPtr->seqLimit))
+            {
+                sensorPtr->lastSeq = seq;
+                sensorPtr->seqLimit = seq;
+            }
+        }
+        else if (sscanf(line, "%255s sent %lf %" SCNu64, obsPath, &start, &seq) == 3)
+        {
+            sensorPtr = FindSensor(sensors, numSensors, obsPath);
+            if (sensorPtr != NULL)
+            {
+                tracker_SetSent(sensorPtr, start, seq);
+            }
+        }
+        else if (   (sscanf(line, "%255s %lf %lf", obsPath, &start, &end) == 3)
+                 && (end > start))
+        {
+            sensorPtr = FindSensor(sensors, numSensors, obsPath);
+            if (sensorPtr != NULL)
+            {
+                tracker_AddDelivered(sensorPtr, start, end);
+            }
+        }
+        else
+        {
+            LE_WARN("%s:%u: malformed delivery record. Skipped.", path, lineNum);
+        }
+    }
+
+    bool isOk = !ferror(filePtr);
+    fclose(filePtr);
+
+    return isOk ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save sensors' delivered ranges and sequence numbers to a file.
+ *
+ * They are written to a temporary file beside it, synced, and then renamed over it, so the file
+ * keeps its previous contents if power is lost during the save.
+ *
+ * @return LE_OK if successful, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tracker_Save
+(
+    tracker_Sensor_t* const sensors[],
+    size_t numSensors,
+    const char* path
+)
+{
+    char tmpPath[PATH_MAX];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath))
+    {
+        return LE_FAULT;
+    }
+
+    FILE* filePtr = fopen(tmpPath, "w");
+    if (filePtr == NULL)
+    {
+        return LE_FAULT;
+    }
+
+    bool isOk = (fprintf(filePtr,
+                         "# obsPath start end (delivered after start, up to end)\n"
+                         "# obsPath seq limit | obsPath sent timestamp seq\n") > 0);
+
+    for (size_t i = 0; isOk && (i < numSensors); i++)
+    {
+        const tracker_Sensor_t* sensorPtr = sensors[i];
+
+        // Timestamps are written in full, so that a range still ends exactly at its sample.
+        for (size_t j = 0; isOk && (j < sensorPtr->numDelivered); j++)
+        {
+            isOk = (fprintf(filePtr,
+                            "%s %.17g %.17g\n",
+                            sensorPtr->obsPath,
+                            sensorPtr->delivered[j].start,
+                            sensorPtr->delivered[j].end) > 0);
+        }
+
+        if (isOk && (sensorPtr->seqLimit > 0))
+        {
+            isOk = (fprintf(filePtr,
+                            "%s seq %" PRIu64 "\n",
+                            sensorPtr->obsPath,
+                            sensorPtr->seqLimit) > 0);
+        }
+
+        for (size_t j = 0; isOk && (j < sensorPtr->numSent); j++)
+        {
+            isOk = (fprintf(filePtr,
+                            "%s sent %.17g %" PRIu64 "\n",
+                            sensorPtr->obsPath,
+                            sensorPtr->sent[j].timestamp,
+                            sensorPtr->sent[j].seq) > 0);
+        }
+    }
+
+    isOk = isOk && (fflush(filePtr) == 0) && (fsync(fileno(filePtr)) == 0);
+    isOk = (fclose(filePtr) == 0) && isOk;
+    isOk = isOk && (rename(tmpPath, path) == 0);
+
+    if (!isOk)
+    {
+        unlink(tmpPath);
+        return LE_FAULT;
+    }
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
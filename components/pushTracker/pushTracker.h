@@ -0,0 +1,385 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pushTracker.h
+ *
+ * Cloud push tracking state machine for sensor time-series.  Decides when a sensor sample is
+ * pushed, when the backlog buffered in the Data Hub is drained, and how failures are retried.
+ *
+ * The state machine is independent of where the samples come from and where they go.  Those are
+ * provided by a backend (tracker_Backend_t): avPublisher uses the Data Hub and AirVantage, and the
+ * push simulator uses a simulated buffer, link and clock.
+ *
+ * What has been delivered is kept per sensor as a set of delivered time ranges, not as the newest
+ * timestamp delivered, so delivery doesn't have to be in order: the newest sample is pushed first,
+ * and the gaps left by an outage (or by failed pushes) are backfilled afterward, oldest first.
+ * Only the samples in a gap are ever pushed again.  Samples timestamped at or before 0 count as
+ * delivered.
+ *
+ * A sensor can be held, so that its updates aren't pushed as they arrive but wait in the backlog
+ * until tracker_Flush() is called, e.g., to uplink in bulk at scheduled windows.  The flush then
+ * pushes the sensor's backlog as after an outage, and the sensor goes back to waiting once it has
+ * caught up.
+ *
+ * Each sample is uplinked with a sequence number, so the server can drop the duplicates a push
+ * that reached it but was reported failed causes when it is retried.  A sensor's sequence numbers
+ * increase (from 1) in the order its samples are first pushed.  A sample pushed again before its
+ * push was acknowledged gets the sequence number it was first pushed with, as long as it is one
+ * of the sensor's last TRACKER_MAX_SENT samples pushed without acknowledgement.
+ *
+ * The delivered ranges and the sequence numbers can be saved to a file and loaded back, so a
+ * restart neither sends again what was delivered before it nor reuses sequence numbers.  The
+ * file has lines of three forms:
+ *
+ * <obsPath> <start> <end>
+ * <obsPath> seq <limit>
+ * <obsPath> sent <timestamp> <seq>
+ *
+ * The first covers the samples timestamped after start, up to and including end.  The second is
+ * the limit sequence numbers have been given out up to (see tracker_ReserveSeqs()), after which a
+ * restart continues.  The third is a sample pushed without acknowledgement.  Lines starting with #
+ * are comments.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PUSH_TRACKER_H_INCLUDE_GUARD
+#define PUSH_TRACKER_H_INCLUDE_GUARD
+
+
+/// Maximum length of a JSON sample read from the backlog of a sensor that doesn't declare its own
+/// (see tracker_Sensor_t maxJsonLen).  Same as the Data Hub's IO_MAX_STRING_VALUE_LEN.
+#define TRACKER_MAX_JSON_LEN 50000
+
+/// Maximum number of delivered time ranges kept per sensor.  When a sensor has more, its oldest
+/// gap is given up on.
+#define TRACKER_MAX_INTERVALS 16
+
+/// Maximum number of samples pushed without acknowledgement whose sequence numbers are kept per
+/// sensor, for pushing them again with the same ones.
+#define TRACKER_MAX_SENT 64
+
+/// Number of sequence numbers reserved at a time (see tracker_ReserveSeqs()).
+#define TRACKER_SEQ_BLOCK 1000
+
+
+/// Push state of a sensor.
+typedef enum
+{
+    TRACKER_STATE_IDLE,      ///< No data to send.
+    TRACKER_STATE_PUSHING,   ///< Sending data to the cloud.
+    TRACKER_STATE_BACKLOGGED,///< Sending data to the cloud and more data waiting to be sent.
+    TRACKER_STATE_FAULT,     ///< Failed to push data.
+    TRACKER_STATE_HELD,      ///< Held sensor with data waiting for tracker_Flush().
+}
+tracker_State_t;
+
+
+typedef struct tracker_Sensor tracker_Sensor_t;
+
+
+/// Delivered time range: the samples timestamped after start, up to and including end.
+typedef struct
+{
+    double start;
+    double end;
+}
+tracker_Interval_t;
+
+
+/// Sample pushed without acknowledgement, and the sequence number it was pushed with.
+typedef struct
+{
+    double timestamp;
+    uint64_t seq;
+}
+tracker_Sent_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operations a backend provides to the state machine.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Start pushing a numeric sample to the cloud.  If LE_OK is returned, the outcome must later
+     * be reported with tracker_HandlePushComplete().
+     *
+     * The backend may include newer backlogged samples in the same push, up to the first one that
+     * is already delivered (see tracker_IsDelivered()).  If it does, it must set
+     * sensorPtr->timestamp to the timestamp of the newest sample included.
+     *
+     * @return LE_OK if the push was started.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*pushNumeric)(tracker_Sensor_t* sensorPtr, double timestamp, double value);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Start pushing a JSON sample to the cloud.  As for pushNumeric, plus:
+     *
+     * @return LE_FORMAT_ERROR if the sample is malformed and can never be pushed.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*pushJson)(tracker_Sensor_t* sensorPtr, double timestamp, const char* value);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Read the oldest buffered numeric sample newer than a given timestamp.
+     *
+     * @return LE_OK if found, LE_NOT_FOUND if there is none.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*readBacklogNumeric)(tracker_Sensor_t* sensorPtr,
+                                      double startAfter,
+                                      double* timestampPtr,
+                                      double* valuePtr);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Read the oldest buffered JSON sample newer than a given timestamp.
+     *
+     * @return LE_OK if found, LE_NOT_FOUND if there is none, LE_OVERFLOW if it is longer than the
+     *         buffer.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*readBacklogJson)(tracker_Sensor_t* sensorPtr,
+                                   double startAfter,
+                                   double* timestampPtr,
+                                   char* valuePtr,
+                                   size_t valueSize);
+}
+tracker_Backend_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Structure that holds variables needed to manage one sensor's data.
+ */
+//--------------------------------------------------------------------------------------------------
+struct tracker_Sensor
+{
+    const char* obsPath; ///< String containing Data Hub observation path to fetch data from.
+    bool isJson;         ///< true if the sensor's samples are JSON, false if numeric.
+    size_t maxJsonLen;   ///< Longest JSON sample (excluding the null terminator), or 0 for
+                         ///< TRACKER_MAX_JSON_LEN.  Sizes the buffers its backlog is read into.
+    const tracker_Backend_t* backendPtr; ///< Backend that moves this sensor's samples.
+    bool isHeld;         ///< Updates wait for tracker_Flush() instead of being pushed right away.
+    tracker_Interval_t delivered[TRACKER_MAX_INTERVALS]; ///< Delivered ranges, oldest first.
+    size_t numDelivered; ///< Number of delivered ranges.
+    double newestTimestamp; ///< Timestamp of newest sample received from the sensor, or 0.
+    double newestStart; ///< Newest sample is the only one after this (the one before it's time).
+    double pushStart; ///< Push in progress covers the samples after this, up to timestamp.
+    uint64_t lastSeq; ///< Last sequence number given to a sample, or 0.
+    uint64_t seqLimit; ///< Sequence numbers are reserved up to this one (see tracker_ReserveSeqs).
+    tracker_Sent_t sent[TRACKER_MAX_SENT]; ///< Pushed without acknowledgement, oldest first.
+    size_t numSent; ///< Number of samples pushed without acknowledgement.
+    double timestamp; ///< Timestamp of sample we are trying to push to the cloud.
+    tracker_State_t state; ///< State of the sensor.
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a numeric sensor update arriving from the sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_HandleNumericUpdate
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a JSON sensor update arriving from the sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_HandleJsonUpdate
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a numeric sensor's latest sample again (e.g., at an observation's pmax), with a newer
+ * timestamp, if the sensor is idle.  The sample isn't buffered, so it is pushed right away even if
+ * the sensor is held, and isn't pushed again if the push fails.  If the sensor isn't idle (e.g., a
+ * push is in progress), nothing is done, as the sample couldn't be read from the backlog later.
+ *
+ * @return true if the sample is pushed, false if nothing was done.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool tracker_RepeatNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a JSON sensor's latest sample again, as tracker_RepeatNumeric() does a numeric one.
+ *
+ * @return true if the sample is pushed, false if nothing was done.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool tracker_RepeatJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the completion of a push started by the backend.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_HandlePushComplete
+(
+    tracker_Sensor_t* sensorPtr,
+    bool isSuccess
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push what a sensor has waiting, if it is held (or its last push couldn't be started).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_Flush
+(
+    tracker_Sensor_t* sensorPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sample has been delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool tracker_IsDelivered
+(
+    const tracker_Sensor_t* sensorPtr,
+    double timestamp
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the start of the oldest gap in what has been delivered.
+ *
+ * @return The timestamp the gap is after.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double tracker_GetGapStart
+(
+    const tracker_Sensor_t* sensorPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a time range as delivered, merging it with the ranges it overlaps or touches.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_AddDelivered
+(
+    tracker_Sensor_t* sensorPtr,
+    double start,   ///< Exclusive.
+    double end      ///< Inclusive.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the sequence number to push a sample with: the one it was pushed with before without
+ * acknowledgement, or else a new one.  Nothing is recorded until tracker_SetSent() is called, so
+ * new ones are counted in numNewPtr, to give each sample of a batch a different one.
+ *
+ * @return The sequence number.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED uint64_t tracker_GetSeq
+(
+    const tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    size_t* numNewPtr   ///< [IN/OUT] New sequence numbers given so far in the batch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that a sample was pushed with a sequence number from tracker_GetSeq().
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tracker_SetSent
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    uint64_t seq
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make sure sequence numbers are reserved for a number of new samples, before pushing them.  The
+ * reservation is what persists, so that a restart never gives out a sequence number again.
+ *
+ * @return true if more were reserved, which must be saved (see tracker_Save()) before the push.
+ *         If they can't be, seqLimit must be set back to what it was and nothing pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED bool tracker_ReserveSeqs
+(
+    tracker_Sensor_t* sensorPtr,
+    size_t numNew
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load sensors' delivered ranges and sequence numbers from a file, adding the ranges to the ones
+ * they have.  Lines for other sensors and malformed lines are skipped.
+ *
+ * @return LE_OK if successful, LE_NOT_FOUND if there is no file, LE_FAULT if it can't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tracker_Load
+(
+    tracker_Sensor_t* const sensors[],
+    size_t numSensors,
+    const char* path
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save sensors' delivered ranges and sequence numbers to a file.
+ *
+ * They are written to a temporary file beside it, synced, and then renamed over it, so the file
+ * keeps its previous contents if power is lost during the save.
+ *
+ * @return LE_OK if successful, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tracker_Save
+(
+    tracker_Sensor_t* const sensors[],
+    size_t numSensors,
+    const char* path
+);
+
+
+#endif // PUSH_TRACKER_H_INCLUDE_GUARD
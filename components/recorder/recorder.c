@@ -0,0 +1,155 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file recorder.c
+ *
+ * Records the timestamped samples arriving at the cloud publisher's six Data Hub observations
+ * (/obs/accel, /obs/gyro, ...) into a compact binary sensor log (see sensorLog.h).
+ *
+ * Usage: record [LOG_FILE]
+ *
+ * Recording continues until the process is stopped (SIGTERM), at which point the log is flushed
+ * and closed.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sensorLog.h"
+
+
+#define DEFAULT_LOG_PATH "/tmp/redSensor.rslg"
+
+
+/// The log file being written.
+static FILE* LogFile = NULL;
+
+/// Number of samples recorded per channel.
+static uint64_t Counts[SLOG_NUM_CHANNELS];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Channel number.
+)
+{
+    slog_Channel_t channel = (slog_Channel_t)(uintptr_t)contextPtr;
+
+    le_result_t result = slog_WriteNumeric(LogFile, channel, timestamp, value);
+    if (result != LE_OK)
+    {
+        LE_FATAL("Failed to write to log (%s).", LE_RESULT_TXT(result));
+    }
+
+    Counts[channel]++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a JSON observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleJsonUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Channel number.
+)
+{
+    slog_Channel_t channel = (slog_Channel_t)(uintptr_t)contextPtr;
+
+    le_result_t result = slog_WriteJson(LogFile, channel, timestamp, value);
+    if (result == LE_OVERFLOW)
+    {
+        LE_ERROR("Sample from '%s' too long to record. Skipped.", slog_GetObsPath(channel));
+        return;
+    }
+    if (result != LE_OK)
+    {
+        LE_FATAL("Failed to write to log (%s).", LE_RESULT_TXT(result));
+    }
+
+    Counts[channel]++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush and close the log, then exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTerm
+(
+    int sigNum
+)
+{
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        LE_INFO("Recorded %" PRIu64 " samples from '%s'.",
+                Counts[channel],
+                slog_GetObsPath(channel));
+    }
+
+    if (fclose(LogFile) != 0)
+    {
+        LE_CRIT("Failed to close log (%m).");
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+
+COMPONENT_INIT
+{
+    const char* logPath = DEFAULT_LOG_PATH;
+
+    if (le_arg_NumArgs() > 0)
+    {
+        logPath = le_arg_GetArg(0);
+    }
+
+    LogFile = fopen(logPath, "w");
+    LE_FATAL_IF(LogFile == NULL, "Couldn't create '%s' - %m", logPath);
+    LE_FATAL_IF(slog_WriteHeader(LogFile) != LE_OK, "Couldn't write to '%s' - %m", logPath);
+
+    le_sig_Block(SIGTERM);
+    le_sig_SetEventHandler(SIGTERM, HandleTerm);
+
+    // Observations may not exist yet if the cloud publisher hasn't started.  Create them
+    // (LE_DUPLICATE is fine) so the handlers can be registered either way.
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        const char* obsPath = slog_GetObsPath(channel);
+
+        le_result_t result = dhubAdmin_CreateObs(obsPath);
+        if ((result != LE_OK) && (result != LE_DUPLICATE))
+        {
+            LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+                     obsPath,
+                     LE_RESULT_TXT(result));
+        }
+
+        if (slog_GetType(channel) == SLOG_TYPE_JSON)
+        {
+            dhubAdmin_AddJsonPushHandler(obsPath, HandleJsonUpdate, (void*)(uintptr_t)channel);
+        }
+        else
+        {
+            dhubAdmin_AddNumericPushHandler(obsPath,
+                                            HandleNumericUpdate,
+                                            (void*)(uintptr_t)channel);
+        }
+    }
+
+    LE_INFO("Recording sensor observations to '%s'.", logPath);
+}
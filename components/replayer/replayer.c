@@ -0,0 +1,252 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file replayer.c
+ *
+ * Replays a binary sensor log (see sensorLog.h) into the cloud publisher's Data Hub
+ * observations, so the publisher can be exercised with exactly the same input on every run.
+ *
+ * Usage: replay [--fast] [--keep-sources] LOG_FILE
+ *
+ * The observations are disconnected from the real sensors for the duration of the replay so the
+ * log is the only input.  Samples are pushed in log order.  Their timestamps keep the recorded
+ * spacing but are shifted so the first sample is stamped with the time the replay started; this
+ * keeps the publisher's delivered-timestamp bookkeeping consistent with any earlier live data.
+ *
+ * By default samples are pushed at their recorded pace (1x).  With --fast they are pushed as fast
+ * as the Data Hub will take them, SAMPLES_PER_BATCH at a time, yielding to the event loop between
+ * batches.  Either way, the sequence of (observation, timestamp, value) pushed is identical.
+ *
+ * When the log has been replayed, the observations are reconnected to the real sensors, unless
+ * --keep-sources is given, and the process exits.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sensorLog.h"
+
+
+/// Number of samples pushed per event loop iteration in fast mode.
+#define SAMPLES_PER_BATCH 64
+
+
+/// The log being replayed.
+static FILE* LogFile = NULL;
+
+/// true = push as fast as possible, false = push at the recorded pace.
+static bool IsFast = false;
+
+/// true = leave the observations disconnected from the real sensors after the replay.
+static bool KeepSources = false;
+
+/// Path of the log file.
+static const char* LogPath = NULL;
+
+/// The next sample to be pushed.
+static slog_Record_t Next;
+
+/// Timestamp of the first sample in the log, and the time at which the replay started.
+static double FirstTimestamp;
+static double StartTime;
+
+/// Timer used to pace the replay at 1x.
+static le_timer_Ref_t PaceTimer;
+
+/// Number of samples pushed per channel.
+static uint64_t Counts[SLOG_NUM_CHANNELS];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reconnect the observations to the sensors (unless asked not to), report, and exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Finish
+(
+    le_result_t result  ///< LE_NOT_FOUND if the end of the log was reached.
+)
+{
+    if (result != LE_NOT_FOUND)
+    {
+        LE_CRIT("Replay of '%s' aborted (%s).", LogPath, LE_RESULT_TXT(result));
+    }
+
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        if (!KeepSources)
+        {
+            dhubAdmin_SetSource(slog_GetObsPath(channel), slog_GetSourcePath(channel));
+        }
+
+        LE_INFO("Replayed %" PRIu64 " samples to '%s'.",
+                Counts[channel],
+                slog_GetObsPath(channel));
+    }
+
+    LE_INFO("Replay finished in %.3lf s.", Now() - StartTime);
+
+    exit((result == LE_NOT_FOUND) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the next sample into its observation and read the one after it.
+ *
+ * @return
+ *  - LE_OK if there is another sample to push.
+ *  - LE_NOT_FOUND at the end of the log.
+ *  - LE_FORMAT_ERROR if the log is corrupt.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PushNext
+(
+    void
+)
+{
+    const char* obsPath = slog_GetObsPath(Next.channel);
+    double timestamp = StartTime + (Next.timestamp - FirstTimestamp);
+
+    if (Next.type == SLOG_TYPE_JSON)
+    {
+        dhubAdmin_PushJson(obsPath, timestamp, Next.json);
+    }
+    else
+    {
+        dhubAdmin_PushNumeric(obsPath, timestamp, Next.numeric);
+    }
+
+    Counts[Next.channel]++;
+
+    return slog_ReadRecord(LogFile, &Next);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a batch of samples, then queue another batch (fast mode).
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushBatch
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    for (int i = 0; i < SAMPLES_PER_BATCH; i++)
+    {
+        le_result_t result = PushNext();
+        if (result != LE_OK)
+        {
+            Finish(result);
+        }
+    }
+
+    le_event_QueueFunction(PushBatch, NULL, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push all samples that have come due, then arm the timer for the next one (1x mode).
+ */
+//--------------------------------------------------------------------------------------------------
+static void PaceTimerHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    double elapsed = Now() - StartTime;
+
+    while ((Next.timestamp - FirstTimestamp) <= elapsed)
+    {
+        le_result_t result = PushNext();
+        if (result != LE_OK)
+        {
+            Finish(result);
+        }
+    }
+
+    double waitMs = ((Next.timestamp - FirstTimestamp) - elapsed) * 1000.0;
+
+    le_timer_SetMsInterval(PaceTimer, (waitMs < 1.0) ? 1 : (uint32_t)waitMs);
+    le_timer_Start(PaceTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Positional command-line argument handler.  Takes the log file path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetLogPath
+(
+    const char* arg
+)
+{
+    LogPath = arg;
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetFlagVar(&IsFast, NULL, "fast");
+    le_arg_SetFlagVar(&KeepSources, NULL, "keep-sources");
+    le_arg_AddPositionalCallback(SetLogPath);
+    le_arg_Scan();
+
+    LE_FATAL_IF(LogPath == NULL, "Usage: replay [--fast] [--keep-sources] LOG_FILE");
+
+    LogFile = fopen(LogPath, "r");
+    LE_FATAL_IF(LogFile == NULL, "Couldn't open '%s' - %m", LogPath);
+
+    le_result_t result = slog_ReadHeader(LogFile);
+    LE_FATAL_IF(result != LE_OK, "'%s' is not a sensor log (%s).", LogPath, LE_RESULT_TXT(result));
+
+    StartTime = Now();
+
+    result = slog_ReadRecord(LogFile, &Next);
+    if (result != LE_OK)
+    {
+        Finish(result);
+    }
+    FirstTimestamp = Next.timestamp;
+
+    // Disconnect the observations from the real sensors so the log is the only input.
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        dhubAdmin_RemoveSource(slog_GetObsPath(channel));
+    }
+
+    LE_INFO("Replaying '%s' at %s.", LogPath, IsFast ? "full speed" : "recorded pace");
+
+    if (IsFast)
+    {
+        le_event_QueueFunction(PushBatch, NULL, NULL);
+    }
+    else
+    {
+        PaceTimer = le_timer_Create("replayPace");
+        le_timer_SetHandler(PaceTimer, PaceTimerHandler);
+        le_timer_SetMsInterval(PaceTimer, 1);
+        le_timer_Start(PaceTimer);
+    }
+}
@@ -0,0 +1,220 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rollup.c
+ *
+ * Multi-resolution rollups of numeric sensors (see rollup.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "rollup.h"
+
+
+/// Length of each tier's buckets (seconds).
+static const double TierLengths[ROLLUP_NUM_TIERS] =
+{
+    [ROLLUP_TIER_MINUTE] = 60.0,
+    [ROLLUP_TIER_HOUR] = 3600.0,
+    [ROLLUP_TIER_DAY] = 86400.0,
+};
+
+/// Name of each tier.
+static const char* const TierNames[ROLLUP_NUM_TIERS] =
+{
+    [ROLLUP_TIER_MINUTE] = "minute",
+    [ROLLUP_TIER_HOUR] = "hour",
+    [ROLLUP_TIER_DAY] = "day",
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hand a tier's open bucket to the completion function, and leave the tier without an open
+ * bucket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompleteBucket
+(
+    rollup_Series_t* seriesPtr,
+    rollup_Tier_t tier
+)
+{
+    rollup_Bucket_t* bucketPtr = &seriesPtr->buckets[tier];
+
+    seriesPtr->completeFunc(tier, bucketPtr, seriesPtr->contextPtr);
+
+    seriesPtr->nextStarts[tier] = bucketPtr->start + TierLengths[tier];
+    bucketPtr->count = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a sensor's rollups.
+ */
+//--------------------------------------------------------------------------------------------------
+void rollup_Init
+(
+    rollup_Series_t* seriesPtr,
+    rollup_CompleteFunc_t completeFunc,
+    void* contextPtr
+)
+{
+    memset(seriesPtr, 0, sizeof(*seriesPtr));
+
+    for (size_t tier = 0; tier < ROLLUP_NUM_TIERS; tier++)
+    {
+        seriesPtr->nextStarts[tier] = -HUGE_VAL;
+    }
+
+    seriesPtr->completeFunc = completeFunc;
+    seriesPtr->contextPtr = contextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to every tier, completing the open buckets it falls after.
+ */
+//--------------------------------------------------------------------------------------------------
+void rollup_Add
+(
+    rollup_Series_t* seriesPtr,
+    double timestamp,
+    double value
+)
+{
+    for (rollup_Tier_t tier = 0; tier < ROLLUP_NUM_TIERS; tier++)
+    {
+        rollup_Bucket_t* bucketPtr = &seriesPtr->buckets[tier];
+        double start = floor(timestamp / TierLengths[tier]) * TierLengths[tier];
+
+        if ((bucketPtr->count > 0) && (start > bucketPtr->start))
+        {
+            CompleteBucket(seriesPtr, tier);
+        }
+
+        if (   (start < seriesPtr->nextStarts[tier])
+            || ((bucketPtr->count > 0) && (start < bucketPtr->start)))
+        {
+            seriesPtr->lateCounts[tier]++;
+            continue;
+        }
+
+        if (bucketPtr->count == 0)
+        {
+            bucketPtr->start = start;
+            bucketPtr->min = value;
+            bucketPtr->max = value;
+            bucketPtr->sum = 0.0;
+            bucketPtr->lastTime = -HUGE_VAL;
+        }
+        else if (value < bucketPtr->min)
+        {
+            bucketPtr->min = value;
+        }
+        else if (value > bucketPtr->max)
+        {
+            bucketPtr->max = value;
+        }
+
+        bucketPtr->count++;
+        bucketPtr->sum += value;
+
+        if (timestamp >= bucketPtr->lastTime)
+        {
+            bucketPtr->last = value;
+            bucketPtr->lastTime = timestamp;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the open buckets that end at or before a given time.
+ */
+//--------------------------------------------------------------------------------------------------
+void rollup_CloseUntil
+(
+    rollup_Series_t* seriesPtr,
+    double time
+)
+{
+    for (rollup_Tier_t tier = 0; tier < ROLLUP_NUM_TIERS; tier++)
+    {
+        const rollup_Bucket_t* bucketPtr = &seriesPtr->buckets[tier];
+
+        if ((bucketPtr->count > 0) && ((bucketPtr->start + TierLengths[tier]) <= time))
+        {
+            CompleteBucket(seriesPtr, tier);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the length of a tier's buckets.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+double rollup_GetLength
+(
+    rollup_Tier_t tier
+)
+{
+    LE_ASSERT(tier < ROLLUP_NUM_TIERS);
+
+    return TierLengths[tier];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a tier.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* rollup_GetName
+(
+    rollup_Tier_t tier
+)
+{
+    LE_ASSERT(tier < ROLLUP_NUM_TIERS);
+
+    return TierNames[tier];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a tier by name.
+ *
+ * @return LE_OK if found, LE_NOT_FOUND otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t rollup_FindTier
+(
+    const char* name,
+    rollup_Tier_t* tierPtr
+)
+{
+    for (rollup_Tier_t tier = 0; tier < ROLLUP_NUM_TIERS; tier++)
+    {
+        if (strcmp(name, TierNames[tier]) == 0)
+        {
+            *tierPtr = tier;
+            return LE_OK;
+        }
+    }
+
+    return LE_NOT_FOUND;
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rollup.h
+ *
+ * Multi-resolution rollups of a numeric sensor: the count, minimum, maximum, mean and last value
+ * of its samples in fixed 1 minute, 1 hour and 1 day buckets (aligned to the Epoch, so days are
+ * UTC days).
+ *
+ * Every tier is updated incrementally as samples arrive, in constant time and without allocating:
+ * only the open bucket of each tier is kept.  When a sample falls after a tier's open bucket (or
+ * rollup_CloseUntil() is called past its end), the bucket is handed to the completion function and
+ * a new one is started.  Samples older than a tier's open bucket are counted as late and left out
+ * of that tier.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef ROLLUP_H_INCLUDE_GUARD
+#define ROLLUP_H_INCLUDE_GUARD
+
+
+/// Rollup tiers, finest first.
+typedef enum
+{
+    ROLLUP_TIER_MINUTE,
+    ROLLUP_TIER_HOUR,
+    ROLLUP_TIER_DAY,
+    ROLLUP_NUM_TIERS
+}
+rollup_Tier_t;
+
+
+/// Summary of the samples in one bucket.
+typedef struct
+{
+    double start;       ///< Start of the bucket (seconds since the Epoch).
+    uint32_t count;     ///< Number of samples (0 if the bucket isn't started).
+    double min;
+    double max;
+    double sum;
+    double last;        ///< Value of the newest sample.
+    double lastTime;    ///< Timestamp of the newest sample.
+}
+rollup_Bucket_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called when a bucket is complete.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*rollup_CompleteFunc_t)
+(
+    rollup_Tier_t tier,
+    const rollup_Bucket_t* bucketPtr,
+    void* contextPtr
+);
+
+
+/// Rollups of one sensor.  Initialize with rollup_Init().
+typedef struct
+{
+    rollup_Bucket_t buckets[ROLLUP_NUM_TIERS];  ///< Open bucket of each tier.
+    double nextStarts[ROLLUP_NUM_TIERS];        ///< Earliest start of each tier's next bucket.
+    uint64_t lateCounts[ROLLUP_NUM_TIERS];      ///< Samples left out of each tier.
+    rollup_CompleteFunc_t completeFunc;
+    void* contextPtr;
+}
+rollup_Series_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a sensor's rollups.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void rollup_Init
+(
+    rollup_Series_t* seriesPtr,
+    rollup_CompleteFunc_t completeFunc,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to every tier, completing the open buckets it falls after.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void rollup_Add
+(
+    rollup_Series_t* seriesPtr,
+    double timestamp,       ///< Seconds since the Epoch.
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the open buckets that end at or before a given time, e.g., when a sensor has stopped
+ * producing samples.  Later samples in those buckets are late.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void rollup_CloseUntil
+(
+    rollup_Series_t* seriesPtr,
+    double time             ///< Seconds since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the length of a tier's buckets.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double rollup_GetLength
+(
+    rollup_Tier_t tier
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a tier: "minute", "hour" or "day".
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED const char* rollup_GetName
+(
+    rollup_Tier_t tier
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a tier by name.
+ *
+ * @return LE_OK if found, LE_NOT_FOUND otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t rollup_FindTier
+(
+    const char* name,
+    rollup_Tier_t* tierPtr      ///< [OUT]
+);
+
+
+#endif // ROLLUP_H_INCLUDE_GUARD
@@ -0,0 +1,1158 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rules.c
+ *
+ * Edge rules engine (see rules.h): a recursive-descent compiler from rule text to stack bytecode,
+ * and the virtual machine that evaluates it.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "rules.h"
+
+
+/// Bytecode operations.  Binary operations pop b, then a, and push (a op b).
+typedef enum
+{
+    OP_CONST,   ///< Push constants[arg].
+    OP_VALUE,   ///< Push values[arg].
+    OP_RULE,    ///< Push 1 if rules[arg] is active, 0 otherwise.
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG,
+    OP_NOT,
+    OP_AND,
+    OP_OR,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_ABS,
+    OP_SQRT,
+    OP_MIN,
+    OP_MAX,
+    OP_MAG,     ///< Pop arg values, push the square root of the sum of their squares.
+}
+Op_t;
+
+
+/// State of the compilation of a rule.
+typedef struct
+{
+    rules_Engine_t* enginePtr;
+    rules_Rule_t* rulePtr;      ///< Rule being compiled.
+    const char* textPtr;        ///< Whole rule text.
+    const char* posPtr;         ///< Next character to parse.
+    size_t depth;               ///< Evaluation stack depth after the code emitted so far.
+    le_result_t result;         ///< First error, or LE_OK.
+    char* errorPtr;
+    size_t errorSize;
+}
+Parser_t;
+
+
+/// A binary operator and its operation.
+typedef struct
+{
+    const char* text;
+    Op_t op;
+}
+Operator_t;
+
+/// Comparison operators.  Longer ones first, so "<=" isn't taken for "<".
+static const Operator_t ComparisonOps[] =
+{
+    { "==", OP_EQ },
+    { "!=", OP_NE },
+    { "<=", OP_LE },
+    { ">=", OP_GE },
+    { "<", OP_LT },
+    { ">", OP_GT },
+};
+
+static const Operator_t AdditiveOps[] =
+{
+    { "+", OP_ADD },
+    { "-", OP_SUB },
+};
+
+static const Operator_t MultiplicativeOps[] =
+{
+    { "*", OP_MUL },
+    { "/", OP_DIV },
+};
+
+
+static void ParseExpression(Parser_t* parserPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a compilation error, unless there already is one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Fail
+(
+    Parser_t* parserPtr,
+    le_result_t result,
+    const char* format,
+    ...
+)
+{
+    if (parserPtr->result != LE_OK)
+    {
+        return;
+    }
+
+    parserPtr->result = result;
+
+    int len = snprintf(parserPtr->errorPtr,
+                       parserPtr->errorSize,
+                       "column %d: ",
+                       (int)(parserPtr->posPtr - parserPtr->textPtr) + 1);
+
+    if ((len >= 0) && ((size_t)len < parserPtr->errorSize))
+    {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(parserPtr->errorPtr + len, parserPtr->errorSize - len, format, args);
+        va_end(args);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append an instruction to the rule being compiled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Emit
+(
+    Parser_t* parserPtr,
+    Op_t op,
+    size_t arg,
+    int stackChange     ///< Change of the stack depth when the instruction runs.
+)
+{
+    rules_Rule_t* rulePtr = parserPtr->rulePtr;
+
+    if (rulePtr->codeLen >= RULES_MAX_CODE)
+    {
+        Fail(parserPtr, LE_NO_MEMORY, "rule too long (max %d operations)", RULES_MAX_CODE);
+        return;
+    }
+
+    parserPtr->depth += stackChange;
+    if (parserPtr->depth > RULES_MAX_STACK)
+    {
+        Fail(parserPtr, LE_NO_MEMORY, "rule too deeply nested");
+        return;
+    }
+
+    rulePtr->code[rulePtr->codeLen].op = op;
+    rulePtr->code[rulePtr->codeLen].arg = arg;
+    rulePtr->codeLen++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip white space.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SkipSpace
+(
+    Parser_t* parserPtr
+)
+{
+    while (isspace((unsigned char)*parserPtr->posPtr))
+    {
+        parserPtr->posPtr++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consume a given token, if it is next.
+ *
+ * @return true if it was.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Accept
+(
+    Parser_t* parserPtr,
+    const char* token
+)
+{
+    size_t len = strlen(token);
+
+    SkipSpace(parserPtr);
+
+    if (strncmp(parserPtr->posPtr, token, len) != 0)
+    {
+        return false;
+    }
+
+    parserPtr->posPtr += len;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consume a given token, failing if it isn't next.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Expect
+(
+    Parser_t* parserPtr,
+    const char* token
+)
+{
+    if (!Accept(parserPtr, token))
+    {
+        Fail(parserPtr, LE_FORMAT_ERROR, "expected '%s'", token);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consume a name (letters, digits and underscores, not starting with a digit), if one is next.
+ *
+ * @return true if one was.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AcceptName
+(
+    Parser_t* parserPtr,
+    char name[RULES_MAX_NAME_LEN + 1]   ///< [OUT]
+)
+{
+    SkipSpace(parserPtr);
+
+    const char* startPtr = parserPtr->posPtr;
+    const char* endPtr = startPtr;
+
+    if (!isalpha((unsigned char)*endPtr) && (*endPtr != '_'))
+    {
+        return false;
+    }
+
+    while (isalnum((unsigned char)*endPtr) || (*endPtr == '_'))
+    {
+        endPtr++;
+    }
+
+    if ((endPtr - startPtr) > RULES_MAX_NAME_LEN)
+    {
+        Fail(parserPtr, LE_FORMAT_ERROR, "name too long (max %d characters)", RULES_MAX_NAME_LEN);
+        return false;
+    }
+
+    memcpy(name, startPtr, endPtr - startPtr);
+    name[endPtr - startPtr] = '\0';
+    parserPtr->posPtr = endPtr;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consume a number, if one is next.
+ *
+ * @return true if one was.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AcceptNumber
+(
+    Parser_t* parserPtr,
+    double* valuePtr    ///< [OUT]
+)
+{
+    SkipSpace(parserPtr);
+
+    const char* posPtr = parserPtr->posPtr;
+
+    // Not strtod() on its own, which also takes "inf", "nan" and hexadecimal.
+    if (   !isdigit((unsigned char)posPtr[0])
+        && !((posPtr[0] == '.') && isdigit((unsigned char)posPtr[1])))
+    {
+        return false;
+    }
+
+    char* endPtr;
+    *valuePtr = strtod(posPtr, &endPtr);
+    parserPtr->posPtr = endPtr;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Emit an instruction pushing a constant.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EmitConstant
+(
+    Parser_t* parserPtr,
+    double value
+)
+{
+    rules_Rule_t* rulePtr = parserPtr->rulePtr;
+    size_t i;
+
+    for (i = 0; i < RULES_MAX_CONSTANTS; i++)
+    {
+        // Unused constants are NAN, so never match (NAN != NAN).
+        if (rulePtr->constants[i] == value)
+        {
+            break;
+        }
+        if (isnan(rulePtr->constants[i]))
+        {
+            rulePtr->constants[i] = value;
+            break;
+        }
+    }
+
+    if (i == RULES_MAX_CONSTANTS)
+    {
+        Fail(parserPtr, LE_NO_MEMORY, "too many numbers (max %d)", RULES_MAX_CONSTANTS);
+        return;
+    }
+
+    Emit(parserPtr, OP_CONST, i, 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a channel by name.
+ *
+ * @return The channel, or NULL if there is none by that name.
+ */
+//--------------------------------------------------------------------------------------------------
+static const rules_Channel_t* FindChannel
+(
+    const rules_Engine_t* enginePtr,
+    const char* name
+)
+{
+    for (size_t i = 0; i < enginePtr->numChannels; i++)
+    {
+        if (strcmp(enginePtr->channels[i].name, name) == 0)
+        {
+            return &enginePtr->channels[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a rule by name.
+ *
+ * @return Its index, or -1 if there is none by that name.
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t FindRule
+(
+    const rules_Engine_t* enginePtr,
+    const char* name
+)
+{
+    for (size_t i = 0; i < enginePtr->numRules; i++)
+    {
+        if (strcmp(enginePtr->rules[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Emit an instruction pushing a channel value, and make the rule depend on the channel.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EmitValue
+(
+    Parser_t* parserPtr,
+    const rules_Channel_t* channelPtr,
+    size_t member
+)
+{
+    size_t channel = channelPtr - parserPtr->enginePtr->channels;
+
+    parserPtr->rulePtr->channelMask |= (1u << channel);
+    Emit(parserPtr, OP_VALUE, channelPtr->firstValue + member, 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the arguments of a function call, up to and including the closing parenthesis.
+ *
+ * @return The number of arguments.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t ParseArguments
+(
+    Parser_t* parserPtr,
+    bool isChannelAllowed   ///< A single JSON channel name stands for all its members.
+)
+{
+    size_t numArgs = 0;
+
+    if (Accept(parserPtr, ")"))
+    {
+        return 0;
+    }
+
+    if (isChannelAllowed)
+    {
+        const char* startPtr = parserPtr->posPtr;
+        char name[RULES_MAX_NAME_LEN + 1];
+
+        if (AcceptName(parserPtr, name) && Accept(parserPtr, ")"))
+        {
+            const rules_Channel_t* channelPtr = FindChannel(parserPtr->enginePtr, name);
+
+            if ((channelPtr != NULL) && (channelPtr->numMembers > 0))
+            {
+                for (size_t i = 0; i < channelPtr->numMembers; i++)
+                {
+                    EmitValue(parserPtr, channelPtr, i);
+                }
+                return channelPtr->numMembers;
+            }
+        }
+
+        // Not a channel on its own: parse it as an expression.
+        parserPtr->posPtr = startPtr;
+    }
+
+    do
+    {
+        ParseExpression(parserPtr);
+        numArgs++;
+    }
+    while ((parserPtr->result == LE_OK) && Accept(parserPtr, ","));
+
+    Expect(parserPtr, ")");
+
+    return numArgs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a function call, after its name and opening parenthesis.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseCall
+(
+    Parser_t* parserPtr,
+    const char* name
+)
+{
+    static const struct
+    {
+        const char* name;
+        Op_t op;
+        size_t minArgs;
+        size_t maxArgs;
+    }
+    Functions[] =
+    {
+        { "abs", OP_ABS, 1, 1 },
+        { "sqrt", OP_SQRT, 1, 1 },
+        { "min", OP_MIN, 2, 2 },
+        { "max", OP_MAX, 2, 2 },
+        { "mag", OP_MAG, 1, 3 },
+    };
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Functions); i++)
+    {
+        if (strcmp(Functions[i].name, name) == 0)
+        {
+            const char* startPtr = parserPtr->posPtr;
+            size_t numArgs = ParseArguments(parserPtr, Functions[i].op == OP_MAG);
+
+            if ((numArgs < Functions[i].minArgs) || (numArgs > Functions[i].maxArgs))
+            {
+                parserPtr->posPtr = startPtr;
+                Fail(parserPtr, LE_FORMAT_ERROR, "wrong number of arguments to %s()", name);
+                return;
+            }
+
+            Emit(parserPtr, Functions[i].op, numArgs, 1 - (int)numArgs);
+            return;
+        }
+    }
+
+    Fail(parserPtr, LE_FORMAT_ERROR, "unknown function '%s'", name);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a name used in an expression: a function call, a channel value or a rule.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseName
+(
+    Parser_t* parserPtr,
+    const char* name
+)
+{
+    const rules_Engine_t* enginePtr = parserPtr->enginePtr;
+
+    if (Accept(parserPtr, "("))
+    {
+        ParseCall(parserPtr, name);
+        return;
+    }
+
+    const rules_Channel_t* channelPtr = FindChannel(enginePtr, name);
+
+    if (channelPtr != NULL)
+    {
+        char member[RULES_MAX_NAME_LEN + 1];
+
+        if (channelPtr->numMembers == 0)
+        {
+            EmitValue(parserPtr, channelPtr, 0);
+            return;
+        }
+
+        if (!Accept(parserPtr, ".") || !AcceptName(parserPtr, member))
+        {
+            Fail(parserPtr, LE_FORMAT_ERROR, "expected '%s.<member>'", name);
+            return;
+        }
+
+        for (size_t i = 0; i < channelPtr->numMembers; i++)
+        {
+            if (strcmp(channelPtr->members[i], member) == 0)
+            {
+                EmitValue(parserPtr, channelPtr, i);
+                return;
+            }
+        }
+
+        Fail(parserPtr, LE_FORMAT_ERROR, "'%s' has no member '%s'", name, member);
+        return;
+    }
+
+    ssize_t rule = FindRule(enginePtr, name);
+
+    if (rule >= 0)
+    {
+        parserPtr->rulePtr->channelMask |= enginePtr->rules[rule].channelMask;
+        Emit(parserPtr, OP_RULE, rule, 1);
+        return;
+    }
+
+    Fail(parserPtr, LE_FORMAT_ERROR, "unknown channel or rule '%s'", name);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a unary expression: a number, name, parenthesized expression, or a negated or logically
+ * inverted unary expression.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseUnary
+(
+    Parser_t* parserPtr
+)
+{
+    char name[RULES_MAX_NAME_LEN + 1];
+    double value;
+
+    if (parserPtr->result != LE_OK)
+    {
+        return;
+    }
+
+    if (Accept(parserPtr, "-"))
+    {
+        ParseUnary(parserPtr);
+        Emit(parserPtr, OP_NEG, 0, 0);
+    }
+    else if (Accept(parserPtr, "!"))
+    {
+        ParseUnary(parserPtr);
+        Emit(parserPtr, OP_NOT, 0, 0);
+    }
+    else if (Accept(parserPtr, "("))
+    {
+        ParseExpression(parserPtr);
+        Expect(parserPtr, ")");
+    }
+    else if (AcceptNumber(parserPtr, &value))
+    {
+        EmitConstant(parserPtr, value);
+    }
+    else if (AcceptName(parserPtr, name))
+    {
+        ParseName(parserPtr, name);
+    }
+    else
+    {
+        Fail(parserPtr, LE_FORMAT_ERROR, "expected a number, name or '('");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Consume one of a set of binary operators, if one is next.
+ *
+ * @return true if one was.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AcceptOperator
+(
+    Parser_t* parserPtr,
+    const Operator_t operators[],
+    size_t numOperators,
+    Op_t* opPtr         ///< [OUT]
+)
+{
+    if (parserPtr->result != LE_OK)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < numOperators; i++)
+    {
+        if (Accept(parserPtr, operators[i].text))
+        {
+            *opPtr = operators[i].op;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a product or quotient.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseMultiplicative
+(
+    Parser_t* parserPtr
+)
+{
+    Op_t op;
+
+    ParseUnary(parserPtr);
+
+    while (AcceptOperator(parserPtr, MultiplicativeOps, NUM_ARRAY_MEMBERS(MultiplicativeOps), &op))
+    {
+        ParseUnary(parserPtr);
+        Emit(parserPtr, op, 0, -1);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a sum or difference.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseAdditive
+(
+    Parser_t* parserPtr
+)
+{
+    Op_t op;
+
+    ParseMultiplicative(parserPtr);
+
+    while (AcceptOperator(parserPtr, AdditiveOps, NUM_ARRAY_MEMBERS(AdditiveOps), &op))
+    {
+        ParseMultiplicative(parserPtr);
+        Emit(parserPtr, op, 0, -1);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a comparison.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseComparison
+(
+    Parser_t* parserPtr
+)
+{
+    Op_t op;
+
+    ParseAdditive(parserPtr);
+
+    if (AcceptOperator(parserPtr, ComparisonOps, NUM_ARRAY_MEMBERS(ComparisonOps), &op))
+    {
+        ParseAdditive(parserPtr);
+        Emit(parserPtr, op, 0, -1);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a logical AND.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseAnd
+(
+    Parser_t* parserPtr
+)
+{
+    ParseComparison(parserPtr);
+
+    while ((parserPtr->result == LE_OK) && Accept(parserPtr, "&&"))
+    {
+        ParseComparison(parserPtr);
+        Emit(parserPtr, OP_AND, 0, -1);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse an expression (a logical OR, the lowest precedence).
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseExpression
+(
+    Parser_t* parserPtr
+)
+{
+    ParseAnd(parserPtr);
+
+    while ((parserPtr->result == LE_OK) && Accept(parserPtr, "||"))
+    {
+        ParseAnd(parserPtr);
+        Emit(parserPtr, OP_OR, 0, -1);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a rule's optional duration ("for <number>ms" or "for <number>s").
+ */
+//--------------------------------------------------------------------------------------------------
+static void ParseDuration
+(
+    Parser_t* parserPtr
+)
+{
+    char keyword[RULES_MAX_NAME_LEN + 1];
+    double value;
+
+    if (parserPtr->result != LE_OK)
+    {
+        return;
+    }
+
+    const char* startPtr = parserPtr->posPtr;
+
+    if (!AcceptName(parserPtr, keyword) || (strcmp(keyword, "for") != 0))
+    {
+        parserPtr->posPtr = startPtr;
+        return;
+    }
+
+    if (!AcceptNumber(parserPtr, &value))
+    {
+        Fail(parserPtr, LE_FORMAT_ERROR, "expected a duration");
+    }
+    else if (strncmp(parserPtr->posPtr, "ms", 2) == 0)
+    {
+        parserPtr->rulePtr->duration = value / 1000.0;
+        parserPtr->posPtr += 2;
+    }
+    else if (*parserPtr->posPtr == 's')
+    {
+        parserPtr->rulePtr->duration = value;
+        parserPtr->posPtr++;
+    }
+    else
+    {
+        Fail(parserPtr, LE_FORMAT_ERROR, "expected 'ms' or 's' after the duration");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Truth of a value: anything but 0 is true, except unknown values (NAN).
+ */
+//--------------------------------------------------------------------------------------------------
+static inline bool IsTrue
+(
+    double value
+)
+{
+    return (value != 0.0) && !isnan(value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a rule's bytecode.
+ *
+ * @return The value of its expression.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Run
+(
+    const rules_Engine_t* enginePtr,
+    const rules_Rule_t* rulePtr
+)
+{
+    double stack[RULES_MAX_STACK];
+    size_t top = 0;     // Number of values on the stack.
+
+    for (size_t pc = 0; pc < rulePtr->codeLen; pc++)
+    {
+        const rules_Instr_t* instrPtr = &rulePtr->code[pc];
+
+        switch (instrPtr->op)
+        {
+            case OP_CONST:
+                stack[top++] = rulePtr->constants[instrPtr->arg];
+                continue;
+
+            case OP_VALUE:
+                stack[top++] = enginePtr->values[instrPtr->arg];
+                continue;
+
+            case OP_RULE:
+                stack[top++] = enginePtr->rules[instrPtr->arg].isActive ? 1.0 : 0.0;
+                continue;
+
+            case OP_MAG:
+            {
+                double sum = 0.0;
+
+                for (size_t i = 0; i < instrPtr->arg; i++)
+                {
+                    double value = stack[--top];
+                    sum += value * value;
+                }
+                stack[top++] = sqrt(sum);
+                continue;
+            }
+
+            case OP_NEG:  stack[top - 1] = -stack[top - 1]; continue;
+            case OP_NOT:  stack[top - 1] = IsTrue(stack[top - 1]) ? 0.0 : 1.0; continue;
+            case OP_ABS:  stack[top - 1] = fabs(stack[top - 1]); continue;
+            case OP_SQRT: stack[top - 1] = sqrt(stack[top - 1]); continue;
+        }
+
+        // Binary operations: pop b, and replace a with the result.
+        double b = stack[--top];
+        double* aPtr = &stack[top - 1];
+
+        switch (instrPtr->op)
+        {
+            case OP_ADD: *aPtr = *aPtr + b; break;
+            case OP_SUB: *aPtr = *aPtr - b; break;
+            case OP_MUL: *aPtr = *aPtr * b; break;
+            case OP_DIV: *aPtr = *aPtr / b; break;
+            case OP_AND: *aPtr = (IsTrue(*aPtr) && IsTrue(b)) ? 1.0 : 0.0; break;
+            case OP_OR:  *aPtr = (IsTrue(*aPtr) || IsTrue(b)) ? 1.0 : 0.0; break;
+            case OP_EQ:  *aPtr = (*aPtr == b) ? 1.0 : 0.0; break;
+            case OP_NE:  *aPtr = (*aPtr != b) ? 1.0 : 0.0; break;
+            case OP_LT:  *aPtr = (*aPtr < b) ? 1.0 : 0.0; break;
+            case OP_LE:  *aPtr = (*aPtr <= b) ? 1.0 : 0.0; break;
+            case OP_GT:  *aPtr = (*aPtr > b) ? 1.0 : 0.0; break;
+            case OP_GE:  *aPtr = (*aPtr >= b) ? 1.0 : 0.0; break;
+            case OP_MIN: *aPtr = fmin(*aPtr, b); break;
+            case OP_MAX: *aPtr = fmax(*aPtr, b); break;
+        }
+    }
+
+    return stack[0];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Evaluate a rule, and report it if it matches or clears.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Evaluate
+(
+    rules_Engine_t* enginePtr,
+    rules_Rule_t* rulePtr,
+    double timestamp,
+    rules_EventFunc_t eventFunc,
+    void* contextPtr
+)
+{
+    bool isHolding = IsTrue(Run(enginePtr, rulePtr));
+
+    if (isHolding && !rulePtr->isHolding)
+    {
+        rulePtr->holdingSince = timestamp;
+    }
+    rulePtr->isHolding = isHolding;
+
+    bool isActive = isHolding && ((timestamp - rulePtr->holdingSince) >= rulePtr->duration);
+
+    if (isActive != rulePtr->isActive)
+    {
+        rulePtr->isActive = isActive;
+
+        if (eventFunc != NULL)
+        {
+            eventFunc(rulePtr->name, isActive, timestamp, contextPtr);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an engine without channels or rules.
+ */
+//--------------------------------------------------------------------------------------------------
+void rules_Init
+(
+    rules_Engine_t* enginePtr
+)
+{
+    memset(enginePtr, 0, sizeof(*enginePtr));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a channel.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_DUPLICATE if there is already a channel by that name.
+ *  - LE_NO_MEMORY if there are too many channels or values.
+ *  - LE_BAD_PARAMETER if a name is too long.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t rules_AddChannel
+(
+    rules_Engine_t* enginePtr,
+    const char* name,
+    const char* const members[],
+    size_t numMembers,
+    size_t* channelPtr
+)
+{
+    size_t numValues = (numMembers > 0) ? numMembers : 1;
+
+    if (FindChannel(enginePtr, name) != NULL)
+    {
+        return LE_DUPLICATE;
+    }
+
+    if (   (enginePtr->numChannels >= RULES_MAX_CHANNELS)
+        || (numMembers > RULES_MAX_MEMBERS)
+        || ((enginePtr->numValues + numValues) > RULES_MAX_VALUES))
+    {
+        return LE_NO_MEMORY;
+    }
+
+    rules_Channel_t* newPtr = &enginePtr->channels[enginePtr->numChannels];
+
+    if (le_utf8_Copy(newPtr->name, name, sizeof(newPtr->name), NULL) != LE_OK)
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    for (size_t i = 0; i < numMembers; i++)
+    {
+        if (le_utf8_Copy(newPtr->members[i], members[i], sizeof(newPtr->members[i]), NULL)
+            != LE_OK)
+        {
+            return LE_BAD_PARAMETER;
+        }
+    }
+
+    newPtr->numMembers = numMembers;
+    newPtr->firstValue = enginePtr->numValues;
+
+    for (size_t i = 0; i < numValues; i++)
+    {
+        enginePtr->values[enginePtr->numValues++] = NAN;
+    }
+
+    *channelPtr = enginePtr->numChannels++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compile and add a rule.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the rule is malformed (described in the error buffer).
+ *  - LE_DUPLICATE if there is already a rule by that name.
+ *  - LE_NO_MEMORY if there are too many rules, or the rule is too long or too deeply nested.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t rules_Add
+(
+    rules_Engine_t* enginePtr,
+    const char* text,
+    char* errorPtr,
+    size_t errorSize
+)
+{
+    Parser_t parser = {
+        .enginePtr=enginePtr,
+        .rulePtr=&enginePtr->rules[enginePtr->numRules],
+        .textPtr=text,
+        .posPtr=text,
+        .depth=0,
+        .result=LE_OK,
+        .errorPtr=errorPtr,
+        .errorSize=errorSize,
+    };
+
+    if (enginePtr->numRules >= RULES_MAX_RULES)
+    {
+        Fail(&parser, LE_NO_MEMORY, "too many rules (max %d)", RULES_MAX_RULES);
+        return parser.result;
+    }
+
+    rules_Rule_t* rulePtr = parser.rulePtr;
+
+    memset(rulePtr, 0, sizeof(*rulePtr));
+    for (size_t i = 0; i < RULES_MAX_CONSTANTS; i++)
+    {
+        rulePtr->constants[i] = NAN;
+    }
+
+    if (!AcceptName(&parser, rulePtr->name))
+    {
+        Fail(&parser, LE_FORMAT_ERROR, "expected a rule name");
+        return parser.result;
+    }
+
+    if (   (FindRule(enginePtr, rulePtr->name) >= 0)
+        || (FindChannel(enginePtr, rulePtr->name) != NULL))
+    {
+        Fail(&parser, LE_DUPLICATE, "'%s' is already defined", rulePtr->name);
+        return parser.result;
+    }
+
+    Expect(&parser, "=");
+    ParseExpression(&parser);
+    ParseDuration(&parser);
+    SkipSpace(&parser);
+
+    if ((parser.result == LE_OK) && (*parser.posPtr != '\0'))
+    {
+        Fail(&parser, LE_FORMAT_ERROR, "unexpected '%s'", parser.posPtr);
+    }
+
+    if (parser.result == LE_OK)
+    {
+        LE_ASSERT(parser.depth == 1);
+        enginePtr->numRules++;
+    }
+
+    return parser.result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the channels the rules depend on.
+ *
+ * @return A mask with bit n set if channel n is used.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t rules_GetChannelMask
+(
+    const rules_Engine_t* enginePtr
+)
+{
+    uint32_t mask = 0;
+
+    for (size_t i = 0; i < enginePtr->numRules; i++)
+    {
+        mask |= enginePtr->rules[i].channelMask;
+    }
+
+    return mask;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update a channel's values, and evaluate the rules that depend on it.  Rules are evaluated in
+ * the order they were added, so rules used by others are up to date when those are evaluated.
+ */
+//--------------------------------------------------------------------------------------------------
+void rules_Update
+(
+    rules_Engine_t* enginePtr,
+    size_t channel,
+    const double values[],
+    double timestamp,
+    rules_EventFunc_t eventFunc,
+    void* contextPtr
+)
+{
+    LE_ASSERT(channel < enginePtr->numChannels);
+
+    const rules_Channel_t* channelPtr = &enginePtr->channels[channel];
+    size_t numValues = (channelPtr->numMembers > 0) ? channelPtr->numMembers : 1;
+    uint32_t bit = 1u << channel;
+
+    memcpy(&enginePtr->values[channelPtr->firstValue], values, numValues * sizeof(double));
+
+    for (size_t i = 0; i < enginePtr->numRules; i++)
+    {
+        rules_Rule_t* rulePtr = &enginePtr->rules[i];
+
+        if (rulePtr->channelMask & bit)
+        {
+            Evaluate(enginePtr, rulePtr, timestamp, eventFunc, contextPtr);
+        }
+    }
+}
+
+
+COMPONENT_INIT
+{
+}
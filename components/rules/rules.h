@@ -0,0 +1,213 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rules.h
+ *
+ * Edge rules engine.  Rules are conditions over sensor channels, compiled to a compact stack
+ * bytecode when they are added, and re-evaluated incrementally: an update of a channel only runs
+ * the rules that depend on it.  A rule matches (becomes active) once its condition has held for
+ * its duration, and clears when the condition stops holding; both are reported to an event
+ * function.
+ *
+ * A rule is one line of text:
+ *
+ *     <name> = <expression> [for <duration>]
+ *
+ * for example:
+ *
+ *     moving = mag(gyro) > 0.2
+ *     shock = mag(accel) > 19.6 && moving for 200ms
+ *
+ * Expressions are made of:
+ *  - numbers, e.g. 19.6 or 1e-3.
+ *  - channel values: "light" for numeric channels, "accel.x" for members of JSON channels.
+ *  - names of rules added before, which are 1 while the rule is active and 0 otherwise.
+ *  - the operators || && ! == != < <= > >= + - * / and parentheses, with C precedence.
+ *    Comparisons and logical operators give 1 (true) or 0 (false); anything but 0 is true.
+ *  - the functions abs(x), sqrt(x), min(a, b), max(a, b) and mag(...), the Euclidean norm of its
+ *    one to three arguments.  mag(accel) is short for mag(accel.x, accel.y, accel.z).
+ *
+ * Durations are a number followed by "ms" or "s".  Without one, a rule matches as soon as its
+ * condition holds.  Durations are measured between channel updates, so a rule's condition is
+ * only seen to have held for its duration at the next update of a channel the rule depends on.
+ *
+ * Everything is held in the engine structure, so evaluation never allocates memory.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef RULES_H_INCLUDE_GUARD
+#define RULES_H_INCLUDE_GUARD
+
+
+/// Longest channel, member or rule name (excluding the null terminator).
+#define RULES_MAX_NAME_LEN 31
+
+/// Most channels.
+#define RULES_MAX_CHANNELS 32
+
+/// Most members of a channel.
+#define RULES_MAX_MEMBERS 8
+
+/// Most channel values (all the members of all the channels).
+#define RULES_MAX_VALUES 64
+
+/// Most rules.
+#define RULES_MAX_RULES 128
+
+/// Most instructions in a rule.
+#define RULES_MAX_CODE 64
+
+/// Most constants in a rule.
+#define RULES_MAX_CONSTANTS 16
+
+/// Deepest evaluation stack of a rule.
+#define RULES_MAX_STACK 16
+
+
+/// A bytecode instruction: an operation and its operand (a value, constant or rule index, or an
+/// argument count).
+typedef struct
+{
+    uint8_t op;
+    uint8_t arg;
+}
+rules_Instr_t;
+
+
+/// A channel.
+typedef struct
+{
+    char name[RULES_MAX_NAME_LEN + 1];
+    char members[RULES_MAX_MEMBERS][RULES_MAX_NAME_LEN + 1];
+    size_t numMembers;          ///< 0 for a numeric channel.
+    size_t firstValue;          ///< Index of its (first member's) value.
+}
+rules_Channel_t;
+
+
+/// A compiled rule and its state.
+typedef struct
+{
+    char name[RULES_MAX_NAME_LEN + 1];
+    uint32_t channelMask;       ///< Channels it depends on, directly or through other rules.
+    double duration;            ///< Seconds its condition must hold before it matches.
+    size_t codeLen;
+    rules_Instr_t code[RULES_MAX_CODE];
+    double constants[RULES_MAX_CONSTANTS];
+    bool isHolding;             ///< Its condition held at the last evaluation.
+    double holdingSince;        ///< Timestamp from which the condition has held.
+    bool isActive;              ///< It matched and hasn't cleared since.
+}
+rules_Rule_t;
+
+
+/// A set of channels and rules.  Initialize with rules_Init().
+typedef struct
+{
+    rules_Channel_t channels[RULES_MAX_CHANNELS];
+    size_t numChannels;
+    double values[RULES_MAX_VALUES];    ///< Latest value of each channel (member), or NAN.
+    size_t numValues;
+    rules_Rule_t rules[RULES_MAX_RULES];
+    size_t numRules;
+}
+rules_Engine_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called when a rule matches or clears.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*rules_EventFunc_t)
+(
+    const char* name,       ///< Rule name.
+    bool isActive,          ///< true if it matched, false if it cleared.
+    double timestamp,       ///< Timestamp of the channel update that caused it.
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize an engine without channels or rules.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void rules_Init
+(
+    rules_Engine_t* enginePtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a channel.  Its values are unknown (NAN) until its first update.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_DUPLICATE if there is already a channel by that name.
+ *  - LE_NO_MEMORY if there are too many channels or values.
+ *  - LE_BAD_PARAMETER if a name is too long.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t rules_AddChannel
+(
+    rules_Engine_t* enginePtr,
+    const char* name,
+    const char* const members[],    ///< JSON member names, or NULL for a numeric channel.
+    size_t numMembers,              ///< 0 for a numeric channel.
+    size_t* channelPtr              ///< [OUT] Index, for rules_Update().
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compile and add a rule.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the rule is malformed (described in the error buffer).
+ *  - LE_DUPLICATE if there is already a rule by that name.
+ *  - LE_NO_MEMORY if there are too many rules, or the rule is too long or too deeply nested.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t rules_Add
+(
+    rules_Engine_t* enginePtr,
+    const char* text,
+    char* errorPtr,                 ///< [OUT] Why the rule couldn't be added.
+    size_t errorSize
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the channels the rules depend on.
+ *
+ * @return A mask with bit n set if channel n is used.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED uint32_t rules_GetChannelMask
+(
+    const rules_Engine_t* enginePtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update a channel's values, and evaluate the rules that depend on it.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void rules_Update
+(
+    rules_Engine_t* enginePtr,
+    size_t channel,
+    const double values[],          ///< One per member (one for a numeric channel).
+    double timestamp,               ///< Seconds since the Epoch.
+    rules_EventFunc_t eventFunc,
+    void* contextPtr
+);
+
+
+#endif // RULES_H_INCLUDE_GUARD
@@ -0,0 +1,304 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file rulesService.c
+ *
+ * Evaluates edge rules (see rules.h) on the sensor samples flowing through the Data Hub, and
+ * publishes when each rule matches and clears.
+ *
+ * The rules are read from a text file, one per line; blank lines and lines starting with '#' are
+ * skipped.  Each rule is published as a boolean input "rules/<name>" of this app, pushed true when
+ * the rule matches and false when it clears.  Only the sensors the rules use are observed, each
+ * through its own Data Hub observation, and an update of a sensor only evaluates the rules that
+ * depend on it.
+ *
+ * The sensors are the rule channels (members in parentheses):
+ *  accel (x, y, z), gyro (x, y, z), light, pressure, temperature, imuTemp and
+ *  position (lat, lon, hAcc, alt, vAcc).
+ *
+ * Configured with environment variables:
+ *
+ *  - RULES_FILE: path of the rules file (default /rules.txt, as bundled with redRules).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "rules.h"
+#include "sampleCodec.h"
+
+
+#define DEFAULT_RULES_FILE "/rules.txt"
+
+/// Longest line of the rules file (excluding the newline and null terminator).
+#define MAX_LINE_LEN 255
+
+/// Longest Data Hub path of a rule's input (excluding the null terminator).
+#define MAX_RULE_PATH_LEN (sizeof("rules/") - 1 + RULES_MAX_NAME_LEN)
+
+
+/// A sensor that rules can use.
+typedef struct
+{
+    const char* name;                               ///< Channel name.
+    const char* sourcePath;                         ///< Data Hub sensor value input.
+    const char* obsPath;                            ///< Data Hub observation feeding the rules.
+    size_t numMembers;                              ///< 0 for a numeric sensor.
+    const char* members[RULES_MAX_MEMBERS];         ///< JSON member names.
+    size_t channel;                                 ///< Index in the engine.
+}
+Channel_t;
+
+
+static Channel_t Channels[] =
+{
+    {
+        .name="accel",
+        .sourcePath="/app/redSensor/accel/value",
+        .obsPath="/obs/rulesAccel",
+        .numMembers=3,
+        .members={ "x", "y", "z" },
+    },
+    {
+        .name="gyro",
+        .sourcePath="/app/redSensor/gyro/value",
+        .obsPath="/obs/rulesGyro",
+        .numMembers=3,
+        .members={ "x", "y", "z" },
+    },
+    {
+        .name="light",
+        .sourcePath="/app/redSensor/light/value",
+        .obsPath="/obs/rulesLight",
+    },
+    {
+        .name="pressure",
+        .sourcePath="/app/redSensor/pressure/value",
+        .obsPath="/obs/rulesPressure",
+    },
+    {
+        .name="temperature",
+        .sourcePath="/app/redSensor/pressure/temp/value",
+        .obsPath="/obs/rulesTemperature",
+    },
+    {
+        .name="imuTemp",
+        .sourcePath="/app/redSensor/imu/temp/value",
+        .obsPath="/obs/rulesImuTemp",
+    },
+    {
+        .name="position",
+        .sourcePath="/app/redSensor/position/value",
+        .obsPath="/obs/rulesPosition",
+        .numMembers=5,
+        .members={ "lat", "lon", "hAcc", "alt", "vAcc" },
+    },
+};
+
+
+/// The rules and their state (too big for the stack).
+static rules_Engine_t Engine;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish a rule matching or clearing.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleRuleEvent
+(
+    const char* name,
+    bool isActive,
+    double timestamp,
+    void* contextPtr
+)
+{
+    char path[MAX_RULE_PATH_LEN + 1];
+
+    snprintf(path, sizeof(path), "rules/%s", name);
+    dhubIO_PushBoolean(path, timestamp, isActive);
+
+    LE_INFO("Rule '%s' %s.", name, isActive ? "matched" : "cleared");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Channel_t
+)
+{
+    const Channel_t* channelPtr = contextPtr;
+
+    rules_Update(&Engine, channelPtr->channel, &value, timestamp, HandleRuleEvent, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a JSON observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleJsonUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Channel_t
+)
+{
+    const Channel_t* channelPtr = contextPtr;
+    double values[RULES_MAX_MEMBERS];
+
+    for (size_t m = 0; m < channelPtr->numMembers; m++)
+    {
+        values[m] = codec_ExtractNumber(value, channelPtr->members[m]);
+        if (isnan(values[m]))
+        {
+            LE_ERROR("Malformed sample from '%s'. Skipped.", channelPtr->sourcePath);
+            return;
+        }
+    }
+
+    rules_Update(&Engine, channelPtr->channel, values, timestamp, HandleRuleEvent, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the rules in a file, and create each rule's Data Hub input.  Rules that can't be added are
+ * logged and skipped.
+ *
+ * @return The number of rules that couldn't be added.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t LoadRules
+(
+    const char* filePath
+)
+{
+    FILE* filePtr = fopen(filePath, "r");
+    LE_FATAL_IF(filePtr == NULL, "Couldn't open rules file '%s' (%m).", filePath);
+
+    char line[MAX_LINE_LEN + 2];
+    size_t lineNum = 0;
+    size_t numFailed = 0;
+
+    while (fgets(line, sizeof(line), filePtr) != NULL)
+    {
+        lineNum++;
+
+        size_t len = strlen(line);
+        if ((len > 0) && (line[len - 1] == '\n'))
+        {
+            line[--len] = '\0';
+        }
+        else if (!feof(filePtr))
+        {
+            LE_ERROR("%s:%zu: line too long (max %d characters). Skipped.",
+                     filePath,
+                     lineNum,
+                     MAX_LINE_LEN);
+            numFailed++;
+
+            int c;
+            while (((c = fgetc(filePtr)) != EOF) && (c != '\n'))
+            {
+            }
+            continue;
+        }
+
+        const char* textPtr = line + strspn(line, " \t\r");
+        if ((*textPtr == '\0') || (*textPtr == '#'))
+        {
+            continue;
+        }
+
+        char error[128];
+        le_result_t result = rules_Add(&Engine, textPtr, error, sizeof(error));
+        if (result != LE_OK)
+        {
+            LE_ERROR("%s:%zu: %s. Skipped.", filePath, lineNum, error);
+            numFailed++;
+            continue;
+        }
+
+        const rules_Rule_t* rulePtr = &Engine.rules[Engine.numRules - 1];
+        char path[MAX_RULE_PATH_LEN + 1];
+
+        snprintf(path, sizeof(path), "rules/%s", rulePtr->name);
+        result = dhubIO_CreateInput(path, DHUBIO_DATA_TYPE_BOOLEAN, "");
+        if ((result != LE_OK) && (result != LE_DUPLICATE))
+        {
+            LE_FATAL("Failed to create Data Hub input '%s' (%s).", path, LE_RESULT_TXT(result));
+        }
+        dhubIO_PushBoolean(path, 0.0, false);
+    }
+
+    fclose(filePtr);
+
+    return numFailed;
+}
+
+
+COMPONENT_INIT
+{
+    const char* filePath = getenv("RULES_FILE");
+    if (filePath == NULL)
+    {
+        filePath = DEFAULT_RULES_FILE;
+    }
+
+    rules_Init(&Engine);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Channels); i++)
+    {
+        Channel_t* channelPtr = &Channels[i];
+
+        LE_ASSERT_OK(rules_AddChannel(&Engine,
+                                      channelPtr->name,
+                                      (channelPtr->numMembers > 0) ? channelPtr->members : NULL,
+                                      channelPtr->numMembers,
+                                      &channelPtr->channel));
+    }
+
+    size_t numFailed = LoadRules(filePath);
+    uint32_t channelMask = rules_GetChannelMask(&Engine);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Channels); i++)
+    {
+        Channel_t* channelPtr = &Channels[i];
+
+        if ((channelMask & (1u << channelPtr->channel)) == 0)
+        {
+            continue;
+        }
+
+        le_result_t result = dhubAdmin_CreateObs(channelPtr->obsPath);
+        if ((result != LE_OK) && (result != LE_DUPLICATE))
+        {
+            LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+                     channelPtr->obsPath,
+                     LE_RESULT_TXT(result));
+        }
+
+        if (channelPtr->numMembers > 0)
+        {
+            dhubAdmin_AddJsonPushHandler(channelPtr->obsPath, HandleJsonUpdate, channelPtr);
+        }
+        else
+        {
+            dhubAdmin_AddNumericPushHandler(channelPtr->obsPath, HandleNumericUpdate, channelPtr);
+        }
+
+        dhubAdmin_SetSource(channelPtr->obsPath, channelPtr->sourcePath);
+    }
+
+    LE_INFO("Evaluating %zu rules from '%s' (%zu skipped).", Engine.numRules, filePath, numFailed);
+}
@@ -0,0 +1,350 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleCodec.c
+ *
+ * Encoding and decoding of the JSON sensor samples exchanged through the Data Hub.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "json.h"
+#include "sampleCodec.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a three-axis sample (accelerometer or gyro) as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodeXyz
+(
+    char* buffPtr,
+    size_t buffSize,
+    double x,
+    double y,
+    double z
+)
+{
+    int len = snprintf(buffPtr, buffSize, "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a tilt sample as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodeTilt
+(
+    char* buffPtr,
+    size_t buffSize,
+    double pitch,
+    double roll
+)
+{
+    int len = snprintf(buffPtr, buffSize, "{\"pitch\":%lf, \"roll\":%lf}", pitch, roll);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a shock event as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodeShock
+(
+    char* buffPtr,
+    size_t buffSize,
+    double peak,
+    double duration,
+    int axis
+)
+{
+    int len = snprintf(buffPtr,
+                       buffSize,
+                       "{\"peak\":%.3lf, \"duration\":%.3lf, \"axis\":%d}",
+                       peak,
+                       duration,
+                       axis);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a free-fall event as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodeFreeFall
+(
+    char* buffPtr,
+    size_t buffSize,
+    double peak,
+    double duration
+)
+{
+    int len = snprintf(buffPtr,
+                       buffSize,
+                       "{\"peak\":%.3lf, \"duration\":%.3lf}",
+                       peak,
+                       duration);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a position sample as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodePosition
+(
+    char* buffPtr,
+    size_t buffSize,
+    double latitude,
+    double longitude,
+    double hAccuracy,
+    double altitude,
+    double vAccuracy
+)
+{
+    int len = snprintf(buffPtr,
+                       buffSize,
+                       "{ \"lat\": %lf, \"lon\": %lf, \"hAcc\": %lf,"
+                        " \"alt\": %lf, \"vAcc\": %lf }",
+                       latitude,
+                       longitude,
+                       hAccuracy,
+                       altitude,
+                       vAccuracy);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode the GNSS receiver's duty-cycling statistics as JSON.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_EncodeGnssDuty
+(
+    char* buffPtr,
+    size_t buffSize,
+    double onRatio,
+    double availability,
+    double ttff,
+    double lead
+)
+{
+    int len = snprintf(buffPtr,
+                       buffSize,
+                       "{\"onRatio\":%.3lf, \"availability\":%.3lf, \"ttff\":%.3lf,"
+                       " \"lead\":%.3lf}",
+                       onRatio,
+                       availability,
+                       ttff,
+                       lead);
+    if ((len < 0) || (len >= buffSize))
+    {
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract a numerical member from a JSON structure.
+ *
+ * @return The number, or NAN if failed (check using isnan()) .
+ */
+//--------------------------------------------------------------------------------------------------
+double codec_ExtractNumber
+(
+    const char* json,
+    const char* memberName
+)
+{
+    char member[32];
+    json_DataType_t dataType;
+
+    le_result_t result = json_Extract(member, sizeof(member), json, memberName, &dataType);
+
+    if (result != LE_OK)
+    {
+        LE_ERROR("'%s' not found in JSON value '%s'.", memberName, json);
+        return NAN;
+    }
+
+    if (dataType != JSON_TYPE_NUMBER)
+    {
+        LE_ERROR("'%s' has wrong data type (%s) in JSON value '%s'.",
+                 memberName,
+                 json_GetDataTypeName(dataType),
+                 json);
+        return NAN;
+    }
+
+    double number = json_ConvertToNumber(member);
+
+    if (isnan(number))
+    {
+        LE_CRIT("Unable to convert '%s' to a number! (member '%s' of '%s')",
+                member,
+                memberName,
+                json);
+    }
+
+    return number;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a three-axis JSON sample.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if a member is missing or not a number.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_DecodeXyz
+(
+    const char* json,
+    double* xPtr,
+    double* yPtr,
+    double* zPtr
+)
+{
+    *xPtr = codec_ExtractNumber(json, "x");
+    if (isnan(*xPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *yPtr = codec_ExtractNumber(json, "y");
+    if (isnan(*yPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *zPtr = codec_ExtractNumber(json, "z");
+    if (isnan(*zPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a JSON position sample.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if a member is missing or not a number.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t codec_DecodePosition
+(
+    const char* json,
+    double* latitudePtr,
+    double* longitudePtr,
+    double* hAccuracyPtr,
+    double* altitudePtr,
+    double* vAccuracyPtr
+)
+{
+    *latitudePtr = codec_ExtractNumber(json, "lat");
+    if (isnan(*latitudePtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *longitudePtr = codec_ExtractNumber(json, "lon");
+    if (isnan(*longitudePtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *hAccuracyPtr = codec_ExtractNumber(json, "hAcc");
+    if (isnan(*hAccuracyPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *altitudePtr = codec_ExtractNumber(json, "alt");
+    if (isnan(*altitudePtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *vAccuracyPtr = codec_ExtractNumber(json, "vAcc");
+    if (isnan(*vAccuracyPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
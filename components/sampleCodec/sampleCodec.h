@@ -0,0 +1,211 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleCodec.h
+ *
+ * Encoding and decoding of the JSON sensor samples exchanged through the Data Hub.  The sensor
+ * components encode, and the cloud publisher decodes.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SAMPLE_CODEC_H_INCLUDE_GUARD
+#define SAMPLE_CODEC_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest encoding of each type of sample, excluding the null terminator.  The sensors encode into
+ * buffers of exactly this size, so no sample of the type in the Data Hub is longer, and readers
+ * can size their buffers to the type rather than to the Data Hub's longest string.
+ */
+//--------------------------------------------------------------------------------------------------
+#define CODEC_XYZ_MAX_LEN 127
+#define CODEC_TILT_MAX_LEN 63
+#define CODEC_SHOCK_MAX_LEN 63
+#define CODEC_FREE_FALL_MAX_LEN 63
+#define CODEC_POSITION_MAX_LEN 255
+#define CODEC_GNSS_DUTY_MAX_LEN 127
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a three-axis sample (accelerometer or gyro) as JSON, e.g.:
+ *
+ * {"x":-1.094340, "y":0.085514, "z":9.778496}
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodeXyz
+(
+    char* buffPtr,
+    size_t buffSize,
+    double x,
+    double y,
+    double z
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a tilt sample (derived from the accelerometer) as JSON, e.g.:
+ *
+ * {"pitch":-6.371042, "roll":0.501055}
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodeTilt
+(
+    char* buffPtr,
+    size_t buffSize,
+    double pitch,       ///< degrees
+    double roll         ///< degrees
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a shock event (see motionDetector.h) as JSON, e.g.:
+ *
+ * {"peak":3.059, "duration":0.050, "axis":-3}
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodeShock
+(
+    char* buffPtr,
+    size_t buffSize,
+    double peak,        ///< g
+    double duration,    ///< seconds
+    int axis            ///< +/-1, 2 or 3 for the positive or negative x, y or z axis
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a free-fall event (see motionDetector.h) as JSON, e.g.:
+ *
+ * {"peak":0.033, "duration":0.290}
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodeFreeFall
+(
+    char* buffPtr,
+    size_t buffSize,
+    double peak,        ///< g
+    double duration     ///< seconds
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a position sample as JSON, e.g.:
+ *
+ * { "lat": 49.172350, "lon": -123.070987, "hAcc": 14.000000, "alt": 0.009000, "vAcc": 8.000000 }
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodePosition
+(
+    char* buffPtr,
+    size_t buffSize,
+    double latitude,    ///< degrees
+    double longitude,   ///< degrees
+    double hAccuracy,   ///< metres
+    double altitude,    ///< metres
+    double vAccuracy    ///< metres
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode the GNSS receiver's duty-cycling statistics (see components/sensors/position) as JSON,
+ * e.g.:
+ *
+ * {"onRatio":0.182, "availability":0.975, "ttff":4.310, "lead":12.930}
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_EncodeGnssDuty
+(
+    char* buffPtr,
+    size_t buffSize,
+    double onRatio,         ///< Fraction of the time the receiver was on.
+    double availability,    ///< Fraction of the samples due that had a fix on time.
+    double ttff,            ///< Mean time to fix (seconds).
+    double lead             ///< How long before a sample the receiver is turned on (seconds).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract a numerical member from a JSON structure.
+ *
+ * @return The number, or NAN if failed (check using isnan()) .
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double codec_ExtractNumber
+(
+    const char* json,
+    const char* memberName
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a three-axis JSON sample.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if a member is missing or not a number.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_DecodeXyz
+(
+    const char* json,
+    double* xPtr,
+    double* yPtr,
+    double* zPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a JSON position sample.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if a member is missing or not a number.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t codec_DecodePosition
+(
+    const char* json,
+    double* latitudePtr,
+    double* longitudePtr,
+    double* hAccuracyPtr,
+    double* altitudePtr,
+    double* vAccuracyPtr
+);
+
+
+#endif // SAMPLE_CODEC_H_INCLUDE_GUARD
@@ -0,0 +1,459 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file senml.c
+ *
+ * SenML (RFC 8428) pack encoder, CBOR representation (RFC 7049).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "senml.h"
+
+
+// CBOR major types (already shifted into the top three bits of the initial byte).
+#define CBOR_UNSIGNED   0x00
+#define CBOR_NEGATIVE   0x20
+#define CBOR_TEXT       0x60
+#define CBOR_ARRAY      0x80
+#define CBOR_MAP        0xa0
+
+// CBOR floating point initial bytes.
+#define CBOR_FLOAT32    0xfa
+#define CBOR_FLOAT64    0xfb
+
+// SenML CBOR labels (RFC 8428 section 6).
+#define LABEL_BASE_NAME -2
+#define LABEL_BASE_TIME -3
+#define LABEL_NAME      0
+#define LABEL_VALUE     2
+#define LABEL_TIME      6
+
+/// Extension label carrying a sample's sequence number (in its first record).
+#define LABEL_SEQ       "seq"
+
+/// Space reserved for the array header at the start of the buffer: initial byte + 16-bit count.
+#define ARRAY_HEADER_SIZE 3
+
+/// Largest number of records a pack can hold (limited by the reserved array header).
+#define MAX_RECORDS 0xffff
+
+/// Integers beyond this magnitude aren't all exactly representable as doubles.
+#define MAX_EXACT_INT 9007199254740992.0 // 2^53
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append bytes to the pack.
+ *
+ * @return false if they don't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutBytes
+(
+    senml_Pack_t* packPtr,
+    const void* bytesPtr,
+    size_t numBytes
+)
+{
+    if ((packPtr->buffSize - packPtr->len) < numBytes)
+    {
+        return false;
+    }
+
+    memcpy(packPtr->buffPtr + packPtr->len, bytesPtr, numBytes);
+    packPtr->len += numBytes;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a CBOR initial byte and argument, in its shortest form, into a small buffer.
+ *
+ * @return The number of bytes encoded (1 to 9).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t EncodeHead
+(
+    uint8_t* headPtr,
+    uint8_t majorType,
+    uint64_t argument
+)
+{
+    size_t numArgBytes;
+
+    if (argument < 24)
+    {
+        headPtr[0] = majorType | (uint8_t)argument;
+        return 1;
+    }
+    else if (argument <= UINT8_MAX)
+    {
+        headPtr[0] = majorType | 24;
+        numArgBytes = 1;
+    }
+    else if (argument <= UINT16_MAX)
+    {
+        headPtr[0] = majorType | 25;
+        numArgBytes = 2;
+    }
+    else if (argument <= UINT32_MAX)
+    {
+        headPtr[0] = majorType | 26;
+        numArgBytes = 4;
+    }
+    else
+    {
+        headPtr[0] = majorType | 27;
+        numArgBytes = 8;
+    }
+
+    // Big-endian argument.
+    for (size_t i = 0; i < numArgBytes; i++)
+    {
+        headPtr[numArgBytes - i] = (uint8_t)(argument >> (8 * i));
+    }
+
+    return numArgBytes + 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a CBOR initial byte and argument.
+ *
+ * @return false if it doesn't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutHead
+(
+    senml_Pack_t* packPtr,
+    uint8_t majorType,
+    uint64_t argument
+)
+{
+    uint8_t head[9];
+
+    return PutBytes(packPtr, head, EncodeHead(head, majorType, argument));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a CBOR integer (a SenML label, or an integral value).
+ *
+ * @return false if it doesn't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutInt
+(
+    senml_Pack_t* packPtr,
+    int64_t value
+)
+{
+    if (value < 0)
+    {
+        // CBOR negative integers encode -1 - value.
+        return PutHead(packPtr, CBOR_NEGATIVE, (uint64_t)(-1 - value));
+    }
+
+    return PutHead(packPtr, CBOR_UNSIGNED, (uint64_t)value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a CBOR text string.
+ *
+ * @return false if it doesn't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutText
+(
+    senml_Pack_t* packPtr,
+    const char* text
+)
+{
+    size_t len = strlen(text);
+
+    return PutHead(packPtr, CBOR_TEXT, len) && PutBytes(packPtr, text, len);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a number in the smallest CBOR form that represents it exactly: integer, single or
+ * double precision float.
+ *
+ * @return false if it doesn't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutNumber
+(
+    senml_Pack_t* packPtr,
+    double value
+)
+{
+    if ((value == floor(value)) && (fabs(value) < MAX_EXACT_INT))
+    {
+        return PutInt(packPtr, (int64_t)value);
+    }
+
+    uint8_t bytes[9];
+    size_t numBytes;
+    float single = (float)value;
+
+    if ((double)single == value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        bytes[0] = CBOR_FLOAT32;
+        numBytes = 4;
+        for (size_t i = 0; i < numBytes; i++)
+        {
+            bytes[numBytes - i] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+    else
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        bytes[0] = CBOR_FLOAT64;
+        numBytes = 8;
+        for (size_t i = 0; i < numBytes; i++)
+        {
+            bytes[numBytes - i] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+
+    return PutBytes(packPtr, bytes, numBytes + 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a time (seconds), rounded to the millisecond, in the smallest CBOR form that holds the
+ * rounded value to the millisecond.
+ *
+ * @return false if it doesn't fit.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PutTime
+(
+    senml_Pack_t* packPtr,
+    double seconds
+)
+{
+    double ms = round(seconds * 1000.0);
+    double rounded = ms / 1000.0;
+    float single = (float)rounded;
+
+    if ((rounded != floor(rounded)) && (round((double)single * 1000.0) == ms))
+    {
+        return PutNumber(packPtr, (double)single);
+    }
+
+    return PutNumber(packPtr, rounded);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the length of the base name for a set of resource names: the longest common prefix that
+ * ends with a '.' or, if there is only one name, the whole name.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t senml_GetBaseNameLen
+(
+    const char* const names[],
+    size_t numNames
+)
+{
+    if (numNames == 0)
+    {
+        return 0;
+    }
+
+    if (numNames == 1)
+    {
+        return strlen(names[0]);
+    }
+
+    size_t baseLen = 0;
+
+    for (size_t i = 0; names[0][i] != '\0'; i++)
+    {
+        for (size_t n = 1; n < numNames; n++)
+        {
+            if (names[n][i] != names[0][i])
+            {
+                return baseLen;
+            }
+        }
+
+        if (names[0][i] == '.')
+        {
+            baseLen = i + 1;
+        }
+    }
+
+    return baseLen;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start encoding a pack into a buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+void senml_Start
+(
+    senml_Pack_t* packPtr,
+    uint8_t* buffPtr,
+    size_t buffSize,
+    const char* baseName,   ///< Base name ("" for none).  Must remain valid until senml_Finish().
+    double baseTime         ///< Base time (seconds since the Epoch).
+)
+{
+    LE_ASSERT(buffSize >= ARRAY_HEADER_SIZE);
+
+    packPtr->buffPtr = buffPtr;
+    packPtr->buffSize = buffSize;
+    packPtr->len = ARRAY_HEADER_SIZE;
+    packPtr->numRecords = 0;
+    packPtr->baseName = baseName;
+    packPtr->baseTime = baseTime;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to a pack: one record per field.  Either all of the sample's records are added,
+ * or none of them.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the sample doesn't fit in what is left of the buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t senml_AddSample
+(
+    senml_Pack_t* packPtr,
+    double timestamp,               ///< Seconds since the Epoch.
+    const char* const names[],      ///< Field names, relative to the base name.
+    const double values[],
+    size_t numFields,
+    uint64_t seq                    ///< Sequence number, or 0 for none.
+)
+{
+    if ((packPtr->numRecords + numFields) > MAX_RECORDS)
+    {
+        return LE_OVERFLOW;
+    }
+
+    size_t startLen = packPtr->len;
+    // Work in whole milliseconds so base time + relative time adds up to the rounded timestamp.
+    double relativeMs = round(timestamp * 1000.0) - round(packPtr->baseTime * 1000.0);
+    double relativeTime = relativeMs / 1000.0;
+    bool hasTime = (relativeMs != 0.0);
+
+    for (size_t i = 0; i < numFields; i++)
+    {
+        bool isFirst = (packPtr->numRecords == 0) && (i == 0);
+        bool hasBaseName = isFirst && (packPtr->baseName[0] != '\0');
+        bool hasName = (names[i][0] != '\0');
+        bool hasSeq = (i == 0) && (seq != 0);
+
+        // SenML resolves each record's time on its own, so every record of the sample has it.
+        size_t numPairs = 1 + (isFirst ? 1 : 0) + (hasBaseName ? 1 : 0) + (hasName ? 1 : 0)
+                        + (hasTime ? 1 : 0) + (hasSeq ? 1 : 0);
+
+        bool fits = PutHead(packPtr, CBOR_MAP, numPairs);
+
+        if (fits && hasBaseName)
+        {
+            fits = PutInt(packPtr, LABEL_BASE_NAME) && PutText(packPtr, packPtr->baseName);
+        }
+        if (fits && isFirst)
+        {
+            fits = PutInt(packPtr, LABEL_BASE_TIME) && PutTime(packPtr, packPtr->baseTime);
+        }
+        if (fits && hasName)
+        {
+            fits = PutInt(packPtr, LABEL_NAME) && PutText(packPtr, names[i]);
+        }
+        if (fits)
+        {
+            fits = PutInt(packPtr, LABEL_VALUE) && PutNumber(packPtr, values[i]);
+        }
+        if (fits && hasTime)
+        {
+            fits = PutInt(packPtr, LABEL_TIME) && PutTime(packPtr, relativeTime);
+        }
+        if (fits && hasSeq)
+        {
+            fits = PutText(packPtr, LABEL_SEQ) && PutHead(packPtr, CBOR_UNSIGNED, seq);
+        }
+
+        if (!fits)
+        {
+            packPtr->len = startLen;
+            packPtr->numRecords -= i;
+            return LE_OVERFLOW;
+        }
+
+        packPtr->numRecords++;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of records added to a pack so far.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t senml_GetNumRecords
+(
+    const senml_Pack_t* packPtr
+)
+{
+    return packPtr->numRecords;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finish encoding a pack.  The encoded pack starts at the beginning of the buffer.
+ *
+ * @return The size of the encoded pack (bytes).
+ */
+//--------------------------------------------------------------------------------------------------
+size_t senml_Finish
+(
+    senml_Pack_t* packPtr
+)
+{
+    uint8_t head[9];
+    size_t headLen = EncodeHead(head, CBOR_ARRAY, packPtr->numRecords);
+
+    LE_ASSERT(headLen <= ARRAY_HEADER_SIZE);
+
+    // Move the records down against the real (possibly shorter) array header.
+    size_t recordsLen = packPtr->len - ARRAY_HEADER_SIZE;
+    memmove(packPtr->buffPtr + headLen, packPtr->buffPtr + ARRAY_HEADER_SIZE, recordsLen);
+    memcpy(packPtr->buffPtr, head, headLen);
+
+    packPtr->len = headLen + recordsLen;
+
+    return packPtr->len;
+}
+
+
+COMPONENT_INIT
+{
+}
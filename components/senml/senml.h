@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file senml.h
+ *
+ * SenML (RFC 8428) pack encoder, CBOR representation.
+ *
+ * A pack carries a batch of samples of one sensor.  The common prefix of the sensor's resource
+ * names is sent once as the base name, and the first sample's timestamp once as the base time.
+ * Each sample then adds one record per field, carrying only the rest of the name, the value and
+ * (if non-zero) the time relative to the base time.  For example, two accelerometer samples:
+ *
+ * [ {bn:"MangOH.Sensors.Accelerometer.Acceleration.", bt:1500000000.1, n:"X", v:-1.09434},
+ *   {n:"Y", v:0.085514}, {n:"Z", v:9.778496},
+ *   {n:"X", v:-1.09434, t:10.0}, {n:"Y", v:0.085514, t:10.0}, {n:"Z", v:9.778496, t:10.0} ]
+ *
+ * A sample can also carry a sequence number, as the extension label "seq" of its first record,
+ * e.g., {n:"X", v:-1.09434, t:10.0, seq:42}.  Receivers that don't know the label ignore it (RFC
+ * 8428 section 4.4).
+ *
+ * Values are encoded losslessly in the smallest CBOR form that holds them exactly (integer,
+ * single or double precision float).  Relative times are rounded to the millisecond, like the
+ * timestamps given to the avdata service.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SENML_H_INCLUDE_GUARD
+#define SENML_H_INCLUDE_GUARD
+
+
+/// Pack being encoded.  The members are private to the encoder.
+typedef struct
+{
+    uint8_t* buffPtr;       ///< Output buffer.
+    size_t buffSize;        ///< Size of the output buffer (bytes).
+    size_t len;             ///< Bytes encoded so far, including the reserved array header.
+    size_t numRecords;      ///< Records encoded so far.
+    const char* baseName;   ///< Base name, sent in the first record ("" if none).
+    double baseTime;        ///< Base time (seconds since the Epoch), sent in the first record.
+}
+senml_Pack_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the length of the base name for a set of resource names: the longest common prefix that
+ * ends with a '.' or, if there is only one name, the whole name.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED size_t senml_GetBaseNameLen
+(
+    const char* const names[],
+    size_t numNames
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start encoding a pack into a buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void senml_Start
+(
+    senml_Pack_t* packPtr,
+    uint8_t* buffPtr,
+    size_t buffSize,
+    const char* baseName,   ///< Base name ("" for none).  Must remain valid until senml_Finish().
+    double baseTime         ///< Base time (seconds since the Epoch).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to a pack: one record per field.  Either all of the sample's records are added,
+ * or none of them.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the sample doesn't fit in what is left of the buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t senml_AddSample
+(
+    senml_Pack_t* packPtr,
+    double timestamp,               ///< Seconds since the Epoch.
+    const char* const names[],      ///< Field names, relative to the base name.
+    const double values[],
+    size_t numFields,
+    uint64_t seq                    ///< Sequence number, or 0 for none.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of records added to a pack so far.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED size_t senml_GetNumRecords
+(
+    const senml_Pack_t* packPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Finish encoding a pack.  The encoded pack starts at the beginning of the buffer.
+ *
+ * @return The size of the encoded pack (bytes).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED size_t senml_Finish
+(
+    senml_Pack_t* packPtr
+);
+
+
+#endif // SENML_H_INCLUDE_GUARD
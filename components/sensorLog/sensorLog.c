@@ -0,0 +1,302 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorLog.c
+ *
+ * Reading and writing of the compact binary sensor sample log.  See sensorLog.h for the format.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "sensorLog.h"
+
+
+static const char Magic[4] = { 'R', 'S', 'L', 'G' };
+
+
+/// Record header, as stored in the file.
+typedef struct __attribute__((packed))
+{
+    uint8_t channel;
+    uint8_t type;
+    uint16_t length;
+    double timestamp;
+}
+RecordHeader_t;
+
+
+/// Per-channel information.
+static const struct
+{
+    const char* obsPath;
+    const char* sourcePath;
+    slog_Type_t type;
+}
+Channels[SLOG_NUM_CHANNELS] =
+{
+    [SLOG_CHANNEL_ACCEL] =
+        { "/obs/accel", "/app/redSensor/accel/value", SLOG_TYPE_JSON },
+    [SLOG_CHANNEL_GYRO] =
+        { "/obs/gyro", "/app/redSensor/gyro/value", SLOG_TYPE_JSON },
+    [SLOG_CHANNEL_LIGHT] =
+        { "/obs/light", "/app/redSensor/light/value", SLOG_TYPE_NUMERIC },
+    [SLOG_CHANNEL_PRESSURE] =
+        { "/obs/pressure", "/app/redSensor/pressure/value", SLOG_TYPE_NUMERIC },
+    [SLOG_CHANNEL_TEMPERATURE] =
+        { "/obs/temperature", "/app/redSensor/pressure/temp/value", SLOG_TYPE_NUMERIC },
+    [SLOG_CHANNEL_POSITION] =
+        { "/obs/position", "/app/redSensor/position/value", SLOG_TYPE_JSON },
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the Data Hub observation path that a channel is recorded from (and replayed to).
+ */
+//--------------------------------------------------------------------------------------------------
+const char* slog_GetObsPath
+(
+    slog_Channel_t channel
+)
+{
+    LE_ASSERT(channel < SLOG_NUM_CHANNELS);
+
+    return Channels[channel].obsPath;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the Data Hub sensor input path that normally feeds a channel's observation.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* slog_GetSourcePath
+(
+    slog_Channel_t channel
+)
+{
+    LE_ASSERT(channel < SLOG_NUM_CHANNELS);
+
+    return Channels[channel].sourcePath;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the data type of a channel's samples.
+ */
+//--------------------------------------------------------------------------------------------------
+slog_Type_t slog_GetType
+(
+    slog_Channel_t channel
+)
+{
+    LE_ASSERT(channel < SLOG_NUM_CHANNELS);
+
+    return Channels[channel].type;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the log file header.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t slog_WriteHeader
+(
+    FILE* f
+)
+{
+    uint16_t version = SLOG_VERSION;
+    uint16_t reserved = 0;
+
+    if (   (fwrite(Magic, sizeof(Magic), 1, f) != 1)
+        || (fwrite(&version, sizeof(version), 1, f) != 1)
+        || (fwrite(&reserved, sizeof(reserved), 1, f) != 1)  )
+    {
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a numeric sample to a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t slog_WriteNumeric
+(
+    FILE* f,
+    slog_Channel_t channel,
+    double timestamp,
+    double value
+)
+{
+    RecordHeader_t header = {
+        .channel = channel,
+        .type = SLOG_TYPE_NUMERIC,
+        .length = sizeof(value),
+        .timestamp = timestamp,
+    };
+
+    if (   (fwrite(&header, sizeof(header), 1, f) != 1)
+        || (fwrite(&value, sizeof(value), 1, f) != 1)  )
+    {
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a JSON sample to a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the JSON value is longer than SLOG_MAX_JSON_LEN.
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t slog_WriteJson
+(
+    FILE* f,
+    slog_Channel_t channel,
+    double timestamp,
+    const char* value
+)
+{
+    size_t len = strlen(value);
+
+    if (len > SLOG_MAX_JSON_LEN)
+    {
+        return LE_OVERFLOW;
+    }
+
+    RecordHeader_t header = {
+        .channel = channel,
+        .type = SLOG_TYPE_JSON,
+        .length = len,
+        .timestamp = timestamp,
+    };
+
+    if (   (fwrite(&header, sizeof(header), 1, f) != 1)
+        || (fwrite(value, 1, len, f) != len)  )
+    {
+        return LE_IO_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read and check the log file header.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the read failed.
+ *  - LE_FORMAT_ERROR if the file is not a sensor log or is of an unsupported version.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t slog_ReadHeader
+(
+    FILE* f
+)
+{
+    char magic[sizeof(Magic)];
+    uint16_t version;
+    uint16_t reserved;
+
+    if (   (fread(magic, sizeof(magic), 1, f) != 1)
+        || (fread(&version, sizeof(version), 1, f) != 1)
+        || (fread(&reserved, sizeof(reserved), 1, f) != 1)  )
+    {
+        return LE_IO_ERROR;
+    }
+
+    if ((memcmp(magic, Magic, sizeof(Magic)) != 0) || (version != SLOG_VERSION))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next sample from a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_NOT_FOUND at the end of the log.
+ *  - LE_FORMAT_ERROR if the record is corrupt or truncated.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t slog_ReadRecord
+(
+    FILE* f,
+    slog_Record_t* recordPtr
+)
+{
+    RecordHeader_t header;
+
+    size_t count = fread(&header, 1, sizeof(header), f);
+    if (count == 0)
+    {
+        return LE_NOT_FOUND;
+    }
+    if (count != sizeof(header))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (   (header.channel >= SLOG_NUM_CHANNELS)
+        || (header.type != Channels[header.channel].type)  )
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    recordPtr->channel = header.channel;
+    recordPtr->type = header.type;
+    recordPtr->timestamp = header.timestamp;
+
+    if (header.type == SLOG_TYPE_NUMERIC)
+    {
+        if (   (header.length != sizeof(recordPtr->numeric))
+            || (fread(&recordPtr->numeric, sizeof(recordPtr->numeric), 1, f) != 1)  )
+        {
+            return LE_FORMAT_ERROR;
+        }
+    }
+    else
+    {
+        if (   (header.length > SLOG_MAX_JSON_LEN)
+            || (fread(recordPtr->json, 1, header.length, f) != header.length)  )
+        {
+            return LE_FORMAT_ERROR;
+        }
+        recordPtr->json[header.length] = '\0';
+    }
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
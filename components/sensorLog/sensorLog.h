@@ -0,0 +1,205 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorLog.h
+ *
+ * Compact binary log of timestamped sensor samples, as captured from the cloud publisher's
+ * Data Hub observations.  Used to record sensor streams and replay them deterministically.
+ *
+ * A log file starts with a header:
+ *
+ *  - magic "RSLG" (4 bytes)
+ *  - format version (uint16)
+ *  - reserved (uint16, 0)
+ *
+ * followed by any number of records:
+ *
+ *  - channel (uint8, see slog_Channel_t)
+ *  - data type (uint8, see slog_Type_t)
+ *  - payload length in bytes (uint16)
+ *  - timestamp in seconds since the Epoch (double)
+ *  - payload: a double for numeric samples, or the JSON text (no terminator) for JSON samples.
+ *
+ * All multi-byte fields are in the host's byte order.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SENSOR_LOG_H_INCLUDE_GUARD
+#define SENSOR_LOG_H_INCLUDE_GUARD
+
+
+/// Current log format version.
+#define SLOG_VERSION 1
+
+/// Maximum length of a JSON sample (excluding the null terminator).
+#define SLOG_MAX_JSON_LEN 1023
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sensor channels that can appear in a log.  Values are stored in log files, so never renumber.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    SLOG_CHANNEL_ACCEL = 0,
+    SLOG_CHANNEL_GYRO = 1,
+    SLOG_CHANNEL_LIGHT = 2,
+    SLOG_CHANNEL_PRESSURE = 3,
+    SLOG_CHANNEL_TEMPERATURE = 4,
+    SLOG_CHANNEL_POSITION = 5,
+
+    SLOG_NUM_CHANNELS
+}
+slog_Channel_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample data types.  Values are stored in log files, so never renumber.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    SLOG_TYPE_NUMERIC = 0,
+    SLOG_TYPE_JSON = 1,
+}
+slog_Type_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * One sample read from a log.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    slog_Channel_t channel;
+    slog_Type_t type;
+    double timestamp;
+    double numeric;                     ///< Value, if type is SLOG_TYPE_NUMERIC.
+    char json[SLOG_MAX_JSON_LEN + 1];   ///< Value, if type is SLOG_TYPE_JSON.
+}
+slog_Record_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the Data Hub observation path that a channel is recorded from (and replayed to).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED const char* slog_GetObsPath
+(
+    slog_Channel_t channel
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the Data Hub sensor input path that normally feeds a channel's observation.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED const char* slog_GetSourcePath
+(
+    slog_Channel_t channel
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the data type of a channel's samples.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED slog_Type_t slog_GetType
+(
+    slog_Channel_t channel
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the log file header.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t slog_WriteHeader
+(
+    FILE* f
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a numeric sample to a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t slog_WriteNumeric
+(
+    FILE* f,
+    slog_Channel_t channel,
+    double timestamp,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a JSON sample to a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the JSON value is longer than SLOG_MAX_JSON_LEN.
+ *  - LE_IO_ERROR if the write failed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t slog_WriteJson
+(
+    FILE* f,
+    slog_Channel_t channel,
+    double timestamp,
+    const char* value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read and check the log file header.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the read failed.
+ *  - LE_FORMAT_ERROR if the file is not a sensor log or is of an unsupported version.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t slog_ReadHeader
+(
+    FILE* f
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next sample from a log.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_NOT_FOUND at the end of the log.
+ *  - LE_FORMAT_ERROR if the record is corrupt or truncated.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t slog_ReadRecord
+(
+    FILE* f,
+    slog_Record_t* recordPtr
+);
+
+
+#endif // SENSOR_LOG_H_INCLUDE_GUARD
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file legatoBackend.c
+ *
+ * Sensor backend implementation that uses the Legato modem (ADC) and positioning services.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sensorBackend.h"
+
+
+/// Positioning service activation, or NULL if the receiver isn't active.
+static le_posCtrl_ActivationRef_t PosCtrlRef = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the value of an ADC channel.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_ReadAdc
+(
+    const char* adcName,
+    int32_t* valuePtr
+)
+{
+    return le_adc_ReadValue(adcName, valuePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activate the positioning receiver.  Does nothing if it is already active.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_RequestPositioning
+(
+    void
+)
+{
+    if (PosCtrlRef == NULL)
+    {
+        PosCtrlRef = le_posCtrl_Request();
+        if (PosCtrlRef == NULL)
+        {
+            return LE_FAULT;
+        }
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the positioning receiver so it can be powered down.  Does nothing if it isn't active.
+ */
+//--------------------------------------------------------------------------------------------------
+void backend_ReleasePositioning
+(
+    void
+)
+{
+    if (PosCtrlRef != NULL)
+    {
+        le_posCtrl_Release(PosCtrlRef);
+        PosCtrlRef = NULL;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current 3D location, with the same units as le_pos_Get3DLocation().
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OUT_OF_RANGE if one of the values is invalid.
+ *  - LE_FAULT if there is no fix (including when the receiver isn't active).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_Get3DLocation
+(
+    int32_t* latPtr,
+    int32_t* lonPtr,
+    int32_t* hAccuracyPtr,
+    int32_t* altPtr,
+    int32_t* vAccuracyPtr
+)
+{
+    return le_pos_Get3DLocation(latPtr, lonPtr, hAccuracyPtr, altPtr, vAccuracyPtr);
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file mockBackend.c
+ *
+ * Sensor backend implementation for running off-target.  Values are read from the fake driver
+ * tree maintained by the mockSysfs tool, in the same directory as the fake sysfs attributes:
+ *
+ *  - adc/<ADC name>: one integer, the ADC reading.
+ *  - pos/location: five integers, "lat lon hAccuracy alt vAccuracy", in le_pos units.
+ *    If the file is missing, there is no fix.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "sensorBackend.h"
+#include "fileUtils.h"
+
+
+/// Maximum length of a fake driver file path (including the null terminator).
+#define MOCK_PATH_BYTES 128
+
+/// true if the (fake) positioning receiver is active.
+static bool IsPositioningActive = false;
+
+/// Path of the fake location file, built when the component is initialized.
+static char LocationPath[MOCK_PATH_BYTES];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the value of an ADC channel.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_ReadAdc
+(
+    const char* adcName,
+    int32_t* valuePtr
+)
+{
+    char attr[MOCK_PATH_BYTES];
+    char path[MOCK_PATH_BYTES];
+
+    int len = snprintf(attr, sizeof(attr), "adc/%s", adcName);
+    if ((len >= sizeof(attr)) || (file_MakeDriverPath(attr, path, sizeof(path)) != LE_OK))
+    {
+        return LE_OVERFLOW;
+    }
+
+    int value;
+    le_result_t r = file_ReadInt(path, &value);
+    if (r == LE_OK)
+    {
+        *valuePtr = value;
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activate the positioning receiver.  Does nothing if it is already active.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_RequestPositioning
+(
+    void
+)
+{
+    IsPositioningActive = true;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the positioning receiver so it can be powered down.  Does nothing if it isn't active.
+ */
+//--------------------------------------------------------------------------------------------------
+void backend_ReleasePositioning
+(
+    void
+)
+{
+    IsPositioningActive = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current 3D location, with the same units as le_pos_Get3DLocation().
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OUT_OF_RANGE if one of the values is invalid.
+ *  - LE_FAULT if there is no fix (including when the receiver isn't active).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t backend_Get3DLocation
+(
+    int32_t* latPtr,
+    int32_t* lonPtr,
+    int32_t* hAccuracyPtr,
+    int32_t* altPtr,
+    int32_t* vAccuracyPtr
+)
+{
+    if (!IsPositioningActive)
+    {
+        return LE_FAULT;
+    }
+
+    FILE *f = fopen(LocationPath, "r");
+    if (f == NULL)
+    {
+        return LE_FAULT;
+    }
+
+    int numScanned = fscanf(f,
+                            "%" SCNd32 " %" SCNd32 " %" SCNd32 " %" SCNd32 " %" SCNd32,
+                            latPtr,
+                            lonPtr,
+                            hAccuracyPtr,
+                            altPtr,
+                            vAccuracyPtr);
+    fclose(f);
+
+    return (numScanned == 5) ? LE_OK : LE_OUT_OF_RANGE;
+}
+
+
+COMPONENT_INIT
+{
+    le_result_t result = file_MakeDriverPath("pos/location", LocationPath, sizeof(LocationPath));
+    LE_FATAL_IF(result != LE_OK, "Path of fake location file too long.");
+
+    LE_INFO("Using mock sensor backend.");
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorBackend.h
+ *
+ * Backend seam between the sensor components and the platform services they sample (the ADC and
+ * the positioning service).  On target the backend forwards to the Legato modem and positioning
+ * services.  Off-target (localhost builds) a mock backend reads the values from a fake driver
+ * tree (see the mockSysfs component), so the sensor components can run on a development host.
+ *
+ * The sysfs driver attribute files have their own seam; see file_MakeDriverPath().
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SENSOR_BACKEND_H_INCLUDE_GUARD
+#define SENSOR_BACKEND_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the value of an ADC channel.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t backend_ReadAdc
+(
+    const char* adcName,    ///< ADC channel name (e.g., "EXT_ADC3").
+    int32_t* valuePtr       ///< [OUT] Where the reading will be put if LE_OK is returned.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Activate the positioning receiver.  Does nothing if it is already active.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t backend_RequestPositioning
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the positioning receiver so it can be powered down.  Does nothing if it isn't active.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void backend_ReleasePositioning
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current 3D location, with the same units as le_pos_Get3DLocation().
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OUT_OF_RANGE if one of the values is invalid.
+ *  - LE_FAULT if there is no fix (including when the receiver isn't active).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t backend_Get3DLocation
+(
+    int32_t* latPtr,        ///< [OUT] Latitude (degrees, 6 decimal places).
+    int32_t* lonPtr,        ///< [OUT] Longitude (degrees, 6 decimal places).
+    int32_t* hAccuracyPtr,  ///< [OUT] Horizontal accuracy (metres).
+    int32_t* altPtr,        ///< [OUT] Altitude (metres, 3 decimal places).
+    int32_t* vAccuracyPtr   ///< [OUT] Vertical accuracy (metres).
+);
+
+
+#endif // SENSOR_BACKEND_H_INCLUDE_GUARD
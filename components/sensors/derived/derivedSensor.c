@@ -0,0 +1,486 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file derivedSensor.c
+ *
+ * Virtual sensors derived from the other sensors' samples as they flow through the Data Hub:
+ *
+ *  - accelMagnitude: magnitude of the acceleration (m/s^2), from accel.
+ *  - tilt: pitch and roll (degrees) of the board, from the direction of gravity in accel, as
+ *    {"pitch":..., "roll":...}.  Only meaningful while the board isn't otherwise accelerating.
+ *  - boardTemp: mean of the pressure sensor's and the IMU's temperatures (degC).
+ *
+ * Each is published to the Data Hub input derived/<name>/value, so it can be observed and
+ * uplinked like any other sensor (see DERIVED_UPLINK in redCloud.adef) while the samples it comes
+ * from stay on the device.
+ *
+ * Each input sensor gets its own Data Hub observation of its value input, without any filtering.
+ * A derived sample is computed when every input of the virtual sensor has a sample it hasn't been
+ * computed from yet, and those samples are within the maximum skew of each other; it is
+ * timestamped with the newest of them.  So a virtual sensor with several inputs produces at most
+ * one sample per sample of its slowest input, from samples taken at about the same time, and a
+ * sample of an input that has no partner within the skew is superseded by the input's next one.
+ *
+ * Configured with environment variables:
+ *
+ *  - DERIVED_SENSORS: comma-separated list of the virtual sensors computed (default all).
+ *  - DERIVED_MAX_SKEW_MS: largest difference between the timestamps of the input samples a
+ *    derived sample is computed from (default 5000).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sampleCodec.h"
+
+
+#define DERIVED_SENSORS_ENV_VAR "DERIVED_SENSORS"
+#define MAX_SKEW_ENV_VAR "DERIVED_MAX_SKEW_MS"
+#define DEFAULT_MAX_SKEW_MS 5000
+
+/// Most inputs of a virtual sensor.
+#define MAX_INPUTS 2
+
+/// Most members of an input's JSON samples.
+#define MAX_MEMBERS 3
+
+
+/// A sensor virtual sensors are derived from.
+typedef struct
+{
+    const char* sourcePath;                 ///< Data Hub sensor value input.
+    const char* obsPath;                    ///< Data Hub observation feeding the virtual sensors.
+    size_t numMembers;                      ///< 0 for a numeric sensor.
+    const char* members[MAX_MEMBERS];       ///< JSON member names.
+    double values[MAX_MEMBERS];             ///< Latest sample (one value for a numeric sensor).
+    double timestamp;                       ///< Of the latest sample, or -HUGE_VAL if none yet.
+    bool isObserved;                        ///< An enabled virtual sensor uses it.
+}
+Input_t;
+
+
+typedef struct Derived Derived_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function that computes a virtual sensor's sample from its inputs' latest samples, and pushes it.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*ComputeFunc_t)
+(
+    const Derived_t* derivedPtr,
+    double timestamp
+);
+
+
+/// A virtual sensor.
+struct Derived
+{
+    const char* name;
+    const char* inputPath;                  ///< Data Hub input it is published to.
+    dhubIO_DataType_t type;
+    const char* units;
+    const char* jsonExample;                ///< For JSON samples.
+    size_t numInputs;
+    Input_t* inputPtrs[MAX_INPUTS];
+    ComputeFunc_t computeFunc;
+    bool isEnabled;
+    double usedTimestamps[MAX_INPUTS];      ///< Of the latest sample of each input computed from.
+    double timestamp;                       ///< Of the latest derived sample.
+};
+
+
+static Input_t Accel = {
+    .sourcePath="/app/redSensor/accel/value",
+    .obsPath="/obs/derivedAccel",
+    .numMembers=3,
+    .members={ "x", "y", "z" },
+};
+
+static Input_t PressureTemp = {
+    .sourcePath="/app/redSensor/pressure/temp/value",
+    .obsPath="/obs/derivedPressureTemp",
+};
+
+static Input_t ImuTemp = {
+    .sourcePath="/app/redSensor/imu/temp/value",
+    .obsPath="/obs/derivedImuTemp",
+};
+
+static Input_t* const Inputs[] = {
+    &Accel,
+    &PressureTemp,
+    &ImuTemp,
+};
+
+
+static void ComputeAccelMagnitude(const Derived_t* derivedPtr, double timestamp);
+static void ComputeTilt(const Derived_t* derivedPtr, double timestamp);
+static void ComputeBoardTemp(const Derived_t* derivedPtr, double timestamp);
+
+static Derived_t DerivedSensors[] = {
+    {
+        .name="accelMagnitude",
+        .inputPath="derived/accelMagnitude/value",
+        .type=DHUBIO_DATA_TYPE_NUMERIC,
+        .units="m/s2",
+        .numInputs=1,
+        .inputPtrs={ &Accel },
+        .computeFunc=ComputeAccelMagnitude,
+    },
+    {
+        .name="tilt",
+        .inputPath="derived/tilt/value",
+        .type=DHUBIO_DATA_TYPE_JSON,
+        .units="",
+        .jsonExample="{\"pitch\":0.1,\"roll\":0.2}",
+        .numInputs=1,
+        .inputPtrs={ &Accel },
+        .computeFunc=ComputeTilt,
+    },
+    {
+        .name="boardTemp",
+        .inputPath="derived/boardTemp/value",
+        .type=DHUBIO_DATA_TYPE_NUMERIC,
+        .units="degC",
+        .numInputs=2,
+        .inputPtrs={ &PressureTemp, &ImuTemp },
+        .computeFunc=ComputeBoardTemp,
+    },
+};
+
+
+/// Largest difference between the timestamps of the samples a derived sample is computed from.
+static double MaxSkew;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the magnitude of the acceleration.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComputeAccelMagnitude
+(
+    const Derived_t* derivedPtr,
+    double timestamp
+)
+{
+    const double* v = derivedPtr->inputPtrs[0]->values;
+
+    dhubIO_PushNumeric(derivedPtr->inputPath,
+                       timestamp,
+                       sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2])));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the pitch and roll of the board from the direction of gravity.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComputeTilt
+(
+    const Derived_t* derivedPtr,
+    double timestamp
+)
+{
+    const double* v = derivedPtr->inputPtrs[0]->values;
+    double pitch = atan2(-v[0], sqrt((v[1] * v[1]) + (v[2] * v[2]))) * (180.0 / M_PI);
+    double roll = atan2(v[1], v[2]) * (180.0 / M_PI);
+    char json[CODEC_TILT_MAX_LEN + 1];
+
+    LE_ASSERT_OK(codec_EncodeTilt(json, sizeof(json), pitch, roll));
+    dhubIO_PushJson(derivedPtr->inputPath, timestamp, json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the board temperature from the pressure sensor's and the IMU's.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComputeBoardTemp
+(
+    const Derived_t* derivedPtr,
+    double timestamp
+)
+{
+    double pressureTemp = derivedPtr->inputPtrs[0]->values[0];
+    double imuTemp = derivedPtr->inputPtrs[1]->values[0];
+
+    dhubIO_PushNumeric(derivedPtr->inputPath, timestamp, (pressureTemp + imuTemp) / 2.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute a virtual sensor's sample if every input has a new sample, and they are aligned.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Derive
+(
+    Derived_t* derivedPtr
+)
+{
+    double oldest = HUGE_VAL;
+    double newest = -HUGE_VAL;
+
+    for (size_t i = 0; i < derivedPtr->numInputs; i++)
+    {
+        double timestamp = derivedPtr->inputPtrs[i]->timestamp;
+
+        if (timestamp <= derivedPtr->usedTimestamps[i])
+        {
+            return;
+        }
+
+        oldest = fmin(oldest, timestamp);
+        newest = fmax(newest, timestamp);
+    }
+
+    // The oldest input's next sample may be closer to the others.
+    if (((newest - oldest) > MaxSkew) || (newest <= derivedPtr->timestamp))
+    {
+        return;
+    }
+
+    derivedPtr->computeFunc(derivedPtr, newest);
+
+    for (size_t i = 0; i < derivedPtr->numInputs; i++)
+    {
+        derivedPtr->usedTimestamps[i] = derivedPtr->inputPtrs[i]->timestamp;
+    }
+    derivedPtr->timestamp = newest;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep an input's new sample, and compute the virtual sensors that use it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateInput
+(
+    Input_t* inputPtr,
+    double timestamp
+)
+{
+    inputPtr->timestamp = timestamp;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+    {
+        Derived_t* derivedPtr = &DerivedSensors[i];
+
+        if (!derivedPtr->isEnabled)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < derivedPtr->numInputs; j++)
+        {
+            if (derivedPtr->inputPtrs[j] == inputPtr)
+            {
+                Derive(derivedPtr);
+                break;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Input_t
+)
+{
+    Input_t* inputPtr = contextPtr;
+
+    inputPtr->values[0] = value;
+    UpdateInput(inputPtr, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a JSON observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleJsonUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Input_t
+)
+{
+    Input_t* inputPtr = contextPtr;
+    double values[MAX_MEMBERS];
+
+    for (size_t m = 0; m < inputPtr->numMembers; m++)
+    {
+        values[m] = codec_ExtractNumber(value, inputPtr->members[m]);
+        if (isnan(values[m]))
+        {
+            LE_ERROR("Malformed sample from '%s'. Skipped.", inputPtr->sourcePath);
+            return;
+        }
+    }
+
+    memcpy(inputPtr->values, values, inputPtr->numMembers * sizeof(double));
+    UpdateInput(inputPtr, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable the virtual sensors listed in the DERIVED_SENSORS environment variable, or all of them if
+ * it isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SelectDerivedSensors
+(
+    void
+)
+{
+    const char* value = getenv(DERIVED_SENSORS_ENV_VAR);
+    if (value == NULL)
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+        {
+            DerivedSensors[i].isEnabled = true;
+        }
+        return;
+    }
+
+    char list[128];
+    LE_FATAL_IF(le_utf8_Copy(list, value, sizeof(list), NULL) != LE_OK,
+                "%s too long.",
+                DERIVED_SENSORS_ENV_VAR);
+
+    char* savePtr = NULL;
+    for (char* itemPtr = strtok_r(list, ", ", &savePtr);
+         itemPtr != NULL;
+         itemPtr = strtok_r(NULL, ", ", &savePtr))
+    {
+        Derived_t* derivedPtr = NULL;
+
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+        {
+            if (strcmp(DerivedSensors[i].name, itemPtr) == 0)
+            {
+                derivedPtr = &DerivedSensors[i];
+            }
+        }
+        LE_FATAL_IF(derivedPtr == NULL,
+                    "Unknown virtual sensor '%s' in %s"
+                    " (expected 'accelMagnitude', 'tilt' or 'boardTemp').",
+                    itemPtr,
+                    DERIVED_SENSORS_ENV_VAR);
+
+        derivedPtr->isEnabled = true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the maximum skew from the DERIVED_MAX_SKEW_MS environment variable.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetMaxSkew
+(
+    void
+)
+{
+    const char* valueStr = getenv(MAX_SKEW_ENV_VAR);
+
+    if (valueStr == NULL)
+    {
+        return DEFAULT_MAX_SKEW_MS / 1000.0;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value < 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                MAX_SKEW_ENV_VAR,
+                valueStr);
+
+    return (double)value / 1000.0;
+}
+
+
+COMPONENT_INIT
+{
+    MaxSkew = GetMaxSkew();
+    SelectDerivedSensors();
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DerivedSensors); i++)
+    {
+        Derived_t* derivedPtr = &DerivedSensors[i];
+
+        if (!derivedPtr->isEnabled)
+        {
+            continue;
+        }
+
+        le_result_t result = dhubIO_CreateInput(derivedPtr->inputPath,
+                                                derivedPtr->type,
+                                                derivedPtr->units);
+        LE_FATAL_IF((result != LE_OK) && (result != LE_DUPLICATE),
+                    "Failed to create Data Hub input '%s' (%s).",
+                    derivedPtr->inputPath,
+                    LE_RESULT_TXT(result));
+        if (derivedPtr->type == DHUBIO_DATA_TYPE_JSON)
+        {
+            dhubIO_SetJsonExample(derivedPtr->inputPath, derivedPtr->jsonExample);
+        }
+
+        for (size_t j = 0; j < derivedPtr->numInputs; j++)
+        {
+            derivedPtr->inputPtrs[j]->isObserved = true;
+            derivedPtr->usedTimestamps[j] = -HUGE_VAL;
+        }
+        derivedPtr->timestamp = -HUGE_VAL;
+
+        LE_INFO("Deriving '%s'.", derivedPtr->name);
+    }
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Inputs); i++)
+    {
+        Input_t* inputPtr = Inputs[i];
+
+        inputPtr->timestamp = -HUGE_VAL;
+
+        if (!inputPtr->isObserved)
+        {
+            continue;
+        }
+
+        le_result_t result = dhubAdmin_CreateObs(inputPtr->obsPath);
+        LE_FATAL_IF((result != LE_OK) && (result != LE_DUPLICATE),
+                    "Failed to create Data Hub observation at path '%s' (%s).",
+                    inputPtr->obsPath,
+                    LE_RESULT_TXT(result));
+
+        if (inputPtr->numMembers > 0)
+        {
+            dhubAdmin_AddJsonPushHandler(inputPtr->obsPath, HandleJsonUpdate, inputPtr);
+        }
+        else
+        {
+            dhubAdmin_AddNumericPushHandler(inputPtr->obsPath, HandleNumericUpdate, inputPtr);
+        }
+
+        dhubAdmin_SetSource(inputPtr->obsPath, inputPtr->sourcePath);
+    }
+}
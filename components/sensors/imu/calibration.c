@@ -0,0 +1,275 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file calibration.c
+ *
+ * Calibration of the IMU's samples (see imuCalibration.h).  The raw gyro and accelerometer are
+ * read at the calibration rate into the estimator, with the IMU temperature read once per window.
+ * The calibration is applied to every sample read through imu.api and published to accel/value
+ * and gyro/value, at the latest IMU temperature read (by the imu/temp sensor or a window).  The
+ * table is loaded at start, and saved when it has changed, at most once per save interval to
+ * spare the flash.
+ *
+ * Configured with environment variables:
+ *
+ *  - CALIBRATION_FILE: where the table persists.  Not set: nothing is loaded or saved.
+ *  - CALIBRATION_RATE_HZ: rate the raw samples are read at for estimation (default 10).  0 turns
+ *    estimation off; the loaded table is still applied.
+ *  - CALIBRATION_WINDOW_S: length of a stationary window (default 5).
+ *  - CALIBRATION_SAVE_S: shortest time between saves (default 3600, at most 604800).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "calibration.h"
+#include "imu.h"
+#include "imuCalibration.h"
+
+
+#define DEFAULT_RATE_HZ 10
+#define DEFAULT_WINDOW_S 5
+#define DEFAULT_SAVE_S 3600
+#define MAX_SAVE_S (7 * 24 * 3600)
+
+
+static calib_Table_t Table;
+
+/// Estimator (too big for the stack).
+static calib_Estimator_t Estimator;
+
+/// IMU temperature the calibration is applied at (degrees C), NAN until one is read.
+static double Temperature = NAN;
+
+/// File the table persists to, or NULL.
+static const char* FilePath = NULL;
+
+/// true if the table changed since it was saved.
+static bool IsDirty = false;
+
+/// Timer limiting how often the table is saved.
+static le_timer_Ref_t SaveTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save the table if it changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSaveTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    if (!IsDirty)
+    {
+        return;
+    }
+
+    if (calib_Save(&Table, FilePath) == LE_OK)
+    {
+        IsDirty = false;
+        LE_DEBUG("Saved IMU calibration to '%s'.", FilePath);
+    }
+    else
+    {
+        LE_ERROR("Couldn't save IMU calibration to '%s' (%m).", FilePath);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the raw IMU into the estimator.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSampleTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double gyro[3];
+    double accel[3];
+
+    // The temperature changes slowly, so it's only read at the start of a window.
+    if (Estimator.count == 0)
+    {
+        double temperature;
+        if (temperature_Read(&temperature) != LE_OK)
+        {
+            return;
+        }
+        Temperature = temperature;
+    }
+
+    le_result_t result = imuRaw_ReadGyro(&gyro[0], &gyro[1], &gyro[2]);
+    if (result == LE_OK)
+    {
+        result = imuRaw_ReadAccel(&accel[0], &accel[1], &accel[2]);
+    }
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to read IMU for calibration (%s).", LE_RESULT_TXT(result));
+        return;
+    }
+
+    if (calib_Add(&Estimator, gyro, accel, Temperature))
+    {
+        size_t accelBins;
+        size_t gyroBins = calib_CountBins(&Table, &accelBins);
+
+        LE_DEBUG("Stationary at %.1f degC: %zu gyro and %zu accelerometer bins calibrated.",
+                 Temperature,
+                 gyroBins,
+                 accelBins);
+
+        IsDirty = true;
+        if ((FilePath != NULL) && !le_timer_IsRunning(SaveTimer))
+        {
+            HandleSaveTimer(SaveTimer);
+            le_timer_Start(SaveTimer);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer configuration value from an environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if (valueStr == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value < 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the calibration and start estimating it.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_Start
+(
+    void
+)
+{
+    calib_InitTable(&Table);
+
+    FilePath = getenv("CALIBRATION_FILE");
+    if ((FilePath != NULL) && (FilePath[0] == '\0'))
+    {
+        FilePath = NULL;
+    }
+
+    if (FilePath != NULL)
+    {
+        le_result_t result = calib_Load(&Table, FilePath);
+        if (result == LE_OK)
+        {
+            size_t accelBins;
+            size_t gyroBins = calib_CountBins(&Table, &accelBins);
+
+            LE_INFO("Loaded IMU calibration from '%s': %zu gyro and %zu accelerometer bins.",
+                    FilePath,
+                    gyroBins,
+                    accelBins);
+        }
+        else if (result != LE_NOT_FOUND)
+        {
+            LE_ERROR("Couldn't load IMU calibration from '%s' (%m).", FilePath);
+        }
+    }
+
+    double temperature;
+    if (temperature_Read(&temperature) == LE_OK)
+    {
+        Temperature = temperature;
+    }
+
+    int rate = GetEnvInt("CALIBRATION_RATE_HZ", DEFAULT_RATE_HZ);
+    if (rate == 0)
+    {
+        LE_INFO("IMU calibration estimation off.");
+        return;
+    }
+    LE_FATAL_IF(rate > 100, "CALIBRATION_RATE_HZ %d too high (max 100).", rate);
+
+    int window = GetEnvInt("CALIBRATION_WINDOW_S", DEFAULT_WINDOW_S);
+    LE_FATAL_IF(window > (INT_MAX / rate), "CALIBRATION_WINDOW_S %d too long.", window);
+    LE_FATAL_IF((window * rate) < 2, "CALIBRATION_WINDOW_S %d too short.", window);
+    calib_Init(&Estimator, &Table, (size_t)(window * rate));
+
+    int savePeriod = GetEnvInt("CALIBRATION_SAVE_S", DEFAULT_SAVE_S);
+    LE_FATAL_IF(savePeriod > MAX_SAVE_S,
+                "CALIBRATION_SAVE_S %d too long (max %d).",
+                savePeriod,
+                MAX_SAVE_S);
+
+    SaveTimer = le_timer_Create("calibrationSave");
+    le_timer_SetHandler(SaveTimer, HandleSaveTimer);
+    le_timer_SetMsInterval(SaveTimer, (uint32_t)savePeriod * 1000);
+
+    le_timer_Ref_t sampleTimer = le_timer_Create("calibrationSample");
+    le_timer_SetHandler(sampleTimer, HandleSampleTimer);
+    le_timer_SetMsInterval(sampleTimer, 1000 / rate);
+    le_timer_SetRepeat(sampleTimer, 0);
+    le_timer_Start(sampleTimer);
+
+    LE_INFO("Estimating IMU calibration at %d Hz in %d s windows.", rate, window);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the IMU temperature the calibration is applied at.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_SetTemperature
+(
+    double temperature
+)
+{
+    Temperature = temperature;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Calibrate raw samples in place.  Either may be NULL.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_Apply
+(
+    double gyro[3],
+    double accel[3]
+)
+{
+    // Without a temperature, the samples stay raw rather than get the wrong bin's correction.
+    if (!isnan(Temperature))
+    {
+        calib_Apply(&Table, Temperature, gyro, accel);
+    }
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file calibration.h
+ *
+ * Gyro bias and accelerometer offset calibration of the IMU's samples, estimated while the board
+ * is stationary and persisted across restarts.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CALIBRATION_H_INCLUDE_GUARD
+#define CALIBRATION_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the calibration and start estimating it, as configured by the environment.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_Start
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the IMU temperature the calibration is applied at.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_SetTemperature
+(
+    double temperature      ///< degrees C
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Calibrate raw samples in place.  Either may be NULL.
+ */
+//--------------------------------------------------------------------------------------------------
+void calibration_Apply
+(
+    double gyro[3],         ///< rad/s
+    double accel[3]         ///< m/s^2
+);
+
+
+#endif // CALIBRATION_H_INCLUDE_GUARD
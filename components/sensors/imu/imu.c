@@ -12,18 +12,68 @@
 #include "interfaces.h"
 
 #include "imu.h"
+#include "calibration.h"
+#include "motionEvents.h"
 #include "fileUtils.h"
 #include "periodicSensor.h"
+#include "sampleCodec.h"
+#include "streamServer.h"
+
+
+/// Data Hub inputs of the uncalibrated samples.
+#define GYRO_RAW_PATH "gyro/raw/value"
+#define ACCEL_RAW_PATH "accel/raw/value"
+
+/// Maximum length of a driver attribute file path (including the null terminator).
+#define ATTR_PATH_BYTES 128
+
+/// Driver attribute files read by this component.
+typedef enum
+{
+    ATTR_ACCEL_SCALE,
+    ATTR_ACCEL_X_RAW,
+    ATTR_ACCEL_Y_RAW,
+    ATTR_ACCEL_Z_RAW,
+    ATTR_ANGLVEL_SCALE,
+    ATTR_ANGLVEL_X_RAW,
+    ATTR_ANGLVEL_Y_RAW,
+    ATTR_ANGLVEL_Z_RAW,
+    ATTR_TEMP_SCALE,
+    ATTR_TEMP_OFFSET,
+    ATTR_TEMP_RAW,
+    NUM_ATTRS
+}
+Attr_t;
+
+/// Names of the driver attribute files.
+static const char* const AttrNames[NUM_ATTRS] =
+{
+    [ATTR_ACCEL_SCALE] = "in_accel_scale",
+    [ATTR_ACCEL_X_RAW] = "in_accel_x_raw",
+    [ATTR_ACCEL_Y_RAW] = "in_accel_y_raw",
+    [ATTR_ACCEL_Z_RAW] = "in_accel_z_raw",
+    [ATTR_ANGLVEL_SCALE] = "in_anglvel_scale",
+    [ATTR_ANGLVEL_X_RAW] = "in_anglvel_x_raw",
+    [ATTR_ANGLVEL_Y_RAW] = "in_anglvel_y_raw",
+    [ATTR_ANGLVEL_Z_RAW] = "in_anglvel_z_raw",
+    [ATTR_TEMP_SCALE] = "in_temp_scale",
+    [ATTR_TEMP_OFFSET] = "in_temp_offset",
+    [ATTR_TEMP_RAW] = "in_temp_raw",
+};
+
+/// Full paths of the driver attribute files, built when the component is initialized.
+static char AttrPaths[NUM_ATTRS][ATTR_PATH_BYTES];
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Read the accelerometer's linear acceleration measurement in meters per second squared.
+ * Read the accelerometer's uncalibrated linear acceleration measurement in meters per second
+ * squared.
  *
  * @return LE_OK if successful.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t imu_ReadAccel
+le_result_t imuRaw_ReadAccel
 (
     double* xPtr,
         ///< [OUT] Where the x-axis acceleration (m/s2) will be put if LE_OK is returned.
@@ -36,27 +86,27 @@ le_result_t imu_ReadAccel
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_accel_scale", &scaling);
+    r = file_ReadDouble(AttrPaths[ATTR_ACCEL_SCALE], &scaling);
     if (r != LE_OK)
     {
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_accel_x_raw", xPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ACCEL_X_RAW], xPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_y_raw", yPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ACCEL_Y_RAW], yPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_z_raw", zPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ACCEL_Z_RAW], zPtr);
     if (r != LE_OK)
     {
         goto done;
@@ -70,12 +120,12 @@ done:
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Read the gyroscope's angular velocity measurement in radians per seconds.
+ * Read the gyroscope's uncalibrated angular velocity measurement in radians per seconds.
  *
  * @return LE_OK if successful.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t imu_ReadGyro
+le_result_t imuRaw_ReadGyro
 (
     double* xPtr,
         ///< [OUT] Where the x-axis rotation (rads/s) will be put if LE_OK is returned.
@@ -88,27 +138,27 @@ le_result_t imu_ReadGyro
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_anglvel_scale", &scaling);
+    r = file_ReadDouble(AttrPaths[ATTR_ANGLVEL_SCALE], &scaling);
     if (r != LE_OK)
     {
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_anglvel_x_raw", xPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ANGLVEL_X_RAW], xPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_y_raw", yPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ANGLVEL_Y_RAW], yPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_z_raw", zPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_ANGLVEL_Z_RAW], zPtr);
     if (r != LE_OK)
     {
         goto done;
@@ -120,6 +170,71 @@ done:
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer's calibrated linear acceleration measurement in meters per second
+ * squared.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imu_ReadAccel
+(
+    double* xPtr,
+        ///< [OUT] Where the x-axis acceleration (m/s2) will be put if LE_OK is returned.
+    double* yPtr,
+        ///< [OUT] Where the y-axis acceleration (m/s2) will be put if LE_OK is returned.
+    double* zPtr
+        ///< [OUT] Where the z-axis acceleration (m/s2) will be put if LE_OK is returned.
+)
+{
+    double accel[3];
+
+    le_result_t r = imuRaw_ReadAccel(&accel[0], &accel[1], &accel[2]);
+    if (r == LE_OK)
+    {
+        calibration_Apply(NULL, accel);
+        *xPtr = accel[0];
+        *yPtr = accel[1];
+        *zPtr = accel[2];
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the gyroscope's calibrated angular velocity measurement in radians per seconds.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imu_ReadGyro
+(
+    double* xPtr,
+        ///< [OUT] Where the x-axis rotation (rads/s) will be put if LE_OK is returned.
+    double* yPtr,
+        ///< [OUT] Where the y-axis rotation (rads/s) will be put if LE_OK is returned.
+    double* zPtr
+        ///< [OUT] Where the z-axis rotation (rads/s) will be put if LE_OK is returned.
+)
+{
+    double gyro[3];
+
+    le_result_t r = imuRaw_ReadGyro(&gyro[0], &gyro[1], &gyro[2]);
+    if (r == LE_OK)
+    {
+        calibration_Apply(gyro, NULL);
+        *xPtr = gyro[0];
+        *yPtr = gyro[1];
+        *zPtr = gyro[2];
+    }
+
+    return r;
+}
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Read the temperature measurement.
@@ -136,7 +251,7 @@ le_result_t temperature_Read
     le_result_t r;
 
     double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_temp_scale", &scaling);
+    r = file_ReadDouble(AttrPaths[ATTR_TEMP_SCALE], &scaling);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read scale");
@@ -144,14 +259,14 @@ le_result_t temperature_Read
     }
 
     double offset = 0.0;
-    r = file_ReadDouble("/driver/in_temp_offset", &offset);
+    r = file_ReadDouble(AttrPaths[ATTR_TEMP_OFFSET], &offset);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read offset (%s)", LE_RESULT_TXT(r));
         goto done;
     }
 
-    r = file_ReadDouble("/driver/in_temp_raw", readingPtr);
+    r = file_ReadDouble(AttrPaths[ATTR_TEMP_RAW], readingPtr);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read raw value (%s)", LE_RESULT_TXT(r));
@@ -176,23 +291,29 @@ static void SampleGyro
     void *contextPtr
 )
 {
-    double x;
-    double y;
-    double z;
+    double values[3];
 
-    le_result_t result = imu_ReadGyro(&x, &y, &z);
+    le_result_t result = imuRaw_ReadGyro(&values[0], &values[1], &values[2]);
 
     if (result == LE_OK)
     {
-        char sample[256];
+        char sample[CODEC_XYZ_MAX_LEN + 1];
 
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
+        if (codec_EncodeXyz(sample, sizeof(sample), values[0], values[1], values[2]) != LE_OK)
         {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+            LE_FATAL("JSON string is longer than buffer (size %zu).", sizeof(sample));
         }
+        dhubIO_PushJson(GYRO_RAW_PATH, 0 /* now */, sample);
+
+        calibration_Apply(values, NULL);
 
+        if (codec_EncodeXyz(sample, sizeof(sample), values[0], values[1], values[2]) != LE_OK)
+        {
+            LE_FATAL("JSON string is longer than buffer (size %zu).", sizeof(sample));
+        }
         psensor_PushJson(ref, 0 /* now */, sample);
+
+        stream_Publish(STREAM_CHANNEL_GYRO, values, NUM_ARRAY_MEMBERS(values));
     }
     else
     {
@@ -212,23 +333,29 @@ static void SampleAccel
     void *contextPtr
 )
 {
-    double x;
-    double y;
-    double z;
+    double values[3];
 
-    le_result_t result = imu_ReadAccel(&x, &y, &z);
+    le_result_t result = imuRaw_ReadAccel(&values[0], &values[1], &values[2]);
 
     if (result == LE_OK)
     {
-        char sample[256];
+        char sample[CODEC_XYZ_MAX_LEN + 1];
 
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
+        if (codec_EncodeXyz(sample, sizeof(sample), values[0], values[1], values[2]) != LE_OK)
         {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+            LE_FATAL("JSON string is longer than buffer (size %zu).", sizeof(sample));
         }
+        dhubIO_PushJson(ACCEL_RAW_PATH, 0 /* now */, sample);
+
+        calibration_Apply(NULL, values);
 
+        if (codec_EncodeXyz(sample, sizeof(sample), values[0], values[1], values[2]) != LE_OK)
+        {
+            LE_FATAL("JSON string is longer than buffer (size %zu).", sizeof(sample));
+        }
         psensor_PushJson(ref, 0 /* now */, sample);
+
+        stream_Publish(STREAM_CHANNEL_ACCEL, values, NUM_ARRAY_MEMBERS(values));
     }
     else
     {
@@ -255,6 +382,8 @@ static void SampleTemp
     if (result == LE_OK)
     {
         psensor_PushNumeric(ref, 0 /* now */, sample);
+        calibration_SetTemperature(sample);
+        stream_Publish(STREAM_CHANNEL_IMU_TEMPERATURE, &sample, 1);
     }
     else
     {
@@ -270,6 +399,14 @@ static void SampleTemp
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
+    for (Attr_t attr = 0; attr < NUM_ATTRS; attr++)
+    {
+        le_result_t result = file_MakeDriverPath(AttrNames[attr],
+                                                 AttrPaths[attr],
+                                                 sizeof(AttrPaths[attr]));
+        LE_FATAL_IF(result != LE_OK, "Path of driver file '%s' too long.", AttrNames[attr]);
+    }
+
     // Use the Periodic Sensor component from the Data Hub to implement the sensor interfaces.
     psensor_Create("gyro", DHUBIO_DATA_TYPE_JSON, "", SampleGyro, NULL);
     psensor_Create("accel", DHUBIO_DATA_TYPE_JSON, "", SampleAccel, NULL);
@@ -277,4 +414,14 @@ COMPONENT_INIT
 
     dhubIO_SetJsonExample("gyro/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
     dhubIO_SetJsonExample("accel/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+
+    // The sensors publish calibrated samples, and the uncalibrated ones next to them.
+    LE_ASSERT_OK(dhubIO_CreateInput(GYRO_RAW_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(GYRO_RAW_PATH, "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+    LE_ASSERT_OK(dhubIO_CreateInput(ACCEL_RAW_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(ACCEL_RAW_PATH, "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+    calibration_Start();
+
+    // Detect shocks and free falls, which are far shorter than the accel sensor's period.
+    motionEvents_Start();
 }
@@ -16,4 +16,8 @@ LE_SHARED le_result_t mangOH_ReadAccelerometer(double *xAcc, double *yAcc, doubl
 LE_SHARED le_result_t mangOH_ReadGyro(double *x, double *y, double *z);
 LE_SHARED le_result_t mangOH_ReadImuTemp(double *temperature);
 
+/// Uncalibrated samples (imu_ReadAccel() and imu_ReadGyro() are calibrated).
+LE_SHARED le_result_t imuRaw_ReadAccel(double* xPtr, double* yPtr, double* zPtr);
+LE_SHARED le_result_t imuRaw_ReadGyro(double* xPtr, double* yPtr, double* zPtr);
+
 #endif // IMU_H_INCLUDE_GUARD
@@ -0,0 +1,365 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motionEvents.c
+ *
+ * Shock and free-fall events from the accelerometer (see motionDetector.h), published to the Data
+ * Hub inputs accel/shock/value and accel/freeFall/value as soon as they end, timestamped with
+ * their start.  Shocks are published as
+ *
+ * {"peak":3.059, "duration":0.050, "axis":-3}
+ *
+ * (peak dynamic acceleration in g, seconds, and the dominant axis: +/-1, 2 or 3 for the positive
+ * or negative x, y or z axis), and free falls as {"peak":0.033, "duration":0.290} (lowest
+ * acceleration in g, seconds).
+ *
+ * The accelerometer is read at the detection rate, independently of the accel sensor's period,
+ * which is far too long to catch impacts.  If the IMU driver has IIO threshold events and their
+ * device is given, the accelerometer is only read for a while after the IMU raises one, rather
+ * than all the time.
+ *
+ * Configured with environment variables:
+ *
+ *  - MOTION_RATE_HZ: detection rate (default 100).  0 turns detection off.
+ *  - SHOCK_THRESHOLD_MG: dynamic acceleration (milli-g) above which a shock is detected
+ *    (default 1500).  Must be above 1000, which free fall exceeds, and below the IMU's range
+ *    (+/-2 g by default).
+ *  - FREE_FALL_THRESHOLD_MG: acceleration (milli-g) below which the board is falling
+ *    (default 350).
+ *  - FREE_FALL_MIN_MS: shortest free fall detected (default 100).
+ *  - MOTION_EVENT_DEVICE: IMU's IIO device (e.g., /dev/iio:device0), whose events wake the
+ *    detector.  Not set by default: the accelerometer is read all the time.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "motionEvents.h"
+#include "motionDetector.h"
+#include "fileUtils.h"
+#include "sampleCodec.h"
+
+#include <sys/ioctl.h>
+#include <linux/iio/events.h>
+
+
+#define SHOCK_PATH "accel/shock/value"
+#define FREE_FALL_PATH "accel/freeFall/value"
+
+#define DEFAULT_RATE_HZ 100
+#define DEFAULT_SHOCK_THRESHOLD_MG 1500
+#define DEFAULT_FREE_FALL_THRESHOLD_MG 350
+#define DEFAULT_FREE_FALL_MIN_MS 100
+
+/// How long the accelerometer is read after an IIO event, if no motion event is in progress.
+#define CAPTURE_WINDOW 1.0 // seconds
+
+/// Driver attribute files enabling, and setting the thresholds of, the IIO events.
+#define SHOCK_EVENT_ENABLE_ATTR "events/in_accel_mag_rising_en"
+#define SHOCK_EVENT_VALUE_ATTR "events/in_accel_mag_rising_value"
+#define FREE_FALL_EVENT_ENABLE_ATTR "events/in_accel_x&y&z_mag_falling_en"
+#define FREE_FALL_EVENT_VALUE_ATTR "events/in_accel_x&y&z_mag_falling_value"
+
+/// Maximum length of a driver attribute file path (including the null terminator).
+#define ATTR_PATH_BYTES 128
+
+
+static motion_Detector_t Detector;
+
+/// Timer reading the accelerometer at the detection rate.
+static le_timer_Ref_t SampleTimer;
+
+/// true if the accelerometer is only read after IIO events.
+static bool IsEventDriven = false;
+
+/// In event-driven mode, time until which the accelerometer is read (seconds since the Epoch).
+static double CaptureUntil;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time.
+ *
+ * @return Seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish an event.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEvent
+(
+    const motion_Event_t* eventPtr,
+    void* contextPtr
+)
+{
+    char json[CODEC_SHOCK_MAX_LEN + 1];    // No shorter than CODEC_FREE_FALL_MAX_LEN.
+
+    if (eventPtr->type == MOTION_EVENT_SHOCK)
+    {
+        LE_ASSERT_OK(codec_EncodeShock(json,
+                                       sizeof(json),
+                                       eventPtr->peak,
+                                       eventPtr->duration,
+                                       eventPtr->axis));
+        dhubIO_PushJson(SHOCK_PATH, eventPtr->start, json);
+    }
+    else
+    {
+        LE_ASSERT_OK(codec_EncodeFreeFall(json,
+                                          CODEC_FREE_FALL_MAX_LEN + 1,
+                                          eventPtr->peak,
+                                          eventPtr->duration));
+        dhubIO_PushJson(FREE_FALL_PATH, eventPtr->start, json);
+    }
+
+    LE_INFO("%s: %s", (eventPtr->type == MOTION_EVENT_SHOCK) ? "Shock" : "Free fall", json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer into the detector.  In event-driven mode, stop reading once the capture
+ * window is over and no event is in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSampleTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double x;
+    double y;
+    double z;
+    double now = GetNow();
+
+    le_result_t result = imu_ReadAccel(&x, &y, &z);
+    if (result == LE_OK)
+    {
+        motion_Add(&Detector, now, x, y, z);
+    }
+    else
+    {
+        LE_ERROR("Failed to read accelerometer (%s).", LE_RESULT_TXT(result));
+    }
+
+    if (IsEventDriven && (now > CaptureUntil) && motion_IsIdle(&Detector))
+    {
+        le_timer_Stop(timer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the IMU raising IIO events: read the accelerometer for the capture window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleIioEvents
+(
+    int fd,
+    short events
+)
+{
+    struct iio_event_data event;
+
+    while (read(fd, &event, sizeof(event)) == sizeof(event))
+    {
+        LE_DEBUG("IIO event 0x%" PRIx64 ".", (uint64_t)event.id);
+    }
+
+    CaptureUntil = GetNow() + CAPTURE_WINDOW;
+    if (!le_timer_IsRunning(SampleTimer))
+    {
+        le_timer_Start(SampleTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a value to a driver attribute file.
+ *
+ * @return LE_OK if successful, LE_FAULT otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteAttr
+(
+    const char* attrName,
+    double value
+)
+{
+    char path[ATTR_PATH_BYTES];
+
+    if (file_MakeDriverPath(attrName, path, sizeof(path)) != LE_OK)
+    {
+        return LE_FAULT;
+    }
+
+    FILE* filePtr = fopen(path, "w");
+    if (filePtr == NULL)
+    {
+        return LE_FAULT;
+    }
+
+    bool isOk = (fprintf(filePtr, "%g\n", value) > 0);
+    isOk = (fclose(filePtr) == 0) && isOk;
+
+    return isOk ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable the IMU's IIO threshold events and start monitoring them, if the driver has them.
+ *
+ * @return LE_OK if the detector is event-driven, LE_UNSUPPORTED if the accelerometer must be read
+ *         all the time.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartIioEvents
+(
+    const char* devicePath,
+    const motion_Config_t* configPtr
+)
+{
+    // The events' thresholds are in m/s^2 (after the channel's scale), and only wake the
+    // detector, which applies the thresholds itself.
+    if (   (WriteAttr(SHOCK_EVENT_VALUE_ATTR,
+                      configPtr->shockThreshold * MOTION_STANDARD_GRAVITY) != LE_OK)
+        || (WriteAttr(SHOCK_EVENT_ENABLE_ATTR, 1) != LE_OK))
+    {
+        LE_INFO("IMU driver has no shock events; reading the accelerometer all the time.");
+        return LE_UNSUPPORTED;
+    }
+
+    if (   (WriteAttr(FREE_FALL_EVENT_VALUE_ATTR,
+                      configPtr->freeFallThreshold * MOTION_STANDARD_GRAVITY) != LE_OK)
+        || (WriteAttr(FREE_FALL_EVENT_ENABLE_ATTR, 1) != LE_OK))
+    {
+        LE_INFO("IMU driver has no free-fall events; reading the accelerometer all the time.");
+        return LE_UNSUPPORTED;
+    }
+
+    int deviceFd = open(devicePath, O_RDONLY);
+    if (deviceFd < 0)
+    {
+        LE_ERROR("Couldn't open IIO device '%s' (%m).", devicePath);
+        return LE_UNSUPPORTED;
+    }
+
+    int eventFd = -1;
+    int result = ioctl(deviceFd, IIO_GET_EVENT_FD_IOCTL, &eventFd);
+    close(deviceFd);
+    if ((result < 0) || (eventFd < 0))
+    {
+        LE_ERROR("Couldn't get the events of IIO device '%s' (%m).", devicePath);
+        return LE_UNSUPPORTED;
+    }
+
+    fcntl(eventFd, F_SETFL, fcntl(eventFd, F_GETFL) | O_NONBLOCK);
+    le_fdMonitor_Create("imuEvents", eventFd, HandleIioEvents, POLLIN);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer configuration value from an environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if (valueStr == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value < 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start detecting shocks and free falls.
+ */
+//--------------------------------------------------------------------------------------------------
+void motionEvents_Start
+(
+    void
+)
+{
+    int rate = GetEnvInt("MOTION_RATE_HZ", DEFAULT_RATE_HZ);
+    if (rate == 0)
+    {
+        LE_INFO("Shock and free-fall detection off.");
+        return;
+    }
+    LE_FATAL_IF(rate > 1000, "MOTION_RATE_HZ %d too high (max 1000).", rate);
+
+    motion_Config_t config = {
+        .shockThreshold=GetEnvInt("SHOCK_THRESHOLD_MG", DEFAULT_SHOCK_THRESHOLD_MG) / 1000.0,
+        .freeFallThreshold=GetEnvInt("FREE_FALL_THRESHOLD_MG",
+                                     DEFAULT_FREE_FALL_THRESHOLD_MG) / 1000.0,
+        .freeFallMinDuration=GetEnvInt("FREE_FALL_MIN_MS", DEFAULT_FREE_FALL_MIN_MS) / 1000.0,
+    };
+    motion_Init(&Detector, &config, HandleEvent, NULL);
+
+    LE_ASSERT_OK(dhubIO_CreateInput(SHOCK_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(SHOCK_PATH, "{\"peak\":3.1,\"duration\":0.05,\"axis\":-3}");
+    LE_ASSERT_OK(dhubIO_CreateInput(FREE_FALL_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(FREE_FALL_PATH, "{\"peak\":0.03,\"duration\":0.29}");
+
+    SampleTimer = le_timer_Create("motionSample");
+    le_timer_SetHandler(SampleTimer, HandleSampleTimer);
+    le_timer_SetMsInterval(SampleTimer, 1000 / rate);
+    le_timer_SetRepeat(SampleTimer, 0);
+
+    const char* devicePath = getenv("MOTION_EVENT_DEVICE");
+    if ((devicePath != NULL) && (devicePath[0] != '\0'))
+    {
+        IsEventDriven = (StartIioEvents(devicePath, &config) == LE_OK);
+    }
+
+    if (!IsEventDriven)
+    {
+        le_timer_Start(SampleTimer);
+    }
+
+    LE_INFO("Detecting shocks over %.3f g and free falls under %.3f g for %.3f s, at %d Hz%s.",
+            config.shockThreshold,
+            config.freeFallThreshold,
+            config.freeFallMinDuration,
+            rate,
+            IsEventDriven ? " after IMU events" : "");
+}
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motionEvents.h
+ *
+ * Shock and free-fall events from the accelerometer, published to the Data Hub.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef MOTION_EVENTS_H_INCLUDE_GUARD
+#define MOTION_EVENTS_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start detecting shocks and free falls, as configured by the environment.
+ */
+//--------------------------------------------------------------------------------------------------
+void motionEvents_Start
+(
+    void
+);
+
+
+#endif // MOTION_EVENTS_H_INCLUDE_GUARD
@@ -12,6 +12,8 @@
 #include "interfaces.h"
 #include "periodicSensor.h"
 #include "lightSensor.h"
+#include "sensorBackend.h"
+#include "streamServer.h"
 
 const char lightSensorAdc[] = "EXT_ADC3";
 
@@ -28,7 +30,10 @@ static void Sample
 
     if (result == LE_OK)
     {
-        psensor_PushNumeric(ref, 0 /* now */, (double)sample);
+        double value = sample;
+
+        psensor_PushNumeric(ref, 0 /* now */, value);
+        stream_Publish(STREAM_CHANNEL_LIGHT, &value, 1);
     }
     else
     {
@@ -56,5 +61,5 @@ le_result_t light_Read
         ///< [OUT] Where the light intensity reading will be put if LE_OK is returned.
 )
 {
-    return le_adc_ReadValue(lightSensorAdc, readingPtr);
+    return backend_ReadAdc(lightSensorAdc, readingPtr);
 }
@@ -2,63 +2,655 @@
 /**
  * Implementation of the mangOH Red position sensor interface to the Data Hub.
  *
+ * The sensor has the same Data Hub resources as a periodic sensor (position/value, period and
+ * enable), but samples on its own timer, so that it can duty-cycle the GNSS receiver: when the
+ * period is long enough, the receiver is released after each sample and requested again ahead of
+ * the next one, by the time to fix observed recently (its mean plus two standard deviations).
+ * The receiver stays on when the period is shorter than GNSS_DUTY_MIN_PERIOD_S or barely longer
+ * than the time to fix, and while the device is moving: the fixes moved faster than
+ * GNSS_MOVING_KMH, or true was pushed to the optional position/moving output.
+ *
+ * A sample with no fix on time is pushed as soon as there is one.  If there is still none after
+ * GNSS_MAX_ACQUIRE_S, the duty-cycled receiver is released until the next sample.
+ *
+ * The receiver's on-time and fix availability are published to position/duty/value at every
+ * sample (see codec_EncodeGnssDuty()).
+ *
  * Copyright (C) Sierra Wireless Inc.
  */
 //--------------------------------------------------------------------------------------------------
 
 #include "legato.h"
 #include "interfaces.h"
-#include "periodicSensor.h"
+#include "sensorBackend.h"
+#include "sampleCodec.h"
+
+
+#define VALUE_PATH "position/value"
+#define PERIOD_PATH "position/period"
+#define ENABLE_PATH "position/enable"
+#define MOVING_PATH "position/moving"
+#define DUTY_PATH "position/duty/value"
+
+#define DEFAULT_DUTY_MIN_PERIOD_S 30
+#define DEFAULT_MAX_ACQUIRE_S 120
+#define DEFAULT_MOVING_KMH 5
+
+/// Interval at which the receiver is polled for a fix while it has none (ms).
+#define POLL_INTERVAL_MS 1000
+
+/// Number of recent times to fix the lead is estimated from.
+#define NUM_TTFF 16
+
+/// Lead before any time to fix is observed (seconds).
+#define DEFAULT_LEAD 30.0
+
+/// Added to the estimated time to fix, for the polling interval (seconds).
+#define LEAD_MARGIN 2.0
+
+/// Shortest time worth turning the receiver off for (seconds).
+#define MIN_OFF_TIME 10.0
+
+/// Mean radius of the Earth (metres).
+#define EARTH_RADIUS 6371000.0
+
+
+/// Configuration.
+static double DutyMinPeriod;    ///< seconds
+static double MaxAcquire;       ///< seconds
+static double MovingSpeed;      ///< m/s
+
+/// Settings pushed to the outputs.
+static double Period = 0.0;     ///< seconds, 0 until set
+static bool IsEnabled = false;
+static bool IsMovingSet = false;
+
+static le_timer_Ref_t DueTimer;     ///< Samples at the period.
+static le_timer_Ref_t WakeTimer;    ///< Requests the receiver ahead of a sample.
+static le_timer_Ref_t PollTimer;    ///< Polls for a fix while there is none.
+
+/// Receiver state.
+static bool IsRequested = false;
+static bool HasFix = false;         ///< A fix was read since the receiver was requested.
+static double RequestTime;          ///< When the receiver was requested.
+static bool IsSamplePending = false;///< The latest sample is waiting for a fix.
+static double NextDue;              ///< When the next sample is due.
+
+/// Latest fix pushed, for detecting movement.
+static bool HasLastFix = false;
+static double LastLat;              ///< degrees
+static double LastLon;              ///< degrees
+static double LastAccuracy;         ///< metres
+static double LastFixTime;
+static bool IsMovingFixes = false;
+
+/// Recent times to fix (seconds), in a ring.
+static double Ttffs[NUM_TTFF];
+static size_t NumTtffs = 0;
+static size_t NextTtff = 0;
+
+/// Statistics since the sensor was enabled.
+static double StatsStart;
+static double OnTime;               ///< Receiver on-time (seconds), up to OnSince.
+static double OnSince;              ///< When the receiver was requested, if it is.
+static unsigned int SamplesDue;
+static unsigned int SamplesOnTime;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time since boot.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetNow
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the mean of the recent times to fix.
+ *
+ * @return Seconds, or 0 if none was observed.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetMeanTtff
+(
+    void
+)
+{
+    double sum = 0.0;
+
+    for (size_t i = 0; i < NumTtffs; i++)
+    {
+        sum += Ttffs[i];
+    }
+
+    return (NumTtffs == 0) ? 0.0 : (sum / NumTtffs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get how long before a sample the receiver must be requested to have a fix on time.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetLead
+(
+    void
+)
+{
+    if (NumTtffs == 0)
+    {
+        return DEFAULT_LEAD;
+    }
+
+    double mean = GetMeanTtff();
+    double variance = 0.0;
+    for (size_t i = 0; i < NumTtffs; i++)
+    {
+        variance += (Ttffs[i] - mean) * (Ttffs[i] - mean);
+    }
+    variance /= NumTtffs;
+
+    return fmin(mean + (2.0 * sqrt(variance)) + LEAD_MARGIN, MaxAcquire);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether the receiver should be released between samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsDutyCycled
+(
+    void
+)
+{
+    return    !IsMovingSet
+           && !IsMovingFixes
+           && (Period >= DutyMinPeriod)
+           && ((Period - GetLead()) >= MIN_OFF_TIME);
+}
+
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Request the receiver, if it isn't already.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Request
+(
+    double now
+)
+{
+    le_timer_Stop(WakeTimer);
 
-static void Sample
+    if (IsRequested)
+    {
+        return;
+    }
+
+    if (backend_RequestPositioning() != LE_OK)
+    {
+        LE_ERROR("Couldn't activate positioning service.");
+        return;
+    }
+
+    IsRequested = true;
+    HasFix = false;
+    RequestTime = now;
+    OnSince = now;
+    le_timer_Start(PollTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release the receiver, if it is requested.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Release
+(
+    double now
+)
+{
+    if (!IsRequested)
+    {
+        return;
+    }
+
+    backend_ReleasePositioning();
+
+    IsRequested = false;
+    OnTime += now - OnSince;
+    le_timer_Stop(PollTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a fix, timing the receiver's first one since it was requested.
+ *
+ * @return LE_OK if there is a fix.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadFix
 (
-    psensor_Ref_t ref,
-    void *contextPtr
+    double now,
+    int32_t* latPtr,
+    int32_t* lonPtr,
+    int32_t* hAccuracyPtr,
+    int32_t* altPtr,
+    int32_t* vAccuracyPtr
 )
 {
+    if (!IsRequested)
+    {
+        return LE_FAULT;
+    }
+
+    le_result_t result = backend_Get3DLocation(latPtr, lonPtr, hAccuracyPtr, altPtr, vAccuracyPtr);
+
+    if ((result == LE_OK) && !HasFix)
+    {
+        HasFix = true;
+
+        Ttffs[NextTtff] = now - RequestTime;
+        NextTtff = (NextTtff + 1) % NUM_TTFF;
+        if (NumTtffs < NUM_TTFF)
+        {
+            NumTtffs++;
+        }
+        LE_DEBUG("Time to fix %.1f s.", now - RequestTime);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish a fix, and check whether the device moved since the previous one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushFix
+(
+    double now,
+    int32_t lat,
+    int32_t lon,
+    int32_t hAccuracy,
+    int32_t alt,
+    int32_t vAccuracy
+)
+{
+    char json[CODEC_POSITION_MAX_LEN + 1];
+
+    le_result_t result = codec_EncodePosition(json,
+                                              sizeof(json),
+                                              (double)lat / 1000000.0,
+                                              (double)lon / 1000000.0,
+                                              (double)hAccuracy,
+                                              (double)alt / 1000.0,
+                                              (double)vAccuracy);
+    if (result != LE_OK)
+    {
+        LE_FATAL("JSON string is longer than buffer (size %zu).", sizeof(json));
+    }
+
+    dhubIO_PushJson(VALUE_PATH, 0 /* now */, json);
+
+    double latitude = (double)lat / 1000000.0;
+    double longitude = (double)lon / 1000000.0;
+
+    // Over a sample period, the fixes are close enough for an equirectangular distance.  Only
+    // movement beyond the fixes' accuracy counts.
+    if (HasLastFix && (now > LastFixTime))
+    {
+        double dx = (longitude - LastLon) * (M_PI / 180.0) * cos(latitude * (M_PI / 180.0));
+        double dy = (latitude - LastLat) * (M_PI / 180.0);
+        double distance = (EARTH_RADIUS * sqrt((dx * dx) + (dy * dy)))
+                          - (LastAccuracy + (double)hAccuracy);
+        bool isMoving = ((distance / (now - LastFixTime)) > MovingSpeed);
+
+        if (isMoving != IsMovingFixes)
+        {
+            LE_INFO("Device %s.", isMoving ? "moving: receiver stays on" : "stopped");
+            IsMovingFixes = isMoving;
+        }
+    }
+
+    HasLastFix = true;
+    LastLat = latitude;
+    LastLon = longitude;
+    LastAccuracy = (double)hAccuracy;
+    LastFixTime = now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the duty-cycling statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishDuty
+(
+    double now
+)
+{
+    double onTime = OnTime + (IsRequested ? (now - OnSince) : 0.0);
+    double elapsed = now - StatsStart;
+    char json[CODEC_GNSS_DUTY_MAX_LEN + 1];
+
+    LE_ASSERT_OK(codec_EncodeGnssDuty(json,
+                                      sizeof(json),
+                                      (elapsed > 0.0) ? (onTime / elapsed) : 1.0,
+                                      (SamplesDue > 0) ? ((double)SamplesOnTime / SamplesDue) : 1.0,
+                                      GetMeanTtff(),
+                                      GetLead()));
+    dhubIO_PushJson(DUTY_PATH, 0 /* now */, json);
+
+    LE_DEBUG("GNSS duty: %s", json);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * After a sample, release the receiver until the lead before the next one, or keep it on.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScheduleReceiver
+(
+    double now
+)
+{
+    if (!IsDutyCycled())
+    {
+        Request(now);
+        return;
+    }
+
+    double wakeIn = NextDue - GetLead() - now;
+    if (wakeIn < MIN_OFF_TIME)
+    {
+        Request(now);
+        return;
+    }
+
+    Release(now);
+    le_timer_SetMsInterval(WakeTimer, (uint32_t)(wakeIn * 1000.0));
+    le_timer_Start(WakeTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take a sample, or leave it pending until there is a fix.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleDueTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double now = GetNow();
     int32_t lat;
     int32_t lon;
     int32_t hAccuracy;
     int32_t alt;
     int32_t vAccuracy;
 
-    le_result_t posRes = le_pos_Get3DLocation(&lat, &lon, &hAccuracy, &alt, &vAccuracy);
+    NextDue = now + Period;
+    SamplesDue++;
 
-    if (posRes == LE_OK)
+    if (IsSamplePending)
     {
-        char json[256];
+        LE_WARN("No fix for a whole period.");
+        IsSamplePending = false;
+    }
 
-        int len = snprintf(json,
-                           sizeof(json),
-                           "{ \"lat\": %lf, \"lon\": %lf, \"hAcc\": %lf,"
-                            " \"alt\": %lf, \"vAcc\": %lf }",
-                           (double)lat / 1000000.0,
-                           (double)lon / 1000000.0,
-                           (double)hAccuracy,
-                           (double)alt / 1000.0,
-                           (double)vAccuracy);
-        if (len >= sizeof(json))
+    if (ReadFix(now, &lat, &lon, &hAccuracy, &alt, &vAccuracy) == LE_OK)
+    {
+        SamplesOnTime++;
+        PushFix(now, lat, lon, hAccuracy, alt, vAccuracy);
+        ScheduleReceiver(now);
+    }
+    else
+    {
+        IsSamplePending = true;
+        Request(now);
+        if (!le_timer_IsRunning(PollTimer))
+        {
+            le_timer_Start(PollTimer);
+        }
+    }
+
+    PublishDuty(now);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Poll for a fix, pushing the pending sample when there is one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePollTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    double now = GetNow();
+    int32_t lat;
+    int32_t lon;
+    int32_t hAccuracy;
+    int32_t alt;
+    int32_t vAccuracy;
+
+    if (ReadFix(now, &lat, &lon, &hAccuracy, &alt, &vAccuracy) == LE_OK)
+    {
+        if (IsSamplePending)
         {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(json));
+            IsSamplePending = false;
+            PushFix(now, lat, lon, hAccuracy, alt, vAccuracy);
+            ScheduleReceiver(now);
         }
 
-        psensor_PushJson(ref, 0 /* now */, json);
+        if (!IsSamplePending)
+        {
+            le_timer_Stop(PollTimer);
+        }
     }
-    else
+    else if (IsSamplePending && ((now - RequestTime) > MaxAcquire) && IsDutyCycled())
     {
-        LE_ERROR("Failed to read sensor (%s).", LE_RESULT_TXT(posRes));
+        LE_WARN("No fix after %.0f s; receiver off until the next sample.", now - RequestTime);
+        IsSamplePending = false;
+        ScheduleReceiver(now);
     }
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Request the receiver ahead of a sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleWakeTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    Request(GetNow());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start or stop sampling, and the receiver, after a setting changed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Restart
+(
+    void
+)
+{
+    double now = GetNow();
+
+    le_timer_Stop(DueTimer);
+    le_timer_Stop(WakeTimer);
+    IsSamplePending = false;
+
+    if (!IsEnabled || (Period <= 0.0))
+    {
+        Release(now);
+        return;
+    }
+
+    StatsStart = now;
+    OnTime = 0.0;
+    OnSince = now;
+    SamplesDue = 0;
+    SamplesOnTime = 0;
+
+    NextDue = now + Period;
+    le_timer_SetMsInterval(DueTimer, (uint32_t)(Period * 1000.0));
+    le_timer_Start(DueTimer);
+
+    // The first sample's lead isn't known yet, so the receiver starts right away.
+    Request(now);
+
+    LE_INFO("Sampling position every %.0f s, receiver %s.",
+            Period,
+            IsDutyCycled() ? "duty-cycled" : "always on");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a new period.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePeriod
+(
+    double timestamp,
+    double value,
+    void* contextPtr
+)
+{
+    Period = value;
+    Restart();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the sensor being enabled or disabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEnable
+(
+    double timestamp,
+    bool value,
+    void* contextPtr
+)
+{
+    IsEnabled = value;
+    Restart();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the device starting or stopping moving, e.g., from a rule on the accelerometer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleMoving
+(
+    double timestamp,
+    bool value,
+    void* contextPtr
+)
+{
+    IsMovingSet = value;
+
+    if (IsMovingSet && IsEnabled && (Period > 0.0))
+    {
+        Request(GetNow());
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer configuration value from an environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if (valueStr == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value < 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
 COMPONENT_INIT
 {
-    // Activate the positioning service.
-    le_posCtrl_ActivationRef_t posCtrlRef = le_posCtrl_Request();
-    LE_FATAL_IF(posCtrlRef == NULL, "Couldn't activate positioning service");
+    DutyMinPeriod = GetEnvInt("GNSS_DUTY_MIN_PERIOD_S", DEFAULT_DUTY_MIN_PERIOD_S);
+    MaxAcquire = GetEnvInt("GNSS_MAX_ACQUIRE_S", DEFAULT_MAX_ACQUIRE_S);
+    MovingSpeed = GetEnvInt("GNSS_MOVING_KMH", DEFAULT_MOVING_KMH) / 3.6;
+
+    DueTimer = le_timer_Create("positionDue");
+    le_timer_SetHandler(DueTimer, HandleDueTimer);
+    le_timer_SetRepeat(DueTimer, 0);
+
+    WakeTimer = le_timer_Create("positionWake");
+    le_timer_SetHandler(WakeTimer, HandleWakeTimer);
+
+    PollTimer = le_timer_Create("positionPoll");
+    le_timer_SetHandler(PollTimer, HandlePollTimer);
+    le_timer_SetMsInterval(PollTimer, POLL_INTERVAL_MS);
+    le_timer_SetRepeat(PollTimer, 0);
+
+    // We'll provide samples as JSON structures.
+    LE_ASSERT_OK(dhubIO_CreateInput(VALUE_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    LE_ASSERT_OK(dhubIO_CreateInput(DUTY_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(DUTY_PATH,
+                          "{\"onRatio\":0.2,\"availability\":1.0,\"ttff\":4.3,\"lead\":12.9}");
+
+    LE_ASSERT_OK(dhubIO_CreateOutput(PERIOD_PATH, DHUBIO_DATA_TYPE_NUMERIC, "s"));
+    dhubIO_AddNumericPushHandler(PERIOD_PATH, HandlePeriod, NULL);
+    LE_ASSERT_OK(dhubIO_CreateOutput(ENABLE_PATH, DHUBIO_DATA_TYPE_BOOLEAN, ""));
+    dhubIO_AddBooleanPushHandler(ENABLE_PATH, HandleEnable, NULL);
+    LE_ASSERT_OK(dhubIO_CreateOutput(MOVING_PATH, DHUBIO_DATA_TYPE_BOOLEAN, ""));
+    dhubIO_MarkOptional(MOVING_PATH);
+    dhubIO_AddBooleanPushHandler(MOVING_PATH, HandleMoving, NULL);
 
-    // Use the periodic sensor component from the Data Hub to implement the timer and Data Hub
-    // interface.  We'll provide samples as JSON structures.
-    psensor_Create("position", DHUBIO_DATA_TYPE_JSON, "", Sample, NULL);
+    LE_INFO("GNSS receiver duty-cycled for periods of %.0f s or more.", DutyMinPeriod);
 }
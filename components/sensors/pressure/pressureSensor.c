@@ -14,9 +14,14 @@
 #include "interfaces.h"
 #include "periodicSensor.h"
 #include "fileUtils.h"
+#include "streamServer.h"
 
-static const char PressureFile[] = "/driver/in_pressure_input";
-static const char TemperatureFile[] = "/driver/in_temp_input";
+/// Maximum length of a driver attribute file path (including the null terminator).
+#define ATTR_PATH_BYTES 128
+
+/// Paths of the driver attribute files, built when the component is initialized.
+static char PressureFile[ATTR_PATH_BYTES];
+static char TemperatureFile[ATTR_PATH_BYTES];
 
 
 static void SamplePressure
@@ -32,6 +37,7 @@ static void SamplePressure
     if (result == LE_OK)
     {
         psensor_PushNumeric(ref, 0 /* now */, sample);
+        stream_Publish(STREAM_CHANNEL_PRESSURE, &sample, 1);
     }
     else
     {
@@ -53,6 +59,7 @@ static void SampleTemperature
     if (result == LE_OK)
     {
         psensor_PushNumeric(ref, 0 /* now */, sample);
+        stream_Publish(STREAM_CHANNEL_TEMPERATURE, &sample, 1);
     }
     else
     {
@@ -108,6 +115,14 @@ le_result_t temperature_Read
 
 COMPONENT_INIT
 {
+    le_result_t result = file_MakeDriverPath("in_pressure_input",
+                                             PressureFile,
+                                             sizeof(PressureFile));
+    LE_FATAL_IF(result != LE_OK, "Path of pressure driver file too long.");
+
+    result = file_MakeDriverPath("in_temp_input", TemperatureFile, sizeof(TemperatureFile));
+    LE_FATAL_IF(result != LE_OK, "Path of temperature driver file too long.");
+
     // Use the periodic sensor component from the Data Hub to implement the timers and the
     // interface to the Data Hub.
     psensor_Create("pressure", DHUBIO_DATA_TYPE_NUMERIC, "kPa", SamplePressure, NULL);
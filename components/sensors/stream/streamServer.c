@@ -0,0 +1,556 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file streamServer.c
+ *
+ * Local sensor streaming server (see streamServer.h).
+ *
+ * Listens on a Unix socket and/or a TCP port, configured by environment variables:
+ *
+ *  - STREAM_SOCKET: Unix socket path (default /tmp/redSensor.stream; empty to disable).  In a
+ *    sandboxed app, the path is inside the app's sandbox.
+ *  - STREAM_PORT: TCP port (default 5760; 0 to disable).
+ *  - STREAM_ADDRESS: address the TCP port is bound to (default 127.0.0.1).  Set it to the address
+ *    of a local link interface to serve a box on that link.
+ *  - STREAM_QUEUE: samples queued per client before the oldest are dropped (default 4096, at
+ *    most 1048576).
+ *
+ * Queued samples are written to the clients every FLUSH_INTERVAL_MS, in blocks of up to
+ * MAX_BLOCK_RECORDS, so the cost per sample stays a copy into each client's queue however high
+ * the sample rate.  A client whose socket is full is written to again when it becomes writable.
+ * Anything a client sends is ignored.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "streamServer.h"
+
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+#define DEFAULT_SOCKET_PATH "/tmp/redSensor.stream"
+#define DEFAULT_PORT 5760
+#define DEFAULT_ADDRESS "127.0.0.1"
+#define DEFAULT_QUEUE_RECORDS 4096
+#define MAX_QUEUE_RECORDS (1024 * 1024)
+
+#define MAX_CLIENTS 8
+
+/// Most records written in one block.
+#define MAX_BLOCK_RECORDS 128
+
+/// How long samples are left to accumulate in the client queues before being written.
+#define FLUSH_INTERVAL_MS 10
+
+#define LISTEN_BACKLOG 4
+
+/// Kernel send buffer per client, kept small so that a slow client's backlog stays in its queue,
+/// where the oldest samples get dropped, rather than going stale in the kernel.
+#define SOCKET_SEND_BUFFER_BYTES (16 * 1024)
+
+
+/// Header sent when a client connects.
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+}
+StreamHeader_t;
+
+/// Header of a block of records.
+typedef struct
+{
+    uint32_t numRecords;
+    uint32_t reserved;
+    uint64_t drops;
+}
+BlockHeader_t;
+
+
+/// A connected client.
+typedef struct
+{
+    int fd;                         ///< -1 if this slot is free.
+    le_fdMonitor_Ref_t monitor;
+    stream_Record_t* queuePtr;      ///< Ring of QueueRecords samples.
+    size_t head;                    ///< Index of the oldest queued sample.
+    size_t count;                   ///< Number of queued samples.
+    uint64_t drops;                 ///< Samples dropped because the queue was full.
+    uint64_t sent;                  ///< Samples written to the socket.
+    size_t outStart;                ///< Offset of the unwritten part of out[].
+    size_t outLen;                  ///< Bytes of out[] still to write.
+    uint8_t out[sizeof(BlockHeader_t) + (MAX_BLOCK_RECORDS * sizeof(stream_Record_t))];
+}
+Client_t;
+
+
+static Client_t Clients[MAX_CLIENTS];
+
+static size_t QueueRecords = DEFAULT_QUEUE_RECORDS;
+static le_mem_PoolRef_t QueuePool;
+
+static le_timer_Ref_t FlushTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Disconnect a client.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseClient
+(
+    Client_t* clientPtr
+)
+{
+    LE_INFO("Stream client %d disconnected (%" PRIu64 " samples sent, %" PRIu64 " dropped).",
+            clientPtr->fd,
+            clientPtr->sent,
+            clientPtr->drops);
+
+    le_fdMonitor_Delete(clientPtr->monitor);
+    close(clientPtr->fd);
+    le_mem_Release(clientPtr->queuePtr);
+
+    clientPtr->fd = -1;
+    clientPtr->monitor = NULL;
+    clientPtr->queuePtr = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Move up to a block of queued samples into the client's output buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FillBlock
+(
+    Client_t* clientPtr
+)
+{
+    size_t n = (clientPtr->count < MAX_BLOCK_RECORDS) ? clientPtr->count : MAX_BLOCK_RECORDS;
+    BlockHeader_t header = { .numRecords = n, .reserved = 0, .drops = clientPtr->drops };
+    stream_Record_t* recordsPtr = (stream_Record_t*)(clientPtr->out + sizeof(header));
+
+    memcpy(clientPtr->out, &header, sizeof(header));
+
+    // The queue is a ring, so the block may come from its end and its start.
+    size_t first = QueueRecords - clientPtr->head;
+    if (first > n)
+    {
+        first = n;
+    }
+    memcpy(recordsPtr, clientPtr->queuePtr + clientPtr->head, first * sizeof(stream_Record_t));
+    memcpy(recordsPtr + first, clientPtr->queuePtr, (n - first) * sizeof(stream_Record_t));
+
+    clientPtr->head = (clientPtr->head + n) % QueueRecords;
+    clientPtr->count -= n;
+    clientPtr->sent += n;
+
+    clientPtr->outStart = 0;
+    clientPtr->outLen = sizeof(header) + (n * sizeof(stream_Record_t));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write as much of the client's output and queue as its socket takes.  Waits for the socket to be
+ * writable again if some is left.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FlushClient
+(
+    Client_t* clientPtr
+)
+{
+    for (;;)
+    {
+        if (clientPtr->outLen == 0)
+        {
+            if (clientPtr->count == 0)
+            {
+                le_fdMonitor_Disable(clientPtr->monitor, POLLOUT);
+                return;
+            }
+
+            FillBlock(clientPtr);
+        }
+
+        ssize_t n = send(clientPtr->fd,
+                         clientPtr->out + clientPtr->outStart,
+                         clientPtr->outLen,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                le_fdMonitor_Enable(clientPtr->monitor, POLLOUT);
+                return;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LE_WARN("Stream client %d write failed - %m", clientPtr->fd);
+            CloseClient(clientPtr);
+            return;
+        }
+
+        clientPtr->outStart += n;
+        clientPtr->outLen -= n;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush timer expiry handler: write the queued samples to every client.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFlushTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    for (size_t i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (Clients[i].fd >= 0)
+        {
+            FlushClient(&Clients[i]);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle events on a client's socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleClient
+(
+    int fd,
+    short events
+)
+{
+    Client_t* clientPtr = le_fdMonitor_GetContextPtr();
+
+    if (events & POLLIN)
+    {
+        uint8_t discard[256];
+        ssize_t n = recv(fd, discard, sizeof(discard), MSG_DONTWAIT);
+
+        if ((n == 0) || ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)))
+        {
+            CloseClient(clientPtr);
+            return;
+        }
+    }
+
+    if (events & (POLLERR | POLLHUP | POLLRDHUP))
+    {
+        CloseClient(clientPtr);
+        return;
+    }
+
+    if (events & POLLOUT)
+    {
+        FlushClient(clientPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Accept a client connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleListener
+(
+    int listenFd,
+    short events
+)
+{
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0)
+    {
+        LE_WARN("Stream accept failed - %m");
+        return;
+    }
+
+    // Never block the sensors on a client.
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    int bufferSize = SOCKET_SEND_BUFFER_BYTES;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    Client_t* clientPtr = NULL;
+    for (size_t i = 0; (i < MAX_CLIENTS) && (clientPtr == NULL); i++)
+    {
+        if (Clients[i].fd < 0)
+        {
+            clientPtr = &Clients[i];
+        }
+    }
+
+    if (clientPtr == NULL)
+    {
+        LE_WARN("Too many stream clients (max %d).", MAX_CLIENTS);
+        close(fd);
+        return;
+    }
+
+    clientPtr->fd = fd;
+    clientPtr->queuePtr = le_mem_ForceAlloc(QueuePool);
+    clientPtr->head = 0;
+    clientPtr->count = 0;
+    clientPtr->drops = 0;
+    clientPtr->sent = 0;
+
+    StreamHeader_t header =
+    {
+        .magic = { 'R', 'S', 'S', 'T' },
+        .version = STREAM_VERSION,
+        .recordSize = sizeof(stream_Record_t),
+    };
+    memcpy(clientPtr->out, &header, sizeof(header));
+    clientPtr->outStart = 0;
+    clientPtr->outLen = sizeof(header);
+
+    clientPtr->monitor = le_fdMonitor_Create("streamClient", fd, HandleClient, POLLIN | POLLRDHUP);
+    le_fdMonitor_SetContextPtr(clientPtr->monitor, clientPtr);
+
+    LE_INFO("Stream client %d connected.", fd);
+
+    FlushClient(clientPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start listening on a bound socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Listen
+(
+    int fd,
+    const char* description
+)
+{
+    if (listen(fd, LISTEN_BACKLOG) != 0)
+    {
+        LE_ERROR("Couldn't listen on %s - %m", description);
+        close(fd);
+        return;
+    }
+
+    le_fdMonitor_Create("streamListener", fd, HandleListener, POLLIN);
+
+    LE_INFO("Streaming sensor samples on %s.", description);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Listen on a Unix socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ListenUnix
+(
+    const char* path
+)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        LE_ERROR("Stream socket path '%s' is too long.", path);
+        return;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    LE_FATAL_IF(fd < 0, "Couldn't create socket - %m");
+
+    // Remove the socket left by an earlier instance.
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        LE_ERROR("Couldn't bind stream socket '%s' - %m", path);
+        close(fd);
+        return;
+    }
+
+    Listen(fd, path);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Listen on a TCP port.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ListenTcp
+(
+    const char* address,
+    int port
+)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    char description[64];
+
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+    {
+        LE_ERROR("Invalid STREAM_ADDRESS '%s'.", address);
+        return;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    LE_FATAL_IF(fd < 0, "Couldn't create socket - %m");
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        LE_ERROR("Couldn't bind stream port %s:%d - %m", address, port);
+        close(fd);
+        return;
+    }
+
+    snprintf(description, sizeof(description), "%s:%d", address, port);
+    Listen(fd, description);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stream a sample, timestamped now, to every connected client.
+ */
+//--------------------------------------------------------------------------------------------------
+void stream_Publish
+(
+    stream_Channel_t channel,
+    const double values[],
+    size_t numValues        ///< 1 to STREAM_MAX_VALUES
+)
+{
+    LE_ASSERT((numValues > 0) && (numValues <= STREAM_MAX_VALUES));
+
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+    stream_Record_t record =
+    {
+        .timestamp = now.sec + (now.usec / 1000000.0),
+        .channel = channel,
+        .numValues = numValues,
+    };
+    bool isAnyClient = false;
+
+    for (size_t i = 0; i < numValues; i++)
+    {
+        record.values[i] = (float)values[i];
+    }
+
+    for (size_t i = 0; i < MAX_CLIENTS; i++)
+    {
+        Client_t* clientPtr = &Clients[i];
+
+        if (clientPtr->fd < 0)
+        {
+            continue;
+        }
+
+        // Drop the oldest sample to make room.
+        if (clientPtr->count == QueueRecords)
+        {
+            clientPtr->head = (clientPtr->head + 1) % QueueRecords;
+            clientPtr->count--;
+            clientPtr->drops++;
+        }
+
+        clientPtr->queuePtr[(clientPtr->head + clientPtr->count) % QueueRecords] = record;
+        clientPtr->count++;
+        isAnyClient = true;
+    }
+
+    if (isAnyClient && !le_timer_IsRunning(FlushTimer))
+    {
+        le_timer_Start(FlushTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.  Terminates the process if the
+ *         value isn't an integer from 0 to maxValue.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue,
+    int maxValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if (valueStr == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value < 0) || (value > maxValue),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
+COMPONENT_INIT
+{
+    for (size_t i = 0; i < MAX_CLIENTS; i++)
+    {
+        Clients[i].fd = -1;
+    }
+
+    QueueRecords = GetEnvInt("STREAM_QUEUE", DEFAULT_QUEUE_RECORDS, MAX_QUEUE_RECORDS);
+    LE_FATAL_IF(QueueRecords == 0, "STREAM_QUEUE must be at least 1.");
+    QueuePool = le_mem_CreatePool("StreamQueue", QueueRecords * sizeof(stream_Record_t));
+
+    FlushTimer = le_timer_Create("StreamFlush");
+    le_timer_SetHandler(FlushTimer, HandleFlushTimer);
+    le_timer_SetMsInterval(FlushTimer, FLUSH_INTERVAL_MS);
+
+    const char* path = getenv("STREAM_SOCKET");
+    if (path == NULL)
+    {
+        path = DEFAULT_SOCKET_PATH;
+    }
+    if (path[0] != '\0')
+    {
+        ListenUnix(path);
+    }
+
+    int port = GetEnvInt("STREAM_PORT", DEFAULT_PORT, UINT16_MAX);
+    if (port > 0)
+    {
+        const char* address = getenv("STREAM_ADDRESS");
+        ListenTcp((address != NULL) ? address : DEFAULT_ADDRESS, port);
+    }
+}
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file streamServer.h
+ *
+ * Local streaming of raw sensor samples to high-rate consumers (e.g., an edge box on a local
+ * link), without going through the Data Hub and JSON.
+ *
+ * The sensor components hand every sample they take to stream_Publish().  Clients connect to a
+ * Unix socket or a TCP port and receive every sample from then on, as binary blocks.  Each client
+ * has its own bounded queue: if a client reads too slowly, its oldest queued samples are dropped
+ * (and counted) rather than slowing down the sensors or the other clients.
+ *
+ * Stream format, in the host's byte order (like the sensor log, see sensorLog.h):
+ *
+ *  - Stream header, once on connect:
+ *     - magic "RSST" (4 bytes)
+ *     - format version (uint16)
+ *     - record size in bytes (uint16)
+ *  - Any number of blocks:
+ *     - number of records in the block (uint32)
+ *     - reserved (uint32, 0)
+ *     - samples dropped for this client so far (uint64)
+ *     - the records (see stream_Record_t).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STREAM_SERVER_H_INCLUDE_GUARD
+#define STREAM_SERVER_H_INCLUDE_GUARD
+
+
+/// Current stream format version.
+#define STREAM_VERSION 1
+
+/// Most values in one sample.
+#define STREAM_MAX_VALUES 3
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Streamed sensor channels.  Values are sent to clients, so never renumber.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    STREAM_CHANNEL_ACCEL = 0,           ///< x, y, z (m/s2)
+    STREAM_CHANNEL_GYRO = 1,            ///< x, y, z (rad/s)
+    STREAM_CHANNEL_LIGHT = 2,
+    STREAM_CHANNEL_PRESSURE = 3,        ///< kPa
+    STREAM_CHANNEL_TEMPERATURE = 4,     ///< Pressure sensor temperature (degC)
+    STREAM_CHANNEL_IMU_TEMPERATURE = 5, ///< IMU temperature (degC)
+
+    STREAM_NUM_CHANNELS
+}
+stream_Channel_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A streamed sample.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double timestamp;                   ///< Seconds since the Epoch.
+    uint8_t channel;                    ///< stream_Channel_t
+    uint8_t numValues;
+    uint16_t reserved;                  ///< 0
+    float values[STREAM_MAX_VALUES];    ///< Unused values are 0.
+}
+stream_Record_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stream a sample, timestamped now, to every connected client.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void stream_Publish
+(
+    stream_Channel_t channel,
+    const double values[],
+    size_t numValues        ///< 1 to STREAM_MAX_VALUES
+);
+
+
+#endif // STREAM_SERVER_H_INCLUDE_GUARD
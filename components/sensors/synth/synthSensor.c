@@ -0,0 +1,562 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file synthSensor.c
+ *
+ * Implementation of a synthetic sensor that publishes generated waveforms to the Data Hub.
+ *
+ * This is used to load test the Data Hub -> avPublisher path at sample rates far beyond what
+ * the real sensors produce.  Up to SYNTH_MAX_CHANNELS channels can be run at once.  Each channel
+ * publishes either numeric samples or JSON samples of the form {"x":..,"y":..,"z":..} (the same
+ * format as the accelerometer and gyro) to an arbitrary Data Hub input resource path.
+ *
+ * Channels are added, changed and stopped at runtime by pushing a JSON string to the "control"
+ * output, for example:
+ *
+ * {"path":"accel/value","type":"json","shape":"sine","rate":1000,"amplitude":9.8,"freq":2}
+ *
+ * Members:
+ *  - path: Data Hub resource path (relative to the app) of the channel.  Required.
+ *  - type: "numeric" (default) or "json".  Only applies when the channel is first created.
+ *  - shape: "sine" (default), "noise", "step" or "burst".
+ *  - rate: sample rate in Hz.  0 stops the channel.
+ *  - amplitude, offset: scaling of the waveform.
+ *  - freq: waveform frequency in Hz (sine, step, burst period).
+ *  - duty: fraction of each burst period during which a "burst" channel publishes samples.
+ *
+ * To feed a channel into the cloud publisher, point one of its observations at it, e.g.
+ * /obs/accel -> /app/redSynth/accel/value.
+ *
+ * The achieved aggregate sample rate (Hz) and the cumulative number of dropped samples (samples
+ * that came due but could not be published because the event loop fell behind) are published
+ * once per second to the "stats/rate" and "stats/drops" inputs.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "json.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Limits and defaults.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#define SYNTH_MAX_CHANNELS 8
+
+#define SYNTH_MAX_RATE 10000.0  // Hz
+
+/// Shortest tick interval (ms).  Faster channels publish several samples per tick.
+#define SYNTH_MIN_TICK_MS 1
+
+/// Maximum number of samples a channel will publish in one tick.  Anything due beyond this is
+/// counted as dropped, so a saturated event loop doesn't snowball.
+#define SYNTH_MAX_SAMPLES_PER_TICK 50
+
+#define SYNTH_STATS_PERIOD_MS 1000
+
+#define CONTROL_PATH "control"
+#define STATS_RATE_PATH "stats/rate"
+#define STATS_DROPS_PATH "stats/drops"
+
+#define CONTROL_EXAMPLE "{\"path\":\"synth/value\",\"type\":\"numeric\",\"shape\":\"sine\"," \
+                        "\"rate\":100,\"amplitude\":1,\"offset\":0,\"freq\":1,\"duty\":0.1}"
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * type definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+/// Waveform shapes.
+typedef enum
+{
+    SHAPE_SINE,     ///< offset + amplitude * sin(2 pi freq t)
+    SHAPE_NOISE,    ///< offset + uniform noise in [-amplitude, amplitude]
+    SHAPE_STEP,     ///< Square wave between offset - amplitude and offset + amplitude
+    SHAPE_BURST,    ///< Noise, published only during the first 'duty' fraction of each period
+}
+Shape_t;
+
+/// State of one synthetic channel.
+typedef struct
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1]; ///< Data Hub resource path. Empty if unused.
+    bool isJson;            ///< true = publish {"x","y","z"} JSON, false = publish numbers.
+    Shape_t shape;          ///< Waveform shape.
+    double rate;            ///< Sample rate (Hz).
+    double amplitude;       ///< Waveform amplitude.
+    double offset;          ///< Waveform offset.
+    double freq;            ///< Waveform frequency (Hz).
+    double duty;            ///< Burst duty cycle (0..1).
+    le_timer_Ref_t timer;   ///< Tick timer.
+    double startTime;       ///< Absolute time (s) at which sample 0 was due.
+    uint64_t sampleIndex;   ///< Index of the next sample that will come due.
+    uint64_t published;     ///< Number of samples published (for stats).
+    uint64_t dropped;       ///< Number of samples dropped (for stats).
+}
+Channel_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * variable definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+static Channel_t Channels[SYNTH_MAX_CHANNELS];
+
+/// State of the noise generator (xorshift64).  Fixed seed so runs are repeatable.
+static uint64_t NoiseState = 0x9E3779B97F4A7C15ULL;
+
+/// Total samples published across all channels, and the time, at the last stats report.
+static uint64_t LastPublished = 0;
+static double LastStatsTime = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current absolute time in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate a uniformly distributed pseudo-random number in [-1, 1].
+ */
+//--------------------------------------------------------------------------------------------------
+static double Noise
+(
+    void
+)
+{
+    NoiseState ^= NoiseState << 13;
+    NoiseState ^= NoiseState >> 7;
+    NoiseState ^= NoiseState << 17;
+
+    return ((double)(NoiseState >> 11) / (double)(1ULL << 52)) - 1.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the waveform value of a channel at a given time (seconds since the channel started).
+ *
+ * @return false if no sample should be published at this time (burst gap).
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Waveform
+(
+    const Channel_t* chanPtr,
+    double t,
+    double phase,   ///< Phase shift (fraction of a period) used for the JSON y and z members.
+    double* valuePtr
+)
+{
+    double cycles = (t * chanPtr->freq) + phase;
+    double fraction = cycles - floor(cycles);
+
+    switch (chanPtr->shape)
+    {
+        case SHAPE_SINE:
+
+            *valuePtr = chanPtr->offset + (chanPtr->amplitude * sin(2 * M_PI * cycles));
+            return true;
+
+        case SHAPE_NOISE:
+
+            *valuePtr = chanPtr->offset + (chanPtr->amplitude * Noise());
+            return true;
+
+        case SHAPE_STEP:
+
+            *valuePtr = chanPtr->offset + ((fraction < 0.5) ? chanPtr->amplitude
+                                                            : -chanPtr->amplitude);
+            return true;
+
+        case SHAPE_BURST:
+
+            // Gate on the un-shifted phase so all members of a JSON sample agree.
+            fraction = (t * chanPtr->freq) - floor(t * chanPtr->freq);
+            if (fraction >= chanPtr->duty)
+            {
+                return false;
+            }
+            *valuePtr = chanPtr->offset + (chanPtr->amplitude * Noise());
+            return true;
+    }
+
+    LE_FATAL("Unexpected shape %d.", chanPtr->shape);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate and publish one sample of a channel.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishSample
+(
+    Channel_t* chanPtr,
+    double timestamp
+)
+{
+    double t = timestamp - chanPtr->startTime;
+
+    if (chanPtr->isJson)
+    {
+        double x;
+        double y;
+        double z;
+
+        if (   !Waveform(chanPtr, t, 0.0, &x)
+            || !Waveform(chanPtr, t, 1.0 / 3.0, &y)
+            || !Waveform(chanPtr, t, 2.0 / 3.0, &z)  )
+        {
+            return;
+        }
+
+        char sample[128];
+
+        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
+        if (len >= sizeof(sample))
+        {
+            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+        }
+
+        dhubIO_PushJson(chanPtr->path, timestamp, sample);
+    }
+    else
+    {
+        double value;
+
+        if (!Waveform(chanPtr, t, 0.0, &value))
+        {
+            return;
+        }
+
+        dhubIO_PushNumeric(chanPtr->path, timestamp, value);
+    }
+
+    chanPtr->published++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Channel tick timer expiry handler.  Publishes all the samples that have come due since the
+ * last tick, up to SYNTH_MAX_SAMPLES_PER_TICK.  The rest are counted as dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TickHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    Channel_t* chanPtr = le_timer_GetContextPtr(timer);
+
+    double now = Now();
+
+    uint64_t dueIndex = (uint64_t)((now - chanPtr->startTime) * chanPtr->rate) + 1;
+
+    if (dueIndex <= chanPtr->sampleIndex)
+    {
+        return;
+    }
+
+    uint64_t dueCount = dueIndex - chanPtr->sampleIndex;
+
+    if (dueCount > SYNTH_MAX_SAMPLES_PER_TICK)
+    {
+        // Fell behind.  Skip to the most recent samples.
+        chanPtr->dropped += dueCount - SYNTH_MAX_SAMPLES_PER_TICK;
+        chanPtr->sampleIndex = dueIndex - SYNTH_MAX_SAMPLES_PER_TICK;
+    }
+
+    while (chanPtr->sampleIndex < dueIndex)
+    {
+        PublishSample(chanPtr,
+                      chanPtr->startTime + ((double)chanPtr->sampleIndex / chanPtr->rate));
+        chanPtr->sampleIndex++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * (Re)start a channel's tick timer according to its current rate.  Stops it if the rate is 0.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartChannel
+(
+    Channel_t* chanPtr
+)
+{
+    le_timer_Stop(chanPtr->timer);
+
+    if (chanPtr->rate <= 0.0)
+    {
+        LE_INFO("Synthetic channel '%s' stopped.", chanPtr->path);
+        return;
+    }
+
+    uint32_t tickMs = (uint32_t)(1000.0 / chanPtr->rate);
+    if (tickMs < SYNTH_MIN_TICK_MS)
+    {
+        tickMs = SYNTH_MIN_TICK_MS;
+    }
+
+    chanPtr->startTime = Now();
+    chanPtr->sampleIndex = 0;
+
+    le_timer_SetMsInterval(chanPtr->timer, tickMs);
+    le_timer_Start(chanPtr->timer);
+
+    LE_INFO("Synthetic channel '%s' running at %.1lf Hz (tick %" PRIu32 " ms).",
+            chanPtr->path,
+            chanPtr->rate,
+            tickMs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the channel publishing to a given path, or allocate a free channel for it.
+ *
+ * @return Pointer to the channel, or NULL if there are no free channels.
+ */
+//--------------------------------------------------------------------------------------------------
+static Channel_t* GetChannel
+(
+    const char* path,
+    bool isJson ///< Data type to use if a new channel is created.
+)
+{
+    Channel_t* freePtr = NULL;
+
+    for (int i = 0; i < SYNTH_MAX_CHANNELS; i++)
+    {
+        if (strcmp(Channels[i].path, path) == 0)
+        {
+            return &Channels[i];
+        }
+        if ((freePtr == NULL) && (Channels[i].path[0] == '\0'))
+        {
+            freePtr = &Channels[i];
+        }
+    }
+
+    if (freePtr == NULL)
+    {
+        return NULL;
+    }
+
+    le_result_t result = dhubIO_CreateInput(path,
+                                            isJson ? DHUBIO_DATA_TYPE_JSON
+                                                   : DHUBIO_DATA_TYPE_NUMERIC,
+                                            "");
+    if ((result != LE_OK) && (result != LE_DUPLICATE))
+    {
+        LE_ERROR("Failed to create Data Hub input '%s' (%s).", path, LE_RESULT_TXT(result));
+        return NULL;
+    }
+
+    if (isJson)
+    {
+        dhubIO_SetJsonExample(path, "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+    }
+
+    LE_ASSERT(le_utf8_Copy(freePtr->path, path, sizeof(freePtr->path), NULL) == LE_OK);
+    freePtr->isJson = isJson;
+    freePtr->shape = SHAPE_SINE;
+    freePtr->rate = 0.0;
+    freePtr->amplitude = 1.0;
+    freePtr->offset = 0.0;
+    freePtr->freq = 1.0;
+    freePtr->duty = 0.1;
+
+    if (freePtr->timer == NULL)
+    {
+        freePtr->timer = le_timer_Create(path);
+        le_timer_SetHandler(freePtr->timer, TickHandler);
+        le_timer_SetRepeat(freePtr->timer, 0);
+        le_timer_SetContextPtr(freePtr->timer, freePtr);
+    }
+
+    return freePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract an optional numerical member from a JSON structure.
+ *
+ * @return true if the member was found and is a number.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ExtractNumber
+(
+    const char* json,
+    const char* memberName,
+    double* numberPtr
+)
+{
+    char member[32];
+    json_DataType_t dataType;
+
+    if (   (json_Extract(member, sizeof(member), json, memberName, &dataType) != LE_OK)
+        || (dataType != JSON_TYPE_NUMBER)  )
+    {
+        return false;
+    }
+
+    *numberPtr = json_ConvertToNumber(member);
+
+    return !isnan(*numberPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a new channel configuration is pushed to the
+ * "control" output.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleControl
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    char member[16];
+    json_DataType_t dataType;
+
+    if (   (json_Extract(path, sizeof(path), value, "path", &dataType) != LE_OK)
+        || (dataType != JSON_TYPE_STRING)
+        || (path[0] == '\0')  )
+    {
+        LE_ERROR("Synthetic channel control '%s' has no valid 'path'.", value);
+        return;
+    }
+
+    bool isJson = (   (json_Extract(member, sizeof(member), value, "type", &dataType) == LE_OK)
+                   && (strcmp(member, "json") == 0)  );
+
+    Channel_t* chanPtr = GetChannel(path, isJson);
+    if (chanPtr == NULL)
+    {
+        LE_ERROR("No free synthetic channel for '%s' (max %d).", path, SYNTH_MAX_CHANNELS);
+        return;
+    }
+
+    if (json_Extract(member, sizeof(member), value, "shape", &dataType) == LE_OK)
+    {
+        if (strcmp(member, "sine") == 0)
+        {
+            chanPtr->shape = SHAPE_SINE;
+        }
+        else if (strcmp(member, "noise") == 0)
+        {
+            chanPtr->shape = SHAPE_NOISE;
+        }
+        else if (strcmp(member, "step") == 0)
+        {
+            chanPtr->shape = SHAPE_STEP;
+        }
+        else if (strcmp(member, "burst") == 0)
+        {
+            chanPtr->shape = SHAPE_BURST;
+        }
+        else
+        {
+            LE_ERROR("Unknown waveform shape '%s'. Keeping the previous one.", member);
+        }
+    }
+
+    (void)ExtractNumber(value, "amplitude", &chanPtr->amplitude);
+    (void)ExtractNumber(value, "offset", &chanPtr->offset);
+    (void)ExtractNumber(value, "freq", &chanPtr->freq);
+    (void)ExtractNumber(value, "duty", &chanPtr->duty);
+
+    double rate;
+    if (ExtractNumber(value, "rate", &rate))
+    {
+        if ((rate < 0.0) || (rate > SYNTH_MAX_RATE))
+        {
+            LE_ERROR("Rate %lf Hz out of range (0..%lf). Ignored.", rate, SYNTH_MAX_RATE);
+        }
+        else
+        {
+            chanPtr->rate = rate;
+        }
+    }
+
+    StartChannel(chanPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stats timer expiry handler.  Publishes the achieved aggregate rate and the number of drops.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StatsHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    uint64_t published = 0;
+    uint64_t dropped = 0;
+
+    for (int i = 0; i < SYNTH_MAX_CHANNELS; i++)
+    {
+        published += Channels[i].published;
+        dropped += Channels[i].dropped;
+    }
+
+    double now = Now();
+    double rate = (double)(published - LastPublished) / (now - LastStatsTime);
+
+    LastPublished = published;
+    LastStatsTime = now;
+
+    dhubIO_PushNumeric(STATS_RATE_PATH, now, rate);
+    dhubIO_PushNumeric(STATS_DROPS_PATH, now, (double)dropped);
+
+    LE_DEBUG("Synthetic load: %.1lf samples/s, %" PRIu64 " dropped.", rate, dropped);
+}
+
+
+COMPONENT_INIT
+{
+    LE_ASSERT_OK(dhubIO_CreateOutput(CONTROL_PATH, DHUBIO_DATA_TYPE_JSON, ""));
+    dhubIO_SetJsonExample(CONTROL_PATH, CONTROL_EXAMPLE);
+    dhubIO_AddJsonPushHandler(CONTROL_PATH, HandleControl, NULL);
+
+    LE_ASSERT_OK(dhubIO_CreateInput(STATS_RATE_PATH, DHUBIO_DATA_TYPE_NUMERIC, "Hz"));
+    LE_ASSERT_OK(dhubIO_CreateInput(STATS_DROPS_PATH, DHUBIO_DATA_TYPE_NUMERIC, "count"));
+
+    LastStatsTime = Now();
+
+    le_timer_Ref_t statsTimer = le_timer_Create("synthStats");
+    le_timer_SetHandler(statsTimer, StatsHandler);
+    le_timer_SetMsInterval(statsTimer, SYNTH_STATS_PERIOD_MS);
+    le_timer_SetRepeat(statsTimer, 0);
+    le_timer_Start(statsTimer);
+}
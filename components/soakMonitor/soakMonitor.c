@@ -0,0 +1,742 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file soakMonitor.c
+ *
+ * Soak test for the sensor-to-cloud pipeline.  Runs the sensors at an accelerated rate for hours
+ * and watches the pipeline's processes for slow resource leaks.
+ *
+ * Usage: soak [--hours=N] [--interval=S] [--warmup=MIN] [--rate=HZ] [--csv=FILE]
+ *             [--max-rss-growth=KIB_PER_HOUR] [--max-fd-growth=FDS_PER_HOUR]
+ *             [--max-pool-growth=BYTES_PER_HOUR] [PROCESS_NAME ...]
+ *
+ * For the duration of the soak (default 4 hours), every sensor's period is set to 1 / rate
+ * (default 20 Hz) and the cloud publisher's change-by filters are turned off, so every sample
+ * travels the whole Data Hub -> avPublisher -> AirVantage path.  Both are restored at the end.
+ * Off-target, run it with the redMock app so the sensors read the mock driver tree.
+ *
+ * Every interval (default 10 s) the following are sampled for each monitored process (by default
+ * redSensor, the cloud publisher and the Data Hub) and appended to a CSV file (default
+ * /tmp/redSoak.csv):
+ *
+ *  - Resident set size (VmRSS from /proc/PID/status).
+ *  - Number of open file descriptors (entries in /proc/PID/fd).
+ *  - Bytes in use in the process's le_mem pools (sum of the "USED BYTES" column of
+ *    "inspect pools PID"), or -1 if the inspect tool isn't available.
+ *
+ * Samples taken during the warm-up (default 30 minutes) are not used for trend detection, so
+ * pools and caches can reach their working size first.  After that, a metric is trending up if
+ * both its least-squares slope exceeds the allowed growth per hour and the lowest value in the
+ * last quarter of the samples is above the highest value in the first quarter (so transient
+ * spikes aren't mistaken for leaks).  By default any sustained growth of file descriptors or pool
+ * usage fails, while RSS may grow by up to 64 KiB per hour (heap fragmentation).
+ *
+ * At the end (or on SIGTERM), one JSON object per process and metric is output, for example:
+ *
+ * {"suite":"redSoak","version":1,"process":"redSensor","metric":"fds","samples":1260,
+ *  "first":14,"last":14,"slope_per_hour":0.000,"verdict":"pass"}
+ *
+ * The process exits with EXIT_FAILURE if any metric trended up or any monitored process
+ * restarted or disappeared during the soak.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sensorLog.h"
+
+#include <dirent.h>
+
+
+/// Version of the result record format.
+#define RESULT_VERSION 1
+
+#define MAX_PROCS 8
+
+/// Processes monitored if none are named on the command line.
+static const char* const DefaultProcs[] = { "redSensor", "cloud", "hubd" };
+
+/// Where the inspect tool lives on target.  Off-target, it's looked for in the PATH.
+#define INSPECT_PATH "/legato/systems/current/bin/inspect"
+
+
+/// Metrics sampled for each process.
+typedef enum
+{
+    METRIC_RSS,     ///< Resident set size (KiB).
+    METRIC_FDS,     ///< Open file descriptors.
+    METRIC_POOL,    ///< Bytes in use in le_mem pools.
+    NUM_METRICS
+}
+Metric_t;
+
+static const char* const MetricNames[NUM_METRICS] = { "rss_kib", "fds", "pool_bytes" };
+
+
+/// Samples of one metric of one process, taken after the warm-up.
+typedef struct
+{
+    double* timesPtr;   ///< Hours since the end of the warm-up.
+    double* valuesPtr;
+    size_t count;
+    size_t size;        ///< Number of samples the arrays can hold.
+}
+Series_t;
+
+
+/// A monitored process.
+typedef struct
+{
+    const char* name;           ///< Process name (as in /proc/PID/comm).
+    pid_t pid;                  ///< Current PID, or 0 if not found.
+    unsigned int restarts;      ///< Number of times the PID changed or the process disappeared.
+    Series_t series[NUM_METRICS];
+}
+Proc_t;
+
+
+static Proc_t Procs[MAX_PROCS];
+static size_t NumProcs = 0;
+
+static int Hours = 4;
+static int Interval = 10;
+static int WarmupMinutes = 30;
+static int RateHz = 20;
+static const char* CsvPath = "/tmp/redSoak.csv";
+static int MaxGrowth[NUM_METRICS] = { 64, 0, 0 };
+
+static FILE* CsvFile = NULL;
+
+/// Time the soak started (seconds, relative clock).
+static double StartTime;
+
+/// Sensor periods and change-by thresholds in effect before the soak, restored after it.
+static double SavedPeriods[SLOG_NUM_CHANNELS];
+static bool IsPeriodSaved[SLOG_NUM_CHANNELS];
+static double SavedChangeBy[SLOG_NUM_CHANNELS];
+
+static le_timer_Ref_t SampleTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current relative time in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a sensor's "period" resource from the path of its "value" resource.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetPeriodPath
+(
+    slog_Channel_t channel,
+    char* pathBuf,
+    size_t pathBufSize
+)
+{
+    const char* valuePath = slog_GetSourcePath(channel);
+    const char* lastSlashPtr = strrchr(valuePath, '/');
+
+    LE_ASSERT(lastSlashPtr != NULL);
+
+    snprintf(pathBuf, pathBufSize, "%.*s/period", (int)(lastSlashPtr - valuePath), valuePath);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Speed the sensors up and turn off change-by filtering, remembering the original settings.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Accelerate
+(
+    void
+)
+{
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        char path[DHUBADMIN_MAX_RESOURCE_PATH_LEN + 1];
+        double timestamp;
+
+        GetPeriodPath(channel, path, sizeof(path));
+
+        IsPeriodSaved[channel] = (dhubQuery_GetNumeric(path, &timestamp, &SavedPeriods[channel])
+                                  == LE_OK);
+        dhubAdmin_PushNumeric(path, 0.0, 1.0 / (double)RateHz);
+
+        const char* obsPath = slog_GetObsPath(channel);
+        SavedChangeBy[channel] = dhubAdmin_GetChangeBy(obsPath);
+        dhubAdmin_SetChangeBy(obsPath, 0.0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Put the sensor periods and change-by thresholds back the way they were.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Restore
+(
+    void
+)
+{
+    for (slog_Channel_t channel = 0; channel < SLOG_NUM_CHANNELS; channel++)
+    {
+        if (IsPeriodSaved[channel])
+        {
+            char path[DHUBADMIN_MAX_RESOURCE_PATH_LEN + 1];
+
+            GetPeriodPath(channel, path, sizeof(path));
+            dhubAdmin_PushNumeric(path, 0.0, SavedPeriods[channel]);
+        }
+
+        dhubAdmin_SetChangeBy(slog_GetObsPath(channel), SavedChangeBy[channel]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a process has a given name.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HasName
+(
+    pid_t pid,
+    const char* name
+)
+{
+    char path[64];
+    char comm[32] = "";
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    bool isFound = (fgets(comm, sizeof(comm), f) != NULL);
+    fclose(f);
+
+    comm[strcspn(comm, "\n")] = '\0';
+
+    // The kernel truncates names to 15 characters.
+    return isFound && (strncmp(comm, name, 15) == 0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the PID of a process by name.
+ *
+ * @return The PID, or 0 if not found.
+ */
+//--------------------------------------------------------------------------------------------------
+static pid_t FindPid
+(
+    const char* name
+)
+{
+    pid_t result = 0;
+    DIR* dir = opendir("/proc");
+    LE_FATAL_IF(dir == NULL, "Couldn't open /proc - %m");
+
+    struct dirent* entryPtr;
+    while ((result == 0) && ((entryPtr = readdir(dir)) != NULL))
+    {
+        char* endPtr;
+        long pid = strtol(entryPtr->d_name, &endPtr, 10);
+
+        if ((*endPtr == '\0') && (pid > 0) && HasName((pid_t)pid, name))
+        {
+            result = (pid_t)pid;
+        }
+    }
+
+    closedir(dir);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a process's resident set size.
+ *
+ * @return The RSS in KiB, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ReadRss
+(
+    pid_t pid
+)
+{
+    char path[64];
+    char line[128];
+    double rss = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        long kib;
+
+        if (sscanf(line, "VmRSS: %ld kB", &kib) == 1)
+        {
+            rss = (double)kib;
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return rss;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a process's open file descriptors.
+ *
+ * @return The count, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static double CountFds
+(
+    pid_t pid
+)
+{
+    char path[64];
+    int count = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+    {
+        return -1;
+    }
+
+    struct dirent* entryPtr;
+    while ((entryPtr = readdir(dir)) != NULL)
+    {
+        if (entryPtr->d_name[0] != '.')
+        {
+            count++;
+        }
+    }
+
+    closedir(dir);
+
+    return (double)count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sum the bytes in use in a process's le_mem pools, as reported by "inspect pools".
+ *
+ * Data lines start with seven numeric columns: total blocks, used blocks, max used, overflows,
+ * allocs, block bytes and used bytes.  Other lines (headers, blank lines) are skipped.
+ *
+ * @return The number of bytes, or -1 if the inspect tool couldn't be run.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ReadPoolBytes
+(
+    pid_t pid
+)
+{
+    char command[PATH_MAX + 32];
+    char line[256];
+    double total = 0;
+    bool isFound = false;
+
+    snprintf(command,
+             sizeof(command),
+             "%s pools %d 2>/dev/null",
+             (access(INSPECT_PATH, X_OK) == 0) ? INSPECT_PATH : "inspect",
+             (int)pid);
+
+    FILE* pipe = popen(command, "r");
+    if (pipe == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), pipe) != NULL)
+    {
+        unsigned long columns[7];
+
+        if (sscanf(line, "%lu %lu %lu %lu %lu %lu %lu",
+                   &columns[0], &columns[1], &columns[2], &columns[3],
+                   &columns[4], &columns[5], &columns[6]) == 7)
+        {
+            total += (double)columns[6];
+            isFound = true;
+        }
+    }
+
+    int status = pclose(pipe);
+
+    return ((status == 0) && isFound) ? total : -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to a series.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSample
+(
+    Series_t* seriesPtr,
+    double hours,
+    double value
+)
+{
+    if (seriesPtr->count == seriesPtr->size)
+    {
+        seriesPtr->size = (seriesPtr->size == 0) ? 256 : (seriesPtr->size * 2);
+        seriesPtr->timesPtr = realloc(seriesPtr->timesPtr, seriesPtr->size * sizeof(double));
+        seriesPtr->valuesPtr = realloc(seriesPtr->valuesPtr, seriesPtr->size * sizeof(double));
+        LE_ASSERT((seriesPtr->timesPtr != NULL) && (seriesPtr->valuesPtr != NULL));
+    }
+
+    seriesPtr->timesPtr[seriesPtr->count] = hours;
+    seriesPtr->valuesPtr[seriesPtr->count] = value;
+    seriesPtr->count++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample every monitored process.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Sample
+(
+    void
+)
+{
+    double elapsed = Now() - StartTime;
+    double hoursAfterWarmup = (elapsed - (WarmupMinutes * 60.0)) / 3600.0;
+
+    for (size_t i = 0; i < NumProcs; i++)
+    {
+        Proc_t* procPtr = &Procs[i];
+
+        if ((procPtr->pid == 0) || !HasName(procPtr->pid, procPtr->name))
+        {
+            pid_t pid = FindPid(procPtr->name);
+
+            if (procPtr->pid != 0)
+            {
+                LE_CRIT("Process '%s' (%d) %s.",
+                        procPtr->name,
+                        (int)procPtr->pid,
+                        (pid == 0) ? "disappeared" : "restarted");
+                procPtr->restarts++;
+            }
+            else if (pid == 0)
+            {
+                LE_WARN("Process '%s' not found.", procPtr->name);
+            }
+
+            procPtr->pid = pid;
+
+            // Samples from an earlier instance of the process say nothing about this one.
+            for (Metric_t metric = 0; metric < NUM_METRICS; metric++)
+            {
+                procPtr->series[metric].count = 0;
+            }
+
+            if (pid == 0)
+            {
+                continue;
+            }
+        }
+
+        double values[NUM_METRICS];
+        values[METRIC_RSS] = ReadRss(procPtr->pid);
+        values[METRIC_FDS] = CountFds(procPtr->pid);
+        values[METRIC_POOL] = ReadPoolBytes(procPtr->pid);
+
+        fprintf(CsvFile,
+                "%.0f,%s,%d,%.0f,%.0f,%.0f\n",
+                elapsed,
+                procPtr->name,
+                (int)procPtr->pid,
+                values[METRIC_RSS],
+                values[METRIC_FDS],
+                values[METRIC_POOL]);
+
+        if (hoursAfterWarmup >= 0)
+        {
+            for (Metric_t metric = 0; metric < NUM_METRICS; metric++)
+            {
+                if (values[metric] >= 0)
+                {
+                    AddSample(&procPtr->series[metric], hoursAfterWarmup, values[metric]);
+                }
+            }
+        }
+    }
+
+    fflush(CsvFile);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the least-squares slope of a series (units per hour).
+ */
+//--------------------------------------------------------------------------------------------------
+static double ComputeSlope
+(
+    const Series_t* seriesPtr
+)
+{
+    double n = (double)seriesPtr->count;
+    double sumT = 0;
+    double sumV = 0;
+    double sumTT = 0;
+    double sumTV = 0;
+
+    for (size_t i = 0; i < seriesPtr->count; i++)
+    {
+        double t = seriesPtr->timesPtr[i];
+        double v = seriesPtr->valuesPtr[i];
+
+        sumT += t;
+        sumV += v;
+        sumTT += t * t;
+        sumTV += t * v;
+    }
+
+    double denominator = (n * sumTT) - (sumT * sumT);
+
+    return (denominator > 0) ? (((n * sumTV) - (sumT * sumV)) / denominator) : 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether the values in the last quarter of a series all lie above those in the first
+ * quarter.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HasRisen
+(
+    const Series_t* seriesPtr
+)
+{
+    size_t quarter = seriesPtr->count / 4;
+
+    if (quarter == 0)
+    {
+        return false;
+    }
+
+    double firstMax = seriesPtr->valuesPtr[0];
+    double lastMin = seriesPtr->valuesPtr[seriesPtr->count - 1];
+
+    for (size_t i = 0; i < quarter; i++)
+    {
+        firstMax = fmax(firstMax, seriesPtr->valuesPtr[i]);
+        lastMin = fmin(lastMin, seriesPtr->valuesPtr[seriesPtr->count - 1 - i]);
+    }
+
+    return lastMin > firstMax;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Evaluate the trends, report, restore the sensor settings and exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Finish
+(
+    void
+)
+{
+    bool isFailed = false;
+
+    Restore();
+
+    for (size_t i = 0; i < NumProcs; i++)
+    {
+        const Proc_t* procPtr = &Procs[i];
+
+        for (Metric_t metric = 0; metric < NUM_METRICS; metric++)
+        {
+            const Series_t* seriesPtr = &procPtr->series[metric];
+            const char* verdict = "pass";
+            double slope = ComputeSlope(seriesPtr);
+
+            if (seriesPtr->count < 4)
+            {
+                verdict = "no_data";
+            }
+            else if ((slope > MaxGrowth[metric]) && HasRisen(seriesPtr))
+            {
+                verdict = "fail";
+                isFailed = true;
+            }
+
+            printf("{\"suite\":\"redSoak\",\"version\":%d,\"process\":\"%s\",\"metric\":\"%s\","
+                   "\"samples\":%zu,\"first\":%.0f,\"last\":%.0f,\"slope_per_hour\":%.3f,"
+                   "\"restarts\":%u,\"verdict\":\"%s\"}\n",
+                   RESULT_VERSION,
+                   procPtr->name,
+                   MetricNames[metric],
+                   seriesPtr->count,
+                   (seriesPtr->count > 0) ? seriesPtr->valuesPtr[0] : -1.0,
+                   (seriesPtr->count > 0) ? seriesPtr->valuesPtr[seriesPtr->count - 1] : -1.0,
+                   slope,
+                   procPtr->restarts,
+                   verdict);
+
+            if (strcmp(verdict, "fail") == 0)
+            {
+                LE_CRIT("'%s' %s is trending up (%.3f per hour).",
+                        procPtr->name,
+                        MetricNames[metric],
+                        slope);
+            }
+        }
+
+        if ((procPtr->restarts > 0) || (procPtr->pid == 0))
+        {
+            LE_CRIT("'%s' restarted or disappeared during the soak.", procPtr->name);
+            isFailed = true;
+        }
+    }
+
+    fflush(stdout);
+    fclose(CsvFile);
+
+    LE_INFO("Soak %s.", isFailed ? "FAILED" : "passed");
+
+    exit(isFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler.  Takes a sample and ends the soak when the time is up.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SampleTimerHandler
+(
+    le_timer_Ref_t timer
+)
+{
+    Sample();
+
+    if ((Now() - StartTime) >= (Hours * 3600.0))
+    {
+        Finish();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SIGTERM handler.  Ends the soak early, with a verdict on what has been sampled so far.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTerm
+(
+    int sigNum
+)
+{
+    LE_INFO("Soak stopped early.");
+    Finish();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Positional command-line argument handler.  Adds a process to monitor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddProc
+(
+    const char* name
+)
+{
+    LE_FATAL_IF(NumProcs >= MAX_PROCS, "Too many processes (max %d).", MAX_PROCS);
+
+    Procs[NumProcs++].name = name;
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetIntVar(&Hours, NULL, "hours");
+    le_arg_SetIntVar(&Interval, NULL, "interval");
+    le_arg_SetIntVar(&WarmupMinutes, NULL, "warmup");
+    le_arg_SetIntVar(&RateHz, NULL, "rate");
+    le_arg_SetStringVar(&CsvPath, NULL, "csv");
+    le_arg_SetIntVar(&MaxGrowth[METRIC_RSS], NULL, "max-rss-growth");
+    le_arg_SetIntVar(&MaxGrowth[METRIC_FDS], NULL, "max-fd-growth");
+    le_arg_SetIntVar(&MaxGrowth[METRIC_POOL], NULL, "max-pool-growth");
+    le_arg_AddPositionalCallback(AddProc);
+    le_arg_AllowMorePositionalArgsThanCallbacks();
+    le_arg_Scan();
+
+    LE_FATAL_IF((Hours <= 0) || (Interval <= 0) || (WarmupMinutes < 0) || (RateHz <= 0),
+                "Invalid soak parameters.");
+
+    if (NumProcs == 0)
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(DefaultProcs); i++)
+        {
+            AddProc(DefaultProcs[i]);
+        }
+    }
+
+    CsvFile = fopen(CsvPath, "w");
+    LE_FATAL_IF(CsvFile == NULL, "Couldn't open '%s' - %m", CsvPath);
+    fprintf(CsvFile, "seconds,process,pid,rss_kib,fds,pool_bytes\n");
+
+    le_sig_Block(SIGTERM);
+    le_sig_SetEventHandler(SIGTERM, HandleTerm);
+
+    Accelerate();
+
+    LE_INFO("Soaking for %d hours at %d Hz (warm-up %d minutes).", Hours, RateHz, WarmupMinutes);
+
+    StartTime = Now();
+    Sample();
+
+    SampleTimer = le_timer_Create("soakSample");
+    le_timer_SetHandler(SampleTimer, SampleTimerHandler);
+    le_timer_SetMsInterval(SampleTimer, (uint32_t)Interval * 1000);
+    le_timer_SetRepeat(SampleTimer, 0);
+    le_timer_Start(SampleTimer);
+}
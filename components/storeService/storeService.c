@@ -0,0 +1,589 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file storeService.c
+ *
+ * Keeps the sensor samples flowing through the Data Hub in an on-flash time-series store (see
+ * tsStore.h), one series per sensor, and serves queries on them (store.api).
+ *
+ * Each series gets its own Data Hub observation of the sensor's value input, without any
+ * filtering, so it holds every sample the sensor produced, independently of what redCloud
+ * buffers and uplinks.
+ *
+ * Configured with environment variables:
+ *
+ *  - STORE_DIR: directory the series are kept in (default /tmp/redStore).
+ *  - STORE_MAX_KB: size limit of each series, above which its oldest samples are deleted
+ *    (default 8192).
+ *  - STORE_FLUSH_INTERVAL: longest time (seconds) samples are kept in RAM before being written to
+ *    flash, even if their block isn't full (default 60).  Shorter loses less on a power cut, but
+ *    writes more, smaller blocks.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "tsStore.h"
+#include "sampleCodec.h"
+
+
+#define DEFAULT_STORE_DIR "/tmp/redStore"
+#define DEFAULT_MAX_KB 8192
+#define DEFAULT_FLUSH_INTERVAL 60 // seconds
+
+
+/// A stored sensor.
+typedef struct
+{
+    const char* name;                           ///< Series name.
+    const char* sourcePath;                     ///< Data Hub sensor value input.
+    const char* obsPath;                        ///< Data Hub observation feeding the series.
+    bool isJson;                                ///< true if the samples are JSON.
+    size_t numColumns;
+    const char* columns[TSS_MAX_COLUMNS];       ///< JSON member names, or "value".
+    tss_Series_t* seriesPtr;
+    uint64_t rejected;                          ///< Samples that couldn't be stored.
+}
+Series_t;
+
+
+static Series_t Series[] =
+{
+    {
+        .name="accel",
+        .sourcePath="/app/redSensor/accel/value",
+        .obsPath="/obs/storeAccel",
+        .isJson=true,
+        .numColumns=3,
+        .columns={ "x", "y", "z" },
+    },
+    {
+        .name="gyro",
+        .sourcePath="/app/redSensor/gyro/value",
+        .obsPath="/obs/storeGyro",
+        .isJson=true,
+        .numColumns=3,
+        .columns={ "x", "y", "z" },
+    },
+    {
+        .name="light",
+        .sourcePath="/app/redSensor/light/value",
+        .obsPath="/obs/storeLight",
+        .isJson=false,
+        .numColumns=1,
+        .columns={ "value" },
+    },
+    {
+        .name="pressure",
+        .sourcePath="/app/redSensor/pressure/value",
+        .obsPath="/obs/storePressure",
+        .isJson=false,
+        .numColumns=1,
+        .columns={ "value" },
+    },
+    {
+        .name="temperature",
+        .sourcePath="/app/redSensor/pressure/temp/value",
+        .obsPath="/obs/storeTemperature",
+        .isJson=false,
+        .numColumns=1,
+        .columns={ "value" },
+    },
+    {
+        .name="imuTemp",
+        .sourcePath="/app/redSensor/imu/temp/value",
+        .obsPath="/obs/storeImuTemp",
+        .isJson=false,
+        .numColumns=1,
+        .columns={ "value" },
+    },
+    {
+        .name="position",
+        .sourcePath="/app/redSensor/position/value",
+        .obsPath="/obs/storePosition",
+        .isJson=true,
+        .numColumns=5,
+        .columns={ "lat", "lon", "hAcc", "alt", "vAcc" },
+    },
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a sample to a series.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Store
+(
+    Series_t* seriesPtr,
+    double timestamp,
+    const double values[]
+)
+{
+    le_result_t result = tss_Append(seriesPtr->seriesPtr, timestamp, values);
+
+    if (result == LE_OUT_OF_RANGE)
+    {
+        LE_DEBUG("Sample from '%s' older than the newest stored. Skipped.", seriesPtr->sourcePath);
+        seriesPtr->rejected++;
+    }
+    else if (result != LE_OK)
+    {
+        LE_ERROR("Failed to store samples from '%s' (%s).",
+                 seriesPtr->sourcePath,
+                 LE_RESULT_TXT(result));
+        seriesPtr->rejected++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Series_t
+)
+{
+    Store(contextPtr, timestamp, &value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a JSON observation receives an update.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleJsonUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Series_t
+)
+{
+    Series_t* seriesPtr = contextPtr;
+    double values[TSS_MAX_COLUMNS];
+
+    for (size_t c = 0; c < seriesPtr->numColumns; c++)
+    {
+        values[c] = codec_ExtractNumber(value, seriesPtr->columns[c]);
+        if (isnan(values[c]))
+        {
+            LE_ERROR("Malformed sample from '%s'. Skipped.", seriesPtr->sourcePath);
+            seriesPtr->rejected++;
+            return;
+        }
+    }
+
+    Store(seriesPtr, timestamp, values);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write every series' open block to flash.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FlushAll
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Series); i++)
+    {
+        le_result_t result = tss_Flush(Series[i].seriesPtr);
+        if (result != LE_OK)
+        {
+            LE_ERROR("Failed to flush '%s' (%s).", Series[i].name, LE_RESULT_TXT(result));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush timer expiry handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFlushTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    FlushAll();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush the store, then exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTerm
+(
+    int sigNum
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Series); i++)
+    {
+        tss_Close(Series[i].seriesPtr);
+
+        if (Series[i].rejected > 0)
+        {
+            LE_INFO("%" PRIu64 " samples from '%s' couldn't be stored.",
+                    Series[i].rejected,
+                    Series[i].sourcePath);
+        }
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a series by name.
+ *
+ * @return The series, or NULL if not found.
+ */
+//--------------------------------------------------------------------------------------------------
+static Series_t* FindSeries
+(
+    const char* name
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Series); i++)
+    {
+        if (strcmp(Series[i].name, name) == 0)
+        {
+            return &Series[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/// Where a query's samples are collected.
+typedef struct
+{
+    double* timestampsPtr;
+    double* valuesPtr;
+    size_t numColumns;
+    size_t capacity;        ///< Most samples that fit.
+    size_t count;
+}
+QueryResult_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a scanned sample to a query's result.
+ *
+ * @return true until the result is full.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool CollectSample
+(
+    double timestamp,
+    const double values[],
+    void* contextPtr    ///< QueryResult_t
+)
+{
+    QueryResult_t* resultPtr = contextPtr;
+
+    resultPtr->timestampsPtr[resultPtr->count] = timestamp;
+    memcpy(resultPtr->valuesPtr + (resultPtr->count * resultPtr->numColumns),
+           values,
+           resultPtr->numColumns * sizeof(double));
+    resultPtr->count++;
+
+    return (resultPtr->count < resultPtr->capacity);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Prepare to collect a query's result in the caller's arrays.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitQueryResult
+(
+    QueryResult_t* resultPtr,
+    const Series_t* seriesPtr,
+    double* timestampsPtr,
+    size_t timestampsSize,
+    double* valuesPtr,
+    size_t valuesSize
+)
+{
+    resultPtr->timestampsPtr = timestampsPtr;
+    resultPtr->valuesPtr = valuesPtr;
+    resultPtr->numColumns = seriesPtr->numColumns;
+    resultPtr->capacity = valuesSize / seriesPtr->numColumns;
+    if (resultPtr->capacity > timestampsSize)
+    {
+        resultPtr->capacity = timestampsSize;
+    }
+    resultPtr->count = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a series' columns, number of samples and time range.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_NOT_FOUND if there is no such series.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t store_GetInfo
+(
+    const char* series,
+    char* columns,
+    size_t columnsSize,
+    uint64_t* countPtr,
+    double* oldestPtr,
+    double* newestPtr
+)
+{
+    Series_t* seriesPtr = FindSeries(series);
+    size_t numColumns;
+
+    if (seriesPtr == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    tss_GetInfo(seriesPtr->seriesPtr, &numColumns, countPtr, oldestPtr, newestPtr);
+
+    size_t len = 0;
+    columns[0] = '\0';
+    for (size_t c = 0; c < numColumns; c++)
+    {
+        len += snprintf(columns + len,
+                        (len < columnsSize) ? (columnsSize - len) : 0,
+                        (c == 0) ? "%s" : ",%s",
+                        seriesPtr->columns[c]);
+    }
+    LE_ASSERT(len < columnsSize);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the oldest samples (or bucket means) with timestamps after one time and up to and including
+ * another.
+ *
+ * @return
+ *  - LE_OK if successful (even if no samples were found)
+ *  - LE_NOT_FOUND if there is no such series.
+ *  - LE_FAULT if the store couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t store_Query
+(
+    const char* series,
+    double after,
+    double until,
+    double interval,
+    double* timestampsPtr,
+    size_t* timestampsSizePtr,
+    double* valuesPtr,
+    size_t* valuesSizePtr
+)
+{
+    Series_t* seriesPtr = FindSeries(series);
+    QueryResult_t queryResult;
+    le_result_t result;
+
+    if (seriesPtr == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    InitQueryResult(&queryResult,
+                    seriesPtr,
+                    timestampsPtr,
+                    *timestampsSizePtr,
+                    valuesPtr,
+                    *valuesSizePtr);
+
+    if (queryResult.capacity == 0)
+    {
+        result = LE_OK;
+    }
+    else if (interval > 0.0)
+    {
+        result = tss_ScanDownsampled(seriesPtr->seriesPtr,
+                                     after,
+                                     until,
+                                     interval,
+                                     CollectSample,
+                                     &queryResult);
+    }
+    else
+    {
+        result = tss_Scan(seriesPtr->seriesPtr, after, until, CollectSample, &queryResult);
+    }
+
+    *timestampsSizePtr = queryResult.count;
+    *valuesSizePtr = queryResult.count * queryResult.numColumns;
+
+    return (result == LE_OK) ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the newest samples.
+ *
+ * @return
+ *  - LE_OK if successful (even if no samples were found)
+ *  - LE_NOT_FOUND if there is no such series.
+ *  - LE_FAULT if the store couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t store_QueryLatest
+(
+    const char* series,
+    uint32_t count,
+    double* timestampsPtr,
+    size_t* timestampsSizePtr,
+    double* valuesPtr,
+    size_t* valuesSizePtr
+)
+{
+    Series_t* seriesPtr = FindSeries(series);
+    QueryResult_t queryResult;
+    le_result_t result = LE_OK;
+
+    if (seriesPtr == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    InitQueryResult(&queryResult,
+                    seriesPtr,
+                    timestampsPtr,
+                    *timestampsSizePtr,
+                    valuesPtr,
+                    *valuesSizePtr);
+
+    if (count > queryResult.capacity)
+    {
+        count = queryResult.capacity;
+    }
+
+    if (count > 0)
+    {
+        result = tss_ScanLatest(seriesPtr->seriesPtr, count, CollectSample, &queryResult);
+    }
+
+    *timestampsSizePtr = queryResult.count;
+    *valuesSizePtr = queryResult.count * queryResult.numColumns;
+
+    return (result == LE_OK) ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer configuration value from an environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetEnvInt
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* valueStr = getenv(name);
+
+    if (valueStr == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(valueStr, &endPtr, 10);
+    LE_FATAL_IF((*valueStr == '\0') || (*endPtr != '\0') || (value <= 0) || (value > INT_MAX),
+                "Invalid %s '%s'.",
+                name,
+                valueStr);
+
+    return (int)value;
+}
+
+
+COMPONENT_INIT
+{
+    const char* dirPath = getenv("STORE_DIR");
+    if (dirPath == NULL)
+    {
+        dirPath = DEFAULT_STORE_DIR;
+    }
+    size_t maxBytes = (size_t)GetEnvInt("STORE_MAX_KB", DEFAULT_MAX_KB) * 1024;
+    int flushInterval = GetEnvInt("STORE_FLUSH_INTERVAL", DEFAULT_FLUSH_INTERVAL);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Series); i++)
+    {
+        Series_t* seriesPtr = &Series[i];
+
+        le_result_t result = tss_Open(dirPath,
+                                      seriesPtr->name,
+                                      seriesPtr->numColumns,
+                                      maxBytes,
+                                      &seriesPtr->seriesPtr);
+        LE_FATAL_IF(result != LE_OK,
+                    "Couldn't open series '%s' in '%s' (%s).",
+                    seriesPtr->name,
+                    dirPath,
+                    LE_RESULT_TXT(result));
+    }
+
+    le_sig_Block(SIGTERM);
+    le_sig_SetEventHandler(SIGTERM, HandleTerm);
+
+    le_timer_Ref_t flushTimer = le_timer_Create("StoreFlush");
+    le_timer_SetHandler(flushTimer, HandleFlushTimer);
+    le_timer_SetMsInterval(flushTimer, (uint32_t)flushInterval * 1000);
+    le_timer_SetRepeat(flushTimer, 0);
+    le_timer_Start(flushTimer);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Series); i++)
+    {
+        Series_t* seriesPtr = &Series[i];
+
+        le_result_t result = dhubAdmin_CreateObs(seriesPtr->obsPath);
+        if ((result != LE_OK) && (result != LE_DUPLICATE))
+        {
+            LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
+                     seriesPtr->obsPath,
+                     LE_RESULT_TXT(result));
+        }
+
+        if (seriesPtr->isJson)
+        {
+            dhubAdmin_AddJsonPushHandler(seriesPtr->obsPath, HandleJsonUpdate, seriesPtr);
+        }
+        else
+        {
+            dhubAdmin_AddNumericPushHandler(seriesPtr->obsPath, HandleNumericUpdate, seriesPtr);
+        }
+
+        dhubAdmin_SetSource(seriesPtr->obsPath, seriesPtr->sourcePath);
+    }
+
+    LE_INFO("Storing sensor history in '%s' (%zu KiB per sensor).", dirPath, maxBytes / 1024);
+}
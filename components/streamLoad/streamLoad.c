@@ -0,0 +1,699 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file streamLoad.c
+ *
+ * Load test for redSensor's local sensor streaming server (see streamServer.h).
+ *
+ * Usage: streamload [--clients=N] [--slow=N] [--slow-rate=BYTES_PER_S] [--duration=S]
+ *                   [--rate=HZ] [--socket=PATH | --port=N] [--server=NAME] [--output=FILE]
+ *
+ * For the duration of the test (default 60 s), the accelerometer and gyro periods are set to
+ * 1 / rate (default 500 Hz each, so 1 kHz aggregate), and restored afterwards (--rate=0 leaves
+ * them alone).  Off-target, run it with the redMock app so the sensors read the mock driver tree.
+ *
+ * --clients (default 4) clients connect to the server's TCP port (default 5760 on 127.0.0.1) or
+ * Unix socket.  The first --slow of them (default 1) read at most --slow-rate bytes per second
+ * (default 2000), far slower than the stream, so their queues overflow: the server must drop
+ * their oldest samples without holding up the other clients.
+ *
+ * At the end, one JSON object per client, plus one for all clients, is output, for example:
+ *
+ * {"suite":"redStream","version":1,"client":"1","kind":"fast","records":59940,
+ *  "records_per_s":999.0,"blocks":5995,"drops":0,"out_of_order":0,"mean_latency_ms":5.4,
+ *  "max_latency_ms":12.8}
+ *
+ * {"suite":"redStream","version":1,"client":"all","clients":4,"records":182180,
+ *  "records_per_s":3036.3,"server_cpu_pct":6.2,"load_cpu_pct":1.1}
+ *
+ *  - drops: samples the server dropped for the client (from the last block header received).
+ *  - out_of_order: samples older than the previous sample of the same channel.
+ *  - latency: time from a sample being taken to the client receiving it.
+ *  - server_cpu_pct: CPU time used by the server process (--server, default redSensor) during the
+ *    test, as a percentage of one core, or null if the process wasn't found.
+ *
+ * Results go to stdout, and are also appended to the output file if one is given.  The process
+ * exits with EXIT_FAILURE if a fast client had samples dropped or out of order, or lost its
+ * connection.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "streamServer.h"
+
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/// Version of the result record format.
+#define RESULT_VERSION 1
+
+#define MAX_CLIENTS 8
+
+/// Interval at which slow clients read.
+#define SLOW_READ_INTERVAL_MS 100
+
+#define RX_BUFFER_BYTES (64 * 1024)
+
+/// Socket receive buffer size for slow clients, so the backlog builds up in the server's queue
+/// rather than in the kernel.
+#define SLOW_SOCKET_BUFFER_BYTES 4096
+
+/// Sensors whose period is set from --rate.
+static const char* const RatePaths[] =
+{
+    "/app/redSensor/accel/period",
+    "/app/redSensor/gyro/period",
+};
+
+
+/// A stream client.
+typedef struct
+{
+    int fd;
+    le_fdMonitor_Ref_t monitor;     ///< NULL for slow clients, which read on a timer.
+    bool isSlow;
+    bool isClosed;                  ///< The server closed the connection.
+    bool isHeaderSeen;
+    uint64_t records;
+    uint64_t blocks;
+    uint64_t drops;
+    uint64_t outOfOrder;
+    double lastTimestamps[STREAM_NUM_CHANNELS];
+    double latencySum;              ///< seconds
+    double maxLatency;              ///< seconds
+    size_t len;                     ///< Bytes in buff.
+    uint8_t buff[RX_BUFFER_BYTES];
+}
+Client_t;
+
+
+static int NumClients = 4;
+static int NumSlow = 1;
+static int SlowRate = 2000;
+static int Duration = 60;
+static int Rate = 500;
+static const char* SocketPath = NULL;
+static int Port = 5760;
+static const char* ServerName = "redSensor";
+static const char* OutputPath = NULL;
+static FILE* OutputFile = NULL;
+
+static Client_t Clients[MAX_CLIENTS];
+
+static double SavedPeriods[NUM_ARRAY_MEMBERS(RatePaths)];
+static bool IsPeriodSaved[NUM_ARRAY_MEMBERS(RatePaths)];
+
+static pid_t ServerPid = 0;
+static double ServerCpuAtStart;     ///< seconds
+static double LoadCpuAtStart;       ///< seconds
+static le_clk_Time_t StartTime;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time in seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return now.sec + (now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the PID of a process by name.
+ *
+ * @return The PID, or 0 if not found.
+ */
+//--------------------------------------------------------------------------------------------------
+static pid_t FindPid
+(
+    const char* name
+)
+{
+    pid_t result = 0;
+    DIR* dir = opendir("/proc");
+    LE_FATAL_IF(dir == NULL, "Couldn't open /proc - %m");
+
+    struct dirent* entryPtr;
+    while ((result == 0) && ((entryPtr = readdir(dir)) != NULL))
+    {
+        char* endPtr;
+        long pid = strtol(entryPtr->d_name, &endPtr, 10);
+        char path[64];
+        char comm[32] = "";
+
+        if ((*endPtr != '\0') || (pid <= 0))
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%ld/comm", pid);
+        FILE* f = fopen(path, "r");
+        if (f != NULL)
+        {
+            if (fgets(comm, sizeof(comm), f) != NULL)
+            {
+                comm[strcspn(comm, "\n")] = '\0';
+
+                // The kernel truncates names to 15 characters.
+                if (strncmp(comm, name, 15) == 0)
+                {
+                    result = (pid_t)pid;
+                }
+            }
+            fclose(f);
+        }
+    }
+
+    closedir(dir);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the CPU time (user + system) a process has used.
+ *
+ * @return Seconds, or -1 if it couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ReadProcessCpu
+(
+    pid_t pid
+)
+{
+    char path[64];
+    char line[1024];
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1.0;
+    }
+
+    bool isRead = (fgets(line, sizeof(line), f) != NULL);
+    fclose(f);
+
+    // The command name (field 2) may contain spaces, so count fields from the closing ')'.
+    char* p = isRead ? strrchr(line, ')') : NULL;
+    unsigned long utime;
+    unsigned long stime;
+
+    if ((p == NULL) || (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                               &utime, &stime) != 2))
+    {
+        return -1.0;
+    }
+
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the CPU time (user + system) this process has used.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double ReadOwnCpu
+(
+    void
+)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + (usage.ru_utime.tv_usec / 1000000.0)
+           + usage.ru_stime.tv_sec + (usage.ru_stime.tv_usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the accelerometer and gyro periods from the rate, saving the current ones.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetPeriods
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(RatePaths); i++)
+    {
+        double timestamp;
+
+        IsPeriodSaved[i] = (dhubQuery_GetNumeric(RatePaths[i], &timestamp, &SavedPeriods[i])
+                            == LE_OK);
+
+        dhubAdmin_PushNumeric(RatePaths[i], 0.0, 1.0 / Rate);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Put the accelerometer and gyro periods back the way they were.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RestorePeriods
+(
+    void
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(RatePaths); i++)
+    {
+        if (IsPeriodSaved[i])
+        {
+            dhubAdmin_PushNumeric(RatePaths[i], 0.0, SavedPeriods[i]);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for the complete blocks in a client's buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Parse
+(
+    Client_t* clientPtr
+)
+{
+    size_t offset = 0;
+    double now = Now();
+
+    if (!clientPtr->isHeaderSeen)
+    {
+        uint8_t magic[4];
+        uint16_t version;
+        uint16_t recordSize;
+
+        if (clientPtr->len < 8)
+        {
+            return;
+        }
+
+        memcpy(magic, clientPtr->buff, sizeof(magic));
+        memcpy(&version, clientPtr->buff + 4, sizeof(version));
+        memcpy(&recordSize, clientPtr->buff + 6, sizeof(recordSize));
+
+        LE_FATAL_IF(   (memcmp(magic, "RSST", 4) != 0)
+                    || (version != STREAM_VERSION)
+                    || (recordSize != sizeof(stream_Record_t)),
+                    "Not a version %d sensor stream.",
+                    STREAM_VERSION);
+
+        clientPtr->isHeaderSeen = true;
+        offset = 8;
+    }
+
+    for (;;)
+    {
+        uint32_t numRecords;
+        uint64_t drops;
+
+        if ((clientPtr->len - offset) < 16)
+        {
+            break;
+        }
+
+        memcpy(&numRecords, clientPtr->buff + offset, sizeof(numRecords));
+        memcpy(&drops, clientPtr->buff + offset + 8, sizeof(drops));
+
+        size_t blockLen = 16 + ((size_t)numRecords * sizeof(stream_Record_t));
+        LE_FATAL_IF(blockLen > sizeof(clientPtr->buff), "Block of %u records too big.", numRecords);
+
+        if ((clientPtr->len - offset) < blockLen)
+        {
+            break;
+        }
+
+        for (uint32_t i = 0; i < numRecords; i++)
+        {
+            stream_Record_t record;
+            memcpy(&record,
+                   clientPtr->buff + offset + 16 + (i * sizeof(record)),
+                   sizeof(record));
+
+            if (record.channel < STREAM_NUM_CHANNELS)
+            {
+                if (record.timestamp < clientPtr->lastTimestamps[record.channel])
+                {
+                    clientPtr->outOfOrder++;
+                }
+                clientPtr->lastTimestamps[record.channel] = record.timestamp;
+            }
+
+            double latency = now - record.timestamp;
+            clientPtr->latencySum += latency;
+            if (latency > clientPtr->maxLatency)
+            {
+                clientPtr->maxLatency = latency;
+            }
+        }
+
+        clientPtr->records += numRecords;
+        clientPtr->blocks++;
+        clientPtr->drops = drops;
+        offset += blockLen;
+    }
+
+    clientPtr->len -= offset;
+    memmove(clientPtr->buff, clientPtr->buff + offset, clientPtr->len);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read up to a number of bytes from a client's socket (without blocking) and account for them.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Read
+(
+    Client_t* clientPtr,
+    size_t maxBytes
+)
+{
+    while ((maxBytes > 0) && !clientPtr->isClosed)
+    {
+        size_t room = sizeof(clientPtr->buff) - clientPtr->len;
+        ssize_t n = recv(clientPtr->fd,
+                         clientPtr->buff + clientPtr->len,
+                         (room < maxBytes) ? room : maxBytes,
+                         MSG_DONTWAIT);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                LE_ERROR("Stream read failed - %m");
+                clientPtr->isClosed = true;
+            }
+            break;
+        }
+        if (n == 0)
+        {
+            LE_ERROR("Server closed the stream.");
+            clientPtr->isClosed = true;
+            break;
+        }
+
+        clientPtr->len += n;
+        maxBytes -= n;
+        Parse(clientPtr);
+    }
+
+    if (clientPtr->isClosed && (clientPtr->monitor != NULL))
+    {
+        le_fdMonitor_Delete(clientPtr->monitor);
+        clientPtr->monitor = NULL;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a fast client's socket becoming readable.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFastClient
+(
+    int fd,
+    short events
+)
+{
+    Read(le_fdMonitor_GetContextPtr(), SIZE_MAX);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Slow client read timer expiry handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSlowTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    size_t maxBytes = ((size_t)SlowRate * SLOW_READ_INTERVAL_MS) / 1000;
+
+    for (int i = 0; i < NumSlow; i++)
+    {
+        Read(&Clients[i], maxBytes);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect to the server.  Slow clients get a small receive buffer.
+ *
+ * @return The socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static int Connect
+(
+    bool isSlow
+)
+{
+    int fd;
+    int result;
+    int bufferSize = SLOW_SOCKET_BUFFER_BYTES;
+
+    if (SocketPath != NULL)
+    {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+        LE_FATAL_IF(strlen(SocketPath) >= sizeof(addr.sun_path), "Socket path too long.");
+        strcpy(addr.sun_path, SocketPath);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        LE_FATAL_IF(fd < 0, "Couldn't create socket - %m");
+        if (isSlow)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        }
+        result = connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+    }
+    else
+    {
+        struct sockaddr_in addr =
+        {
+            .sin_family = AF_INET,
+            .sin_port = htons(Port),
+            .sin_addr = { .s_addr = htonl(INADDR_LOOPBACK) },
+        };
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        LE_FATAL_IF(fd < 0, "Couldn't create socket - %m");
+        if (isSlow)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        }
+        result = connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+    }
+
+    LE_FATAL_IF(result != 0, "Couldn't connect to the sensor stream - %m");
+
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a result line to stdout and the output file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Report
+(
+    const char* line
+)
+{
+    fprintf(stdout, "%s\n", line);
+    fflush(stdout);
+
+    if (OutputFile != NULL)
+    {
+        fprintf(OutputFile, "%s\n", line);
+        fflush(OutputFile);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * End of test timer expiry handler: report the results and exit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleEndTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    le_clk_Time_t elapsedTime = le_clk_Sub(le_clk_GetRelativeTime(), StartTime);
+    double elapsed = elapsedTime.sec + (elapsedTime.usec / 1000000.0);
+    double loadCpu = ReadOwnCpu() - LoadCpuAtStart;
+    double serverCpu = (ServerPid != 0) ? ReadProcessCpu(ServerPid) : -1.0;
+    uint64_t totalRecords = 0;
+    bool isFailed = false;
+    char line[512];
+
+    if (Rate > 0)
+    {
+        RestorePeriods();
+    }
+
+    for (int i = 0; i < NumClients; i++)
+    {
+        const Client_t* clientPtr = &Clients[i];
+
+        snprintf(line,
+                 sizeof(line),
+                 "{\"suite\":\"redStream\",\"version\":%d,\"client\":\"%d\",\"kind\":\"%s\","
+                 "\"records\":%" PRIu64 ",\"records_per_s\":%.1f,\"blocks\":%" PRIu64 ","
+                 "\"drops\":%" PRIu64 ",\"out_of_order\":%" PRIu64 ",\"mean_latency_ms\":%.1f,"
+                 "\"max_latency_ms\":%.1f}",
+                 RESULT_VERSION,
+                 i,
+                 clientPtr->isSlow ? "slow" : "fast",
+                 clientPtr->records,
+                 clientPtr->records / elapsed,
+                 clientPtr->blocks,
+                 clientPtr->drops,
+                 clientPtr->outOfOrder,
+                 (clientPtr->records > 0)
+                     ? (clientPtr->latencySum * 1000.0 / clientPtr->records) : 0.0,
+                 clientPtr->maxLatency * 1000.0);
+        Report(line);
+
+        totalRecords += clientPtr->records;
+
+        if (   (!clientPtr->isSlow)
+            && (clientPtr->isClosed || (clientPtr->drops > 0) || (clientPtr->outOfOrder > 0)))
+        {
+            isFailed = true;
+        }
+    }
+
+    char serverCpuText[32] = "null";
+    if ((ServerPid != 0) && (serverCpu >= 0.0) && (ServerCpuAtStart >= 0.0))
+    {
+        snprintf(serverCpuText,
+                 sizeof(serverCpuText),
+                 "%.1f",
+                 (serverCpu - ServerCpuAtStart) * 100.0 / elapsed);
+    }
+
+    snprintf(line,
+             sizeof(line),
+             "{\"suite\":\"redStream\",\"version\":%d,\"client\":\"all\",\"clients\":%d,"
+             "\"records\":%" PRIu64 ",\"records_per_s\":%.1f,\"server_cpu_pct\":%s,"
+             "\"load_cpu_pct\":%.1f}",
+             RESULT_VERSION,
+             NumClients,
+             totalRecords,
+             totalRecords / elapsed,
+             serverCpuText,
+             loadCpu * 100.0 / elapsed);
+    Report(line);
+
+    exit(isFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetIntVar(&NumClients, NULL, "clients");
+    le_arg_SetIntVar(&NumSlow, NULL, "slow");
+    le_arg_SetIntVar(&SlowRate, NULL, "slow-rate");
+    le_arg_SetIntVar(&Duration, NULL, "duration");
+    le_arg_SetIntVar(&Rate, NULL, "rate");
+    le_arg_SetStringVar(&SocketPath, NULL, "socket");
+    le_arg_SetIntVar(&Port, NULL, "port");
+    le_arg_SetStringVar(&ServerName, NULL, "server");
+    le_arg_SetStringVar(&OutputPath, NULL, "output");
+    le_arg_Scan();
+
+    LE_FATAL_IF((NumClients <= 0) || (NumClients > MAX_CLIENTS) || (NumSlow < 0)
+                || (NumSlow > NumClients) || (SlowRate <= 0) || (Duration <= 0) || (Rate < 0),
+                "Invalid load test parameters.");
+
+    if (OutputPath != NULL)
+    {
+        OutputFile = fopen(OutputPath, "a");
+        LE_FATAL_IF(OutputFile == NULL, "Couldn't open '%s' - %m", OutputPath);
+    }
+
+    if (Rate > 0)
+    {
+        SetPeriods();
+    }
+
+    for (int i = 0; i < NumClients; i++)
+    {
+        Client_t* clientPtr = &Clients[i];
+
+        clientPtr->isSlow = (i < NumSlow);
+        clientPtr->fd = Connect(clientPtr->isSlow);
+
+        if (!clientPtr->isSlow)
+        {
+            clientPtr->monitor = le_fdMonitor_Create("streamClient",
+                                                     clientPtr->fd,
+                                                     HandleFastClient,
+                                                     POLLIN);
+            le_fdMonitor_SetContextPtr(clientPtr->monitor, clientPtr);
+        }
+    }
+
+    if (NumSlow > 0)
+    {
+        le_timer_Ref_t slowTimer = le_timer_Create("SlowClients");
+        le_timer_SetHandler(slowTimer, HandleSlowTimer);
+        le_timer_SetMsInterval(slowTimer, SLOW_READ_INTERVAL_MS);
+        le_timer_SetRepeat(slowTimer, 0);
+        le_timer_Start(slowTimer);
+    }
+
+    ServerPid = FindPid(ServerName);
+    if (ServerPid == 0)
+    {
+        LE_WARN("Server process '%s' not found; its CPU use won't be reported.", ServerName);
+    }
+    else
+    {
+        ServerCpuAtStart = ReadProcessCpu(ServerPid);
+    }
+    LoadCpuAtStart = ReadOwnCpu();
+    StartTime = le_clk_GetRelativeTime();
+
+    le_timer_Ref_t endTimer = le_timer_Create("EndOfTest");
+    le_timer_SetHandler(endTimer, HandleEndTimer);
+    le_timer_SetMsInterval(endTimer, (uint32_t)Duration * 1000);
+    le_timer_Start(endTimer);
+}
@@ -0,0 +1,1852 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file tsStore.c
+ *
+ * On-flash time-series store (see tsStore.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "tsStore.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+
+
+#define SEGMENT_MAGIC "RTSS"
+#define SEGMENT_HEADER_BYTES 8
+
+#define SEGMENT_NAME_FORMAT "%08" PRIu32 ".rts"
+#define MAX_PATH_BYTES 256
+
+/// Longest segment file path: the series' directory, a slash and the longest segment name.
+#define MAX_SEGMENT_PATH_BYTES (MAX_PATH_BYTES + sizeof("/4294967295.rts"))
+
+/// A series is split into about this many segments, so deleting the oldest one loses only a small
+/// part of its history.
+#define SEGMENTS_PER_SERIES 8
+
+#define MIN_SEGMENT_BYTES (64 * 1024)
+
+/// Largest encoding of a block's timestamps or of one of its columns: a varint is at most 10
+/// bytes, and an XOR-encoded value at most 77 bits.
+#define SECTION_CAPACITY ((TSS_BLOCK_SAMPLES * 10) + 16)
+
+/// Largest block payload.
+#define MAX_PAYLOAD_BYTES(numColumns) \
+    (((numColumns) + 1) * (sizeof(uint32_t) + SECTION_CAPACITY))
+
+#define NO_WINDOW 0xFF
+
+
+/// Block header, as stored.
+typedef struct
+{
+    uint32_t payloadBytes;
+    uint16_t count;
+    uint16_t reserved;
+    int64_t firstUs;
+    int64_t lastUs;
+    uint32_t crc;
+    uint32_t reserved2;
+}
+BlockHeader_t;
+
+/// Sparse index entry: where a stored block is and what it covers.
+typedef struct
+{
+    int64_t firstUs;
+    int64_t lastUs;
+    uint32_t segment;       ///< Segment number.
+    uint32_t offset;        ///< Offset of the block header in the segment.
+    uint32_t count;
+}
+IndexEntry_t;
+
+/// A segment file.
+typedef struct
+{
+    uint32_t number;
+    size_t bytes;
+}
+Segment_t;
+
+/// Encoder of one column of the open block.
+typedef struct
+{
+    uint8_t* buffPtr;       ///< SECTION_CAPACITY bytes, zeroed when the block is started.
+    size_t bitPos;
+    uint64_t prevBits;
+    uint8_t prevLeading;    ///< NO_WINDOW if no XOR window has been written yet.
+    uint8_t prevTrailing;
+}
+ColumnEncoder_t;
+
+/// Decoder of one column of a block.
+typedef struct
+{
+    const uint8_t* buffPtr;
+    size_t len;
+    size_t bitPos;
+    uint64_t prevBits;
+    uint8_t prevLeading;
+    uint8_t prevTrailing;
+}
+ColumnDecoder_t;
+
+struct tss_Series
+{
+    char path[MAX_PATH_BYTES];          ///< The series' directory.
+    size_t numColumns;
+    size_t maxBytes;
+    size_t segmentBytes;
+
+    // Stored blocks.
+    IndexEntry_t* indexPtr;
+    size_t indexCount;
+    size_t indexCapacity;
+    uint64_t storedCount;               ///< Samples in the stored blocks.
+    Segment_t* segmentsPtr;             ///< Oldest first.
+    size_t numSegments;
+    size_t segmentsCapacity;
+    size_t totalBytes;
+    int writeFd;                        ///< The newest segment, or -1 if not open yet.
+    int readFd;                         ///< Segment last read from, or -1.
+    uint32_t readSegment;
+
+    // Open block.
+    size_t openCount;
+    int64_t openFirstUs;
+    int64_t openLastUs;
+    int64_t prevDeltaUs;
+    uint8_t* tsBuffPtr;                 ///< SECTION_CAPACITY bytes.
+    size_t tsLen;
+    ColumnEncoder_t columns[TSS_MAX_COLUMNS];
+
+    // Scratch space for writing and decoding blocks.
+    uint8_t* blockBuffPtr;              ///< Block header and largest payload.
+    int64_t* decodedUsPtr;              ///< TSS_BLOCK_SAMPLES timestamps.
+    double* decodedValuesPtr;           ///< TSS_BLOCK_SAMPLES rows of numColumns values.
+
+    // Stored block in the decoded arrays, so paged queries don't decode it again for each page.
+    bool isDecodedStored;
+    uint32_t decodedSegment;
+    uint32_t decodedOffset;
+};
+
+
+/// Function called for each sample found by an internal scan.
+typedef bool (*SampleUsFunc_t)(int64_t timeUs, const double values[], void* contextPtr);
+
+/// Downsampling state.
+typedef struct
+{
+    int64_t intervalUs;
+    int64_t bucketEndUs;                ///< End of the bucket being accumulated, or 0 if none.
+    size_t count;
+    double sums[TSS_MAX_COLUMNS];
+    size_t numColumns;
+    tss_SampleFunc_t func;
+    void* contextPtr;
+    bool isStopped;
+}
+Downsampler_t;
+
+/// Adapter from the internal scan to a tss_SampleFunc_t.
+typedef struct
+{
+    tss_SampleFunc_t func;
+    void* contextPtr;
+}
+ScanAdapter_t;
+
+
+static uint32_t CrcTable[256];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the CRC-32 (IEEE 802.3) lookup table.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitCrcTable
+(
+    void
+)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+        }
+        CrcTable[i] = crc;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the CRC-32 of a buffer.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t Crc32
+(
+    const uint8_t* buffPtr,
+    size_t len
+)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = CrcTable[(crc ^ buffPtr[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a timestamp to microseconds, saturating at the int64 range (e.g., for +/- infinity).
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t ToUs
+(
+    double timestamp
+)
+{
+    if (timestamp >= 9.0e12)
+    {
+        return INT64_MAX;
+    }
+    if (timestamp <= -9.0e12)
+    {
+        return INT64_MIN;
+    }
+
+    return llround(timestamp * 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert microseconds to a timestamp.
+ */
+//--------------------------------------------------------------------------------------------------
+static double FromUs
+(
+    int64_t timeUs
+)
+{
+    return timeUs / 1000000.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the low bits of a value to a bit stream, most significant first.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteBits
+(
+    uint8_t* buffPtr,
+    size_t* bitPosPtr,
+    uint64_t value,
+    unsigned int numBits    ///< 1 to 64
+)
+{
+    size_t bitPos = *bitPosPtr;
+
+    while (numBits > 0)
+    {
+        unsigned int room = 8 - (bitPos % 8);
+        unsigned int n = (numBits < room) ? numBits : room;
+        uint8_t bits = (uint8_t)((value >> (numBits - n)) & ((1u << n) - 1));
+
+        buffPtr[bitPos / 8] |= (uint8_t)(bits << (room - n));
+        bitPos += n;
+        numBits -= n;
+    }
+
+    *bitPosPtr = bitPos;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read bits from a bit stream, most significant first.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if the stream ends first.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadBits
+(
+    ColumnDecoder_t* decoderPtr,
+    unsigned int numBits,   ///< 1 to 64
+    uint64_t* valuePtr      ///< [OUT]
+)
+{
+    uint64_t value = 0;
+    size_t bitPos = decoderPtr->bitPos;
+
+    if ((bitPos + numBits) > (decoderPtr->len * 8))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    while (numBits > 0)
+    {
+        unsigned int avail = 8 - (bitPos % 8);
+        unsigned int n = (numBits < avail) ? numBits : avail;
+        uint8_t byte = decoderPtr->buffPtr[bitPos / 8];
+
+        value = (value << n) | ((byte >> (avail - n)) & ((1u << n) - 1));
+        bitPos += n;
+        numBits -= n;
+    }
+
+    decoderPtr->bitPos = bitPos;
+    *valuePtr = value;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a value to a column of the open block (Gorilla XOR encoding).
+ */
+//--------------------------------------------------------------------------------------------------
+static void EncodeValue
+(
+    ColumnEncoder_t* encoderPtr,
+    double value,
+    bool isFirst
+)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (isFirst)
+    {
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, bits, 64);
+        encoderPtr->prevBits = bits;
+        encoderPtr->prevLeading = NO_WINDOW;
+        return;
+    }
+
+    uint64_t xor = bits ^ encoderPtr->prevBits;
+    encoderPtr->prevBits = bits;
+
+    if (xor == 0)
+    {
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, 0, 1);
+        return;
+    }
+
+    unsigned int leading = __builtin_clzll(xor);
+    unsigned int trailing = __builtin_ctzll(xor);
+
+    // The leading zero count is stored in 5 bits.
+    if (leading > 31)
+    {
+        leading = 31;
+    }
+
+    if (   (encoderPtr->prevLeading != NO_WINDOW)
+        && (leading >= encoderPtr->prevLeading)
+        && (trailing >= encoderPtr->prevTrailing))
+    {
+        // Fits in the previous window.
+        unsigned int len = 64 - encoderPtr->prevLeading - encoderPtr->prevTrailing;
+
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, 0x2, 2);
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, xor >> encoderPtr->prevTrailing, len);
+    }
+    else
+    {
+        unsigned int len = 64 - leading - trailing;
+
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, 0x3, 2);
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, leading, 5);
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, len - 1, 6);
+        WriteBits(encoderPtr->buffPtr, &encoderPtr->bitPos, xor >> trailing, len);
+
+        encoderPtr->prevLeading = leading;
+        encoderPtr->prevTrailing = trailing;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode the next value of a column.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if the column is corrupt.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DecodeValue
+(
+    ColumnDecoder_t* decoderPtr,
+    bool isFirst,
+    double* valuePtr    ///< [OUT]
+)
+{
+    uint64_t bits;
+    uint64_t control;
+
+    if (isFirst)
+    {
+        if (ReadBits(decoderPtr, 64, &bits) != LE_OK)
+        {
+            return LE_FORMAT_ERROR;
+        }
+        decoderPtr->prevLeading = NO_WINDOW;
+    }
+    else
+    {
+        if (ReadBits(decoderPtr, 1, &control) != LE_OK)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        bits = decoderPtr->prevBits;
+
+        if (control != 0)
+        {
+            uint64_t xor;
+            uint64_t isNewWindow;
+
+            if (ReadBits(decoderPtr, 1, &isNewWindow) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+
+            if (isNewWindow)
+            {
+                uint64_t leading;
+                uint64_t lenMinusOne;
+
+                if (   (ReadBits(decoderPtr, 5, &leading) != LE_OK)
+                    || (ReadBits(decoderPtr, 6, &lenMinusOne) != LE_OK)
+                    || ((leading + lenMinusOne + 1) > 64))
+                {
+                    return LE_FORMAT_ERROR;
+                }
+                decoderPtr->prevLeading = (uint8_t)leading;
+                decoderPtr->prevTrailing = (uint8_t)(64 - leading - lenMinusOne - 1);
+            }
+            else if (decoderPtr->prevLeading == NO_WINDOW)
+            {
+                return LE_FORMAT_ERROR;
+            }
+
+            unsigned int len = 64 - decoderPtr->prevLeading - decoderPtr->prevTrailing;
+            if (ReadBits(decoderPtr, len, &xor) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            bits ^= xor << decoderPtr->prevTrailing;
+        }
+    }
+
+    decoderPtr->prevBits = bits;
+    memcpy(valuePtr, &bits, sizeof(*valuePtr));
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a signed integer to a buffer as a zigzag varint.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WriteVarint
+(
+    uint8_t* buffPtr,
+    size_t* lenPtr,
+    int64_t value
+)
+{
+    uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    size_t len = *lenPtr;
+
+    while (zigzag >= 0x80)
+    {
+        buffPtr[len++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    buffPtr[len++] = (uint8_t)zigzag;
+
+    *lenPtr = len;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a zigzag varint.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if the buffer ends first.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadVarint
+(
+    const uint8_t* buffPtr,
+    size_t len,
+    size_t* posPtr,
+    int64_t* valuePtr   ///< [OUT]
+)
+{
+    uint64_t zigzag = 0;
+    size_t pos = *posPtr;
+
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= len)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        uint8_t byte = buffPtr[pos++];
+        zigzag |= (uint64_t)(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            *posPtr = pos;
+            *valuePtr = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            return LE_OK;
+        }
+    }
+
+    return LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a block's sections into the series' decoded sample arrays.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if the block is corrupt.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DecodeBlock
+(
+    tss_Series_t* seriesPtr,
+    size_t count,
+    int64_t firstUs,
+    const uint8_t* tsPtr,
+    size_t tsLen,
+    const uint8_t* columnPtrs[],
+    const size_t columnLens[]
+)
+{
+    size_t numColumns = seriesPtr->numColumns;
+    ColumnDecoder_t decoders[TSS_MAX_COLUMNS];
+    int64_t timeUs = firstUs;
+    int64_t delta = 0;
+    size_t pos = 0;
+
+    if ((count == 0) || (count > TSS_BLOCK_SAMPLES))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    for (size_t c = 0; c < numColumns; c++)
+    {
+        decoders[c].buffPtr = columnPtrs[c];
+        decoders[c].len = columnLens[c];
+        decoders[c].bitPos = 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            int64_t deltaOfDelta;
+
+            if (ReadVarint(tsPtr, tsLen, &pos, &deltaOfDelta) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+            delta += deltaOfDelta;
+            timeUs += delta;
+        }
+        seriesPtr->decodedUsPtr[i] = timeUs;
+
+        double* rowPtr = seriesPtr->decodedValuesPtr + (i * numColumns);
+        for (size_t c = 0; c < numColumns; c++)
+        {
+            if (DecodeValue(&decoders[c], (i == 0), &rowPtr[c]) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+        }
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a new open block.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResetOpenBlock
+(
+    tss_Series_t* seriesPtr
+)
+{
+    seriesPtr->openCount = 0;
+    seriesPtr->prevDeltaUs = 0;
+    seriesPtr->tsLen = 0;
+
+    for (size_t c = 0; c < seriesPtr->numColumns; c++)
+    {
+        memset(seriesPtr->columns[c].buffPtr, 0, SECTION_CAPACITY);
+        seriesPtr->columns[c].bitPos = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a segment file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetSegmentPath
+(
+    const tss_Series_t* seriesPtr,
+    uint32_t number,
+    char* pathPtr,
+    size_t pathSize
+)
+{
+    snprintf(pathPtr, pathSize, "%s/" SEGMENT_NAME_FORMAT, seriesPtr->path, number);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an entry to the sparse index.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddIndexEntry
+(
+    tss_Series_t* seriesPtr,
+    const BlockHeader_t* headerPtr,
+    uint32_t segment,
+    uint32_t offset
+)
+{
+    if (seriesPtr->indexCount == seriesPtr->indexCapacity)
+    {
+        seriesPtr->indexCapacity = (seriesPtr->indexCapacity == 0) ? 256
+                                                                   : seriesPtr->indexCapacity * 2;
+        seriesPtr->indexPtr = realloc(seriesPtr->indexPtr,
+                                      seriesPtr->indexCapacity * sizeof(IndexEntry_t));
+        LE_ASSERT(seriesPtr->indexPtr != NULL);
+    }
+
+    IndexEntry_t* entryPtr = &seriesPtr->indexPtr[seriesPtr->indexCount++];
+    entryPtr->firstUs = headerPtr->firstUs;
+    entryPtr->lastUs = headerPtr->lastUs;
+    entryPtr->segment = segment;
+    entryPtr->offset = offset;
+    entryPtr->count = headerPtr->count;
+
+    seriesPtr->storedCount += headerPtr->count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a segment to the list of segments.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSegment
+(
+    tss_Series_t* seriesPtr,
+    uint32_t number,
+    size_t bytes
+)
+{
+    if (seriesPtr->numSegments == seriesPtr->segmentsCapacity)
+    {
+        seriesPtr->segmentsCapacity = (seriesPtr->segmentsCapacity == 0)
+                                      ? (SEGMENTS_PER_SERIES * 2)
+                                      : (seriesPtr->segmentsCapacity * 2);
+        seriesPtr->segmentsPtr = realloc(seriesPtr->segmentsPtr,
+                                         seriesPtr->segmentsCapacity * sizeof(Segment_t));
+        LE_ASSERT(seriesPtr->segmentsPtr != NULL);
+    }
+
+    seriesPtr->segmentsPtr[seriesPtr->numSegments].number = number;
+    seriesPtr->segmentsPtr[seriesPtr->numSegments].bytes = bytes;
+    seriesPtr->numSegments++;
+    seriesPtr->totalBytes += bytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the oldest segments until the series is within its size limit.  The newest segment is
+ * always kept.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EnforceRetention
+(
+    tss_Series_t* seriesPtr
+)
+{
+    while ((seriesPtr->totalBytes > seriesPtr->maxBytes) && (seriesPtr->numSegments > 1))
+    {
+        Segment_t oldest = seriesPtr->segmentsPtr[0];
+        char path[MAX_SEGMENT_PATH_BYTES];
+
+        GetSegmentPath(seriesPtr, oldest.number, path, sizeof(path));
+        if ((unlink(path) != 0) && (errno != ENOENT))
+        {
+            LE_ERROR("Couldn't delete '%s' - %m", path);
+            return;
+        }
+
+        if ((seriesPtr->readFd >= 0) && (seriesPtr->readSegment == oldest.number))
+        {
+            close(seriesPtr->readFd);
+            seriesPtr->readFd = -1;
+        }
+
+        size_t n = 0;
+        while ((n < seriesPtr->indexCount) && (seriesPtr->indexPtr[n].segment == oldest.number))
+        {
+            seriesPtr->storedCount -= seriesPtr->indexPtr[n].count;
+            n++;
+        }
+        seriesPtr->indexCount -= n;
+        memmove(seriesPtr->indexPtr,
+                seriesPtr->indexPtr + n,
+                seriesPtr->indexCount * sizeof(IndexEntry_t));
+
+        seriesPtr->numSegments--;
+        memmove(seriesPtr->segmentsPtr,
+                seriesPtr->segmentsPtr + 1,
+                seriesPtr->numSegments * sizeof(Segment_t));
+        seriesPtr->totalBytes -= oldest.bytes;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a new segment file and make it the one written to.
+ *
+ * @return LE_OK, or LE_IO_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartSegment
+(
+    tss_Series_t* seriesPtr
+)
+{
+    uint32_t number = 0;
+    char path[MAX_SEGMENT_PATH_BYTES];
+    uint8_t header[SEGMENT_HEADER_BYTES];
+    uint16_t version = TSS_VERSION;
+    uint16_t numColumns = (uint16_t)seriesPtr->numColumns;
+
+    if (seriesPtr->numSegments > 0)
+    {
+        number = seriesPtr->segmentsPtr[seriesPtr->numSegments - 1].number + 1;
+    }
+
+    if (seriesPtr->writeFd >= 0)
+    {
+        close(seriesPtr->writeFd);
+        seriesPtr->writeFd = -1;
+    }
+
+    GetSegmentPath(seriesPtr, number, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        LE_ERROR("Couldn't create '%s' - %m", path);
+        return LE_IO_ERROR;
+    }
+
+    memcpy(header, SEGMENT_MAGIC, 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 6, &numColumns, sizeof(numColumns));
+
+    if (write(fd, header, sizeof(header)) != sizeof(header))
+    {
+        LE_ERROR("Couldn't write '%s' - %m", path);
+        close(fd);
+        unlink(path);
+        return LE_IO_ERROR;
+    }
+
+    seriesPtr->writeFd = fd;
+    AddSegment(seriesPtr, number, sizeof(header));
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the open block to the newest segment (starting a new one if it's full), then start a new
+ * open block.
+ *
+ * @return LE_OK, or LE_IO_ERROR (the block is lost).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WriteOpenBlock
+(
+    tss_Series_t* seriesPtr
+)
+{
+    size_t numColumns = seriesPtr->numColumns;
+    uint8_t* blockPtr = seriesPtr->blockBuffPtr;
+    uint8_t* payloadPtr = blockPtr + sizeof(BlockHeader_t);
+    uint32_t sectionLens[TSS_MAX_COLUMNS + 1];
+    size_t payloadBytes = (numColumns + 1) * sizeof(uint32_t);
+    le_result_t result = LE_OK;
+
+    if (seriesPtr->openCount == 0)
+    {
+        return LE_OK;
+    }
+
+    // Lay out the payload: section lengths, then the sections.
+    sectionLens[0] = seriesPtr->tsLen;
+    memcpy(payloadPtr + payloadBytes, seriesPtr->tsBuffPtr, seriesPtr->tsLen);
+    payloadBytes += seriesPtr->tsLen;
+
+    for (size_t c = 0; c < numColumns; c++)
+    {
+        size_t len = (seriesPtr->columns[c].bitPos + 7) / 8;
+
+        sectionLens[c + 1] = len;
+        memcpy(payloadPtr + payloadBytes, seriesPtr->columns[c].buffPtr, len);
+        payloadBytes += len;
+    }
+    memcpy(payloadPtr, sectionLens, (numColumns + 1) * sizeof(uint32_t));
+
+    BlockHeader_t header =
+    {
+        .payloadBytes = payloadBytes,
+        .count = seriesPtr->openCount,
+        .reserved = 0,
+        .firstUs = seriesPtr->openFirstUs,
+        .lastUs = seriesPtr->openLastUs,
+        .crc = Crc32(payloadPtr, payloadBytes),
+        .reserved2 = 0,
+    };
+    memcpy(blockPtr, &header, sizeof(header));
+
+    size_t blockBytes = sizeof(header) + payloadBytes;
+
+    if (   (seriesPtr->writeFd < 0)
+        || (seriesPtr->segmentsPtr[seriesPtr->numSegments - 1].bytes + blockBytes
+            > seriesPtr->segmentBytes))
+    {
+        result = StartSegment(seriesPtr);
+        if (result != LE_OK)
+        {
+            goto done;
+        }
+    }
+
+    Segment_t* segmentPtr = &seriesPtr->segmentsPtr[seriesPtr->numSegments - 1];
+
+    ssize_t written = write(seriesPtr->writeFd, blockPtr, blockBytes);
+    if (written != (ssize_t)blockBytes)
+    {
+        LE_ERROR("Couldn't write block to '%s' - %m", seriesPtr->path);
+
+        // Don't leave a partial block in the middle of the segment.
+        if ((written > 0) && (ftruncate(seriesPtr->writeFd, segmentPtr->bytes) != 0))
+        {
+            close(seriesPtr->writeFd);
+            seriesPtr->writeFd = -1;
+        }
+        result = LE_IO_ERROR;
+        goto done;
+    }
+
+    AddIndexEntry(seriesPtr, &header, segmentPtr->number, segmentPtr->bytes);
+    segmentPtr->bytes += blockBytes;
+    seriesPtr->totalBytes += blockBytes;
+
+    EnforceRetention(seriesPtr);
+
+done:
+    ResetOpenBlock(seriesPtr);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a stored block and decode it into the series' decoded sample arrays.
+ *
+ * @return LE_OK, LE_IO_ERROR or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadBlock
+(
+    tss_Series_t* seriesPtr,
+    const IndexEntry_t* entryPtr
+)
+{
+    size_t numColumns = seriesPtr->numColumns;
+    BlockHeader_t header;
+
+    if (   seriesPtr->isDecodedStored
+        && (seriesPtr->decodedSegment == entryPtr->segment)
+        && (seriesPtr->decodedOffset == entryPtr->offset))
+    {
+        return LE_OK;
+    }
+    seriesPtr->isDecodedStored = false;
+
+    if ((seriesPtr->readFd < 0) || (seriesPtr->readSegment != entryPtr->segment))
+    {
+        char path[MAX_SEGMENT_PATH_BYTES];
+
+        if (seriesPtr->readFd >= 0)
+        {
+            close(seriesPtr->readFd);
+        }
+
+        GetSegmentPath(seriesPtr, entryPtr->segment, path, sizeof(path));
+        seriesPtr->readFd = open(path, O_RDONLY | O_CLOEXEC);
+        if (seriesPtr->readFd < 0)
+        {
+            LE_ERROR("Couldn't open '%s' - %m", path);
+            return LE_IO_ERROR;
+        }
+        seriesPtr->readSegment = entryPtr->segment;
+    }
+
+    if (pread(seriesPtr->readFd, &header, sizeof(header), entryPtr->offset) != sizeof(header))
+    {
+        return LE_IO_ERROR;
+    }
+
+    if (   (header.count != entryPtr->count)
+        || (header.payloadBytes > MAX_PAYLOAD_BYTES(numColumns))
+        || (header.payloadBytes < (numColumns + 1) * sizeof(uint32_t)))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    uint8_t* payloadPtr = seriesPtr->blockBuffPtr;
+    if (pread(seriesPtr->readFd, payloadPtr, header.payloadBytes,
+              entryPtr->offset + sizeof(header)) != (ssize_t)header.payloadBytes)
+    {
+        return LE_IO_ERROR;
+    }
+
+    if (Crc32(payloadPtr, header.payloadBytes) != header.crc)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    uint32_t sectionLens[TSS_MAX_COLUMNS + 1];
+    const uint8_t* columnPtrs[TSS_MAX_COLUMNS];
+    size_t columnLens[TSS_MAX_COLUMNS];
+    size_t pos = (numColumns + 1) * sizeof(uint32_t);
+
+    memcpy(sectionLens, payloadPtr, pos);
+
+    const uint8_t* tsPtr = payloadPtr + pos;
+    pos += sectionLens[0];
+
+    for (size_t c = 0; c < numColumns; c++)
+    {
+        columnPtrs[c] = payloadPtr + pos;
+        columnLens[c] = sectionLens[c + 1];
+        pos += sectionLens[c + 1];
+    }
+
+    if (pos != header.payloadBytes)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    le_result_t result = DecodeBlock(seriesPtr,
+                                     header.count,
+                                     header.firstUs,
+                                     tsPtr,
+                                     sectionLens[0],
+                                     columnPtrs,
+                                     columnLens);
+    if (result == LE_OK)
+    {
+        seriesPtr->isDecodedStored = true;
+        seriesPtr->decodedSegment = entryPtr->segment;
+        seriesPtr->decodedOffset = entryPtr->offset;
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode the open block into the series' decoded sample arrays.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR (which would be a bug).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadOpenBlock
+(
+    tss_Series_t* seriesPtr
+)
+{
+    const uint8_t* columnPtrs[TSS_MAX_COLUMNS];
+    size_t columnLens[TSS_MAX_COLUMNS];
+
+    seriesPtr->isDecodedStored = false;
+
+    for (size_t c = 0; c < seriesPtr->numColumns; c++)
+    {
+        columnPtrs[c] = seriesPtr->columns[c].buffPtr;
+        columnLens[c] = (seriesPtr->columns[c].bitPos + 7) / 8;
+    }
+
+    return DecodeBlock(seriesPtr,
+                       seriesPtr->openCount,
+                       seriesPtr->openFirstUs,
+                       seriesPtr->tsBuffPtr,
+                       seriesPtr->tsLen,
+                       columnPtrs,
+                       columnLens);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan samples in a time range, starting at a given stored block (or at the open block if it is
+ * indexCount).
+ *
+ * @return LE_OK, LE_IO_ERROR or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ScanFrom
+(
+    tss_Series_t* seriesPtr,
+    size_t blockIndex,
+    int64_t afterUs,
+    int64_t untilUs,
+    size_t skip,            ///< Number of samples in range to skip first.
+    SampleUsFunc_t func,
+    void* contextPtr
+)
+{
+    for (size_t b = blockIndex; b <= seriesPtr->indexCount; b++)
+    {
+        size_t count;
+        le_result_t result;
+
+        if (b < seriesPtr->indexCount)
+        {
+            const IndexEntry_t* entryPtr = &seriesPtr->indexPtr[b];
+
+            if (entryPtr->firstUs > untilUs)
+            {
+                return LE_OK;
+            }
+            if (entryPtr->lastUs <= afterUs)
+            {
+                continue;
+            }
+
+            count = entryPtr->count;
+            result = LoadBlock(seriesPtr, entryPtr);
+        }
+        else
+        {
+            if (   (seriesPtr->openCount == 0)
+                || (seriesPtr->openFirstUs > untilUs)
+                || (seriesPtr->openLastUs <= afterUs))
+            {
+                return LE_OK;
+            }
+
+            count = seriesPtr->openCount;
+            result = LoadOpenBlock(seriesPtr);
+        }
+
+        if (result != LE_OK)
+        {
+            LE_ERROR("Couldn't read block %zu of '%s' (%s).",
+                     b,
+                     seriesPtr->path,
+                     LE_RESULT_TXT(result));
+            return result;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            int64_t timeUs = seriesPtr->decodedUsPtr[i];
+
+            if (timeUs <= afterUs)
+            {
+                continue;
+            }
+            if (timeUs > untilUs)
+            {
+                return LE_OK;
+            }
+            if (skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            const double* valuesPtr = seriesPtr->decodedValuesPtr + (i * seriesPtr->numColumns);
+            if (!func(timeUs, valuesPtr, contextPtr))
+            {
+                return LE_OK;
+            }
+        }
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the first stored block with samples after a given time.
+ *
+ * @return The block's index, or indexCount if there is none.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t FindBlock
+(
+    const tss_Series_t* seriesPtr,
+    int64_t afterUs
+)
+{
+    size_t low = 0;
+    size_t high = seriesPtr->indexCount;
+
+    while (low < high)
+    {
+        size_t mid = low + ((high - low) / 2);
+
+        if (seriesPtr->indexPtr[mid].lastUs <= afterUs)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pass an internally scanned sample on to a tss_SampleFunc_t.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AdaptSample
+(
+    int64_t timeUs,
+    const double values[],
+    void* contextPtr
+)
+{
+    ScanAdapter_t* adapterPtr = contextPtr;
+
+    return adapterPtr->func(FromUs(timeUs), values, adapterPtr->contextPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the bucket being accumulated by a downsampler, if any.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EmitBucket
+(
+    Downsampler_t* dsPtr
+)
+{
+    double means[TSS_MAX_COLUMNS];
+
+    if (dsPtr->count == 0)
+    {
+        return;
+    }
+
+    for (size_t c = 0; c < dsPtr->numColumns; c++)
+    {
+        means[c] = dsPtr->sums[c] / dsPtr->count;
+        dsPtr->sums[c] = 0.0;
+    }
+    dsPtr->count = 0;
+
+    if (!dsPtr->func(FromUs(dsPtr->bucketEndUs), means, dsPtr->contextPtr))
+    {
+        dsPtr->isStopped = true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an internally scanned sample to a downsampler's buckets.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool DownsampleSample
+(
+    int64_t timeUs,
+    const double values[],
+    void* contextPtr
+)
+{
+    Downsampler_t* dsPtr = contextPtr;
+
+    // Bucket k covers (k * interval, (k + 1) * interval].
+    int64_t q = timeUs / dsPtr->intervalUs;
+    if ((timeUs % dsPtr->intervalUs) > 0)
+    {
+        q++;
+    }
+    int64_t bucketEndUs = q * dsPtr->intervalUs;
+
+    if (bucketEndUs != dsPtr->bucketEndUs)
+    {
+        EmitBucket(dsPtr);
+        if (dsPtr->isStopped)
+        {
+            return false;
+        }
+        dsPtr->bucketEndUs = bucketEndUs;
+    }
+
+    for (size_t c = 0; c < dsPtr->numColumns; c++)
+    {
+        dsPtr->sums[c] += values[c];
+    }
+    dsPtr->count++;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load a series' segments and index their blocks.  A torn block at the end of the newest segment
+ * is truncated away.
+ *
+ * @return LE_OK, LE_IO_ERROR or LE_FORMAT_ERROR.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadSegments
+(
+    tss_Series_t* seriesPtr
+)
+{
+    uint32_t* numbersPtr = NULL;
+    size_t numNumbers = 0;
+    size_t capacity = 0;
+    le_result_t result = LE_OK;
+
+    DIR* dir = opendir(seriesPtr->path);
+    if (dir == NULL)
+    {
+        LE_ERROR("Couldn't open '%s' - %m", seriesPtr->path);
+        return LE_IO_ERROR;
+    }
+
+    struct dirent* entryPtr;
+    while ((entryPtr = readdir(dir)) != NULL)
+    {
+        uint32_t number;
+        char check[32];
+
+        if (   (sscanf(entryPtr->d_name, "%" SCNu32, &number) != 1)
+            || (snprintf(check, sizeof(check), SEGMENT_NAME_FORMAT, number) >= (int)sizeof(check))
+            || (strcmp(check, entryPtr->d_name) != 0))
+        {
+            continue;
+        }
+
+        if (numNumbers == capacity)
+        {
+            capacity = (capacity == 0) ? 16 : (capacity * 2);
+            numbersPtr = realloc(numbersPtr, capacity * sizeof(uint32_t));
+            LE_ASSERT(numbersPtr != NULL);
+        }
+        numbersPtr[numNumbers++] = number;
+    }
+    closedir(dir);
+
+    // Oldest first.
+    for (size_t i = 1; i < numNumbers; i++)
+    {
+        uint32_t number = numbersPtr[i];
+        size_t j = i;
+
+        while ((j > 0) && (numbersPtr[j - 1] > number))
+        {
+            numbersPtr[j] = numbersPtr[j - 1];
+            j--;
+        }
+        numbersPtr[j] = number;
+    }
+
+    for (size_t i = 0; (i < numNumbers) && (result == LE_OK); i++)
+    {
+        bool isNewest = (i == (numNumbers - 1));
+        char path[MAX_SEGMENT_PATH_BYTES];
+        uint8_t segmentHeader[SEGMENT_HEADER_BYTES];
+        uint16_t version;
+        uint16_t numColumns;
+        struct stat st;
+
+        GetSegmentPath(seriesPtr, numbersPtr[i], path, sizeof(path));
+
+        int fd = open(path, (isNewest ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if ((fd < 0) || (fstat(fd, &st) != 0))
+        {
+            LE_ERROR("Couldn't open '%s' - %m", path);
+            result = LE_IO_ERROR;
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            break;
+        }
+
+        if (pread(fd, segmentHeader, sizeof(segmentHeader), 0) != sizeof(segmentHeader))
+        {
+            // Torn when created.  Nothing in it.
+            LE_WARN("Deleting empty segment '%s'.", path);
+            close(fd);
+            unlink(path);
+            continue;
+        }
+
+        memcpy(&version, segmentHeader + 4, sizeof(version));
+        memcpy(&numColumns, segmentHeader + 6, sizeof(numColumns));
+
+        if (   (memcmp(segmentHeader, SEGMENT_MAGIC, 4) != 0)
+            || (version != TSS_VERSION)
+            || (numColumns != seriesPtr->numColumns))
+        {
+            LE_ERROR("'%s' is not a version %d segment with %zu columns.",
+                     path,
+                     TSS_VERSION,
+                     seriesPtr->numColumns);
+            close(fd);
+            result = LE_FORMAT_ERROR;
+            break;
+        }
+
+        size_t offset = SEGMENT_HEADER_BYTES;
+        while (offset < (size_t)st.st_size)
+        {
+            BlockHeader_t header;
+            bool isValid = (pread(fd, &header, sizeof(header), offset) == sizeof(header))
+                           && (header.count > 0)
+                           && (header.count <= TSS_BLOCK_SAMPLES)
+                           && (header.payloadBytes <= MAX_PAYLOAD_BYTES(seriesPtr->numColumns))
+                           && ((offset + sizeof(header) + header.payloadBytes)
+                               <= (size_t)st.st_size);
+
+            bool isLast = isValid
+                          && ((offset + sizeof(header) + header.payloadBytes)
+                              == (size_t)st.st_size);
+
+            // Only the newest block can have been torn by a power cut, so only its payload is
+            // checked (checking them all would read the whole store).
+            if (isValid && isLast && isNewest)
+            {
+                uint8_t* payloadPtr = seriesPtr->blockBuffPtr;
+
+                isValid = (pread(fd, payloadPtr, header.payloadBytes, offset + sizeof(header))
+                           == (ssize_t)header.payloadBytes)
+                          && (Crc32(payloadPtr, header.payloadBytes) == header.crc);
+            }
+
+            if (!isValid)
+            {
+                LE_WARN("Dropping torn or corrupt data at offset %zu of '%s'.", offset, path);
+                if (isNewest && (ftruncate(fd, offset) != 0))
+                {
+                    LE_ERROR("Couldn't truncate '%s' - %m", path);
+                }
+                break;
+            }
+
+            if (   (seriesPtr->indexCount > 0)
+                && (header.firstUs < seriesPtr->indexPtr[seriesPtr->indexCount - 1].lastUs))
+            {
+                LE_ERROR("Block at offset %zu of '%s' is out of order.", offset, path);
+                result = LE_FORMAT_ERROR;
+                break;
+            }
+
+            AddIndexEntry(seriesPtr, &header, numbersPtr[i], offset);
+            offset += sizeof(header) + header.payloadBytes;
+        }
+
+        close(fd);
+        AddSegment(seriesPtr, numbersPtr[i], offset);
+    }
+
+    free(numbersPtr);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Free a series' memory and close its files.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FreeSeries
+(
+    tss_Series_t* seriesPtr
+)
+{
+    if (seriesPtr->writeFd >= 0)
+    {
+        close(seriesPtr->writeFd);
+    }
+    if (seriesPtr->readFd >= 0)
+    {
+        close(seriesPtr->readFd);
+    }
+
+    free(seriesPtr->indexPtr);
+    free(seriesPtr->segmentsPtr);
+    free(seriesPtr->tsBuffPtr);
+    free(seriesPtr->blockBuffPtr);
+    free(seriesPtr->decodedUsPtr);
+    free(seriesPtr->decodedValuesPtr);
+    free(seriesPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a series, creating it if it doesn't exist.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the series exists with a different number of columns, or is corrupt.
+ *  - LE_IO_ERROR if its directory or files couldn't be created or read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_Open
+(
+    const char* dirPath,        ///< Directory the series' own directory is in.
+    const char* name,           ///< Series name (also its directory's name).
+    size_t numColumns,          ///< 1 to TSS_MAX_COLUMNS
+    size_t maxBytes,            ///< Size above which the oldest samples are deleted.
+    tss_Series_t** seriesPtrPtr ///< [OUT]
+)
+{
+    LE_ASSERT((numColumns > 0) && (numColumns <= TSS_MAX_COLUMNS));
+    LE_ASSERT(strlen(name) <= TSS_MAX_NAME_LEN);
+
+    if (CrcTable[1] == 0)
+    {
+        InitCrcTable();
+    }
+
+    tss_Series_t* seriesPtr = calloc(1, sizeof(tss_Series_t));
+    LE_ASSERT(seriesPtr != NULL);
+
+    seriesPtr->numColumns = numColumns;
+    seriesPtr->maxBytes = maxBytes;
+    seriesPtr->segmentBytes = maxBytes / SEGMENTS_PER_SERIES;
+    if (seriesPtr->segmentBytes < MIN_SEGMENT_BYTES)
+    {
+        seriesPtr->segmentBytes = MIN_SEGMENT_BYTES;
+    }
+    seriesPtr->writeFd = -1;
+    seriesPtr->readFd = -1;
+
+    // One allocation for the open block's timestamp and column sections.
+    seriesPtr->tsBuffPtr = malloc((numColumns + 1) * SECTION_CAPACITY);
+    seriesPtr->blockBuffPtr = malloc(sizeof(BlockHeader_t) + MAX_PAYLOAD_BYTES(numColumns));
+    seriesPtr->decodedUsPtr = malloc(TSS_BLOCK_SAMPLES * sizeof(int64_t));
+    seriesPtr->decodedValuesPtr = malloc(TSS_BLOCK_SAMPLES * numColumns * sizeof(double));
+    LE_ASSERT(   (seriesPtr->tsBuffPtr != NULL)
+              && (seriesPtr->blockBuffPtr != NULL)
+              && (seriesPtr->decodedUsPtr != NULL)
+              && (seriesPtr->decodedValuesPtr != NULL));
+
+    for (size_t c = 0; c < numColumns; c++)
+    {
+        seriesPtr->columns[c].buffPtr = seriesPtr->tsBuffPtr + ((c + 1) * SECTION_CAPACITY);
+    }
+    ResetOpenBlock(seriesPtr);
+
+    le_result_t result;
+
+    if (snprintf(seriesPtr->path, sizeof(seriesPtr->path), "%s/%s", dirPath, name)
+        >= (int)sizeof(seriesPtr->path))
+    {
+        LE_ERROR("Series path '%s/%s' too long.", dirPath, name);
+        result = LE_IO_ERROR;
+        goto done;
+    }
+
+    if (le_dir_MakePath(seriesPtr->path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+        != LE_OK)
+    {
+        LE_ERROR("Couldn't create '%s'.", seriesPtr->path);
+        result = LE_IO_ERROR;
+        goto done;
+    }
+
+    result = LoadSegments(seriesPtr);
+    if (result != LE_OK)
+    {
+        goto done;
+    }
+
+    // Carry on writing to the newest segment.
+    if (seriesPtr->numSegments > 0)
+    {
+        char path[MAX_SEGMENT_PATH_BYTES];
+
+        GetSegmentPath(seriesPtr,
+                       seriesPtr->segmentsPtr[seriesPtr->numSegments - 1].number,
+                       path,
+                       sizeof(path));
+        seriesPtr->writeFd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (seriesPtr->writeFd < 0)
+        {
+            LE_ERROR("Couldn't open '%s' - %m", path);
+            result = LE_IO_ERROR;
+            goto done;
+        }
+    }
+
+    EnforceRetention(seriesPtr);
+
+    LE_INFO("Opened '%s': %" PRIu64 " samples in %zu blocks, %zu bytes.",
+            seriesPtr->path,
+            seriesPtr->storedCount,
+            seriesPtr->indexCount,
+            seriesPtr->totalBytes);
+
+done:
+    if (result == LE_OK)
+    {
+        *seriesPtrPtr = seriesPtr;
+    }
+    else
+    {
+        FreeSeries(seriesPtr);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush and close a series.
+ */
+//--------------------------------------------------------------------------------------------------
+void tss_Close
+(
+    tss_Series_t* seriesPtr
+)
+{
+    tss_Flush(seriesPtr);
+    FreeSeries(seriesPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a sample to a series.  Writes the open block to flash if it becomes full.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OUT_OF_RANGE if the sample is older than the newest sample in the series (not stored).
+ *  - LE_IO_ERROR if a block couldn't be written (the block is lost).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_Append
+(
+    tss_Series_t* seriesPtr,
+    double timestamp,       ///< Seconds since the Epoch.
+    const double values[]   ///< One per column.
+)
+{
+    int64_t timeUs = ToUs(timestamp);
+
+    if (seriesPtr->openCount > 0)
+    {
+        if (timeUs < seriesPtr->openLastUs)
+        {
+            return LE_OUT_OF_RANGE;
+        }
+
+        int64_t delta = timeUs - seriesPtr->openLastUs;
+
+        WriteVarint(seriesPtr->tsBuffPtr, &seriesPtr->tsLen, delta - seriesPtr->prevDeltaUs);
+        seriesPtr->prevDeltaUs = delta;
+    }
+    else
+    {
+        if (   (seriesPtr->indexCount > 0)
+            && (timeUs < seriesPtr->indexPtr[seriesPtr->indexCount - 1].lastUs))
+        {
+            return LE_OUT_OF_RANGE;
+        }
+
+        seriesPtr->openFirstUs = timeUs;
+    }
+
+    for (size_t c = 0; c < seriesPtr->numColumns; c++)
+    {
+        EncodeValue(&seriesPtr->columns[c], values[c], (seriesPtr->openCount == 0));
+    }
+
+    seriesPtr->openLastUs = timeUs;
+    seriesPtr->openCount++;
+
+    if (seriesPtr->openCount == TSS_BLOCK_SAMPLES)
+    {
+        return WriteOpenBlock(seriesPtr);
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the open block to flash, even if it isn't full.
+ *
+ * @return
+ *  - LE_OK if successful (or there was nothing to write)
+ *  - LE_IO_ERROR if the block couldn't be written (the block is lost).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_Flush
+(
+    tss_Series_t* seriesPtr
+)
+{
+    if (seriesPtr->openCount == 0)
+    {
+        return LE_OK;
+    }
+
+    le_result_t result = WriteOpenBlock(seriesPtr);
+
+    if ((result == LE_OK) && (fdatasync(seriesPtr->writeFd) != 0))
+    {
+        LE_ERROR("Couldn't sync '%s' - %m", seriesPtr->path);
+        result = LE_IO_ERROR;
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a series' number of columns, number of samples and time range.  The timestamps are 0 if
+ * the series is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+void tss_GetInfo
+(
+    tss_Series_t* seriesPtr,
+    size_t* numColumnsPtr,  ///< [OUT]
+    uint64_t* countPtr,     ///< [OUT]
+    double* oldestPtr,      ///< [OUT]
+    double* newestPtr       ///< [OUT]
+)
+{
+    *numColumnsPtr = seriesPtr->numColumns;
+    *countPtr = seriesPtr->storedCount + seriesPtr->openCount;
+    *oldestPtr = 0.0;
+    *newestPtr = 0.0;
+
+    if (seriesPtr->indexCount > 0)
+    {
+        *oldestPtr = FromUs(seriesPtr->indexPtr[0].firstUs);
+        *newestPtr = FromUs(seriesPtr->indexPtr[seriesPtr->indexCount - 1].lastUs);
+    }
+    else if (seriesPtr->openCount > 0)
+    {
+        *oldestPtr = FromUs(seriesPtr->openFirstUs);
+    }
+
+    if (seriesPtr->openCount > 0)
+    {
+        *newestPtr = FromUs(seriesPtr->openLastUs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the samples with timestamps after one time and up to and including another, oldest
+ * first.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if a block couldn't be read.
+ *  - LE_FORMAT_ERROR if a block is corrupt.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_Scan
+(
+    tss_Series_t* seriesPtr,
+    double after,
+    double until,
+    tss_SampleFunc_t func,
+    void* contextPtr
+)
+{
+    ScanAdapter_t adapter = { .func = func, .contextPtr = contextPtr };
+    int64_t afterUs = ToUs(after);
+
+    return ScanFrom(seriesPtr,
+                    FindBlock(seriesPtr, afterUs),
+                    afterUs,
+                    ToUs(until),
+                    0,
+                    AdaptSample,
+                    &adapter);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the means of the samples in fixed time buckets, oldest first.  Bucket k covers the
+ * timestamps after k * interval up to and including (k + 1) * interval, and is reported with the
+ * timestamp at its end.  Buckets without samples are skipped.  Only buckets that end after one
+ * time and up to and including another are scanned.
+ *
+ * @return As for tss_Scan().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_ScanDownsampled
+(
+    tss_Series_t* seriesPtr,
+    double after,
+    double until,
+    double interval,        ///< Bucket length in seconds (> 0).
+    tss_SampleFunc_t func,
+    void* contextPtr
+)
+{
+    Downsampler_t ds =
+    {
+        .intervalUs = ToUs(interval),
+        .bucketEndUs = 0,
+        .count = 0,
+        .numColumns = seriesPtr->numColumns,
+        .func = func,
+        .contextPtr = contextPtr,
+        .isStopped = false,
+    };
+
+    if (ds.intervalUs <= 0)
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    int64_t afterUs = ToUs(after);
+    int64_t untilUs = ToUs(until);
+
+    // Samples in the first bucket ending after 'after', up to the end of the last bucket ending
+    // by 'until'.
+    if (afterUs > (INT64_MIN + ds.intervalUs))
+    {
+        afterUs = ((afterUs / ds.intervalUs) - ((afterUs % ds.intervalUs) < 0)) * ds.intervalUs;
+    }
+    if (untilUs < INT64_MAX)
+    {
+        untilUs = ((untilUs / ds.intervalUs) - ((untilUs % ds.intervalUs) < 0)) * ds.intervalUs;
+    }
+
+    le_result_t result = ScanFrom(seriesPtr,
+                                  FindBlock(seriesPtr, afterUs),
+                                  afterUs,
+                                  untilUs,
+                                  0,
+                                  DownsampleSample,
+                                  &ds);
+    if ((result == LE_OK) && !ds.isStopped)
+    {
+        EmitBucket(&ds);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the newest samples, oldest first.
+ *
+ * @return As for tss_Scan().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t tss_ScanLatest
+(
+    tss_Series_t* seriesPtr,
+    size_t count,
+    tss_SampleFunc_t func,
+    void* contextPtr
+)
+{
+    ScanAdapter_t adapter = { .func = func, .contextPtr = contextPtr };
+    size_t found = seriesPtr->openCount;
+    size_t blockIndex = seriesPtr->indexCount;
+
+    // Walk back through the index until enough samples are covered.
+    while ((found < count) && (blockIndex > 0))
+    {
+        blockIndex--;
+        found += seriesPtr->indexPtr[blockIndex].count;
+    }
+
+    return ScanFrom(seriesPtr,
+                    blockIndex,
+                    INT64_MIN,
+                    INT64_MAX,
+                    (found > count) ? (found - count) : 0,
+                    AdaptSample,
+                    &adapter);
+}
+
+
+COMPONENT_INIT
+{
+}
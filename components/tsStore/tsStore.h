@@ -0,0 +1,217 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file tsStore.h
+ *
+ * On-flash time-series store.  Each series (e.g., one sensor) holds timestamped samples of a fixed
+ * number of numeric columns (e.g., x, y and z), appended in time order.
+ *
+ * Samples are appended to an open block in RAM and written out when the block is full or flushed.
+ * Blocks are columnar and compressed: timestamps (in microseconds) as delta-of-deltas, and each
+ * column as the XOR of consecutive values (as in Facebook's Gorilla), so slowly varying sensor
+ * values take a few bits each.
+ *
+ * A series is a directory of segment files, written in turn.  Once the series' size goes over its
+ * limit, its oldest segment is deleted.  The time range of every block is kept in a sparse index
+ * in RAM (rebuilt from the block headers when the series is opened), so a range query only
+ * decodes the blocks that overlap the range.
+ *
+ * Segment file format, in the host's byte order (like the sensor log, see sensorLog.h):
+ *
+ *  - Segment header:
+ *     - magic "RTSS" (4 bytes)
+ *     - format version (uint16)
+ *     - number of columns (uint16)
+ *  - Any number of blocks:
+ *     - payload length in bytes (uint32)
+ *     - number of samples (uint16)
+ *     - reserved (uint16, 0)
+ *     - first and last timestamps in microseconds since the Epoch (int64 each)
+ *     - CRC-32 of the payload (uint32)
+ *     - reserved (uint32, 0)
+ *     - payload: the length in bytes of each section (uint32 each), then the timestamp section
+ *       and one section per column.
+ *
+ * Timestamps are kept to the microsecond.  A block torn by a power cut is dropped when the series
+ * is next opened.
+ *
+ * The functions are not thread-safe, and must not be called for a series from the callback of a
+ * scan of that series.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TS_STORE_H_INCLUDE_GUARD
+#define TS_STORE_H_INCLUDE_GUARD
+
+
+/// Current segment format version.
+#define TSS_VERSION 1
+
+/// Most columns in a series.
+#define TSS_MAX_COLUMNS 8
+
+/// Longest series name (excluding the null terminator).
+#define TSS_MAX_NAME_LEN 31
+
+/// Most samples in a block.
+#define TSS_BLOCK_SAMPLES 512
+
+
+typedef struct tss_Series tss_Series_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function called for each sample (or downsampled bucket) found by a scan.
+ *
+ * @return true to continue the scan, false to stop it.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef bool (*tss_SampleFunc_t)
+(
+    double timestamp,       ///< Seconds since the Epoch.
+    const double values[],  ///< One per column.
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a series, creating it if it doesn't exist.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the series exists with a different number of columns, or is corrupt.
+ *  - LE_IO_ERROR if its directory or files couldn't be created or read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_Open
+(
+    const char* dirPath,        ///< Directory the series' own directory is in.
+    const char* name,           ///< Series name (also its directory's name).
+    size_t numColumns,          ///< 1 to TSS_MAX_COLUMNS
+    size_t maxBytes,            ///< Size above which the oldest samples are deleted.
+    tss_Series_t** seriesPtrPtr ///< [OUT]
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Flush and close a series.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tss_Close
+(
+    tss_Series_t* seriesPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a sample to a series.  Writes the open block to flash if it becomes full.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OUT_OF_RANGE if the sample is older than the newest sample in the series (not stored).
+ *  - LE_IO_ERROR if a block couldn't be written (the block is lost).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_Append
+(
+    tss_Series_t* seriesPtr,
+    double timestamp,       ///< Seconds since the Epoch.
+    const double values[]   ///< One per column.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the open block to flash, even if it isn't full.
+ *
+ * @return
+ *  - LE_OK if successful (or there was nothing to write)
+ *  - LE_IO_ERROR if the block couldn't be written (the block is lost).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_Flush
+(
+    tss_Series_t* seriesPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a series' number of columns, number of samples and time range.  The timestamps are 0 if
+ * the series is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void tss_GetInfo
+(
+    tss_Series_t* seriesPtr,
+    size_t* numColumnsPtr,  ///< [OUT]
+    uint64_t* countPtr,     ///< [OUT]
+    double* oldestPtr,      ///< [OUT]
+    double* newestPtr       ///< [OUT]
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the samples with timestamps after one time and up to and including another, oldest
+ * first.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if a block couldn't be read.
+ *  - LE_FORMAT_ERROR if a block is corrupt.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_Scan
+(
+    tss_Series_t* seriesPtr,
+    double after,
+    double until,
+    tss_SampleFunc_t func,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the means of the samples in fixed time buckets, oldest first.  Bucket k covers the
+ * timestamps after k * interval up to and including (k + 1) * interval, and is reported with the
+ * timestamp at its end.  Buckets without samples are skipped.  Only buckets that end after one
+ * time and up to and including another are scanned.
+ *
+ * @return As for tss_Scan().
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_ScanDownsampled
+(
+    tss_Series_t* seriesPtr,
+    double after,
+    double until,
+    double interval,        ///< Bucket length in seconds (> 0).
+    tss_SampleFunc_t func,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan the newest samples, oldest first.
+ *
+ * @return As for tss_Scan().
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t tss_ScanLatest
+(
+    tss_Series_t* seriesPtr,
+    size_t count,
+    tss_SampleFunc_t func,
+    void* contextPtr
+);
+
+
+#endif // TS_STORE_H_INCLUDE_GUARD
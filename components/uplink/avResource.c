@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file avResource.c
+ *
+ * Interned AirVantage resource paths.  See avResource.h.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "avResource.h"
+
+
+/// Maximum number of distinct resource paths.
+#define MAX_RESOURCES 64
+
+
+/// Interned resource paths, indexed by handle.
+static char Paths[MAX_RESOURCES][LE_AVDATA_PATH_NAME_BYTES];
+
+/// Number of resource paths interned so far.
+static size_t NumResources = 0;
+
+/// Map of path -> (handle + 1), for finding paths interned before.
+static le_hashmap_Ref_t PathMap = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Intern a resource path.  Interning the same path again returns the same handle.
+ *
+ * @return The handle.  Terminates the process if the path is too long or the table is full.
+ */
+//--------------------------------------------------------------------------------------------------
+avres_Handle_t avres_Intern
+(
+    const char* path
+)
+{
+    if (PathMap == NULL)
+    {
+        PathMap = le_hashmap_Create("avResources",
+                                    MAX_RESOURCES,
+                                    le_hashmap_HashString,
+                                    le_hashmap_EqualsString);
+    }
+
+    uintptr_t entry = (uintptr_t)le_hashmap_Get(PathMap, path);
+    if (entry != 0)
+    {
+        return (avres_Handle_t)(entry - 1);
+    }
+
+    LE_FATAL_IF(NumResources >= MAX_RESOURCES,
+                "Too many AirVantage resources (max %d) interning '%s'.",
+                MAX_RESOURCES,
+                path);
+
+    avres_Handle_t handle = (avres_Handle_t)NumResources;
+
+    LE_FATAL_IF(le_utf8_Copy(Paths[handle], path, sizeof(Paths[handle]), NULL) != LE_OK,
+                "AirVantage resource path '%s' is too long.",
+                path);
+
+    NumResources++;
+
+    le_hashmap_Put(PathMap, Paths[handle], (void*)(uintptr_t)(handle + 1));
+
+    return handle;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the path of an interned resource.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* avres_GetPath
+(
+    avres_Handle_t handle
+)
+{
+    LE_ASSERT(handle < NumResources);
+
+    return Paths[handle];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record an integer value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordInt().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordInt
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    int32_t value,
+    uint64_t timestamp  ///< ms since the Epoch.
+)
+{
+    return le_avdata_RecordInt(rec, avres_GetPath(handle), value, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a floating point value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordFloat().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordFloat
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    double value,
+    uint64_t timestamp  ///< ms since the Epoch.
+)
+{
+    return le_avdata_RecordFloat(rec, avres_GetPath(handle), value, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a string value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordString().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordString
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    const char* value,
+    uint64_t timestamp  ///< ms since the Epoch.
+)
+{
+    return le_avdata_RecordString(rec, avres_GetPath(handle), value, timestamp);
+}
@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file avResource.h
+ *
+ * Interned AirVantage resource paths.
+ *
+ * Each resource path the avdata uplink transports record to is interned once, at start-up, and
+ * referred to by a compact handle from then on.  Interning checks the path once (length,
+ * duplicates), so the per-sample recording functions only do an array lookup before calling the
+ * avdata service.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef AV_RESOURCE_H_INCLUDE_GUARD
+#define AV_RESOURCE_H_INCLUDE_GUARD
+
+
+/// Handle of an interned resource path.
+typedef uint16_t avres_Handle_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Intern a resource path.  Interning the same path again returns the same handle.
+ *
+ * @return The handle.  Terminates the process if the path is too long or the table is full.
+ */
+//--------------------------------------------------------------------------------------------------
+avres_Handle_t avres_Intern
+(
+    const char* path
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the path of an interned resource.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* avres_GetPath
+(
+    avres_Handle_t handle
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record an integer value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordInt().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordInt
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    int32_t value,
+    uint64_t timestamp  ///< ms since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a floating point value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordFloat().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordFloat
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    double value,
+    uint64_t timestamp  ///< ms since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a string value of an interned resource into an avdata record.
+ *
+ * @return Same as le_avdata_RecordString().
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t avres_RecordString
+(
+    le_avdata_RecordRef_t rec,
+    avres_Handle_t handle,
+    const char* value,
+    uint64_t timestamp  ///< ms since the Epoch.
+);
+
+
+#endif // AV_RESOURCE_H_INCLUDE_GUARD
@@ -0,0 +1,464 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file avdataUplink.c
+ *
+ * AirVantage (le_avdata) uplink transports:
+ *
+ *  - "avdata": one sample per push, each field recorded to the resource given by the sensor's
+ *    asset model descriptor, and its sequence number to the sensor's UPLINK_SEQ_PREFIX resource.
+ *  - "avdata-senml": as many samples as fit in a SenML-CBOR pack whose base64 text fits in an
+ *    avdata string value, recorded to the MangOH.Sensors.SenML resource.
+ *
+ * The avdata service queues pushes while the AirVantage session is down, so pushes are always
+ * handed straight to it.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "uplink.h"
+#include "senml.h"
+
+
+/// Resource the SenML packs are recorded to.
+#define SENML_RES "MangOH.Sensors.SenML"
+
+/// Largest SenML pack whose base64 text fits in an avdata string value.
+#define SENML_MAX_PACK_BYTES (((LE_AVDATA_STRING_VALUE_BYTES - 1) / 4) * 3)
+
+/// Samples worth offering per SenML push.  Only two or three accelerometer samples fit in a pack,
+/// and each sample offered costs the caller a Data Hub query.
+#define SENML_MAX_BATCH 8
+
+
+/// true once connected to the avdata service.
+static bool IsConnected = false;
+
+/// Interned SENML_RES.
+static avres_Handle_t SenmlHandle;
+
+static uplink_Stats_t FieldStats = { .wireBytes = -1 };
+static uplink_Stats_t SenmlStats = { .wireBytes = -1 };
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handles notification of AirVantage time-series push status.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleAvPushComplete
+(
+    le_avdata_PushStatus_t status, ///< Push success/failure status
+    void* context                  ///< Pointer to the uplink_Sensor_t object of the sensor.
+)
+{
+    uplink_Sensor_t* sensorPtr = context;
+
+    switch (status)
+    {
+        case LE_AVDATA_PUSH_SUCCESS:
+
+            sensorPtr->completeFunc(true, sensorPtr->completeContextPtr);
+            return;
+
+        case LE_AVDATA_PUSH_FAILED:
+
+            sensorPtr->completeFunc(false, sensorPtr->completeContextPtr);
+            return;
+    }
+
+    LE_FATAL("Unexpected push result status %d (%s).", status, sensorPtr->modelPtr->name);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a record for a sensor.
+ *
+ * @return Same as le_avdata_PushRecord().
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PushRecord
+(
+    uplink_Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    uplink_PushCompleteFunc_t completeFunc,
+    void* contextPtr
+)
+{
+    sensorPtr->completeFunc = completeFunc;
+    sensorPtr->completeContextPtr = contextPtr;
+
+    le_result_t result = le_avdata_PushRecord(rec, HandleAvPushComplete, sensorPtr);
+    if ((result != LE_OK) && (result != LE_BUSY))
+    {
+        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect to the avdata service.
+ *
+ * @return LE_OK if successful, LE_UNAVAILABLE if the service isn't available.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Connect
+(
+    void
+)
+{
+    if (!IsConnected)
+    {
+        if (le_avdata_TryConnectService() != LE_OK)
+        {
+            return LE_UNAVAILABLE;
+        }
+        IsConnected = true;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Intern a sensor's resources.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSensor
+(
+    uplink_Sensor_t* sensorPtr
+)
+{
+    char seqPath[LE_AVDATA_PATH_NAME_BYTES];
+
+    for (size_t i = 0; i < sensorPtr->modelPtr->numFields; i++)
+    {
+        sensorPtr->handles[i] = avres_Intern(sensorPtr->modelPtr->fields[i].path);
+    }
+
+    snprintf(seqPath, sizeof(seqPath), UPLINK_SEQ_PREFIX "%s", sensorPtr->modelPtr->name);
+    sensorPtr->seqHandle = avres_Intern(seqPath);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the size of a sample recorded as one avdata record value per field, plus one for its
+ * sequence number: a CBOR record per value carrying the full resource path, the value and an
+ * absolute timestamp.  The agent's actual encoding isn't visible to apps.
+ *
+ * @return Bytes.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t EstimateFieldBytes
+(
+    const uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t* samplePtr
+)
+{
+    static const char* const NoName[] = { "" };
+    uint8_t buff[LE_AVDATA_PATH_NAME_BYTES + 32];
+    senml_Pack_t pack;
+    size_t total = 0;
+
+    for (size_t i = 0; i < sensorPtr->modelPtr->numFields; i++)
+    {
+        senml_Start(&pack,
+                    buff,
+                    sizeof(buff),
+                    avres_GetPath(sensorPtr->handles[i]),
+                    samplePtr->timestamp);
+        LE_ASSERT_OK(senml_AddSample(&pack,
+                                     samplePtr->timestamp,
+                                     NoName,
+                                     &samplePtr->values[i],
+                                     1,
+                                     0));
+        total += senml_Finish(&pack);
+    }
+
+    if (samplePtr->seq != 0)
+    {
+        double seq = (double)samplePtr->seq;
+
+        senml_Start(&pack,
+                    buff,
+                    sizeof(buff),
+                    avres_GetPath(sensorPtr->seqHandle),
+                    samplePtr->timestamp);
+        LE_ASSERT_OK(senml_AddSample(&pack, samplePtr->timestamp, NoName, &seq, 1, 0));
+        total += senml_Finish(&pack);
+    }
+
+    return total;
+}
+
+
+static size_t GetFieldMaxBatch
+(
+    void
+)
+{
+    return 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a sensor's oldest sample, each field recorded to its own resource.
+ *
+ * @return LE_OK if the push was started.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PushFields
+(
+    uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t samples[],
+    size_t numSamples,
+    size_t* numPushedPtr,
+    uplink_PushCompleteFunc_t completeFunc,
+    void* contextPtr
+)
+{
+    const model_Sensor_t* modelPtr = sensorPtr->modelPtr;
+    const uplink_Sample_t* samplePtr = &samples[0];
+
+    // Convert the timestamp to an integer number of milliseconds.
+    uint64_t ms = (uint64_t)(samplePtr->timestamp * 1000.0);
+
+    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+
+    le_result_t result = LE_OK;
+
+    for (size_t i = 0; i < modelPtr->numFields; i++)
+    {
+        const model_Field_t* fieldPtr = &modelPtr->fields[i];
+
+        if (fieldPtr->type == MODEL_TYPE_INT)
+        {
+            result = avres_RecordInt(rec, sensorPtr->handles[i], (int32_t)samplePtr->values[i], ms);
+        }
+        else
+        {
+            result = avres_RecordFloat(rec, sensorPtr->handles[i], samplePtr->values[i], ms);
+        }
+
+        if (result != LE_OK)
+        {
+            LE_ERROR("Couldn't record %s reading - %s", fieldPtr->path, LE_RESULT_TXT(result));
+            goto done;
+        }
+    }
+
+    // The resource is an int, which holds about 680 years of samples at a 10 s period.
+    if (samplePtr->seq != 0)
+    {
+        result = avres_RecordInt(rec, sensorPtr->seqHandle, (int32_t)samplePtr->seq, ms);
+        if (result != LE_OK)
+        {
+            LE_ERROR("Couldn't record %s sequence number - %s",
+                     modelPtr->name,
+                     LE_RESULT_TXT(result));
+            goto done;
+        }
+    }
+
+    result = PushRecord(sensorPtr, rec, completeFunc, contextPtr);
+    if (result == LE_OK)
+    {
+        *numPushedPtr = 1;
+
+        FieldStats.pushes++;
+        FieldStats.samples++;
+        FieldStats.payloadBytes += EstimateFieldBytes(sensorPtr, samplePtr);
+    }
+
+done:
+
+    le_avdata_DeleteRecord(rec);
+
+    return result;
+}
+
+
+static void GetFieldStats
+(
+    uplink_Stats_t* statsPtr
+)
+{
+    *statsPtr = FieldStats;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the SenML transport: connect and intern the pack resource.
+ *
+ * @return LE_OK if successful, LE_UNAVAILABLE if the avdata service isn't available.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartSenml
+(
+    void
+)
+{
+    SenmlHandle = avres_Intern(SENML_RES);
+
+    return Connect();
+}
+
+
+static size_t GetSenmlMaxBatch
+(
+    void
+)
+{
+    return SENML_MAX_BATCH;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encodes standard base64 (RFC 4648, with padding).
+ */
+//--------------------------------------------------------------------------------------------------
+static void EncodeBase64
+(
+    const uint8_t* dataPtr,
+    size_t dataLen,
+    char* textPtr,          ///< [OUT] Must have room for 4 * ceil(dataLen / 3) + 1 characters.
+    size_t textSize
+)
+{
+    static const char Alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    LE_ASSERT(textSize > (((dataLen + 2) / 3) * 4));
+
+    size_t t = 0;
+
+    for (size_t i = 0; i < dataLen; i += 3)
+    {
+        uint32_t bits = (uint32_t)dataPtr[i] << 16;
+        if ((i + 1) < dataLen)
+        {
+            bits |= (uint32_t)dataPtr[i + 1] << 8;
+        }
+        if ((i + 2) < dataLen)
+        {
+            bits |= dataPtr[i + 2];
+        }
+
+        textPtr[t++] = Alphabet[(bits >> 18) & 0x3f];
+        textPtr[t++] = Alphabet[(bits >> 12) & 0x3f];
+        textPtr[t++] = ((i + 1) < dataLen) ? Alphabet[(bits >> 6) & 0x3f] : '=';
+        textPtr[t++] = ((i + 2) < dataLen) ? Alphabet[bits & 0x3f] : '=';
+    }
+
+    textPtr[t] = '\0';
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push as many of a sensor's samples as fit in one SenML pack.
+ *
+ * @return LE_OK if the push was started, LE_OVERFLOW if the first sample doesn't fit in a pack.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PushSenml
+(
+    uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t samples[],
+    size_t numSamples,
+    size_t* numPushedPtr,
+    uplink_PushCompleteFunc_t completeFunc,
+    void* contextPtr
+)
+{
+    uint8_t pack[SENML_MAX_PACK_BYTES];
+    size_t packLen;
+    size_t numEncoded;
+
+    le_result_t result = uplink_EncodeSenml(sensorPtr,
+                                            samples,
+                                            numSamples,
+                                            pack,
+                                            sizeof(pack),
+                                            &packLen,
+                                            &numEncoded);
+    if (result != LE_OK)
+    {
+        LE_ERROR("%s sample doesn't fit in a SenML pack.", sensorPtr->modelPtr->name);
+        return result;
+    }
+
+    char text[LE_AVDATA_STRING_VALUE_BYTES];
+    EncodeBase64(pack, packLen, text, sizeof(text));
+
+    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+
+    result = avres_RecordString(rec, SenmlHandle, text, (uint64_t)(samples[0].timestamp * 1000.0));
+    if (result != LE_OK)
+    {
+        LE_ERROR("Couldn't record %s SenML pack - %s",
+                 sensorPtr->modelPtr->name,
+                 LE_RESULT_TXT(result));
+        goto done;
+    }
+
+    result = PushRecord(sensorPtr, rec, completeFunc, contextPtr);
+    if (result == LE_OK)
+    {
+        *numPushedPtr = numEncoded;
+
+        SenmlStats.pushes++;
+        SenmlStats.samples += numEncoded;
+        SenmlStats.payloadBytes += strlen(text);
+    }
+
+done:
+
+    le_avdata_DeleteRecord(rec);
+
+    return result;
+}
+
+
+static void GetSenmlStats
+(
+    uplink_Stats_t* statsPtr
+)
+{
+    *statsPtr = SenmlStats;
+}
+
+
+/// Transport recording each sample field to its own resource.
+const uplink_Transport_t uplink_AvdataTransport =
+{
+    .name="avdata",
+    .start=Connect,
+    .addSensor=AddSensor,
+    .getMaxBatch=GetFieldMaxBatch,
+    .push=PushFields,
+    .getStats=GetFieldStats,
+};
+
+/// Transport recording SenML packs to one string resource.
+const uplink_Transport_t uplink_AvdataSenmlTransport =
+{
+    .name="avdata-senml",
+    .start=StartSenml,
+    .addSensor=AddSensor,
+    .getMaxBatch=GetSenmlMaxBatch,
+    .push=PushSenml,
+    .getStats=GetSenmlStats,
+};
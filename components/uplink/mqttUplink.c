@@ -0,0 +1,946 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file mqttUplink.c
+ *
+ * MQTT uplink transport ("mqtt").  Each push publishes as many of a sensor's samples as fit in a
+ * SenML-CBOR pack (up to 4 KiB) to "<prefix>/<sensor name>" with QoS 1, and completes when the
+ * broker acknowledges it (PUBACK).
+ *
+ * Up to a window of publishes are in flight (sent and not yet acknowledged) at a time; the rest
+ * wait in order.  If the connection drops, the client reconnects with exponential back-off and
+ * resends the unacknowledged publishes (with the DUP flag), then the waiting ones.  Like the
+ * avdata service while its session is down, pushes are kept until they can be delivered.
+ *
+ * This is a minimal MQTT 3.1.1 client (CONNECT, PUBLISH QoS 1, PINGREQ), running on the Legato
+ * event loop with a non-blocking socket.  It is configured by environment variables:
+ *
+ *  - MQTT_BROKER: broker "host:port" (default 127.0.0.1:1883).  The host name is resolved with
+ *    getaddrinfo(), which blocks, so use an address or a name in /etc/hosts.
+ *  - MQTT_CLIENT_ID: client identifier (default redCloud).
+ *  - MQTT_TOPIC_PREFIX: topic prefix (default mangoh/redCloud).
+ *  - MQTT_WINDOW: maximum publishes in flight (default 8).
+ *  - MQTT_KEEP_ALIVE: keep alive interval, in seconds (default 60).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "uplink.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+
+#define DEFAULT_BROKER "127.0.0.1:1883"
+#define DEFAULT_CLIENT_ID "redCloud"
+#define DEFAULT_TOPIC_PREFIX "mangoh/redCloud"
+#define DEFAULT_WINDOW 8
+#define DEFAULT_KEEP_ALIVE 60 // seconds
+
+/// Largest SenML pack published.
+#define MAX_PACK_BYTES 4096
+
+/// Room in front of a pack for the PUBLISH fixed header (at most 5 bytes), topic and packet ID.
+#define PACKET_HEADROOM (5 + 2 + UPLINK_MAX_NAME_BYTES + 2)
+
+/// Size of the buffer of bytes waiting to be written to the socket.
+#define TX_BUFFER_BYTES (16 * 1024)
+
+/// Size of the receive buffer.  Must hold the largest packet handled (CONNACK, PUBACK, PINGRESP);
+/// larger packets are skipped.
+#define RX_BUFFER_BYTES 64
+
+#define MIN_RECONNECT_DELAY_MS 1000
+#define MAX_RECONNECT_DELAY_MS 60000
+
+// MQTT 3.1.1 control packet first bytes.
+#define MQTT_CONNECT        0x10
+#define MQTT_CONNACK        0x20
+#define MQTT_PUBLISH_QOS1   0x32
+#define MQTT_PUBLISH_DUP    0x08
+#define MQTT_PUBACK         0x40
+#define MQTT_PINGREQ        0xc0
+#define MQTT_PINGRESP       0xd0
+
+/// CONNECT flags: clean session.
+#define MQTT_CONNECT_CLEAN_SESSION 0x02
+
+/// MQTT 3.1.1 protocol level.
+#define MQTT_PROTOCOL_LEVEL 4
+
+
+/// Broker connection state.
+typedef enum
+{
+    CONN_DOWN,          ///< Not connected (a reconnect is scheduled).
+    CONN_CONNECTING,    ///< TCP connection in progress.
+    CONN_WAIT_CONNACK,  ///< CONNECT sent.
+    CONN_UP,            ///< Connected; publishes can be sent.
+}
+ConnState_t;
+
+
+/// A publish waiting to be sent or acknowledged.
+typedef struct
+{
+    le_dls_Link_t link;             ///< In the Messages list.
+    uplink_Sensor_t* sensorPtr;     ///< Sensor whose push this is.
+    uint16_t packetId;
+    bool isInFlight;                ///< Sent on the current connection, not yet acknowledged.
+    bool wasSent;                   ///< Sent before, so a resend must have the DUP flag.
+    size_t start;                   ///< Offset of the PUBLISH packet in packet[].
+    size_t len;                     ///< Length of the PUBLISH packet.
+    uint8_t packet[PACKET_HEADROOM + MAX_PACK_BYTES];
+}
+Message_t;
+
+
+static const char* BrokerHost;
+static char BrokerHostBuff[256];
+static const char* BrokerPort;
+static const char* ClientId;
+static const char* TopicPrefix;
+static int Window;
+static int KeepAlive;
+
+static ConnState_t State = CONN_DOWN;
+static int Socket = -1;
+static le_fdMonitor_Ref_t Monitor = NULL;
+
+static le_timer_Ref_t ReconnectTimer;
+static uint32_t ReconnectDelayMs = MIN_RECONNECT_DELAY_MS;
+
+static le_timer_Ref_t KeepAliveTimer;
+static bool IsPingOutstanding = false;
+
+/// Publishes in push order.
+static le_dls_List_t Messages = LE_DLS_LIST_INIT;
+static le_mem_PoolRef_t MessagePool;
+static int NumInFlight = 0;
+static uint16_t LastPacketId = 0;
+
+static uint8_t TxBuff[TX_BUFFER_BYTES];
+static size_t TxLen = 0;
+
+static uint8_t RxBuff[RX_BUFFER_BYTES];
+static size_t RxLen = 0;
+static size_t RxSkip = 0;           ///< Bytes still to be discarded of a packet too big for RxBuff.
+
+static uplink_Stats_t Stats = { 0 };
+
+
+static void Connect(void);
+static void SendWaiting(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode an MQTT "remaining length" (variable byte integer).
+ *
+ * @return The number of bytes encoded (1 to 4).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t EncodeLength
+(
+    uint8_t* buffPtr,
+    size_t length
+)
+{
+    size_t n = 0;
+
+    do
+    {
+        uint8_t byte = length % 128;
+        length /= 128;
+        buffPtr[n++] = (length > 0) ? (byte | 0x80) : byte;
+    }
+    while (length > 0);
+
+    return n;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the connection and schedule a reconnect.  Publishes in flight are resent after the
+ * reconnect.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Drop
+(
+    void
+)
+{
+    if (Monitor != NULL)
+    {
+        le_fdMonitor_Delete(Monitor);
+        Monitor = NULL;
+    }
+    if (Socket >= 0)
+    {
+        close(Socket);
+        Socket = -1;
+    }
+
+    State = CONN_DOWN;
+    TxLen = 0;
+    RxLen = 0;
+    RxSkip = 0;
+    NumInFlight = 0;
+    IsPingOutstanding = false;
+    le_timer_Stop(KeepAliveTimer);
+
+    for (le_dls_Link_t* linkPtr = le_dls_Peek(&Messages);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(&Messages, linkPtr))
+    {
+        CONTAINER_OF(linkPtr, Message_t, link)->isInFlight = false;
+    }
+
+    LE_INFO("Reconnecting to MQTT broker %s:%s in %" PRIu32 " ms.",
+            BrokerHost,
+            BrokerPort,
+            ReconnectDelayMs);
+
+    le_timer_SetMsInterval(ReconnectTimer, ReconnectDelayMs);
+    le_timer_Start(ReconnectTimer);
+
+    ReconnectDelayMs *= 2;
+    if (ReconnectDelayMs > MAX_RECONNECT_DELAY_MS)
+    {
+        ReconnectDelayMs = MAX_RECONNECT_DELAY_MS;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write as much of the transmit buffer to the socket as it takes.  Waits for the socket to be
+ * writable again if some is left.
+ *
+ * @return false if the connection was dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Flush
+(
+    void
+)
+{
+    while (TxLen > 0)
+    {
+        ssize_t n = send(Socket, TxBuff, TxLen, MSG_NOSIGNAL);
+
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                le_fdMonitor_Enable(Monitor, POLLOUT);
+                return true;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LE_WARN("MQTT send failed - %m");
+            Drop();
+            return false;
+        }
+
+        Stats.wireBytes += n;
+        TxLen -= n;
+        memmove(TxBuff, TxBuff + n, TxLen);
+    }
+
+    le_fdMonitor_Disable(Monitor, POLLOUT);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a packet to the transmit buffer and start writing it.
+ *
+ * @return false if it doesn't fit in the transmit buffer right now, or if writing it dropped the
+ *         connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Send
+(
+    const uint8_t* packetPtr,
+    size_t len
+)
+{
+    if ((TX_BUFFER_BYTES - TxLen) < len)
+    {
+        return false;
+    }
+
+    memcpy(TxBuff + TxLen, packetPtr, len);
+    TxLen += len;
+
+    return Flush();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send the CONNECT packet.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SendConnect
+(
+    void
+)
+{
+    uint8_t packet[32 + UPLINK_MAX_NAME_BYTES];
+    uint8_t body[sizeof(packet)];
+    size_t clientIdLen = strlen(ClientId);
+    size_t n = 0;
+
+    LE_ASSERT(clientIdLen < UPLINK_MAX_NAME_BYTES);
+
+    // Variable header: protocol name, level, flags, keep alive.
+    body[n++] = 0;
+    body[n++] = 4;
+    memcpy(body + n, "MQTT", 4);
+    n += 4;
+    body[n++] = MQTT_PROTOCOL_LEVEL;
+    body[n++] = MQTT_CONNECT_CLEAN_SESSION;
+    body[n++] = (uint8_t)(KeepAlive >> 8);
+    body[n++] = (uint8_t)KeepAlive;
+
+    // Payload: client identifier.
+    body[n++] = (uint8_t)(clientIdLen >> 8);
+    body[n++] = (uint8_t)clientIdLen;
+    memcpy(body + n, ClientId, clientIdLen);
+    n += clientIdLen;
+
+    packet[0] = MQTT_CONNECT;
+    size_t headerLen = 1 + EncodeLength(packet + 1, n);
+    memcpy(packet + headerLen, body, n);
+
+    State = CONN_WAIT_CONNACK;
+    Send(packet, headerLen + n);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send as many waiting publishes as the window and transmit buffer allow, oldest first.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SendWaiting
+(
+    void
+)
+{
+    for (le_dls_Link_t* linkPtr = le_dls_Peek(&Messages);
+         (linkPtr != NULL) && (State == CONN_UP) && (NumInFlight < Window);
+         linkPtr = le_dls_PeekNext(&Messages, linkPtr))
+    {
+        Message_t* msgPtr = CONTAINER_OF(linkPtr, Message_t, link);
+
+        if (msgPtr->isInFlight)
+        {
+            continue;
+        }
+
+        if (msgPtr->wasSent)
+        {
+            msgPtr->packet[msgPtr->start] |= MQTT_PUBLISH_DUP;
+        }
+
+        if (!Send(msgPtr->packet + msgPtr->start, msgPtr->len))
+        {
+            break;
+        }
+
+        msgPtr->isInFlight = true;
+        msgPtr->wasSent = true;
+        NumInFlight++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a PUBACK: complete the push it acknowledges.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePubAck
+(
+    uint16_t packetId
+)
+{
+    for (le_dls_Link_t* linkPtr = le_dls_Peek(&Messages);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(&Messages, linkPtr))
+    {
+        Message_t* msgPtr = CONTAINER_OF(linkPtr, Message_t, link);
+
+        if (msgPtr->isInFlight && (msgPtr->packetId == packetId))
+        {
+            uplink_Sensor_t* sensorPtr = msgPtr->sensorPtr;
+
+            le_dls_Remove(&Messages, linkPtr);
+            le_mem_Release(msgPtr);
+            NumInFlight--;
+
+            // May push again, which queues another message.
+            sensorPtr->completeFunc(true, sensorPtr->completeContextPtr);
+
+            return;
+        }
+    }
+
+    LE_WARN("PUBACK for unknown packet ID %u.", packetId);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a packet received from the broker.
+ *
+ * @return false if the connection was dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HandlePacket
+(
+    uint8_t type,
+    const uint8_t* bodyPtr,
+    size_t bodyLen
+)
+{
+    switch (type & 0xf0)
+    {
+        case MQTT_CONNACK:
+
+            if ((State != CONN_WAIT_CONNACK) || (bodyLen != 2) || (bodyPtr[1] != 0))
+            {
+                LE_ERROR("MQTT connection refused (return code %d).",
+                         (bodyLen == 2) ? bodyPtr[1] : -1);
+                Drop();
+                return false;
+            }
+
+            LE_INFO("Connected to MQTT broker %s:%s.", BrokerHost, BrokerPort);
+
+            State = CONN_UP;
+            ReconnectDelayMs = MIN_RECONNECT_DELAY_MS;
+            le_timer_Start(KeepAliveTimer);
+            break;
+
+        case MQTT_PUBACK:
+
+            if (bodyLen == 2)
+            {
+                HandlePubAck(((uint16_t)bodyPtr[0] << 8) | bodyPtr[1]);
+            }
+            break;
+
+        case MQTT_PINGRESP:
+
+            IsPingOutstanding = false;
+            break;
+
+        default:
+
+            LE_DEBUG("Ignoring MQTT packet type 0x%02x.", type);
+            break;
+    }
+
+    // A completion callback may have pushed, and writing that may have dropped the connection.
+    return (State != CONN_DOWN);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read what the broker sent and handle the complete packets in it.
+ *
+ * @return false if the connection was dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool Receive
+(
+    void
+)
+{
+    for (;;)
+    {
+        ssize_t n = recv(Socket, RxBuff + RxLen, sizeof(RxBuff) - RxLen, 0);
+
+        if (n == 0)
+        {
+            LE_WARN("MQTT broker closed the connection.");
+            Drop();
+            return false;
+        }
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                return true;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LE_WARN("MQTT receive failed - %m");
+            Drop();
+            return false;
+        }
+
+        Stats.wireBytes += n;
+        RxLen += n;
+
+        // Discard the rest of a packet too big to handle.
+        size_t skip = (RxSkip < RxLen) ? RxSkip : RxLen;
+        RxSkip -= skip;
+        RxLen -= skip;
+        memmove(RxBuff, RxBuff + skip, RxLen);
+
+        // Handle the complete packets.
+        for (;;)
+        {
+            size_t bodyLen = 0;
+            size_t headerLen = 1;
+            bool isLengthComplete = false;
+
+            while ((headerLen < RxLen) && (headerLen <= 4))
+            {
+                uint8_t byte = RxBuff[headerLen];
+                bodyLen |= (size_t)(byte & 0x7f) << (7 * (headerLen - 1));
+                headerLen++;
+                if ((byte & 0x80) == 0)
+                {
+                    isLengthComplete = true;
+                    break;
+                }
+            }
+
+            if (!isLengthComplete)
+            {
+                if (headerLen > 4)
+                {
+                    LE_ERROR("Malformed MQTT packet length.");
+                    Drop();
+                    return false;
+                }
+                break;
+            }
+
+            if ((headerLen + bodyLen) > sizeof(RxBuff))
+            {
+                LE_DEBUG("Skipping %zu byte MQTT packet.", headerLen + bodyLen);
+                RxSkip = headerLen + bodyLen - RxLen;
+                RxLen = 0;
+                break;
+            }
+
+            if ((headerLen + bodyLen) > RxLen)
+            {
+                break;
+            }
+
+            if (!HandlePacket(RxBuff[0], RxBuff + headerLen, bodyLen))
+            {
+                return false;
+            }
+
+            RxLen -= headerLen + bodyLen;
+            memmove(RxBuff, RxBuff + headerLen + bodyLen, RxLen);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle events on the broker connection's socket.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleSocket
+(
+    int fd,
+    short events
+)
+{
+    if (State == CONN_CONNECTING)
+    {
+        if (!(events & (POLLOUT | POLLERR | POLLHUP)))
+        {
+            return;
+        }
+
+        int error = 0;
+        socklen_t errorLen = sizeof(error);
+        if ((getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) != 0) || (error != 0))
+        {
+            LE_WARN("Couldn't connect to MQTT broker %s:%s - %s",
+                    BrokerHost,
+                    BrokerPort,
+                    strerror(error));
+            Drop();
+            return;
+        }
+
+        SendConnect();
+        return;
+    }
+
+    if ((events & POLLIN) && !Receive())
+    {
+        return;
+    }
+
+    if (events & (POLLERR | POLLHUP))
+    {
+        LE_WARN("MQTT connection lost.");
+        Drop();
+        return;
+    }
+
+    if ((events & POLLOUT) && !Flush())
+    {
+        return;
+    }
+
+    SendWaiting();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start connecting to the broker.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Connect
+(
+    void
+)
+{
+    struct addrinfo hints;
+    struct addrinfo* resultPtr = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    int error = getaddrinfo(BrokerHost, BrokerPort, &hints, &resultPtr);
+    if (error != 0)
+    {
+        LE_WARN("Couldn't resolve MQTT broker '%s' - %s", BrokerHost, gai_strerror(error));
+        Drop();
+        return;
+    }
+
+    Socket = socket(resultPtr->ai_family,
+                    resultPtr->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    resultPtr->ai_protocol);
+    if (Socket < 0)
+    {
+        LE_WARN("Couldn't create socket - %m");
+        freeaddrinfo(resultPtr);
+        Drop();
+        return;
+    }
+
+    // Publishes are written whole, so don't hold back small ones (PUBACKs are waited on).
+    int one = 1;
+    setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int result = connect(Socket, resultPtr->ai_addr, resultPtr->ai_addrlen);
+    freeaddrinfo(resultPtr);
+
+    if ((result != 0) && (errno != EINPROGRESS))
+    {
+        LE_WARN("Couldn't connect to MQTT broker %s:%s - %m", BrokerHost, BrokerPort);
+        Drop();
+        return;
+    }
+
+    Monitor = le_fdMonitor_Create("mqttBroker", Socket, HandleSocket, POLLIN | POLLOUT);
+
+    State = CONN_CONNECTING;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reconnect timer expiry handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleReconnectTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    Connect();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keep alive timer expiry handler.  Pings the broker, or drops the connection if the last ping
+ * went unanswered.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleKeepAliveTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    if (IsPingOutstanding)
+    {
+        LE_WARN("MQTT broker stopped answering pings.");
+        Drop();
+        return;
+    }
+
+    static const uint8_t PingReq[] = { MQTT_PINGREQ, 0 };
+
+    // Set first: if writing drops the connection, that clears it.
+    IsPingOutstanding = true;
+    if (!Send(PingReq, sizeof(PingReq)))
+    {
+        IsPingOutstanding = false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get an integer environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.  Terminates the process if the
+ *         value isn't a positive integer.
+ */
+//--------------------------------------------------------------------------------------------------
+static int GetIntEnv
+(
+    const char* name,
+    int defaultValue
+)
+{
+    const char* text = getenv(name);
+    if (text == NULL)
+    {
+        return defaultValue;
+    }
+
+    char* endPtr;
+    long value = strtol(text, &endPtr, 10);
+    LE_FATAL_IF((*endPtr != '\0') || (value <= 0) || (value > UINT16_MAX),
+                "%s must be a positive integer (not '%s').",
+                name,
+                text);
+
+    return (int)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a string environment variable.
+ *
+ * @return The value, or the default if the variable isn't set.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* GetStringEnv
+(
+    const char* name,
+    const char* defaultValue
+)
+{
+    const char* text = getenv(name);
+
+    return (text != NULL) ? text : defaultValue;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the transport: read the configuration and start connecting to the broker.
+ *
+ * @return LE_OK.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Start
+(
+    void
+)
+{
+    const char* broker = GetStringEnv("MQTT_BROKER", DEFAULT_BROKER);
+    const char* colonPtr = strrchr(broker, ':');
+
+    LE_FATAL_IF((colonPtr == NULL) || ((size_t)(colonPtr - broker) >= sizeof(BrokerHostBuff)),
+                "MQTT_BROKER must be host:port (not '%s').",
+                broker);
+    memcpy(BrokerHostBuff, broker, colonPtr - broker);
+    BrokerHostBuff[colonPtr - broker] = '\0';
+    BrokerHost = BrokerHostBuff;
+    BrokerPort = colonPtr + 1;
+
+    ClientId = GetStringEnv("MQTT_CLIENT_ID", DEFAULT_CLIENT_ID);
+    TopicPrefix = GetStringEnv("MQTT_TOPIC_PREFIX", DEFAULT_TOPIC_PREFIX);
+    Window = GetIntEnv("MQTT_WINDOW", DEFAULT_WINDOW);
+    KeepAlive = GetIntEnv("MQTT_KEEP_ALIVE", DEFAULT_KEEP_ALIVE);
+
+    LE_FATAL_IF(strlen(ClientId) >= UPLINK_MAX_NAME_BYTES, "MQTT_CLIENT_ID is too long.");
+
+    MessagePool = le_mem_CreatePool("MqttMessage", sizeof(Message_t));
+
+    ReconnectTimer = le_timer_Create("MqttReconnect");
+    le_timer_SetHandler(ReconnectTimer, HandleReconnectTimer);
+
+    // Ping at half the keep alive interval, so the broker hears from us well within it.
+    KeepAliveTimer = le_timer_Create("MqttKeepAlive");
+    le_timer_SetHandler(KeepAliveTimer, HandleKeepAliveTimer);
+    le_timer_SetMsInterval(KeepAliveTimer, (uint32_t)KeepAlive * 500);
+    le_timer_SetRepeat(KeepAliveTimer, 0);
+
+    Connect();
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a sensor's topic.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSensor
+(
+    uplink_Sensor_t* sensorPtr
+)
+{
+    int len = snprintf(sensorPtr->topic,
+                       sizeof(sensorPtr->topic),
+                       "%s/%s",
+                       TopicPrefix,
+                       sensorPtr->modelPtr->name);
+
+    LE_FATAL_IF(len >= (int)sizeof(sensorPtr->topic), "MQTT topic prefix is too long.");
+}
+
+
+static size_t GetMaxBatch
+(
+    void
+)
+{
+    return UPLINK_MAX_BATCH;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish as many of a sensor's samples as fit in one SenML pack.
+ *
+ * @return LE_OK if the push was started, LE_OVERFLOW if the first sample doesn't fit in a pack.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Push
+(
+    uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t samples[],
+    size_t numSamples,
+    size_t* numPushedPtr,
+    uplink_PushCompleteFunc_t completeFunc,
+    void* contextPtr
+)
+{
+    Message_t* msgPtr = le_mem_ForceAlloc(MessagePool);
+    size_t packLen;
+    size_t numEncoded;
+
+    le_result_t result = uplink_EncodeSenml(sensorPtr,
+                                            samples,
+                                            numSamples,
+                                            msgPtr->packet + PACKET_HEADROOM,
+                                            MAX_PACK_BYTES,
+                                            &packLen,
+                                            &numEncoded);
+    if (result != LE_OK)
+    {
+        LE_ERROR("%s sample doesn't fit in a SenML pack.", sensorPtr->modelPtr->name);
+        le_mem_Release(msgPtr);
+        return result;
+    }
+
+    // Packet IDs must be non-zero.
+    LastPacketId = (LastPacketId == UINT16_MAX) ? 1 : (LastPacketId + 1);
+
+    // Build the variable header (topic, packet ID) and fixed header backwards from the pack.
+    size_t topicLen = strlen(sensorPtr->topic);
+    size_t start = PACKET_HEADROOM - (2 + topicLen + 2);
+    uint8_t* p = msgPtr->packet + start;
+
+    p[0] = (uint8_t)(topicLen >> 8);
+    p[1] = (uint8_t)topicLen;
+    memcpy(p + 2, sensorPtr->topic, topicLen);
+    p[2 + topicLen] = (uint8_t)(LastPacketId >> 8);
+    p[3 + topicLen] = (uint8_t)LastPacketId;
+
+    size_t remainingLen = (PACKET_HEADROOM - start) + packLen;
+    uint8_t header[5];
+    header[0] = MQTT_PUBLISH_QOS1;
+    size_t headerLen = 1 + EncodeLength(header + 1, remainingLen);
+
+    start -= headerLen;
+    memcpy(msgPtr->packet + start, header, headerLen);
+
+    msgPtr->link = LE_DLS_LINK_INIT;
+    msgPtr->sensorPtr = sensorPtr;
+    msgPtr->packetId = LastPacketId;
+    msgPtr->isInFlight = false;
+    msgPtr->wasSent = false;
+    msgPtr->start = start;
+    msgPtr->len = headerLen + remainingLen;
+
+    sensorPtr->completeFunc = completeFunc;
+    sensorPtr->completeContextPtr = contextPtr;
+
+    le_dls_Queue(&Messages, &msgPtr->link);
+
+    *numPushedPtr = numEncoded;
+
+    Stats.pushes++;
+    Stats.samples += numEncoded;
+    Stats.payloadBytes += packLen;
+
+    SendWaiting();
+
+    return LE_OK;
+}
+
+
+static void GetStats
+(
+    uplink_Stats_t* statsPtr
+)
+{
+    *statsPtr = Stats;
+}
+
+
+/// Transport publishing SenML packs to an MQTT broker.
+const uplink_Transport_t uplink_MqttTransport =
+{
+    .name="mqtt",
+    .start=Start,
+    .addSensor=AddSensor,
+    .getMaxBatch=GetMaxBatch,
+    .push=Push,
+    .getStats=GetStats,
+};
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file uplink.c
+ *
+ * Uplink transport registry and the parts common to all transports.  See uplink.h.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "uplink.h"
+#include "senml.h"
+
+
+// Transports, defined in avdataUplink.c and mqttUplink.c.
+extern const uplink_Transport_t uplink_AvdataTransport;
+extern const uplink_Transport_t uplink_AvdataSenmlTransport;
+extern const uplink_Transport_t uplink_MqttTransport;
+
+static const uplink_Transport_t* const Transports[] =
+{
+    &uplink_AvdataTransport,
+    &uplink_AvdataSenmlTransport,
+    &uplink_MqttTransport,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a transport by name.
+ *
+ * @return The transport, or NULL if there is none by that name.
+ */
+//--------------------------------------------------------------------------------------------------
+const uplink_Transport_t* uplink_FindTransport
+(
+    const char* name
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(Transports); i++)
+    {
+        if (strcmp(Transports[i]->name, name) == 0)
+        {
+            return Transports[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the transport-independent part of a sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+void uplink_InitSensor
+(
+    uplink_Sensor_t* sensorPtr,
+    const model_Sensor_t* modelPtr
+)
+{
+    const char* paths[MODEL_MAX_FIELDS];
+
+    memset(sensorPtr, 0, sizeof(*sensorPtr));
+    sensorPtr->modelPtr = modelPtr;
+
+    for (size_t i = 0; i < modelPtr->numFields; i++)
+    {
+        paths[i] = modelPtr->fields[i].path;
+    }
+
+    // Split the paths into a SenML base name and names relative to it.
+    size_t baseNameLen = senml_GetBaseNameLen(paths, modelPtr->numFields);
+    LE_ASSERT(baseNameLen < sizeof(sensorPtr->senmlBaseName));
+    memcpy(sensorPtr->senmlBaseName, paths[0], baseNameLen);
+    sensorPtr->senmlBaseName[baseNameLen] = '\0';
+
+    for (size_t i = 0; i < modelPtr->numFields; i++)
+    {
+        sensorPtr->senmlNames[i] = paths[i] + baseNameLen;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode as many of a batch of samples as fit into a SenML-CBOR pack.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if not even the first sample fits.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t uplink_EncodeSenml
+(
+    const uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t samples[],
+    size_t numSamples,
+    uint8_t* buffPtr,
+    size_t buffSize,
+    size_t* lenPtr,             ///< [OUT] Size of the pack.
+    size_t* numEncodedPtr       ///< [OUT] Number of samples in the pack.
+)
+{
+    LE_ASSERT(numSamples > 0);
+
+    senml_Pack_t pack;
+    size_t n = 0;
+
+    senml_Start(&pack, buffPtr, buffSize, sensorPtr->senmlBaseName, samples[0].timestamp);
+
+    while (   (n < numSamples)
+           && (senml_AddSample(&pack,
+                               samples[n].timestamp,
+                               sensorPtr->senmlNames,
+                               samples[n].values,
+                               sensorPtr->modelPtr->numFields,
+                               samples[n].seq) == LE_OK))
+    {
+        n++;
+    }
+
+    *lenPtr = senml_Finish(&pack);
+    *numEncodedPtr = n;
+
+    return (n > 0) ? LE_OK : LE_OVERFLOW;
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,202 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file uplink.h
+ *
+ * Uplink transports: the ways sensor samples get from the cloud publisher to a cloud service.
+ *
+ *  - "avdata": each sample field is recorded to its own AirVantage resource (le_avdata).
+ *  - "avdata-senml": samples are batched into SenML-CBOR packs, recorded base64-encoded to one
+ *    AirVantage string resource.
+ *  - "mqtt": samples are batched into SenML-CBOR packs, published with QoS 1 to an MQTT broker,
+ *    with a window of unacknowledged publishes in flight.
+ *
+ * A push hands a transport a batch of one sensor's samples, oldest first.  The transport pushes
+ * as many of them as it can carry in one go, and later reports the outcome of the push through
+ * the completion function, as the avdata service does for its own pushes.  Pushes that can't be
+ * sent yet (e.g., while the connection is down) are kept by the transport until they can be.
+ *
+ * Every sample is sent with its sequence number (see pushTracker.h), for the server to drop the
+ * duplicates of retried pushes: as the "seq" label of the sample in SenML packs, and recorded to
+ * the sensor's UPLINK_SEQ_PREFIX<sensor> resource with the sample's timestamp by "avdata".
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef UPLINK_H_INCLUDE_GUARD
+#define UPLINK_H_INCLUDE_GUARD
+
+#include "assetModel.h"
+#include "avResource.h"
+
+
+/// Largest number of samples in a batch.
+#define UPLINK_MAX_BATCH 64
+
+/// Size of the buffers holding a SenML base name or an MQTT topic (including null terminator).
+#define UPLINK_MAX_NAME_BYTES 128
+
+/// Prefix of the "avdata" transport's per-sensor sequence number resources.
+#define UPLINK_SEQ_PREFIX "MangOH.Sensors.Seq."
+
+
+/// A sensor sample, as the values of its sensor's asset model descriptor fields.
+typedef struct
+{
+    double timestamp;                   ///< Seconds since the Epoch.
+    double values[MODEL_MAX_FIELDS];
+    uint64_t seq;                       ///< Sequence number, or 0 for none.
+}
+uplink_Sample_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push completion callback.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*uplink_PushCompleteFunc_t)
+(
+    bool isSuccess,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A sensor whose samples are pushed through a transport.  Initialized by uplink_InitSensor()
+ * and the transport's addSensor function.  A sensor can only have one push in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const model_Sensor_t* modelPtr;     ///< What is published, and where.
+    char senmlBaseName[UPLINK_MAX_NAME_BYTES]; ///< Common prefix of the fields' paths.
+    const char* senmlNames[MODEL_MAX_FIELDS];  ///< Field paths, relative to senmlBaseName.
+    avres_Handle_t handles[MODEL_MAX_FIELDS];  ///< avdata: interned resource of each field.
+    avres_Handle_t seqHandle;           ///< avdata: interned sequence number resource.
+    char topic[UPLINK_MAX_NAME_BYTES];  ///< mqtt: topic the sensor's packs are published to.
+    uplink_PushCompleteFunc_t completeFunc; ///< Completion callback of the push in progress.
+    void* completeContextPtr;           ///< Context of completeFunc.
+}
+uplink_Sensor_t;
+
+
+/// Counters of a transport's activity, for comparing transports.
+typedef struct
+{
+    uint64_t pushes;        ///< Pushes started.
+    uint64_t samples;       ///< Samples in those pushes.
+    uint64_t payloadBytes;  ///< Encoded sample data (estimated for per-field avdata records).
+    int64_t wireBytes;      ///< Bytes sent and received on the network, or -1 if not known.
+}
+uplink_Stats_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operations of a transport.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* name;
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Start the transport (connect to services, read its configuration).
+     *
+     * @return LE_OK if successful, LE_UNAVAILABLE if a service it needs isn't available.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*start)(void);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Prepare a sensor (initialized by uplink_InitSensor()) to be pushed.
+     */
+    //----------------------------------------------------------------------------------------------
+    void (*addSensor)(uplink_Sensor_t* sensorPtr);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Get the largest number of samples worth offering in one push.
+     */
+    //----------------------------------------------------------------------------------------------
+    size_t (*getMaxBatch)(void);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Start pushing a batch of a sensor's samples.  If LE_OK is returned, the outcome is reported
+     * later through the completion callback, which is never called before this returns.
+     *
+     * @return
+     *  - LE_OK if the push was started
+     *  - LE_OVERFLOW if the first sample can't be encoded in one push
+     *  - Anything else if the push couldn't be started.
+     */
+    //----------------------------------------------------------------------------------------------
+    le_result_t (*push)(uplink_Sensor_t* sensorPtr,
+                        const uplink_Sample_t samples[],
+                        size_t numSamples,
+                        size_t* numPushedPtr,   ///< [OUT] How many of the samples are pushed.
+                        uplink_PushCompleteFunc_t completeFunc,
+                        void* contextPtr);
+
+    //----------------------------------------------------------------------------------------------
+    /**
+     * Get the transport's activity counters.
+     */
+    //----------------------------------------------------------------------------------------------
+    void (*getStats)(uplink_Stats_t* statsPtr);
+}
+uplink_Transport_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a transport by name.
+ *
+ * @return The transport, or NULL if there is none by that name.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED const uplink_Transport_t* uplink_FindTransport
+(
+    const char* name
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the transport-independent part of a sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void uplink_InitSensor
+(
+    uplink_Sensor_t* sensorPtr,
+    const model_Sensor_t* modelPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode as many of a batch of samples as fit into a SenML-CBOR pack.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if not even the first sample fits.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t uplink_EncodeSenml
+(
+    const uplink_Sensor_t* sensorPtr,
+    const uplink_Sample_t samples[],
+    size_t numSamples,
+    uint8_t* buffPtr,
+    size_t buffSize,
+    size_t* lenPtr,             ///< [OUT] Size of the pack.
+    size_t* numEncodedPtr       ///< [OUT] Number of samples in the pack.
+);
+
+
+#endif // UPLINK_H_INCLUDE_GUARD
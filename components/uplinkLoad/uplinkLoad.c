@@ -0,0 +1,476 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file uplinkLoad.c
+ *
+ * Load generator for the uplink transports (see uplink.h).
+ *
+ * Usage: uplinkload [--sensor=NAME] [--samples=N] [--streams=N] [--timeout=S] [--output=FILE]
+ *                   TRANSPORT...
+ *
+ * Pushes synthetic samples of one sensor (default accel) through each named transport in turn,
+ * as fast as the transport acknowledges them, the way the cloud publisher pushes its backlog
+ * after an outage.  Each of --streams (default 1) streams has --samples (default 10000) samples
+ * and one push in progress at a time, like one of the cloud publisher's sensors; more streams
+ * keep more pushes in flight at once (e.g., to fill the MQTT publish window).  A failed push is
+ * retried.  A run ends when every sample has been acknowledged.  If that takes longer than
+ * --timeout seconds (default 300), the run is reported and the remaining transports are skipped.
+ *
+ * The avdata transports need an AirVantage session, so run them while redCloud is running.
+ *
+ * One JSON object is output per transport, for example:
+ *
+ * {"suite":"redUplink","version":1,"transport":"mqtt","sensor":"accel","streams":8,
+ *  "samples":80000,"acked":80000,"pushes":1256,"failed_pushes":0,"elapsed_s":0.96,
+ *  "samples_per_s":83235.5,"pushes_per_s":1306.8,"mean_ack_ms":6.1,
+ *  "payload_bytes_per_sample":60.6,"wire_bytes_per_sample":61.1,"overhead":0.008}
+ *
+ *  - acked: samples whose push was acknowledged.
+ *  - payload_bytes_per_sample: encoded sample data (estimated for the "avdata" transport).
+ *  - wire_bytes_per_sample: bytes sent and received on the network per sample acked, or null if
+ *    the transport can't tell (avdata: the AirVantage agent does the networking).
+ *  - overhead: wire bytes beyond the payload, as a fraction of the payload (or null).
+ *
+ * Results go to stdout, and are also appended to the output file if one is given.  The process
+ * exits with status 1 if a run timed out or a transport couldn't start.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "uplink.h"
+
+
+/// Version of the result record format.
+#define RESULT_VERSION 1
+
+#define MAX_STREAMS 64
+#define MAX_TRANSPORTS 8
+
+#define SYNTH_PERIOD 0.01 // seconds
+#define SYNTH_START_TIME 1500000000.0
+
+
+/// A stream of samples of the sensor, pushed one push at a time.
+typedef struct
+{
+    uplink_Sensor_t uplink;
+    uplink_Sample_t* samplesPtr;
+    size_t next;                ///< Index of the first sample not yet acknowledged.
+    size_t numInPush;           ///< Samples in the push in progress, or 0 if none.
+    le_clk_Time_t pushStart;    ///< When the push in progress was started.
+    bool isStalled;             ///< A push couldn't be started; the stream is abandoned.
+}
+Stream_t;
+
+
+static const char* SensorName = "accel";
+static int NumSamples = 10000;
+static int NumStreams = 1;
+static int Timeout = 300;
+static const char* OutputPath = NULL;
+static FILE* OutputFile = NULL;
+
+static const char* TransportNames[MAX_TRANSPORTS];
+static size_t NumTransports = 0;
+static size_t TransportIndex = 0;   ///< Index in TransportNames of the current run.
+
+static const model_Sensor_t* ModelPtr;
+static Stream_t Streams[MAX_STREAMS];
+
+/// Current run.
+static const uplink_Transport_t* Transport;
+static uplink_Stats_t StatsAtStart;
+static le_clk_Time_t RunStart;
+static uint64_t FailedPushes;
+static uint64_t NumAcks;
+static double AckTimeSum;           ///< seconds
+static le_timer_Ref_t TimeoutTimer;
+
+static bool IsAnyRunFailed = false;
+
+
+static void StartRun(void* param1Ptr, void* param2Ptr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generate the synthetic samples of every stream.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Synthesize
+(
+    void
+)
+{
+    unsigned int seed = 1;
+
+    for (int s = 0; s < NumStreams; s++)
+    {
+        uplink_Sample_t* samplesPtr = calloc(NumSamples, sizeof(uplink_Sample_t));
+        LE_ASSERT(samplesPtr != NULL);
+
+        for (int n = 0; n < NumSamples; n++)
+        {
+            for (size_t i = 0; i < ModelPtr->numFields; i++)
+            {
+                double noise = ((double)rand_r(&seed) / RAND_MAX) - 0.5;
+
+                if (ModelPtr->fields[i].type == MODEL_TYPE_INT)
+                {
+                    samplesPtr[n].values[i] = round(400.0 + (100.0 * noise));
+                }
+                else
+                {
+                    samplesPtr[n].values[i] = round((10.0 * (i + 1) + noise) * 1e6) / 1e6;
+                }
+            }
+
+            samplesPtr[n].timestamp = SYNTH_START_TIME + (n * SYNTH_PERIOD);
+        }
+
+        Streams[s].samplesPtr = samplesPtr;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a result line to stdout and the output file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Report
+(
+    const char* transportName,
+    uint64_t acked,
+    const uplink_Stats_t* statsPtr, ///< Transport activity during the run.
+    double elapsed                  ///< seconds
+)
+{
+    char line[768];
+    char wire[32] = "null";
+    char overhead[32] = "null";
+    uint64_t samples = (uint64_t)NumSamples * NumStreams;
+
+    if ((statsPtr->wireBytes >= 0) && (acked > 0) && (statsPtr->payloadBytes > 0))
+    {
+        snprintf(wire, sizeof(wire), "%.1f", (double)statsPtr->wireBytes / acked);
+        snprintf(overhead,
+                 sizeof(overhead),
+                 "%.3f",
+                 ((double)statsPtr->wireBytes - statsPtr->payloadBytes) / statsPtr->payloadBytes);
+    }
+
+    snprintf(line,
+             sizeof(line),
+             "{\"suite\":\"redUplink\",\"version\":%d,\"transport\":\"%s\",\"sensor\":\"%s\","
+             "\"streams\":%d,\"samples\":%" PRIu64 ",\"acked\":%" PRIu64 ","
+             "\"pushes\":%" PRIu64 ",\"failed_pushes\":%" PRIu64 ",\"elapsed_s\":%.2f,"
+             "\"samples_per_s\":%.1f,\"pushes_per_s\":%.1f,\"mean_ack_ms\":%.1f,"
+             "\"payload_bytes_per_sample\":%.1f,\"wire_bytes_per_sample\":%s,\"overhead\":%s}",
+             RESULT_VERSION,
+             transportName,
+             SensorName,
+             NumStreams,
+             samples,
+             acked,
+             statsPtr->pushes,
+             FailedPushes,
+             elapsed,
+             (elapsed > 0.0) ? (acked / elapsed) : 0.0,
+             (elapsed > 0.0) ? (statsPtr->pushes / elapsed) : 0.0,
+             (NumAcks > 0) ? (AckTimeSum * 1000.0 / NumAcks) : 0.0,
+             (statsPtr->samples > 0) ? ((double)statsPtr->payloadBytes / statsPtr->samples) : 0.0,
+             wire,
+             overhead);
+
+    fprintf(stdout, "%s\n", line);
+    fflush(stdout);
+
+    if (OutputFile != NULL)
+    {
+        fprintf(OutputFile, "%s\n", line);
+        fflush(OutputFile);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * End the current run: report it and start the next one, or exit after the last.
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndRun
+(
+    void
+)
+{
+    le_timer_Stop(TimeoutTimer);
+
+    uplink_Stats_t stats;
+    Transport->getStats(&stats);
+    stats.pushes -= StatsAtStart.pushes;
+    stats.samples -= StatsAtStart.samples;
+    stats.payloadBytes -= StatsAtStart.payloadBytes;
+    if (stats.wireBytes >= 0)
+    {
+        stats.wireBytes -= StatsAtStart.wireBytes;
+    }
+
+    uint64_t acked = 0;
+    for (int s = 0; s < NumStreams; s++)
+    {
+        acked += Streams[s].next;
+    }
+
+    if (acked < ((uint64_t)NumSamples * NumStreams))
+    {
+        IsAnyRunFailed = true;
+    }
+
+    le_clk_Time_t elapsed = le_clk_Sub(le_clk_GetRelativeTime(), RunStart);
+
+    Report(TransportNames[TransportIndex],
+           acked,
+           &stats,
+           elapsed.sec + (elapsed.usec / 1000000.0));
+
+    TransportIndex++;
+    le_event_QueueFunction(StartRun, NULL, NULL);
+}
+
+
+static void HandlePushComplete(bool isSuccess, void* contextPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a stream's next push, if it has samples left.
+ *
+ * @return true if a push is in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool PushNext
+(
+    Stream_t* streamPtr
+)
+{
+    size_t remaining = NumSamples - streamPtr->next;
+    size_t maxBatch = Transport->getMaxBatch();
+    size_t numPushed = 0;
+
+    if ((remaining == 0) || streamPtr->isStalled)
+    {
+        return false;
+    }
+
+    le_result_t result = Transport->push(&streamPtr->uplink,
+                                         streamPtr->samplesPtr + streamPtr->next,
+                                         (remaining < maxBatch) ? remaining : maxBatch,
+                                         &numPushed,
+                                         HandlePushComplete,
+                                         streamPtr);
+    if (result != LE_OK)
+    {
+        LE_ERROR("%s push failed to start (%s).", Transport->name, LE_RESULT_TXT(result));
+        streamPtr->isStalled = true;
+        return false;
+    }
+
+    streamPtr->numInPush = numPushed;
+    streamPtr->pushStart = le_clk_GetRelativeTime();
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * End the run if no stream has a push in progress.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CheckDone
+(
+    void
+)
+{
+    for (int s = 0; s < NumStreams; s++)
+    {
+        if (Streams[s].numInPush > 0)
+        {
+            return;
+        }
+    }
+
+    EndRun();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push completion handler: advance the stream, or retry the push if it failed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePushComplete
+(
+    bool isSuccess,
+    void* contextPtr    ///< Stream_t
+)
+{
+    Stream_t* streamPtr = contextPtr;
+
+    if (isSuccess)
+    {
+        le_clk_Time_t ackTime = le_clk_Sub(le_clk_GetRelativeTime(), streamPtr->pushStart);
+
+        NumAcks++;
+        AckTimeSum += ackTime.sec + (ackTime.usec / 1000000.0);
+        streamPtr->next += streamPtr->numInPush;
+    }
+    else
+    {
+        FailedPushes++;
+    }
+
+    streamPtr->numInPush = 0;
+
+    if (!PushNext(streamPtr))
+    {
+        CheckDone();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run timeout handler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTimeout
+(
+    le_timer_Ref_t timer
+)
+{
+    LE_ERROR("%s run timed out.", TransportNames[TransportIndex]);
+
+    // Pushes still in progress would complete into the next run's streams, so stop here.
+    EndRun();
+    TransportIndex = NumTransports;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the run through the next transport, or exit if all have run.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartRun
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    if (TransportIndex >= NumTransports)
+    {
+        exit(IsAnyRunFailed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    const char* name = TransportNames[TransportIndex];
+    const uplink_Transport_t* transportPtr = uplink_FindTransport(name);
+    LE_FATAL_IF(transportPtr == NULL, "Unknown transport '%s'.", name);
+
+    le_result_t result = transportPtr->start();
+    if (result != LE_OK)
+    {
+        LE_ERROR("Couldn't start %s uplink (%s).", name, LE_RESULT_TXT(result));
+        IsAnyRunFailed = true;
+        TransportIndex++;
+        le_event_QueueFunction(StartRun, NULL, NULL);
+        return;
+    }
+
+    Transport = transportPtr;
+    Transport->getStats(&StatsAtStart);
+    FailedPushes = 0;
+    NumAcks = 0;
+    AckTimeSum = 0.0;
+    RunStart = le_clk_GetRelativeTime();
+
+    le_timer_Start(TimeoutTimer);
+
+    for (int s = 0; s < NumStreams; s++)
+    {
+        Stream_t* streamPtr = &Streams[s];
+
+        uplink_InitSensor(&streamPtr->uplink, ModelPtr);
+        Transport->addSensor(&streamPtr->uplink);
+        streamPtr->next = 0;
+        streamPtr->numInPush = 0;
+        streamPtr->isStalled = false;
+    }
+
+    for (int s = 0; s < NumStreams; s++)
+    {
+        PushNext(&Streams[s]);
+    }
+
+    CheckDone();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Positional argument handler: a transport to run.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTransportArg
+(
+    const char* arg
+)
+{
+    LE_FATAL_IF(NumTransports >= MAX_TRANSPORTS, "Too many transports.");
+
+    TransportNames[NumTransports++] = arg;
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetStringVar(&SensorName, NULL, "sensor");
+    le_arg_SetIntVar(&NumSamples, NULL, "samples");
+    le_arg_SetIntVar(&NumStreams, NULL, "streams");
+    le_arg_SetIntVar(&Timeout, NULL, "timeout");
+    le_arg_SetStringVar(&OutputPath, NULL, "output");
+    le_arg_AddPositionalCallback(HandleTransportArg);
+    le_arg_AllowMorePositionalArgsThanCallbacks();
+    le_arg_Scan();
+
+    LE_FATAL_IF(NumTransports == 0, "No transport given.");
+    LE_FATAL_IF((NumSamples <= 0) || (NumStreams <= 0) || (NumStreams > MAX_STREAMS)
+                || (Timeout <= 0),
+                "Invalid load parameters.");
+
+    for (size_t i = 0; i < MODEL_NUM_SENSORS; i++)
+    {
+        if (strcmp(Model_Sensors[i].name, SensorName) == 0)
+        {
+            ModelPtr = &Model_Sensors[i];
+        }
+    }
+    LE_FATAL_IF(ModelPtr == NULL, "Unknown sensor '%s'.", SensorName);
+
+    if (OutputPath != NULL)
+    {
+        OutputFile = fopen(OutputPath, "a");
+        LE_FATAL_IF(OutputFile == NULL, "Couldn't open '%s' - %m", OutputPath);
+    }
+
+    Synthesize();
+
+    TimeoutTimer = le_timer_Create("UplinkLoadTimeout");
+    le_timer_SetHandler(TimeoutTimer, HandleTimeout);
+    le_timer_SetMsInterval(TimeoutTimer, (uint32_t)Timeout * 1000);
+
+    le_event_QueueFunction(StartRun, NULL, NULL);
+}
@@ -0,0 +1,218 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file motionDetectorTest.c
+ *
+ * Unit tests of the shock and free-fall detector (see motionDetector.h), on synthetic
+ * accelerometer samples at 100 Hz.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "motionDetector.h"
+
+
+#define SAMPLE_PERIOD 0.01 // seconds
+
+#define G MOTION_STANDARD_GRAVITY
+
+
+static const motion_Config_t Config = {
+    .shockThreshold=1.5,
+    .freeFallThreshold=0.3,
+    .freeFallMinDuration=0.1,
+};
+
+static motion_Detector_t Detector;
+
+/// Events reported since the detector was initialized.
+static motion_Event_t Events[16];
+static size_t NumEvents;
+
+/// Time of the next sample (seconds).
+static double Now;
+
+
+static void HandleEvent
+(
+    const motion_Event_t* eventPtr,
+    void* contextPtr
+)
+{
+    if (NumEvents < NUM_ARRAY_MEMBERS(Events))
+    {
+        Events[NumEvents] = *eventPtr;
+    }
+    NumEvents++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start again with a detector that hasn't seen a sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Reset
+(
+    void
+)
+{
+    motion_Init(&Detector, &Config, HandleEvent, NULL);
+    NumEvents = 0;
+    Now = 1.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add samples of a constant acceleration for a duration.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddConstant
+(
+    double duration,
+    double x,
+    double y,
+    double z
+)
+{
+    for (double end = Now + duration; Now < end; Now += SAMPLE_PERIOD)
+    {
+        motion_Add(&Detector, Now, x, y, z);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turn the board over, about its x axis, in a given time.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddFlip
+(
+    double duration
+)
+{
+    for (double start = Now; Now < (start + duration); Now += SAMPLE_PERIOD)
+    {
+        double angle = M_PI * (Now - start) / duration;
+
+        motion_Add(&Detector, Now, 0.0, G * sin(angle), G * cos(angle));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A short impact is one shock.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestShock
+(
+    void
+)
+{
+    Reset();
+    AddConstant(10.0, 0.0, 0.0, G);
+    AddConstant(0.02, 3.0 * G, 0.0, G);
+    AddConstant(1.0, 0.0, 0.0, G);
+
+    LE_TEST(NumEvents == 1);
+    LE_TEST(Events[0].type == MOTION_EVENT_SHOCK);
+    LE_TEST(fabs(Events[0].peak - 3.0) < 0.1);
+    LE_TEST(Events[0].axis == 1);
+    LE_TEST(motion_IsIdle(&Detector));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turning the board over doesn't leave the detector in a shock: it ends within MOTION_MAX_SHOCK,
+ * and the board at rest upside down is then idle, with no more events.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestFlip
+(
+    void
+)
+{
+    Reset();
+    AddConstant(10.0, 0.0, 0.0, G);
+    AddFlip(0.3);
+    AddConstant(MOTION_MAX_SHOCK + 0.1, 0.0, 0.0, -G);
+
+    LE_TEST(motion_IsIdle(&Detector));
+    LE_TEST(NumEvents <= 1);
+    LE_TEST((NumEvents == 0) || (Events[0].type == MOTION_EVENT_SHOCK));
+
+    size_t numEvents = NumEvents;
+    AddConstant(60.0, 0.0, 0.0, -G);
+
+    LE_TEST(motion_IsIdle(&Detector));
+    LE_TEST(NumEvents == numEvents);
+
+    // Shocks are still detected upside down.
+    AddConstant(0.02, 0.0, 3.0 * G, -G);
+    AddConstant(1.0, 0.0, 0.0, -G);
+
+    LE_TEST(NumEvents == (numEvents + 1));
+    LE_TEST(Events[numEvents].type == MOTION_EVENT_SHOCK);
+    LE_TEST(Events[numEvents].axis == 2);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * After a gap in the samples in which the board was turned over, gravity starts again from the
+ * first sample, so there is no shock.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestGap
+(
+    void
+)
+{
+    Reset();
+    AddConstant(10.0, 0.0, 0.0, G);
+    Now += 5.0;
+    AddConstant(10.0, 0.0, 0.0, -G);
+
+    LE_TEST(NumEvents == 0);
+    LE_TEST(motion_IsIdle(&Detector));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A drop is one free fall.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestFreeFall
+(
+    void
+)
+{
+    Reset();
+    AddConstant(10.0, 0.0, 0.0, G);
+    AddConstant(0.3, 0.0, 0.0, 0.05 * G);
+    AddConstant(1.0, 0.0, 0.0, G);
+
+    LE_TEST(NumEvents == 1);
+    LE_TEST(Events[0].type == MOTION_EVENT_FREE_FALL);
+    LE_TEST(Events[0].duration >= Config.freeFallMinDuration);
+    LE_TEST(motion_IsIdle(&Detector));
+}
+
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    TestShock();
+    TestFlip();
+    TestGap();
+    TestFreeFall();
+
+    LE_TEST_EXIT;
+}
@@ -0,0 +1,327 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file mqttUplinkTest.c
+ *
+ * Unit tests of the MQTT uplink transport (see components/uplink/mqttUplink.c), against a minimal
+ * broker on a loopback socket.
+ *
+ * The broker resets the connection once the uplink is connected, and a sample is pushed before
+ * the uplink has noticed, so that writing the publish is what drops the connection.  The publish
+ * must then be sent after the reconnect, and its push complete.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "uplink.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+#define SETTLE_MS 200       // for the uplink to handle the CONNACK
+#define TIMEOUT_MS 10000    // for the push to complete, reconnect included
+
+// MQTT 3.1.1 control packet types.
+#define MQTT_CONNECT    0x10
+#define MQTT_PUBLISH    0x30
+#define MQTT_PINGREQ    0xc0
+
+
+static const uplink_Transport_t* Transport;
+static uplink_Sensor_t Sensor;
+
+static int ListenSocket = -1;
+static int BrokerSocket = -1;
+static le_fdMonitor_Ref_t BrokerMonitor = NULL;
+
+static uint8_t RxBuff[8 * 1024];
+static size_t RxLen = 0;
+
+static int NumConnects = 0;     ///< CONNECTs received by the broker.
+static int NumPublishes = 0;    ///< PUBLISHes received by the broker.
+
+static le_timer_Ref_t ResetTimer;
+static le_timer_Ref_t TimeoutTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a packet from the broker, ignoring failures (the test times out).
+ */
+//--------------------------------------------------------------------------------------------------
+static void BrokerSend
+(
+    const uint8_t* packetPtr,
+    size_t len
+)
+{
+    if (send(BrokerSocket, packetPtr, len, MSG_NOSIGNAL) != (ssize_t)len)
+    {
+        LE_WARN("Broker send failed - %m");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the broker's end of the connection.  With reset set, the connection is reset (RST)
+ * rather than shut down, so that the uplink's next write fails.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BrokerClose
+(
+    bool reset
+)
+{
+    if (reset)
+    {
+        struct linger linger = { .l_onoff=1, .l_linger=0 };
+        setsockopt(BrokerSocket, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    }
+
+    le_fdMonitor_Delete(BrokerMonitor);
+    BrokerMonitor = NULL;
+    close(BrokerSocket);
+    BrokerSocket = -1;
+    RxLen = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a packet received by the broker.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBrokerPacket
+(
+    uint8_t type,
+    const uint8_t* bodyPtr,
+    size_t bodyLen
+)
+{
+    switch (type & 0xf0)
+    {
+        case MQTT_CONNECT:
+        {
+            static const uint8_t ConnAck[] = { 0x20, 2, 0, 0 };
+
+            NumConnects++;
+            BrokerSend(ConnAck, sizeof(ConnAck));
+
+            if (NumConnects == 1)
+            {
+                le_timer_Start(ResetTimer);
+            }
+            break;
+        }
+
+        case MQTT_PUBLISH:
+        {
+            // The packet ID follows the topic.
+            size_t topicLen = ((size_t)bodyPtr[0] << 8) | bodyPtr[1];
+            uint8_t pubAck[] = { 0x40, 2, bodyPtr[2 + topicLen], bodyPtr[3 + topicLen] };
+
+            NumPublishes++;
+            BrokerSend(pubAck, sizeof(pubAck));
+            break;
+        }
+
+        case MQTT_PINGREQ:
+        {
+            static const uint8_t PingResp[] = { 0xd0, 0 };
+
+            BrokerSend(PingResp, sizeof(PingResp));
+            break;
+        }
+
+        default:
+
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle events on the broker's end of the connection.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBrokerSocket
+(
+    int fd,
+    short events
+)
+{
+    ssize_t n = recv(fd, RxBuff + RxLen, sizeof(RxBuff) - RxLen, 0);
+    if (n <= 0)
+    {
+        if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+        {
+            return;
+        }
+        BrokerClose(false);
+        return;
+    }
+    RxLen += n;
+
+    for (;;)
+    {
+        size_t bodyLen = 0;
+        size_t headerLen = 1;
+        bool isLengthComplete = false;
+
+        while ((headerLen < RxLen) && (headerLen <= 4))
+        {
+            uint8_t byte = RxBuff[headerLen];
+            bodyLen |= (size_t)(byte & 0x7f) << (7 * (headerLen - 1));
+            headerLen++;
+            if ((byte & 0x80) == 0)
+            {
+                isLengthComplete = true;
+                break;
+            }
+        }
+
+        if (!isLengthComplete || ((headerLen + bodyLen) > RxLen))
+        {
+            return;
+        }
+
+        HandleBrokerPacket(RxBuff[0], RxBuff + headerLen, bodyLen);
+        if (BrokerSocket < 0)
+        {
+            return;
+        }
+
+        RxLen -= headerLen + bodyLen;
+        memmove(RxBuff, RxBuff + headerLen + bodyLen, RxLen);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Accept the uplink's connection to the broker.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleListenSocket
+(
+    int fd,
+    short events
+)
+{
+    int connSocket = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (connSocket < 0)
+    {
+        return;
+    }
+
+    LE_TEST(BrokerSocket < 0);
+    if (BrokerSocket >= 0)
+    {
+        BrokerClose(false);
+    }
+
+    BrokerSocket = connSocket;
+    BrokerMonitor = le_fdMonitor_Create("testBroker", connSocket, HandleBrokerSocket, POLLIN);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push completion callback: the publish reached the broker after the reconnect.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandlePushComplete
+(
+    bool isSuccess,
+    void* contextPtr
+)
+{
+    LE_TEST(isSuccess);
+    LE_TEST(NumConnects == 2);
+    LE_TEST(NumPublishes == 1);
+
+    LE_TEST_EXIT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reset the connection, and push a sample before the uplink has seen the reset.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleResetTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    uplink_Sample_t sample = { .timestamp=1500000000.0, .values={ 42.0 }, .seq=1 };
+    size_t numPushed = 0;
+
+    BrokerClose(true);
+
+    LE_TEST(Transport->push(&Sensor, &sample, 1, &numPushed, HandlePushComplete, NULL) == LE_OK);
+    LE_TEST(numPushed == 1);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * The push never completed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTimeoutTimer
+(
+    le_timer_Ref_t timer
+)
+{
+    LE_TEST(false);
+    LE_INFO("Push not completed: %d connects, %d publishes.", NumConnects, NumPublishes);
+
+    LE_TEST_EXIT;
+}
+
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    // Broker on an ephemeral loopback port.
+    struct sockaddr_in addr = {
+        .sin_family=AF_INET,
+        .sin_port=0,
+        .sin_addr.s_addr=htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrLen = sizeof(addr);
+
+    ListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    LE_ASSERT(ListenSocket >= 0);
+    LE_ASSERT(bind(ListenSocket, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    LE_ASSERT(listen(ListenSocket, 1) == 0);
+    LE_ASSERT(getsockname(ListenSocket, (struct sockaddr*)&addr, &addrLen) == 0);
+    le_fdMonitor_Create("testListen", ListenSocket, HandleListenSocket, POLLIN);
+
+    char broker[32];
+    snprintf(broker, sizeof(broker), "127.0.0.1:%u", ntohs(addr.sin_port));
+    setenv("MQTT_BROKER", broker, 1);
+
+    ResetTimer = le_timer_Create("testReset");
+    le_timer_SetHandler(ResetTimer, HandleResetTimer);
+    le_timer_SetMsInterval(ResetTimer, SETTLE_MS);
+
+    TimeoutTimer = le_timer_Create("testTimeout");
+    le_timer_SetHandler(TimeoutTimer, HandleTimeoutTimer);
+    le_timer_SetMsInterval(TimeoutTimer, TIMEOUT_MS);
+    le_timer_Start(TimeoutTimer);
+
+    Transport = uplink_FindTransport("mqtt");
+    LE_ASSERT(Transport != NULL);
+    LE_ASSERT(Transport->start() == LE_OK);
+
+    uplink_InitSensor(&Sensor, &Model_Sensors[MODEL_SENSOR_LIGHT]);
+    Transport->addSensor(&Sensor);
+}
@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pushTrackerTest.c
+ *
+ * Unit tests of the push tracker (see pushTracker.h), with a backend whose pushes complete when
+ * the test says so.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pushTracker.h"
+
+
+/// Samples buffered by the fake Data Hub observation, oldest first.
+static double BufferedTimestamps[16];
+static double BufferedValues[16];
+static size_t NumBuffered;
+
+/// Pushes started by the backend.
+static size_t NumPushes;
+static double PushedTimestamp;
+static double PushedValue;
+
+static tracker_Sensor_t Sensor;
+
+
+static le_result_t PushNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    double value
+)
+{
+    NumPushes++;
+    PushedTimestamp = timestamp;
+    PushedValue = value;
+
+    return LE_OK;
+}
+
+
+static le_result_t PushJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double timestamp,
+    const char* value
+)
+{
+    return LE_FAULT;
+}
+
+
+static le_result_t ReadBacklogNumeric
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    double* valuePtr
+)
+{
+    for (size_t i = 0; i < NumBuffered; i++)
+    {
+        if (BufferedTimestamps[i] > startAfter)
+        {
+            *timestampPtr = BufferedTimestamps[i];
+            *valuePtr = BufferedValues[i];
+            return LE_OK;
+        }
+    }
+
+    return LE_NOT_FOUND;
+}
+
+
+static le_result_t ReadBacklogJson
+(
+    tracker_Sensor_t* sensorPtr,
+    double startAfter,
+    double* timestampPtr,
+    char* valuePtr,
+    size_t valueSize
+)
+{
+    return LE_NOT_FOUND;
+}
+
+
+static const tracker_Backend_t Backend = {
+    .pushNumeric=PushNumeric,
+    .pushJson=PushJson,
+    .readBacklogNumeric=ReadBacklogNumeric,
+    .readBacklogJson=ReadBacklogJson,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start again with a sensor that has nothing buffered or delivered.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Reset
+(
+    void
+)
+{
+    memset(&Sensor, 0, sizeof(Sensor));
+    Sensor.obsPath = "/obs/test";
+    Sensor.backendPtr = &Backend;
+    Sensor.state = TRACKER_STATE_IDLE;
+
+    NumBuffered = 0;
+    NumPushes = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Buffer a sample and pass it to the tracker, as the Data Hub does.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Update
+(
+    double timestamp,
+    double value
+)
+{
+    LE_ASSERT(NumBuffered < NUM_ARRAY_MEMBERS(BufferedTimestamps));
+
+    BufferedTimestamps[NumBuffered] = timestamp;
+    BufferedValues[NumBuffered] = value;
+    NumBuffered++;
+
+    tracker_HandleNumericUpdate(&Sensor, timestamp, value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Samples are pushed as they arrive, and those arriving during a push follow it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestUpdates
+(
+    void
+)
+{
+    Reset();
+
+    Update(10.0, 1.0);
+    LE_TEST(NumPushes == 1);
+    LE_TEST(Sensor.state == TRACKER_STATE_PUSHING);
+
+    Update(11.0, 2.0);
+    LE_TEST(NumPushes == 1);
+    LE_TEST(Sensor.state == TRACKER_STATE_BACKLOGGED);
+
+    tracker_HandlePushComplete(&Sensor, true);
+    LE_TEST(NumPushes == 2);
+    LE_TEST(PushedTimestamp == 11.0);
+
+    tracker_HandlePushComplete(&Sensor, true);
+    LE_TEST(Sensor.state == TRACKER_STATE_IDLE);
+    LE_TEST(tracker_IsDelivered(&Sensor, 10.0));
+    LE_TEST(tracker_IsDelivered(&Sensor, 11.0));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A sample reported again (e.g., at pmax) while a push is in progress is left alone, rather than
+ * recorded as delivered without being pushed.  Once the sensor is idle, it is pushed right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRepeat
+(
+    void
+)
+{
+    Reset();
+
+    Update(10.0, 1.0);
+    LE_TEST(NumPushes == 1);
+
+    LE_TEST(!tracker_RepeatNumeric(&Sensor, 20.0, 1.0));
+    LE_TEST(NumPushes == 1);
+    LE_TEST(Sensor.state == TRACKER_STATE_PUSHING);
+
+    tracker_HandlePushComplete(&Sensor, true);
+    LE_TEST(NumPushes == 1);
+    LE_TEST(Sensor.state == TRACKER_STATE_IDLE);
+    LE_TEST(!tracker_IsDelivered(&Sensor, 20.0));
+
+    LE_TEST(tracker_RepeatNumeric(&Sensor, 30.0, 1.0));
+    LE_TEST(NumPushes == 2);
+    LE_TEST(PushedTimestamp == 30.0);
+    LE_TEST(PushedValue == 1.0);
+
+    tracker_HandlePushComplete(&Sensor, true);
+    LE_TEST(Sensor.state == TRACKER_STATE_IDLE);
+    LE_TEST(tracker_IsDelivered(&Sensor, 30.0));
+
+    // The next sample only covers itself.
+    Update(40.0, 2.0);
+    LE_TEST(NumPushes == 3);
+    LE_TEST(PushedTimestamp == 40.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * A held sensor reports again right away when it has nothing waiting, and not while it does.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRepeatHeld
+(
+    void
+)
+{
+    Reset();
+    Sensor.isHeld = true;
+
+    LE_TEST(tracker_RepeatNumeric(&Sensor, 10.0, 1.0));
+    LE_TEST(NumPushes == 1);
+    tracker_HandlePushComplete(&Sensor, true);
+    LE_TEST(Sensor.state == TRACKER_STATE_IDLE);
+
+    Update(20.0, 2.0);
+    LE_TEST(Sensor.state == TRACKER_STATE_HELD);
+    LE_TEST(!tracker_RepeatNumeric(&Sensor, 30.0, 2.0));
+    LE_TEST(NumPushes == 1);
+
+    tracker_Flush(&Sensor);
+    LE_TEST(NumPushes == 2);
+    LE_TEST(PushedTimestamp == 20.0);
+}
+
+
+COMPONENT_INIT
+{
+    LE_TEST_INIT;
+
+    TestUpdates();
+    TestRepeat();
+    TestRepeatHeld();
+
+    LE_TEST_EXIT;
+}
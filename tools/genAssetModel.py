@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+#
+# Generates the cloud publisher's asset model descriptor header (assetModel.h) from the
+# AirVantage application model (.app XML) and the sensor map (sensorMap.txt).
+#
+# The sensor map lists, for each sensor, the sample members that are published and the resource
+# each one is published to.  Every resource must be a variable of the .app model (its type is
+# taken from the model) or a resource of a supported standard LwM2M object.
+#
+# Usage: genAssetModel.py --app APP_FILE --map MAP_FILE --output HEADER [--check]
+#
+# With --check, nothing is written; the exit code is non-zero if HEADER is not what would have
+# been generated (i.e., the model or map changed and the header wasn't regenerated).
+#
+# Copyright (C) Sierra Wireless Inc.
+#
+
+import argparse
+import os
+import sys
+import xml.etree.ElementTree as ElementTree
+
+
+# Types of the resources of the standard LwM2M objects samples may be published to, by
+# (object ID, resource ID).
+LWM2M_RESOURCE_TYPES = {
+    # Location object.
+    ('6', '0'): 'double',   # Latitude
+    ('6', '1'): 'double',   # Longitude
+    ('6', '2'): 'double',   # Altitude
+    ('6', '3'): 'double',   # Radius
+    ('6', '6'): 'double',   # Speed
+}
+
+# C enum member for each supported model type.
+C_TYPES = {
+    'int': 'MODEL_TYPE_INT',
+    'double': 'MODEL_TYPE_DOUBLE',
+}
+
+
+class ModelError(Exception):
+    pass
+
+
+def load_model_variables(app_path):
+    """Return a dict mapping the path of every variable in the model to its type."""
+
+    variables = {}
+
+    def walk(element, prefix):
+        for child in element:
+            tag = child.tag.split('}')[-1]
+            if tag == 'node':
+                walk(child, prefix + child.get('path') + '.')
+            elif tag == 'variable':
+                variables[prefix + child.get('path')] = child.get('type')
+
+    root = ElementTree.parse(app_path).getroot()
+    assets = [e for e in root.iter() if e.tag.split('}')[-1] == 'asset']
+    if not assets:
+        raise ModelError('%s: no asset found' % app_path)
+
+    for asset in assets:
+        walk(asset, asset.get('id') + '.')
+
+    return variables
+
+
+def resource_type(path, variables):
+    """Return the type of a resource, or raise ModelError if the resource isn't known."""
+
+    if path in variables:
+        return variables[path]
+
+    parts = path.split('.')
+    if (len(parts) == 4) and (parts[0] == 'lwm2m'):
+        key = (parts[1], parts[3])
+        if key in LWM2M_RESOURCE_TYPES:
+            return LWM2M_RESOURCE_TYPES[key]
+
+    raise ModelError("'%s' is not a variable of the asset model or a supported LwM2M resource"
+                     % path)
+
+
+def load_sensor_map(map_path, variables):
+    """Return a list of (sensor, is_json, [(member, path, type)]) in map order."""
+
+    sensors = []
+    by_name = {}
+
+    with open(map_path) as f:
+        for line_num, line in enumerate(f, 1):
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+
+            where = '%s:%d' % (map_path, line_num)
+
+            fields = line.split()
+            if len(fields) != 3:
+                raise ModelError('%s: expected <sensor> <member> <path>' % where)
+            name, member, path = fields
+
+            try:
+                field_type = resource_type(path, variables)
+            except ModelError as e:
+                raise ModelError('%s: %s' % (where, e))
+
+            if field_type not in C_TYPES:
+                raise ModelError("%s: type '%s' of '%s' can't carry a sensor sample"
+                                 % (where, field_type, path))
+
+            is_json = (member != '-')
+
+            if name not in by_name:
+                by_name[name] = (name, is_json, [])
+                sensors.append(by_name[name])
+            elif by_name[name][1] != is_json:
+                raise ModelError("%s: sensor '%s' mixes numeric and JSON fields" % (where, name))
+            elif not is_json:
+                raise ModelError("%s: numeric sensor '%s' can only have one field" % (where, name))
+
+            by_name[name][2].append((member if is_json else None, path, field_type))
+
+    return sensors
+
+
+def c_identifier(name):
+    return name[0].upper() + name[1:]
+
+
+def generate(app_path, map_path, sensors):
+    app_name = os.path.basename(app_path)
+    map_name = os.path.basename(map_path)
+
+    out = []
+    out.append('//' + '-' * 98)
+    out.append('/**')
+    out.append(' * @file assetModel.h')
+    out.append(' *')
+    out.append(' * Descriptors of the sensor data published to AirVantage: for each sensor, the')
+    out.append(' * sample members published, and the resource path and type each is published as.')
+    out.append(' *')
+    out.append(' * GENERATED by tools/genAssetModel.py from')
+    out.append(' * %s and %s.  DO NOT EDIT.' % (app_name, map_name))
+    out.append(' *')
+    out.append(' * Copyright (C) Sierra Wireless Inc.')
+    out.append(' */')
+    out.append('//' + '-' * 98)
+    out.append('')
+    out.append('#ifndef ASSET_MODEL_H_INCLUDE_GUARD')
+    out.append('#define ASSET_MODEL_H_INCLUDE_GUARD')
+    out.append('')
+    out.append('')
+    out.append('/// Type of an AirVantage resource.')
+    out.append('typedef enum')
+    out.append('{')
+    out.append('    MODEL_TYPE_INT,')
+    out.append('    MODEL_TYPE_DOUBLE,')
+    out.append('}')
+    out.append('model_Type_t;')
+    out.append('')
+    out.append('')
+    out.append('/// A sensor sample member and the resource it is published to.')
+    out.append('typedef struct')
+    out.append('{')
+    out.append('    const char* member; ///< JSON member name, or NULL if the sample is numeric.')
+    out.append('    const char* path;   ///< AirVantage resource path.')
+    out.append('    model_Type_t type;  ///< Type of the resource.')
+    out.append('}')
+    out.append('model_Field_t;')
+    out.append('')
+    out.append('')
+    out.append('/// A sensor whose samples are published.')
+    out.append('typedef struct')
+    out.append('{')
+    out.append('    const char* name;')
+    out.append('    bool isJson;                ///< true if samples are JSON, false if numeric.')
+    out.append('    size_t numFields;')
+    out.append('    const model_Field_t* fields;')
+    out.append('}')
+    out.append('model_Sensor_t;')
+    out.append('')
+    out.append('')
+    out.append('/// Sensor identifiers (indices into Model_Sensors).')
+    out.append('typedef enum')
+    out.append('{')
+    for name, _, _ in sensors:
+        out.append('    MODEL_SENSOR_%s,' % name.upper())
+    out.append('    MODEL_NUM_SENSORS')
+    out.append('}')
+    out.append('model_SensorId_t;')
+    out.append('')
+    out.append('/// Largest number of fields of any sensor.')
+    out.append('#define MODEL_MAX_FIELDS %d' % max(len(fields) for _, _, fields in sensors))
+    out.append('')
+    out.append('')
+    for name, _, fields in sensors:
+        out.append('static const model_Field_t Model_%sFields[] =' % c_identifier(name))
+        out.append('{')
+        for member, path, field_type in fields:
+            member_text = ('"%s"' % member) if member is not None else 'NULL'
+            out.append('    { %s, "%s", %s },' % (member_text, path, C_TYPES[field_type]))
+        out.append('};')
+        out.append('')
+    out.append('static const model_Sensor_t Model_Sensors[MODEL_NUM_SENSORS] =')
+    out.append('{')
+    for name, is_json, fields in sensors:
+        out.append('    [MODEL_SENSOR_%s] = { "%s", %s, %d, Model_%sFields },'
+                   % (name.upper(), name, 'true' if is_json else 'false', len(fields),
+                      c_identifier(name)))
+    out.append('};')
+    out.append('')
+    out.append('')
+    out.append('#endif // ASSET_MODEL_H_INCLUDE_GUARD')
+
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Generate the asset model descriptor header.')
+    parser.add_argument('--app', required=True, help='AirVantage application model (.app)')
+    parser.add_argument('--map', required=True, help='sensor map file')
+    parser.add_argument('--output', required=True, help='header file to generate')
+    parser.add_argument('--check', action='store_true',
+                        help='only check that the header is up to date')
+    args = parser.parse_args()
+
+    try:
+        variables = load_model_variables(args.app)
+        sensors = load_sensor_map(args.map, variables)
+    except (ModelError, ElementTree.ParseError, OSError) as e:
+        sys.stderr.write('genAssetModel: %s\n' % e)
+        return 1
+
+    text = generate(args.app, args.map, sensors)
+
+    if args.check:
+        try:
+            with open(args.output) as f:
+                current = f.read()
+        except OSError:
+            current = None
+        if current != text:
+            sys.stderr.write('genAssetModel: %s is out of date with %s / %s; regenerate it with\n'
+                             '    %s --app %s --map %s --output %s\n'
+                             % (args.output, args.app, args.map, sys.argv[0], args.app,
+                                args.map, args.output))
+            return 1
+        return 0
+
+    with open(args.output, 'w') as f:
+        f.write(text)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())